@@ -0,0 +1,174 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BenchmarkData.cpp
+ * @brief  Fixtures shared by the benchmarks, built from tests/data.
+ * @author Antoni Rosinol
+ */
+
+#include "BenchmarkData.h"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "UtilsOpenCV.h"
+
+DECLARE_string(benchmark_data_path);
+
+namespace VIO {
+
+namespace benchmarks {
+
+namespace {
+
+// Consecutive EuRoC frames, 20Hz.
+const std::array<Timestamp, 2> kFrameTimestamps = {0, 50000000};
+const Timestamp kImuPeriod = 5000000;  // 200Hz.
+
+cv::Mat ReadImage(const std::string& path, double scale) {
+  VioFrontEndParams tp;  // only to get the default stereo matching params
+  cv::Mat img = UtilsOpenCV::ReadAndConvertToGrayScale(
+      path, tp.getStereoMatchingParams().equalize_image_);
+  CHECK(!img.empty()) << "Could not read image: " << path;
+  if (scale == 1.0) return img;
+  cv::Mat resized_img;
+  cv::resize(img, resized_img, cv::Size(), scale, scale, cv::INTER_AREA);
+  return resized_img;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+const StereoData& GetStereoData(int resolution_percent) {
+  static std::mutex mutex;
+  static std::map<int, std::unique_ptr<StereoData>> stereo_data;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<StereoData>& data = stereo_data[resolution_percent];
+  if (data) return *data;
+
+  CHECK_GT(resolution_percent, 0);
+  const double scale = resolution_percent / 100.0;
+  const std::string path = FLAGS_benchmark_data_path + "/ForStereoFrame/";
+  data.reset(new StereoData());
+  CameraParams cam_params_left, cam_params_right;
+  cam_params_left.parseYAML(path + "sensorLeft.yaml");
+  cam_params_right.parseYAML(path + "sensorRight.yaml");
+  data->cam_params_left_ = ScaleCameraParams(cam_params_left, scale);
+  data->cam_params_right_ = ScaleCameraParams(cam_params_right, scale);
+  data->camL_Pose_camR_ =
+      cam_params_left.body_Pose_cam_.between(cam_params_right.body_Pose_cam_);
+  for (size_t i = 0u; i < 2u; i++) {
+    data->left_images_[i] =
+        ReadImage(path + "left_img_" + std::to_string(i) + ".png", scale);
+    data->right_images_[i] =
+        ReadImage(path + "right_img_" + std::to_string(i) + ".png", scale);
+  }
+  return *data;
+}
+
+/* -------------------------------------------------------------------------- */
+CameraParams ScaleCameraParams(const CameraParams& cam_params, double scale) {
+  CHECK_GT(scale, 0.0);
+  CameraParams scaled = cam_params;
+  // The distortion acts on normalized coordinates: only the pinhole changes.
+  CHECK_EQ(scaled.intrinsics_.size(), 4u);
+  for (double& intrinsic : scaled.intrinsics_) intrinsic *= scale;
+  scaled.camera_matrix_ = cam_params.camera_matrix_.clone();
+  cv::Mat pinhole_rows = scaled.camera_matrix_.rowRange(0, 2);
+  pinhole_rows *= scale;
+  scaled.image_size_ =
+      cv::Size(std::round(cam_params.image_size_.width * scale),
+               std::round(cam_params.image_size_.height * scale));
+  const gtsam::Cal3DS2& cal = cam_params.calibration_;
+  scaled.calibration_ =
+      gtsam::Cal3DS2(scale * cal.fx(), scale * cal.fy(), scale * cal.skew(),
+                     scale * cal.px(), scale * cal.py(), cal.k1(), cal.k2(),
+                     cal.p1(), cal.p2());
+  return scaled;
+}
+
+/* -------------------------------------------------------------------------- */
+VioFrontEndParams GetFrontEndParams(int nr_features) {
+  VioFrontEndParams tracker_params;
+  tracker_params.maxFeaturesPerFrame_ = nr_features;
+  tracker_params.ransac_randomize_ = false;
+  return tracker_params;
+}
+
+/* -------------------------------------------------------------------------- */
+StereoFrame CreateStereoFrame(const StereoData& data, size_t index,
+                              const VioFrontEndParams& tracker_params) {
+  CHECK_LT(index, 2u);
+  return StereoFrame(index, kFrameTimestamps[index], data.left_images_[index],
+                     data.cam_params_left_, data.right_images_[index],
+                     data.cam_params_right_, data.camL_Pose_camR_,
+                     tracker_params.getStereoMatchingParams());
+}
+
+/* -------------------------------------------------------------------------- */
+void CreateTrackedStereoFrames(const StereoData& data, Tracker* tracker,
+                               std::unique_ptr<StereoFrame>* ref_frame,
+                               std::unique_ptr<StereoFrame>* cur_frame) {
+  CHECK_NOTNULL(tracker);
+  CHECK_NOTNULL(ref_frame);
+  CHECK_NOTNULL(cur_frame);
+  // As in StereoVisionFrontEnd::processFirstStereoFrame.
+  ref_frame->reset(
+      new StereoFrame(CreateStereoFrame(data, 0u, tracker->trackerParams_)));
+  (*ref_frame)->setIsKeyframe(true);
+  tracker->setCamMask((*ref_frame)->getLeftFrame().img_.size());
+  tracker->featureDetection((*ref_frame)->getLeftFrameMutable());
+  (*ref_frame)->sparseStereoMatching();
+
+  // As in StereoVisionFrontEnd::processStereoFrame.
+  cur_frame->reset(
+      new StereoFrame(CreateStereoFrame(data, 1u, tracker->trackerParams_)));
+  (*cur_frame)->cloneRectificationParameters(**ref_frame);
+  tracker->featureTracking((*ref_frame)->getLeftFrameMutable(),
+                           (*cur_frame)->getLeftFrameMutable());
+  (*cur_frame)->setIsKeyframe(true);
+  (*cur_frame)->sparseStereoMatching();
+}
+
+/* -------------------------------------------------------------------------- */
+void CreateImuMeasurements(size_t nr_measurements, ImuStampS* imu_stamps,
+                           ImuAccGyrS* imu_accgyr) {
+  CHECK_NOTNULL(imu_stamps);
+  CHECK_NOTNULL(imu_accgyr);
+  imu_stamps->resize(Eigen::NoChange, nr_measurements);
+  imu_accgyr->resize(Eigen::NoChange, nr_measurements);
+  for (size_t i = 0u; i < nr_measurements; i++) {
+    const double t = i * kImuPeriod * 1e-9;
+    (*imu_stamps)(i) = i * kImuPeriod;
+    imu_accgyr->col(i) << 0.1 * std::sin(t), 0.2 * std::cos(t), 9.81,
+        0.01 * std::cos(t), -0.02 * std::sin(t), 0.03;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void FeaturesAndResolution(::benchmark::internal::Benchmark* benchmark) {
+  CHECK_NOTNULL(benchmark);
+  benchmark->ArgNames({"features", "resolution"});
+  for (const int resolution_percent : {50, 100}) {
+    for (const int nr_features : {100, 300, 1000}) {
+      benchmark->Args({nr_features, resolution_percent});
+    }
+  }
+}
+
+}  // namespace benchmarks
+
+}  // namespace VIO
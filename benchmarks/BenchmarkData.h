@@ -0,0 +1,75 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BenchmarkData.h
+ * @brief  Fixtures shared by the benchmarks, built from tests/data.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "CameraParams.h"
+#include "StereoFrame.h"
+#include "Tracker.h"
+#include "VioFrontEndParams.h"
+#include "imu-frontend/ImuFrontEnd-definitions.h"
+
+namespace VIO {
+
+namespace benchmarks {
+
+// The two stereo pairs of tests/data/ForStereoFrame (EuRoC, 752x480), resized
+// to resolution_percent of the original resolution.
+struct StereoData {
+  CameraParams cam_params_left_;
+  CameraParams cam_params_right_;
+  gtsam::Pose3 camL_Pose_camR_;
+  std::array<cv::Mat, 2> left_images_;
+  std::array<cv::Mat, 2> right_images_;
+};
+
+// The images are only read once per resolution.
+const StereoData& GetStereoData(int resolution_percent);
+
+// Camera of the same calibration, for images resized by the given scale.
+CameraParams ScaleCameraParams(const CameraParams& cam_params, double scale);
+
+// Frontend parameters detecting (at most) nr_features per frame, with
+// deterministic RANSAC.
+VioFrontEndParams GetFrontEndParams(int nr_features);
+
+StereoFrame CreateStereoFrame(const StereoData& data, size_t index,
+                              const VioFrontEndParams& tracker_params);
+
+// The first two frames as the frontend leaves them before the geometric
+// outlier rejection: features detected and stereo matched in the first,
+// tracked and stereo matched in the second.
+void CreateTrackedStereoFrames(const StereoData& data, Tracker* tracker,
+                               std::unique_ptr<StereoFrame>* ref_frame,
+                               std::unique_ptr<StereoFrame>* cur_frame);
+
+// IMU measurements of a smooth motion, at 200Hz from timestamp 0.
+void CreateImuMeasurements(size_t nr_measurements, ImuStampS* imu_stamps,
+                           ImuAccGyrS* imu_accgyr);
+
+// Arguments {nr_features, resolution_percent} of the frontend benchmarks.
+void FeaturesAndResolution(::benchmark::internal::Benchmark* benchmark);
+
+}  // namespace benchmarks
+
+}  // namespace VIO
@@ -0,0 +1,196 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkBackEnd.cpp
+ * @brief  Benchmarks of the IMU preintegration, feature selection and mesher.
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/HessianFactor.h>
+#include <gtsam/linear/JacobianFactor.h>
+
+#include "BenchmarkData.h"
+#include "FeatureSelector.h"
+#include "StereoFrame.h"
+#include "Tracker.h"
+#include "imu-frontend/ImuFrontEnd-definitions.h"
+#include "imu-frontend/ImuFrontEnd.h"
+#include "imu-frontend/ImuFrontEndParams.h"
+#include "mesh/Mesher.h"
+#include "utils/ThreadPool.h"
+
+namespace VIO {
+
+namespace benchmarks {
+
+namespace {
+
+// Dimension of the state of each keyframe in the feature selection
+// (position, velocity, accelerometer bias).
+const size_t kStateDim = 9u;
+
+gtsam::Matrix RandomMatrix(size_t rows, size_t cols, std::mt19937* rng) {
+  CHECK_NOTNULL(rng);
+  std::normal_distribution<double> normal;
+  gtsam::Matrix M(rows, cols);
+  for (size_t i = 0u; i < rows * cols; i++) M(i) = normal(*rng);
+  return M;
+}
+
+// OmegaBar of a horizon of nr_keys keyframes: a prior on the first one, and
+// (IMU) factors between consecutive ones.
+gtsam::GaussianFactorGraph::shared_ptr CreateOmegaBar(size_t nr_keys,
+                                                      std::mt19937* rng) {
+  auto OmegaBar = boost::make_shared<gtsam::GaussianFactorGraph>();
+  OmegaBar->push_back(boost::make_shared<gtsam::JacobianFactor>(
+      0, gtsam::Matrix::Identity(kStateDim, kStateDim),
+      gtsam::Vector::Zero(kStateDim)));
+  for (size_t k = 1u; k < nr_keys; k++) {
+    OmegaBar->push_back(boost::make_shared<gtsam::JacobianFactor>(
+        k - 1u, RandomMatrix(kStateDim, kStateDim, rng), k,
+        gtsam::Matrix::Identity(kStateDim, kStateDim) +
+            0.1 * RandomMatrix(kStateDim, kStateDim, rng),
+        gtsam::Vector::Zero(kStateDim)));
+  }
+  return OmegaBar;
+}
+
+// Delta of a feature seen in all the keyframes of the horizon, with a pixel
+// (2 rows) per keyframe, as created by FeatureSelector::createDeltas.
+std::vector<gtsam::HessianFactor::shared_ptr> CreateDeltas(
+    size_t nr_candidates, size_t nr_keys, std::mt19937* rng) {
+  std::vector<gtsam::HessianFactor::shared_ptr> Deltas;
+  Deltas.reserve(nr_candidates);
+  for (size_t j = 0u; j < nr_candidates; j++) {
+    std::vector<std::pair<gtsam::Key, gtsam::Matrix>> terms;
+    for (size_t k = 0u; k < nr_keys; k++) {
+      terms.emplace_back(k, RandomMatrix(2u * nr_keys, kStateDim, rng));
+    }
+    Deltas.push_back(boost::make_shared<gtsam::HessianFactor>(
+        gtsam::JacobianFactor(terms, gtsam::Vector::Zero(2u * nr_keys))));
+  }
+  return Deltas;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+// Argument: number of IMU measurements (200Hz) between keyframes.
+static void BM_ImuFrontEndPreintegrateImuMeasurements(
+    ::benchmark::State& state) {
+  ImuParams imu_params;
+  imu_params.gyro_noise_ = 1.6968e-4;
+  imu_params.gyro_walk_ = 1.9393e-5;
+  imu_params.acc_noise_ = 2.0e-3;
+  imu_params.acc_walk_ = 3.0e-3;
+  imu_params.imu_shift_ = 0.0;
+  imu_params.n_gravity_ << 0.0, 0.0, -9.81;
+  imu_params.imu_integration_sigma_ = 1.0e-8;
+  ImuFrontEnd imu_frontend(imu_params, ImuBias());
+  ImuStampS imu_stamps;
+  ImuAccGyrS imu_accgyr;
+  CreateImuMeasurements(state.range(0), &imu_stamps, &imu_accgyr);
+  for (auto _ : state) {
+    // As for each keyframe in the frontend.
+    imu_frontend.resetIntegrationWithCachedBias();
+    ::benchmark::DoNotOptimize(
+        imu_frontend.preintegrateImuMeasurements(imu_stamps, imu_accgyr));
+  }
+  state.SetItemsProcessed(state.iterations() * (state.range(0) - 1));
+}
+BENCHMARK(BM_ImuFrontEndPreintegrateImuMeasurements)
+    ->ArgName("measurements")
+    ->Arg(10)
+    ->Arg(40)
+    ->Arg(200)
+    ->Arg(1000);
+
+/* -------------------------------------------------------------------------- */
+// Arguments: {nr_candidates, nr_keys, criterion, nr_threads}, selecting a
+// quarter of the candidates. As featureSelectionNrThreads, nr_threads = 0
+// uses all the cores, and 1 runs sequentially.
+static void BM_FeatureSelectorGreedyAlgorithm(::benchmark::State& state) {
+  const size_t nr_candidates = state.range(0);
+  const size_t nr_keys = state.range(1);
+  const auto criterion =
+      static_cast<VioFrontEndParams::FeatureSelectionCriterion>(
+          state.range(2));
+  utils::ThreadPool thread_pool(state.range(3));
+  std::mt19937 rng(0u);
+  const gtsam::GaussianFactorGraph::shared_ptr OmegaBar =
+      CreateOmegaBar(nr_keys, &rng);
+  const std::vector<gtsam::HessianFactor::shared_ptr> Deltas =
+      CreateDeltas(nr_candidates, nr_keys, &rng);
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(FeatureSelector::GreedyAlgorithm(
+        OmegaBar, Deltas, nr_candidates / 4, criterion, true,
+        &thread_pool));
+  }
+}
+BENCHMARK(BM_FeatureSelectorGreedyAlgorithm)
+    ->ArgNames({"candidates", "keys", "criterion", "threads"})
+    ->Apply([](::benchmark::internal::Benchmark* benchmark) {
+      for (const auto criterion :
+           {VioFrontEndParams::FeatureSelectionCriterion::LOGDET,
+            VioFrontEndParams::FeatureSelectionCriterion::MIN_EIG}) {
+        for (const int nr_keys : {3, 6}) {
+          for (const int nr_candidates : {100, 300}) {
+            for (const int nr_threads : {1, 4, 0}) {
+              benchmark->Args({nr_candidates, nr_keys,
+                               static_cast<int>(criterion), nr_threads});
+            }
+          }
+        }
+      }
+    })
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_MesherUpdateMesh3D(::benchmark::State& state) {
+  const StereoData& data = GetStereoData(state.range(1));
+  Tracker tracker(GetFrontEndParams(state.range(0)));
+  std::unique_ptr<StereoFrame> ref_frame, cur_frame;
+  CreateTrackedStereoFrames(data, &tracker, &ref_frame, &cur_frame);
+
+  // The stereo landmarks stand for the VIO ones, with the camera at the
+  // origin.
+  const Frame& left_frame = cur_frame->getLeftFrame();
+  std::unordered_map<LandmarkId, gtsam::Point3> points_with_id_VIO;
+  for (size_t i = 0u; i < left_frame.landmarks_.size(); i++) {
+    if (cur_frame->right_keypoints_status_.at(i) == Kstatus::VALID &&
+        left_frame.landmarks_.at(i) != -1) {
+      points_with_id_VIO.emplace(left_frame.landmarks_.at(i),
+                                 gtsam::Point3(cur_frame->keypoints_3d_.at(i)));
+    }
+  }
+  const std::shared_ptr<StereoFrame> stereo_frame(cur_frame.release());
+  const gtsam::Pose3 left_camera_pose;
+
+  Mesher mesher;
+  for (auto _ : state) {
+    mesher.updateMesh3D(points_with_id_VIO, stereo_frame, left_camera_pose);
+  }
+  state.counters["landmarks"] = points_with_id_VIO.size();
+}
+BENCHMARK(BM_MesherUpdateMesh3D)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+}  // namespace benchmarks
+
+}  // namespace VIO
@@ -0,0 +1,197 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkFrontEnd.cpp
+ * @brief  Benchmarks of the stereo matching, tracking and outlier rejection.
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkData.h"
+#include "Frame.h"
+#include "StereoFrame.h"
+#include "Tracker.h"
+
+namespace VIO {
+
+namespace benchmarks {
+
+namespace {
+
+// Fixture of the benchmarks taking the {nr_features, resolution_percent}
+// arguments, see FeaturesAndResolution.
+struct FrontEndData {
+  explicit FrontEndData(const ::benchmark::State& state)
+      : data(GetStereoData(state.range(1))),
+        tracker(GetFrontEndParams(state.range(0))) {
+    CreateTrackedStereoFrames(data, &tracker, &ref_frame, &cur_frame);
+  }
+
+  const StereoData& data;
+  Tracker tracker;
+  std::unique_ptr<StereoFrame> ref_frame;
+  std::unique_ptr<StereoFrame> cur_frame;
+};
+
+// Relative rotation of the frames, given by the IMU in the pipeline.
+gtsam::Rot3 GetRotation(FrontEndData* fixture) {
+  StereoFrame ref_frame(*fixture->ref_frame);
+  StereoFrame cur_frame(*fixture->cur_frame);
+  return fixture->tracker.geometricOutlierRejectionStereo(ref_frame, cur_frame)
+      .second.rotation();
+}
+
+// Number of valid keypoints, which depends on the arguments and the images.
+void SetFeaturesCounter(::benchmark::State& state, const Frame& frame) {
+  state.counters["keypoints"] = frame.getNrValidKeypoints();
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+static void BM_StereoFrameSparseStereoMatching(::benchmark::State& state) {
+  FrontEndData fixture(state);
+  // Keypoints and rectification parameters, but not the rectified images yet,
+  // as for a new keyframe.
+  StereoFrame stereo_frame(*fixture.ref_frame);
+  stereo_frame.left_img_rectified_ = cv::Mat();
+  stereo_frame.right_img_rectified_ = cv::Mat();
+  for (auto _ : state) {
+    state.PauseTiming();
+    StereoFrame cur_frame(stereo_frame);
+    state.ResumeTiming();
+    cur_frame.sparseStereoMatching();
+    ::benchmark::DoNotOptimize(cur_frame.keypoints_3d_.data());
+  }
+  SetFeaturesCounter(state, stereo_frame.getLeftFrame());
+}
+BENCHMARK(BM_StereoFrameSparseStereoMatching)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_TrackerFeatureDetection(::benchmark::State& state) {
+  FrontEndData fixture(state);
+  const StereoFrame stereo_frame =
+      CreateStereoFrame(fixture.data, 0u, fixture.tracker.trackerParams_);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame frame(stereo_frame.getLeftFrame());
+    state.ResumeTiming();
+    fixture.tracker.featureDetection(&frame);
+    ::benchmark::DoNotOptimize(frame.keypoints_.data());
+  }
+  SetFeaturesCounter(state, fixture.ref_frame->getLeftFrame());
+}
+BENCHMARK(BM_TrackerFeatureDetection)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_TrackerFeatureTracking(::benchmark::State& state) {
+  FrontEndData fixture(state);
+  const StereoFrame stereo_frame =
+      CreateStereoFrame(fixture.data, 1u, fixture.tracker.trackerParams_);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame ref_frame(fixture.ref_frame->getLeftFrame());
+    Frame cur_frame(stereo_frame.getLeftFrame());
+    state.ResumeTiming();
+    fixture.tracker.featureTracking(&ref_frame, &cur_frame);
+    ::benchmark::DoNotOptimize(cur_frame.keypoints_.data());
+  }
+  SetFeaturesCounter(state, fixture.cur_frame->getLeftFrame());
+}
+BENCHMARK(BM_TrackerFeatureTracking)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+// The outlier rejection removes the outliers from the frames: each iteration
+// works on copies.
+static void BM_TrackerGeometricOutlierRejectionMono(::benchmark::State& state) {
+  FrontEndData fixture(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame ref_frame(fixture.ref_frame->getLeftFrame());
+    Frame cur_frame(fixture.cur_frame->getLeftFrame());
+    state.ResumeTiming();
+    ::benchmark::DoNotOptimize(
+        fixture.tracker.geometricOutlierRejectionMono(&ref_frame, &cur_frame));
+  }
+  SetFeaturesCounter(state, fixture.cur_frame->getLeftFrame());
+}
+BENCHMARK(BM_TrackerGeometricOutlierRejectionMono)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_TrackerGeometricOutlierRejectionMonoGivenRotation(
+    ::benchmark::State& state) {
+  FrontEndData fixture(state);
+  const gtsam::Rot3 R = GetRotation(&fixture);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame ref_frame(fixture.ref_frame->getLeftFrame());
+    Frame cur_frame(fixture.cur_frame->getLeftFrame());
+    state.ResumeTiming();
+    ::benchmark::DoNotOptimize(
+        fixture.tracker.geometricOutlierRejectionMonoGivenRotation(
+            &ref_frame, &cur_frame, R));
+  }
+  SetFeaturesCounter(state, fixture.cur_frame->getLeftFrame());
+}
+BENCHMARK(BM_TrackerGeometricOutlierRejectionMonoGivenRotation)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_TrackerGeometricOutlierRejectionStereo(
+    ::benchmark::State& state) {
+  FrontEndData fixture(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    StereoFrame ref_frame(*fixture.ref_frame);
+    StereoFrame cur_frame(*fixture.cur_frame);
+    state.ResumeTiming();
+    ::benchmark::DoNotOptimize(
+        fixture.tracker.geometricOutlierRejectionStereo(ref_frame, cur_frame));
+  }
+  SetFeaturesCounter(state, fixture.cur_frame->getLeftFrame());
+}
+BENCHMARK(BM_TrackerGeometricOutlierRejectionStereo)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_TrackerGeometricOutlierRejectionStereoGivenRotation(
+    ::benchmark::State& state) {
+  FrontEndData fixture(state);
+  const gtsam::Rot3 R = GetRotation(&fixture);
+  for (auto _ : state) {
+    state.PauseTiming();
+    StereoFrame ref_frame(*fixture.ref_frame);
+    StereoFrame cur_frame(*fixture.cur_frame);
+    state.ResumeTiming();
+    ::benchmark::DoNotOptimize(
+        fixture.tracker.geometricOutlierRejectionStereoGivenRotation(
+            ref_frame, cur_frame, R));
+  }
+  SetFeaturesCounter(state, fixture.cur_frame->getLeftFrame());
+}
+BENCHMARK(BM_TrackerGeometricOutlierRejectionStereoGivenRotation)
+    ->Apply(FeaturesAndResolution)
+    ->Unit(::benchmark::kMillisecond);
+
+}  // namespace benchmarks
+
+}  // namespace VIO
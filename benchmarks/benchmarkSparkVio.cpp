@@ -0,0 +1,31 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkSparkVio.cpp
+ * @brief  Runs the benchmarks, e.g. to track them per commit:
+ *         ./benchmarkSparkVio --benchmark_out=benchmarks.json
+ *                             --benchmark_out_format=json
+ * @author Antoni Rosinol
+ */
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_string(benchmark_data_path, "../tests/data",
+              "Path to the data for the benchmarks (the unit tests' data).");
+
+int main(int argc, char** argv) {
+  // Removes the --benchmark_* flags, the remaining ones are gflags.
+  ::benchmark::Initialize(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,161 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkThreadsafeBuffers.cpp
+ * @brief  Benchmarks of the queues and IMU buffer shared by the pipeline.
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkData.h"
+#include "StereoImuSyncPacket.h"
+#include "Tracker.h"
+#include "imu-frontend/ImuFrontEnd-definitions.h"
+#include "utils/ThreadsafeImuBuffer.h"
+#include "utils/ThreadsafeQueue.h"
+
+namespace VIO {
+
+namespace benchmarks {
+
+namespace {
+
+// Packet of the frontend input queue: a stereo frame with the given number of
+// features, and the IMU measurements since the previous frame.
+std::unique_ptr<StereoImuSyncPacket> CreatePacket(int nr_features) {
+  Tracker tracker(GetFrontEndParams(nr_features));
+  std::unique_ptr<StereoFrame> ref_frame, cur_frame;
+  CreateTrackedStereoFrames(GetStereoData(100), &tracker, &ref_frame,
+                            &cur_frame);
+  ImuStampS imu_stamps;
+  ImuAccGyrS imu_accgyr;
+  CreateImuMeasurements(11u, &imu_stamps, &imu_accgyr);
+  return std::unique_ptr<StereoImuSyncPacket>(
+      new StereoImuSyncPacket(*cur_frame, imu_stamps, imu_accgyr));
+}
+
+// IMU buffer with nr_measurements at 200Hz, from timestamp 0.
+void FillImuBuffer(size_t nr_measurements,
+                   utils::ThreadsafeImuBuffer* imu_buffer) {
+  CHECK_NOTNULL(imu_buffer);
+  ImuStampS imu_stamps;
+  ImuAccGyrS imu_accgyr;
+  CreateImuMeasurements(nr_measurements, &imu_stamps, &imu_accgyr);
+  imu_buffer->addMeasurements(imu_stamps, imu_accgyr);
+}
+
+// Same rates as CreateImuMeasurements and CreateStereoFrame.
+const Timestamp kFramePeriod = 50000000;  // 20Hz.
+const Timestamp kImuPeriod = 5000000;     // 200Hz.
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+// Argument: number of features of the stereo frame in the packet. With
+// several threads, each one pushes and then pops a packet: the queue is
+// never empty when popping, but the threads contend for the queue.
+static void BM_ThreadsafeQueuePushPop(::benchmark::State& state) {
+  static ThreadsafeQueue<StereoImuSyncPacket> queue("benchmark_queue");
+  static std::unique_ptr<StereoImuSyncPacket> packet;
+  if (state.thread_index() == 0) packet = CreatePacket(state.range(0));
+  // The other threads wait for the setup before the first iteration.
+  for (auto _ : state) {
+    queue.push(*packet);
+    std::shared_ptr<StereoImuSyncPacket> popped_packet = queue.popBlocking();
+    ::benchmark::DoNotOptimize(popped_packet.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) packet.reset();
+}
+BENCHMARK(BM_ThreadsafeQueuePushPop)
+    ->ArgName("features")
+    ->Arg(100)
+    ->Arg(1000)
+    ->ThreadRange(1, 4)
+    ->UseRealTime();
+
+/* -------------------------------------------------------------------------- */
+// Queries of the measurements between consecutive frames, as done by the data
+// provider, cycling over the buffer.
+// Argument: number of measurements in the buffer.
+static void BM_ThreadsafeImuBufferGetImuDataInterpolatedBorders(
+    ::benchmark::State& state) {
+  utils::ThreadsafeImuBuffer imu_buffer(-1);
+  FillImuBuffer(state.range(0), &imu_buffer);
+  const Timestamp buffer_end = (state.range(0) - 1) * kImuPeriod;
+  CHECK_GT(buffer_end, kFramePeriod);
+  // Frame timestamps are not aligned with the IMU ones: both borders are
+  // interpolated.
+  Timestamp timestamp_from = kImuPeriod / 2;
+  ImuStampS imu_stamps;
+  ImuAccGyrS imu_accgyr;
+  for (auto _ : state) {
+    const Timestamp timestamp_to = timestamp_from + kFramePeriod;
+    CHECK(imu_buffer.getImuDataInterpolatedBorders(
+              timestamp_from, timestamp_to, &imu_stamps, &imu_accgyr) ==
+          utils::ThreadsafeImuBuffer::QueryResult::kDataAvailable);
+    const bool wrap_around = timestamp_to + kFramePeriod >= buffer_end;
+    timestamp_from = wrap_around ? kImuPeriod / 2 : timestamp_to;
+  }
+}
+BENCHMARK(BM_ThreadsafeImuBufferGetImuDataInterpolatedBorders)
+    ->ArgName("measurements")
+    ->Arg(200)
+    ->Arg(2000)
+    ->Arg(20000);
+
+/* -------------------------------------------------------------------------- */
+static void BM_ThreadsafeImuBufferGetImuDataBtwTimestamps(
+    ::benchmark::State& state) {
+  utils::ThreadsafeImuBuffer imu_buffer(-1);
+  FillImuBuffer(state.range(0), &imu_buffer);
+  const Timestamp buffer_end = (state.range(0) - 1) * kImuPeriod;
+  CHECK_GT(buffer_end, kFramePeriod);
+  Timestamp timestamp_from = 0;
+  ImuStampS imu_stamps;
+  ImuAccGyrS imu_accgyr;
+  for (auto _ : state) {
+    const Timestamp timestamp_to = timestamp_from + kFramePeriod;
+    CHECK(imu_buffer.getImuDataBtwTimestamps(timestamp_from, timestamp_to,
+                                             &imu_stamps, &imu_accgyr) ==
+          utils::ThreadsafeImuBuffer::QueryResult::kDataAvailable);
+    const bool wrap_around = timestamp_to + kFramePeriod >= buffer_end;
+    timestamp_from = wrap_around ? 0 : timestamp_to;
+  }
+}
+BENCHMARK(BM_ThreadsafeImuBufferGetImuDataBtwTimestamps)
+    ->ArgName("measurements")
+    ->Arg(200)
+    ->Arg(2000)
+    ->Arg(20000);
+
+/* -------------------------------------------------------------------------- */
+// Appending to the buffer, as done by the IMU callback. The buffer keeps the
+// given number of measurements, dropping the oldest ones.
+static void BM_ThreadsafeImuBufferAddMeasurement(::benchmark::State& state) {
+  utils::ThreadsafeImuBuffer imu_buffer(state.range(0) * kImuPeriod);
+  FillImuBuffer(state.range(0), &imu_buffer);
+  Timestamp timestamp = state.range(0) * kImuPeriod;
+  const ImuAccGyr imu_measurement = ImuAccGyr::Zero();
+  for (auto _ : state) {
+    imu_buffer.addMeasurement(timestamp, imu_measurement);
+    timestamp += kImuPeriod;
+  }
+}
+BENCHMARK(BM_ThreadsafeImuBufferAddMeasurement)
+    ->ArgName("measurements")
+    ->Arg(200)
+    ->Arg(20000);
+
+}  // namespace benchmarks
+
+}  // namespace VIO
@@ -0,0 +1,15 @@
+cmake_minimum_required(VERSION 2.8.2)
+
+project(benchmark-download NONE)
+
+include(ExternalProject)
+ExternalProject_Add(benchmark
+    GIT_REPOSITORY https://github.com/google/benchmark.git
+    GIT_TAG v1.7.1
+    SOURCE_DIR "${CMAKE_BINARY_DIR}/external/benchmark-src"
+    BINARY_DIR "${CMAKE_BINARY_DIR}/external/benchmark-build"
+    CONFIGURE_COMMAND ""
+    BUILD_COMMAND ""
+    INSTALL_COMMAND ""
+    TEST_COMMAND ""
+)
@@ -0,0 +1,94 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BuildDatasetCache.cpp
+ * @brief  Converts a dataset (EuRoC, Kitti or synthetic) into a dataset cache,
+ *         to replay it with --dataset_type=3 without decoding its images.
+ * @author Antoni Rosinol
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "datasource/DatasetCache.h"
+#include "datasource/ETH_parser.h"
+#include "datasource/KittiDataSource.h"
+#include "datasource/SyntheticDataSource.h"
+#include "utils/Timer.h"
+
+#include "StereoImuSyncPacket.h"
+
+DEFINE_int32(dataset_type, 0,
+             "Type of parser to convert:\n"
+             "0: EuRoC\n"
+             "1: Kitti (without ground truth)\n"
+             "2: Synthetic");
+DEFINE_string(dataset_cache_output_path, "dataset.dscache",
+              "Dataset cache to write.");
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  // The frames in [initial_k, final_k) are converted, with the same params
+  // as when running the pipeline, so that images are equalized if requested.
+  std::unique_ptr<VIO::DataProvider> dataset_parser;
+  const VIO::GroundTruthData* gt_data = nullptr;
+  bool images_equalized = false;
+  switch (FLAGS_dataset_type) {
+    case 0: {
+      auto eth_parser = VIO::make_unique<VIO::ETHDatasetParser>();
+      if (eth_parser->isGroundTruthAvailable()) {
+        gt_data = &eth_parser->gt_data_;
+      }
+      // Only EuRoC images are equalized while read.
+      images_equalized = eth_parser->pipeline_params_.frontend_params_
+                             .getStereoMatchingParams()
+                             .equalize_image_;
+      dataset_parser = std::move(eth_parser);
+    } break;
+    case 1: {
+      dataset_parser = VIO::make_unique<VIO::KittiDataProvider>();
+    } break;
+    case 2: {
+      auto synthetic = VIO::make_unique<VIO::SyntheticDataProvider>();
+      gt_data = &synthetic->gt_data_;
+      dataset_parser = std::move(synthetic);
+    } break;
+    default: {
+      LOG(FATAL) << "Unrecognized dataset type: " << FLAGS_dataset_type << "."
+                 << " 0: EuRoC, 1: Kitti, 2: Synthetic.";
+    }
+  }
+
+  VIO::DatasetCacheWriter writer(FLAGS_dataset_cache_output_path,
+                                 images_equalized);
+  writer.setImuParams(dataset_parser->pipeline_params_.imu_params_);
+  if (gt_data != nullptr) writer.setGroundTruth(*gt_data);
+  dataset_parser->registerVioCallback(
+      std::bind(&VIO::DatasetCacheWriter::addPacket, &writer,
+                std::placeholders::_1));
+
+  auto tic = VIO::utils::Timer::tic();
+  if (!dataset_parser->spin() || !writer.finish()) {
+    LOG(ERROR) << "Could not build dataset cache: "
+               << FLAGS_dataset_cache_output_path;
+    return EXIT_FAILURE;
+  }
+  LOG(INFO) << "Converted " << writer.nrFrames() << " frames in "
+            << VIO::utils::Timer::toc(tic).count() << " ms.";
+  return EXIT_SUCCESS;
+}
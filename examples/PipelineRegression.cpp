@@ -0,0 +1,402 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineRegression.cpp
+ * @brief  Runs the VIO pipeline over a dataset, sequentially and in parallel,
+ *         and compares its latency, resources and accuracy against a stored
+ *         baseline. Exits with failure on regression.
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "UtilsOpenCV.h"
+#include "datasource/CachedDataSource.h"
+#include "datasource/ETH_parser.h"
+#include "datasource/KittiDataSource.h"
+#include "datasource/SyntheticDataSource.h"
+#include "pipeline/Pipeline.h"
+#include "pipeline/PipelineRegression.h"
+#include "utils/Statistics.h"
+#include "utils/Timer.h"
+
+#include "StereoImuSyncPacket.h"
+
+DEFINE_int32(dataset_type, 0,
+             "Type of parser to use:\n"
+             "0: EuRoC\n"
+             "1: Kitti (no accuracy metrics)\n"
+             "2: Synthetic\n"
+             "3: Dataset cache (see buildDatasetCache)");
+DEFINE_string(regression_modes, "sequential,parallel",
+              "Comma-separated pipeline modes to run: sequential, parallel.");
+DEFINE_string(regression_baseline_path, "",
+              "Baseline metrics to compare against. If empty, only the "
+              "metrics of this run are written.");
+DEFINE_string(regression_output_path, "PipelineRegression.yaml",
+              "Where to write the metrics of this run, which can be used as "
+              "the next baseline.");
+DEFINE_double(regression_latency_tolerance, 0.25,
+              "Relative tolerance for latencies and CPU times, written "
+              "to the metrics of this run.");
+DEFINE_double(regression_memory_tolerance, 0.1,
+              "Relative tolerance for peak memory and queue sizes, written "
+              "to the metrics of this run.");
+DEFINE_double(regression_accuracy_tolerance, 0.1,
+              "Relative tolerance for trajectory errors, written to the "
+              "metrics of this run.");
+
+namespace VIO {
+
+namespace {
+
+// Percentiles reported for each latency statistic.
+const std::vector<std::pair<std::string, double>> kPercentiles = {
+    {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}};
+
+// Absolute tolerances, so that noise on small values does not fail the run.
+constexpr double kLatencyAbsoluteTolerance = 0.5;      // [ms]
+constexpr double kCpuTimeAbsoluteTolerance = 0.1;      // [s]
+constexpr double kQueueSizeAbsoluteTolerance = 2.0;    // [#]
+constexpr double kMemoryAbsoluteTolerance = 10.0;      // [MB]
+constexpr double kTranslationAbsoluteTolerance = 0.01;  // [m]
+constexpr double kRotationAbsoluteTolerance = 0.002;   // [rad]
+
+// Ground truth of the dataset, as needed for the trajectory errors.
+struct GroundTruth {
+  // World_Pose_body at a timestamp.
+  std::function<gtsam::Pose3(const Timestamp&)> pose_;
+  // Rotation and translation errors of an estimated relative pose between
+  // two timestamps, negative if there is no ground truth.
+  std::function<std::pair<double, double>(const gtsam::Pose3&,
+                                          const Timestamp&, const Timestamp&)>
+      relative_pose_errors_;
+};
+
+// Data provider of FLAGS_dataset_type, and its ground truth if any.
+std::unique_ptr<DataProvider> createDataProvider(
+    std::unique_ptr<GroundTruth>* ground_truth) {
+  CHECK_NOTNULL(ground_truth);
+  switch (FLAGS_dataset_type) {
+    case 0: {
+      auto eth_parser = VIO::make_unique<ETHDatasetParser>();
+      const ETHDatasetParser* eth_parser_ptr = eth_parser.get();
+      if (eth_parser->isGroundTruthAvailable()) {
+        ground_truth->reset(new GroundTruth());
+        (*ground_truth)->pose_ = [eth_parser_ptr](const Timestamp& timestamp) {
+          return eth_parser_ptr->getGroundTruthState(timestamp).pose_;
+        };
+        (*ground_truth)->relative_pose_errors_ =
+            [eth_parser_ptr](const gtsam::Pose3& lkf_T_k_body,
+                             const Timestamp& timestamp_lkf,
+                             const Timestamp& timestamp_k) {
+              return eth_parser_ptr->computePoseErrors(
+                  lkf_T_k_body, true, timestamp_lkf, timestamp_k);
+            };
+      }
+      return std::move(eth_parser);
+    }
+    case 1: {
+      LOG(WARNING) << "No ground truth for Kitti: no accuracy metrics.";
+      return VIO::make_unique<KittiDataProvider>();
+    }
+    case 2: {
+      auto synthetic = VIO::make_unique<SyntheticDataProvider>();
+      const SyntheticDataProvider* synthetic_ptr = synthetic.get();
+      ground_truth->reset(new GroundTruth());
+      (*ground_truth)->pose_ = [synthetic_ptr](const Timestamp& timestamp) {
+        return synthetic_ptr->getGroundTruthState(timestamp).pose_;
+      };
+      (*ground_truth)->relative_pose_errors_ =
+          [synthetic_ptr](const gtsam::Pose3& lkf_T_k_body,
+                          const Timestamp& timestamp_lkf,
+                          const Timestamp& timestamp_k) {
+            const gtsam::Pose3 lkf_T_k_gt =
+                synthetic_ptr->getGroundTruthState(timestamp_lkf)
+                    .pose_.between(synthetic_ptr->getGroundTruthState(
+                                                    timestamp_k)
+                                       .pose_);
+            return UtilsOpenCV::ComputeRotationAndTranslationErrors(
+                lkf_T_k_gt, lkf_T_k_body, false);
+          };
+      return std::move(synthetic);
+    }
+    case 3: {
+      auto cached = VIO::make_unique<CachedDataProvider>();
+      const CachedDataProvider* cached_ptr = cached.get();
+      if (!cached->isGroundTruthAvailable()) {
+        LOG(WARNING) << "No ground truth in dataset cache: no accuracy "
+                        "metrics.";
+        return std::move(cached);
+      }
+      ground_truth->reset(new GroundTruth());
+      (*ground_truth)->pose_ = [cached_ptr](const Timestamp& timestamp) {
+        return cached_ptr->getGroundTruthState(timestamp).pose_;
+      };
+      (*ground_truth)->relative_pose_errors_ =
+          [cached_ptr](const gtsam::Pose3& lkf_T_k_body,
+                       const Timestamp& timestamp_lkf,
+                       const Timestamp& timestamp_k) {
+            const gtsam::Pose3 lkf_T_k_gt =
+                cached_ptr->getGroundTruthState(timestamp_lkf)
+                    .pose_.between(
+                        cached_ptr->getGroundTruthState(timestamp_k).pose_);
+            return UtilsOpenCV::ComputeRotationAndTranslationErrors(
+                lkf_T_k_gt, lkf_T_k_body, false);
+          };
+      return std::move(cached);
+    }
+    default: {
+      LOG(FATAL) << "Unrecognized dataset type: " << FLAGS_dataset_type << "."
+                 << " 0: EuRoC, 1: Kitti, 2: Synthetic, 3: Dataset cache.";
+    }
+  }
+  return nullptr;
+}
+
+typedef std::vector<std::pair<Timestamp, gtsam::Pose3>> Trajectory;
+
+// ATE and RPE (RMSE), against the ground truth.
+// The trajectory is aligned to the ground truth at its first keyframe, so
+// that the errors do not depend on the initialization mode.
+void addTrajectoryMetrics(const std::string& mode,
+                          const Trajectory& trajectory,
+                          const GroundTruth& ground_truth,
+                          RegressionMetrics* metrics) {
+  CHECK_NOTNULL(metrics);
+  if (trajectory.size() < 2u) {
+    LOG(ERROR) << "Not enough keyframes for trajectory metrics: "
+               << trajectory.size();
+    return;
+  }
+  const gtsam::Pose3 gt_Pose_estimate =
+      ground_truth.pose_(trajectory.front().first)
+          .compose(trajectory.front().second.inverse());
+  double ate_squared_sum = 0.0;
+  double rpe_rot_squared_sum = 0.0;
+  double rpe_tran_squared_sum = 0.0;
+  size_t nr_relative_poses = 0u;
+  for (size_t i = 0u; i < trajectory.size(); i++) {
+    const gtsam::Pose3 aligned_pose =
+        gt_Pose_estimate.compose(trajectory[i].second);
+    const gtsam::Pose3 gt_pose = ground_truth.pose_(trajectory[i].first);
+    ate_squared_sum +=
+        (aligned_pose.translation() - gt_pose.translation()).squaredNorm();
+    if (i == 0u) continue;
+    double rot_error, tran_error;
+    std::tie(rot_error, tran_error) = ground_truth.relative_pose_errors_(
+        trajectory[i - 1].second.between(trajectory[i].second),
+        trajectory[i - 1].first, trajectory[i].first);
+    if (rot_error < 0.0 || tran_error < 0.0) continue;  // No ground truth.
+    rpe_rot_squared_sum += rot_error * rot_error;
+    rpe_tran_squared_sum += tran_error * tran_error;
+    ++nr_relative_poses;
+  }
+  const double tol = FLAGS_regression_accuracy_tolerance;
+  (*metrics)[mode + "/ATE [m]"] = {
+      std::sqrt(ate_squared_sum / trajectory.size()), tol,
+      kTranslationAbsoluteTolerance};
+  if (nr_relative_poses > 0u) {
+    (*metrics)[mode + "/RPE Rotation [rad]"] = {
+        std::sqrt(rpe_rot_squared_sum / nr_relative_poses), tol,
+        kRotationAbsoluteTolerance};
+    (*metrics)[mode + "/RPE Translation [m]"] = {
+        std::sqrt(rpe_tran_squared_sum / nr_relative_poses), tol,
+        kTranslationAbsoluteTolerance};
+  }
+}
+
+// Latency percentiles, queue sizes and thread CPU times from the statistics
+// of the run.
+void addStatisticsMetrics(const std::string& mode, RegressionMetrics* metrics) {
+  CHECK_NOTNULL(metrics);
+  auto ends_with = [](const std::string& tag, const std::string& suffix) {
+    return tag.size() >= suffix.size() &&
+           tag.compare(tag.size() - suffix.size(), suffix.size(), suffix) ==
+               0;
+  };
+  auto starts_with = [](const std::string& tag, const std::string& prefix) {
+    return tag.compare(0, prefix.size(), prefix) == 0;
+  };
+  for (const auto& stat : utils::Statistics::GetStatsCollectors()) {
+    const std::string& tag = stat.first;
+    const size_t handle = stat.second;
+    if (utils::Statistics::GetNumSamples(handle) == 0u) continue;
+    if (ends_with(tag, "Timing [ms]")) {
+      for (const auto& percentile : kPercentiles) {
+        (*metrics)[mode + "/" + tag + "/" + percentile.first] = {
+            utils::Statistics::GetPercentile(handle, percentile.second),
+            FLAGS_regression_latency_tolerance, kLatencyAbsoluteTolerance};
+      }
+    } else if (starts_with(tag, "Pipeline Max Queue Size")) {
+      (*metrics)[mode + "/" + tag] = {utils::Statistics::GetMax(handle),
+                                      FLAGS_regression_memory_tolerance,
+                                      kQueueSizeAbsoluteTolerance};
+    } else if (starts_with(tag, "Pipeline Thread CPU Time")) {
+      (*metrics)[mode + "/" + tag] = {utils::Statistics::GetTotal(handle),
+                                      FLAGS_regression_latency_tolerance,
+                                      kCpuTimeAbsoluteTolerance};
+    }
+  }
+}
+
+// Runs the whole dataset through a new pipeline, and adds the metrics of the
+// run, prefixed by the mode. Returns false if the pipeline failed.
+bool runPipeline(bool parallel_run, RegressionMetrics* metrics) {
+  CHECK_NOTNULL(metrics);
+  const std::string mode = parallel_run ? "parallel" : "sequential";
+  LOG(INFO) << "Running the pipeline in " << mode << " mode.";
+  utils::Statistics::Reset();
+
+  std::unique_ptr<GroundTruth> ground_truth;
+  std::unique_ptr<DataProvider> data_provider =
+      createDataProvider(&ground_truth);
+  resetPeakRss();
+  const double process_cpu_time_start = getProcessCpuTime();
+
+  Trajectory trajectory;
+  std::mutex trajectory_mutex;
+  size_t nr_frames = 0u;
+  {
+    Pipeline vio_pipeline(data_provider->pipeline_params_, parallel_run);
+    vio_pipeline.registerKeyFrameRateOutputCallback(
+        [&trajectory, &trajectory_mutex](const SpinOutputPacket& output) {
+          std::lock_guard<std::mutex> lock(trajectory_mutex);
+          trajectory.emplace_back(output.getTimestamp(),
+                                  output.getEstimatedPose());
+        });
+    data_provider->registerVioCallback(
+        [&vio_pipeline, &nr_frames](const StereoImuSyncPacket& packet) {
+          ++nr_frames;
+          vio_pipeline.spin(packet);
+        });
+
+    // The thread spinning the dataset also runs the whole pipeline in
+    // sequential mode, hence its CPU time.
+    auto spin_dataset = [&data_provider](double* cpu_time) {
+      const bool is_successful = data_provider->spin();
+      *cpu_time = getThreadCpuTime(pthread_self());
+      return is_successful;
+    };
+    double spin_cpu_time = 0.0;
+    auto tic = utils::Timer::tic();
+    bool is_pipeline_successful = false;
+    if (parallel_run) {
+      auto handle =
+          std::async(std::launch::async, spin_dataset, &spin_cpu_time);
+      auto handle_pipeline =
+          std::async(std::launch::async, &Pipeline::shutdownWhenFinished,
+                     &vio_pipeline);
+      vio_pipeline.spinViz();
+      is_pipeline_successful = handle.get();
+      handle_pipeline.get();
+    } else {
+      const double cpu_time_start = getThreadCpuTime(pthread_self());
+      is_pipeline_successful = spin_dataset(&spin_cpu_time);
+      spin_cpu_time -= cpu_time_start;
+      vio_pipeline.shutdown();
+    }
+    const double wall_time = utils::Timer::toc<std::chrono::duration<double>>(
+                                 tic).count();
+    if (!is_pipeline_successful) {
+      LOG(ERROR) << "Pipeline failed in " << mode << " mode.";
+      return false;
+    }
+    CHECK_GT(nr_frames, 0u);
+
+    const double tol = FLAGS_regression_latency_tolerance;
+    (*metrics)[mode + "/Time Per Frame [ms]"] = {
+        1e3 * wall_time / nr_frames, tol, kLatencyAbsoluteTolerance};
+    (*metrics)[mode + "/Thread CPU Time Dataset Spin [s]"] = {
+        spin_cpu_time, tol, kCpuTimeAbsoluteTolerance};
+  }
+  (*metrics)[mode + "/Process CPU Time [s]"] = {
+      getProcessCpuTime() - process_cpu_time_start,
+      FLAGS_regression_latency_tolerance, kCpuTimeAbsoluteTolerance};
+  (*metrics)[mode + "/Peak RSS [MB]"] = {getPeakRssMb(),
+                                         FLAGS_regression_memory_tolerance,
+                                         kMemoryAbsoluteTolerance};
+  addStatisticsMetrics(mode, metrics);
+  if (ground_truth) {
+    addTrajectoryMetrics(mode, trajectory, *ground_truth, metrics);
+  }
+  LOG(INFO) << '\n' << utils::Statistics::Print();
+  return true;
+}
+
+}  // namespace
+
+}  // namespace VIO
+
+int main(int argc, char* argv[]) {
+  // No visualization and repeatable RANSAC by default, for comparable runs.
+  google::SetCommandLineOptionWithMode("visualize", "false",
+                                       google::SET_FLAGS_DEFAULT);
+  google::SetCommandLineOptionWithMode("deterministic_random_number_generator",
+                                       "true", google::SET_FLAGS_DEFAULT);
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  VIO::RegressionMetrics metrics;
+  std::stringstream modes(FLAGS_regression_modes);
+  std::string mode;
+  while (std::getline(modes, mode, ',')) {
+    if (mode != "sequential" && mode != "parallel") {
+      LOG(FATAL) << "Unrecognized pipeline mode: " << mode
+                 << ", use sequential or parallel.";
+    }
+    if (!VIO::runPipeline(mode == "parallel", &metrics)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!VIO::saveRegressionMetrics(metrics, FLAGS_regression_output_path)) {
+    return EXIT_FAILURE;
+  }
+  LOG(INFO) << "Wrote the metrics of this run to: "
+            << FLAGS_regression_output_path;
+  if (FLAGS_regression_baseline_path.empty()) {
+    LOG(WARNING) << "No baseline given, nothing to compare against.";
+    return EXIT_SUCCESS;
+  }
+
+  VIO::RegressionMetrics baseline;
+  if (!VIO::loadRegressionMetrics(FLAGS_regression_baseline_path,
+                                  &baseline)) {
+    return EXIT_FAILURE;
+  }
+  const std::vector<std::string> regressions =
+      VIO::compareRegressionMetrics(baseline, metrics);
+  if (!regressions.empty()) {
+    std::stringstream message;
+    for (const std::string& regression : regressions) {
+      message << "\n - " << regression;
+    }
+    LOG(ERROR) << regressions.size() << " regressions with respect to "
+               << FLAGS_regression_baseline_path << ":" << message.str();
+    return EXIT_FAILURE;
+  }
+  LOG(INFO) << "No regressions with respect to "
+            << FLAGS_regression_baseline_path << ", compared "
+            << baseline.size() << " metrics.";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RunLogToCsv.cpp
+ * @brief  Converts a binary run log (written with --log_output_binary) to the
+ *         CSV file the loggers would have written.
+ * @author Antoni Rosinol
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "logging/RunLog.h"
+
+DEFINE_string(run_log_path, "", "Binary run log (.runlog) to convert.");
+DEFINE_string(csv_path, "",
+              "CSV file to write. If empty, the run log path with the "
+              "extension .csv.");
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  CHECK(!FLAGS_run_log_path.empty()) << "Missing --run_log_path.";
+  VIO::RunLog run_log;
+  if (!VIO::readRunLog(FLAGS_run_log_path, &run_log)) {
+    LOG(ERROR) << "Could not read run log: " << FLAGS_run_log_path;
+    return EXIT_FAILURE;
+  }
+
+  std::string csv_path = FLAGS_csv_path;
+  if (csv_path.empty()) {
+    csv_path = FLAGS_run_log_path.substr(0u, FLAGS_run_log_path.rfind('.')) +
+               ".csv";
+  }
+  std::ofstream csv_file(csv_path);
+  if (!csv_file.is_open()) {
+    LOG(ERROR) << "Could not open output file: " << csv_path;
+    return EXIT_FAILURE;
+  }
+  // Same precision as the CSV logs (UtilsOpenCV::OpenFile).
+  csv_file.precision(20);
+  VIO::writeRunLogAsCsv(run_log, &csv_file);
+
+  LOG(INFO) << "Wrote " << run_log.nr_rows_ << " rows of "
+            << run_log.stream_name_ << " to " << csv_path;
+  return EXIT_SUCCESS;
+}
@@ -19,10 +19,13 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "datasource/CachedDataSource.h"
 #include "datasource/ETH_parser.h"
 #include "datasource/KittiDataSource.h"
+#include "datasource/SyntheticDataSource.h"
 #include "logging/Logger.h"
 #include "pipeline/Pipeline.h"
+#include "utils/Profiler.h"
 #include "utils/Statistics.h"
 #include "utils/Timer.h"
 
@@ -32,7 +35,11 @@ DEFINE_bool(parallel_run, false, "Run parallelized pipeline.");
 DEFINE_int32(dataset_type, 0,
              "Type of parser to use:\n"
              "0: EuRoC\n"
-             "1: Kitti");
+             "1: Kitti\n"
+             "2: Synthetic\n"
+             "3: Dataset cache (see buildDatasetCache)");
+
+DECLARE_bool(profiler_trace);
 
 int main(int argc, char *argv[]) {
   // Initialize Google's flags library.
@@ -49,10 +56,16 @@ int main(int argc, char *argv[]) {
     case 1: {
       dataset_parser = VIO::make_unique<VIO::KittiDataProvider>();
     } break;
+    case 2: {
+      dataset_parser = VIO::make_unique<VIO::SyntheticDataProvider>();
+    } break;
+    case 3: {
+      dataset_parser = VIO::make_unique<VIO::CachedDataProvider>();
+    } break;
     default:
     {
       LOG(FATAL) << "Unrecognized dataset type: " << FLAGS_dataset_type << "."
-                   << " 0: EuRoC, 1: Kitti.";
+                   << " 0: EuRoC, 1: Kitti, 2: Synthetic, 3: Dataset cache.";
     }
   }
 
@@ -67,9 +80,10 @@ int main(int argc, char *argv[]) {
   auto tic = VIO::utils::Timer::tic();
   bool is_pipeline_successful = false;
   if (FLAGS_parallel_run) {
+    // The provider outlives the pipeline: cached frames point into it.
     auto handle = std::async(std::launch::async,
                              &VIO::DataProvider::spin,
-                             std::move(dataset_parser));
+                             dataset_parser.get());
     auto handle_pipeline =
         std::async(std::launch::async, &VIO::Pipeline::shutdownWhenFinished,
                    &vio_pipeline);
@@ -86,6 +100,13 @@ int main(int argc, char *argv[]) {
   LOG(INFO) << "Pipeline successful? "
             << (is_pipeline_successful ? "Yes!" : "No!");
   VIO::utils::Statistics::WriteAllSamplesToCsvFile("StatisticsVIO.csv");
+  // Includes the tail latencies (p90/p99/p99.9) of each statistic.
+  VIO::utils::Statistics::WriteToYamlFile("StatisticsVIO.yaml");
+  LOG(INFO) << '\n' << VIO::utils::Statistics::Print();
+  if (FLAGS_profiler_trace) {
+    // Open in chrome://tracing.
+    VIO::utils::Profiler::WriteChromeTrace("ProfilerTrace.json");
+  }
 
   if (is_pipeline_successful) {
     // Log overall time of pipeline run.
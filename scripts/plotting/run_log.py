@@ -0,0 +1,187 @@
+#!/usr/bin/env python
+
+"""
+Reads the binary run logs (.runlog) written by SparkVio with
+--log_output_binary, see src/logging/RunLog.h for the format.
+
+Usage as a module:
+    import run_log
+    stream_name, columns = run_log.read_run_log('output_posesVIO.runlog')
+    columns['x']  # numpy array
+    df = run_log.read_run_log_as_dataframe('output_posesVIO.runlog')
+
+Usage as a script, to convert to the CSV the loggers would have written:
+    ./run_log.py output_posesVIO.runlog [output_posesVIO.csv]
+"""
+
+import struct
+import sys
+from collections import OrderedDict
+
+import numpy as np
+
+HEADER_MAGIC = b'SVIORLOG'
+CHUNK_MAGIC = b'CHNK'
+VERSION = 1
+NO_COMPRESSION = 0
+LZ4_COMPRESSION = 1
+
+# Numpy type of each column type, little-endian.
+COLUMN_TYPES = {
+    0: np.dtype('<i4'),
+    1: np.dtype('<i8'),
+    2: np.dtype('<u8'),
+    3: np.dtype('<f8'),
+    4: np.dtype('u1'),
+}
+
+
+class _ByteReader(object):
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+
+    def remaining(self):
+        return len(self.data) - self.offset
+
+    def read(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.remaining() < size:
+            raise EOFError()
+        values = struct.unpack_from(fmt, self.data, self.offset)
+        self.offset += size
+        return values[0] if len(values) == 1 else values
+
+    def read_bytes(self, size):
+        if self.remaining() < size:
+            raise EOFError()
+        value = self.data[self.offset:self.offset + size]
+        self.offset += size
+        return value
+
+    def read_string(self):
+        return self.read_bytes(self.read('<H')).decode('utf-8')
+
+
+def _decompress(stored, raw_size):
+    try:
+        import lz4.block
+    except ImportError:
+        raise RuntimeError('Run log is LZ4-compressed: pip install lz4')
+    return lz4.block.decompress(stored, uncompressed_size=raw_size)
+
+
+def read_run_log_schema_and_chunks(filename):
+    """
+    Returns the stream name, the schema as a list of (name, dtype, labels),
+    and the list of raw chunks as (nr_rows, bytes). Chunks are read in turn,
+    so that the logs of runs that crashed are read up to their last complete
+    chunk.
+    """
+    with open(filename, 'rb') as f:
+        reader = _ByteReader(f.read())
+    if reader.read_bytes(len(HEADER_MAGIC)) != HEADER_MAGIC:
+        raise ValueError('Not a run log: ' + filename)
+    version = reader.read('<I')
+    if version != VERSION:
+        raise ValueError('Unsupported run log version: %d' % version)
+    stream_name = reader.read_string()
+    schema = []
+    for _ in range(reader.read('<I')):
+        name = reader.read_string()
+        column_type = reader.read('<B')
+        if column_type not in COLUMN_TYPES:
+            raise ValueError('Unknown column type: %d' % column_type)
+        labels = [reader.read_string() for _ in range(reader.read('<I'))]
+        schema.append((name, COLUMN_TYPES[column_type], labels))
+
+    row_size = sum(dtype.itemsize for _, dtype, _ in schema)
+    chunks = []
+    while reader.remaining() > 0:
+        try:
+            if reader.read_bytes(len(CHUNK_MAGIC)) != CHUNK_MAGIC:
+                break  # Footer.
+            nr_rows, compression, raw_size, stored_size = reader.read('<IBQQ')
+            stored = reader.read_bytes(stored_size)
+        except EOFError:
+            break  # Truncated last chunk.
+        if compression == LZ4_COMPRESSION:
+            raw = _decompress(stored, raw_size)
+        elif compression == NO_COMPRESSION:
+            raw = stored
+        else:
+            raise ValueError('Unknown compression: %d' % compression)
+        if len(raw) != raw_size or raw_size != nr_rows * row_size:
+            raise ValueError('Corrupted chunk in ' + filename)
+        chunks.append((nr_rows, raw))
+    return stream_name, schema, chunks
+
+
+def _read_columns(filename):
+    stream_name, schema, chunks = read_run_log_schema_and_chunks(filename)
+    parts = [[] for _ in schema]
+    for nr_rows, raw in chunks:
+        offset = 0
+        for i, (_, dtype, _) in enumerate(schema):
+            parts[i].append(np.frombuffer(raw, dtype=dtype, count=nr_rows,
+                                          offset=offset))
+            offset += nr_rows * dtype.itemsize
+    columns = OrderedDict()
+    for (name, dtype, _), column_parts in zip(schema, parts):
+        columns[name] = (np.concatenate(column_parts) if column_parts
+                         else np.empty(0, dtype=dtype))
+    return stream_name, schema, columns
+
+
+def read_run_log(filename):
+    """
+    Returns the stream name and an ordered dict of the columns, as numpy
+    arrays.
+    """
+    stream_name, _, columns = _read_columns(filename)
+    return stream_name, columns
+
+
+def read_run_log_as_dataframe(filename):
+    """
+    Returns the run log as a pandas DataFrame, with the labelled columns
+    (e.g. tracking status) as categoricals.
+    """
+    import pandas as pd
+    _, schema, columns = _read_columns(filename)
+    df = pd.DataFrame(columns)
+    for name, _, labels in schema:
+        if labels:
+            # Values without label are missing.
+            codes = df[name].astype(np.int64).where(df[name] < len(labels), -1)
+            df[name] = pd.Categorical.from_codes(codes, categories=labels)
+    return df
+
+
+def write_run_log_as_csv(filename, csv_filename):
+    """ Writes the run log with the same format as the CSV loggers. """
+    _, schema, columns = _read_columns(filename)
+    formatted = []
+    for name, dtype, labels in schema:
+        values = columns[name]
+        if labels:
+            formatted.append([labels[v] if v < len(labels) else str(v)
+                              for v in values])
+        elif dtype.kind == 'f':
+            formatted.append(['%.20g' % v for v in values])
+        else:
+            formatted.append([str(v) for v in values])
+    with open(csv_filename, 'w') as f:
+        f.write(','.join(name for name, _, _ in schema) + '\n')
+        for row in zip(*formatted):
+            f.write(','.join(row) + '\n')
+
+
+if __name__ == '__main__':
+    if len(sys.argv) not in (2, 3):
+        print(__doc__)
+        sys.exit(1)
+    run_log_filename = sys.argv[1]
+    csv_filename = (sys.argv[2] if len(sys.argv) == 3
+                    else run_log_filename.rsplit('.', 1)[0] + '.csv')
+    write_run_log_as_csv(run_log_filename, csv_filename)
@@ -0,0 +1,47 @@
+#!/bin/bash
+###################################################################
+# Runs the benchmarks and saves the results in JSON, named after the current
+# commit, so that regressions can be tracked per commit.
+# Build them first with: cmake -DSPARK_VIO_BUILD_BENCHMARKS=ON ..
+
+# Specify path of the build folder.
+BUILD_PATH="build"
+
+# Specify path where to save the results.
+OUTPUT_PATH="benchmark_results"
+###################################################################
+
+# Parse Options.
+while [ -n "$1" ]; do # while loop starts
+    case "$1" in
+      # Option -b, provides path to the build folder.
+    -b) BUILD_PATH=$2
+        shift ;;
+      # Option -o, provides path to the results folder.
+    -o) OUTPUT_PATH=$2
+        shift ;;
+    --)
+        shift # The double dash which separates options from parameters
+        break
+        ;; # Exit the loop using break command
+    *) echo "Option $1 not recognized" ;;
+    esac
+    shift
+done
+
+COMMIT=$(git rev-parse --short HEAD)
+if ! git diff --quiet HEAD; then
+  COMMIT="${COMMIT}-dirty"
+fi
+mkdir -p "$OUTPUT_PATH"
+OUTPUT_FILE="$(cd "$OUTPUT_PATH" && pwd)/benchmarkSparkVio_${COMMIT}.json"
+echo "Saving benchmark results to: $OUTPUT_FILE"
+
+# Remaining arguments go to the benchmarks, e.g. --benchmark_filter=Tracker
+# (from the build folder, as the tests, to find tests/data).
+cd "$BUILD_PATH" && ./benchmarkSparkVio \
+  --benchmark_out="$OUTPUT_FILE" \
+  --benchmark_out_format=json \
+  --benchmark_repetitions=3 \
+  --benchmark_report_aggregates_only=true \
+  "$@"
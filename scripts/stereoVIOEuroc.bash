@@ -11,7 +11,7 @@ DATASET_PATH="/home/SENSETIME/wangshuai2/Desktop/slam/dataset/euroc/V1_01_easy"
 # Specify: 1 to use Regular VIO, 0 to use Normal VIO with default parameters.
 USE_REGULAR_VIO=1
 
-# Specify: 0 to run on EuRoC data, 1 to run on Kitti
+# Specify: 0 to run on EuRoC data, 1 to run on Kitti, 2 on synthetic data
 DATASET_TYPE=0
 
 # Specify: 1 to run pipeline in parallel mode, 0 to run sequentially.
@@ -39,7 +39,7 @@ else
         # Option -d, set dataset type
       -d) DATASET_TYPE=$2
           echo "Using dataset type: $DATASET_TYPE"
-          echo "0 is for euroc and 1 is for kitti"
+          echo "0 is for euroc, 1 is for kitti and 2 is for synthetic"
           shift ;;
         # Option -r, specifies that we want to use regular vio.
       -r) USE_REGULAR_VIO=1
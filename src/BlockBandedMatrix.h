@@ -0,0 +1,361 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BlockBandedMatrix.h
+ * @brief  Symmetric block-banded matrix, for the information matrices of the
+ * feature selector.
+ * @author Luca Carlone
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+#include <Eigen/StdVector>
+
+#include <glog/logging.h>
+
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/HessianFactor.h>
+
+namespace VIO {
+
+// Symmetric matrix of nr_blocks x nr_blocks blocks of size BlockSize, whose
+// nonzero blocks (i, j) satisfy |i - j| <= bandwidth.
+// In the feature selector, block i is the state (position, velocity, accBias)
+// at the i-th keyframe of the horizon: the IMU factors are block-tridiagonal,
+// and a vision factor couples the keyframes along its track. The
+// factorization is then O(nr_blocks * bandwidth^2) instead of
+// O(nr_blocks^3), and both coincide when the matrix is dense.
+// Only the lower triangle is stored.
+template <int BlockSize>
+class BlockBandedMatrix {
+ public:
+  using Block = Eigen::Matrix<double, BlockSize, BlockSize>;
+  using BlockVector = Eigen::Matrix<double, BlockSize, 1>;
+
+  BlockBandedMatrix(const size_t& nr_blocks, const size_t& bandwidth)
+      : nr_blocks_(nr_blocks),
+        bandwidth_(nr_blocks == 0u ? 0u
+                                   : std::min(bandwidth, nr_blocks - 1u)),
+        blocks_(nr_blocks_ * (bandwidth_ + 1u), Block::Zero()) {}
+
+  inline size_t getNrBlocks() const { return nr_blocks_; }
+  inline size_t getBandwidth() const { return bandwidth_; }
+  inline size_t rows() const { return nr_blocks_ * BlockSize; }
+
+  // Block (i, j), with i >= j and i - j <= bandwidth.
+  inline Block& block(const size_t& i, const size_t& j) {
+    return blocks_[index(i, j)];
+  }
+  inline const Block& block(const size_t& i, const size_t& j) const {
+    return blocks_[index(i, j)];
+  }
+
+  // Adds B to block (i, j) (and B' to block (j, i)).
+  void addBlock(const size_t& i, const size_t& j, const Block& B) {
+    if (i >= j) {
+      block(i, j) += B;
+    } else {
+      block(j, i) += B.transpose();
+    }
+  }
+
+  // Same matrix with a larger bandwidth (the new blocks are zero).
+  BlockBandedMatrix withBandwidth(const size_t& bandwidth) const {
+    BlockBandedMatrix M(nr_blocks_, std::max(bandwidth, bandwidth_));
+    for (size_t i = 0u; i < nr_blocks_; i++) {
+      for (size_t j = first(i); j <= i; j++) {
+        M.block(i, j) = block(i, j);
+      }
+    }
+    return M;
+  }
+
+  gtsam::Vector diagonal() const {
+    gtsam::Vector d(rows());
+    for (size_t i = 0u; i < nr_blocks_; i++) {
+      d.template segment<BlockSize>(i * BlockSize) = block(i, i).diagonal();
+    }
+    return d;
+  }
+
+  BlockBandedMatrix& operator*=(const double& c) {
+    for (Block& B : blocks_) B *= c;
+    return *this;
+  }
+
+  gtsam::Matrix toDense() const {
+    gtsam::Matrix M = gtsam::Matrix::Zero(rows(), rows());
+    for (size_t i = 0u; i < nr_blocks_; i++) {
+      for (size_t j = first(i); j <= i; j++) {
+        M.template block<BlockSize, BlockSize>(i * BlockSize, j * BlockSize) =
+            block(i, j);
+        M.template block<BlockSize, BlockSize>(j * BlockSize, i * BlockSize) =
+            block(i, j).transpose();
+      }
+    }
+    return M;
+  }
+
+  /* ------------------------------------------------------------------------ */
+  // Information matrix of the given factors, on keys 0, ..., nr_blocks - 1 of
+  // dimension BlockSize (as in the feature selector). The bandwidth is the
+  // one of the nonzero blocks: off-band blocks of a dense factor (e.g.
+  // OmegaBar, a single HessianFactor) are zero if the tracks are short.
+  // Returns false if the factors do not have this structure.
+  static bool FromFactors(
+      const std::vector<gtsam::GaussianFactor::shared_ptr>& factors,
+      BlockBandedMatrix* M) {
+    CHECK_NOTNULL(M);
+    std::vector<gtsam::HessianFactor::shared_ptr> hessians;
+    std::set<gtsam::Key> all_keys;
+    size_t nr_blocks = 0u, bandwidth = 0u;
+    for (const gtsam::GaussianFactor::shared_ptr& factor : factors) {
+      if (!factor || factor->empty()) continue;
+      gtsam::HessianFactor::shared_ptr hessian =
+          boost::dynamic_pointer_cast<gtsam::HessianFactor>(factor);
+      if (!hessian) {
+        hessian = boost::make_shared<gtsam::HessianFactor>(*factor);
+      }
+      const gtsam::KeyVector& keys = hessian->keys();
+      for (size_t a = 0u; a < keys.size(); a++) {
+        if (hessian->getDim(hessian->begin() + a) != BlockSize) return false;
+        nr_blocks = std::max(nr_blocks, size_t(keys[a]) + 1u);
+        all_keys.insert(keys[a]);
+        for (size_t b = 0u; b < a; b++) {
+          if (!hessian->info().block(a, b).isZero(0.0)) {
+            const size_t distance =
+                keys[a] > keys[b] ? keys[a] - keys[b] : keys[b] - keys[a];
+            bandwidth = std::max(bandwidth, distance);
+          }
+        }
+      }
+      hessians.push_back(hessian);
+    }
+    // Keys must be 0, ..., nr_blocks - 1.
+    if (all_keys.size() != nr_blocks) return false;
+
+    *M = BlockBandedMatrix(nr_blocks, bandwidth);
+    for (const gtsam::HessianFactor::shared_ptr& hessian : hessians) {
+      const gtsam::KeyVector& keys = hessian->keys();
+      for (size_t a = 0u; a < keys.size(); a++) {
+        for (size_t b = 0u; b <= a; b++) {
+          const size_t distance =
+              keys[a] > keys[b] ? keys[a] - keys[b] : keys[b] - keys[a];
+          if (distance > M->bandwidth_) continue;  // zero block
+          const Block B = hessian->info().block(a, b);
+          M->addBlock(keys[a], keys[b], B);
+        }
+      }
+    }
+    return true;
+  }
+
+  /* ------------------------------------------------------------------------ */
+  // Block-banded Cholesky factor L (lower triangular, same bandwidth), with
+  // M = L * L'. Returns false if the matrix is not positive definite.
+  bool cholesky(BlockBandedMatrix* L) const {
+    CHECK_NOTNULL(L);
+    *L = BlockBandedMatrix(nr_blocks_, bandwidth_);
+    for (size_t i = 0u; i < nr_blocks_; i++) {
+      for (size_t j = first(i); j <= i; j++) {
+        Block S = block(i, j);
+        for (size_t k = std::max(first(i), first(j)); k < j; k++) {
+          S.noalias() -= L->block(i, k) * L->block(j, k).transpose();
+        }
+        if (i == j) {
+          const Eigen::LLT<Block> llt(S);
+          if (llt.info() != Eigen::Success) return false;
+          L->block(i, i) = llt.matrixL();
+        } else {
+          // L(i, j) = S * L(j, j)^-T
+          L->block(i, j) = L->block(j, j)
+                               .template triangularView<Eigen::Lower>()
+                               .solve(S.transpose())
+                               .transpose();
+        }
+      }
+    }
+    return true;
+  }
+
+  // Log determinant, from the Cholesky factor. Returns false if the matrix
+  // is not positive definite.
+  bool logDeterminant(double* logdet) const {
+    CHECK_NOTNULL(logdet);
+    BlockBandedMatrix L(0u, 0u);
+    if (!cholesky(&L)) return false;
+    *logdet = L.logDeterminantFromCholesky();
+    return true;
+  }
+
+  // Log determinant of L * L', if this is the Cholesky factor L.
+  double logDeterminantFromCholesky() const {
+    double logdet = 0.0;
+    for (size_t i = 0u; i < nr_blocks_; i++) {
+      logdet += block(i, i).diagonal().array().log().sum();
+    }
+    return 2.0 * logdet;
+  }
+
+  // x = (L * L')^-1 * b, if this is the Cholesky factor L.
+  gtsam::Vector solveWithCholesky(const gtsam::Vector& b) const {
+    CHECK_EQ(b.size(), rows());
+    gtsam::Vector y = b;
+    // Forward substitution: L * y = b.
+    for (size_t i = 0u; i < nr_blocks_; i++) {
+      BlockVector yi = y.template segment<BlockSize>(i * BlockSize);
+      for (size_t k = first(i); k < i; k++) {
+        yi.noalias() -=
+            block(i, k) * y.template segment<BlockSize>(k * BlockSize);
+      }
+      y.template segment<BlockSize>(i * BlockSize) =
+          block(i, i).template triangularView<Eigen::Lower>().solve(yi);
+    }
+    // Backward substitution: L' * x = y.
+    for (size_t i = nr_blocks_; i-- > 0u;) {
+      BlockVector xi = y.template segment<BlockSize>(i * BlockSize);
+      for (size_t k = i + 1u; k < std::min(nr_blocks_, i + bandwidth_ + 1u);
+           k++) {
+        xi.noalias() -= block(k, i).transpose() *
+                        y.template segment<BlockSize>(k * BlockSize);
+      }
+      y.template segment<BlockSize>(i * BlockSize) =
+          block(i, i).transpose().template triangularView<Eigen::Upper>().solve(
+              xi);
+    }
+    return y;
+  }
+
+  // Rank-one update of the Cholesky factor L (this), so that L * L' becomes
+  // L * L' + u * u', in O(rows * bandwidth). The band is preserved if the
+  // nonzero blocks of u are within bandwidth of each other: returns false
+  // otherwise (L is not modified).
+  bool choleskyRankUpdate(gtsam::Vector u) {
+    CHECK_EQ(u.size(), rows());
+    size_t begin = 0u, end = 0u;  // scalar rows where u is nonzero
+    for (size_t r = 0u; r < rows(); r++) {
+      if (u(r) == 0.0) continue;
+      if (end == 0u) begin = r;
+      end = r + 1u;
+    }
+    if (end == 0u) return true;
+    if ((end - 1u) / BlockSize - begin / BlockSize > bandwidth_) return false;
+    // Rows of column j within the band: [j + 1, band_end(j)). u stays zero
+    // below the band of the columns processed so far, so there is no fill.
+    const auto band_end = [this](const size_t& j) {
+      return std::min(rows(), (j / BlockSize + bandwidth_ + 1u) * BlockSize);
+    };
+    for (size_t j = begin; j < end; j++) {
+      double& L_jj = coeff(j, j);
+      const double r = std::sqrt(L_jj * L_jj + u(j) * u(j));
+      const double c = r / L_jj;
+      const double s = u(j) / L_jj;
+      L_jj = r;
+      const size_t j_end = band_end(j);
+      for (size_t i = j + 1u; i < j_end; i++) {
+        double& L_ij = coeff(i, j);
+        L_ij = (L_ij + s * u(i)) / c;
+        u(i) = c * u(i) - s * L_ij;
+      }
+      end = std::max(end, j_end);
+    }
+    return true;
+  }
+
+  /* ------------------------------------------------------------------------ */
+  // Smallest eigenvalue and its (unit) eigenvector: Lanczos on the inverse,
+  // using the banded Cholesky factor, since the largest eigenvalues of the
+  // inverse converge fast. Returns false if the matrix is not positive
+  // definite or Lanczos did not converge.
+  bool smallestEigenpair(double* eigenvalue, gtsam::Vector* eigenvector) const {
+    CHECK_NOTNULL(eigenvalue);
+    CHECK_NOTNULL(eigenvector);
+    const size_t n = rows();
+    BlockBandedMatrix L(0u, 0u);
+    if (n == 0u || !cholesky(&L)) return false;
+    const size_t max_steps = std::min(n, kMaxLanczosSteps);
+    gtsam::Matrix Q(n, max_steps);
+    gtsam::Vector alpha(max_steps), beta(max_steps);
+    Q.col(0) = gtsam::Vector::Ones(n) / std::sqrt(double(n));
+    for (size_t k = 0u; k < max_steps; k++) {
+      gtsam::Vector w = L.solveWithCholesky(Q.col(k));
+      alpha(k) = Q.col(k).dot(w);
+      // Full reorthogonalization (twice is enough).
+      for (size_t pass = 0u; pass < 2u; pass++) {
+        w -= Q.leftCols(k + 1) * (Q.leftCols(k + 1).transpose() * w);
+      }
+      beta(k) = w.norm();
+
+      gtsam::Matrix T = gtsam::Matrix::Zero(k + 1, k + 1);
+      T.diagonal() = alpha.head(k + 1);
+      if (k > 0u) {
+        T.diagonal(1) = beta.head(k);
+        T.diagonal(-1) = beta.head(k);
+      }
+      const Eigen::SelfAdjointEigenSolver<gtsam::Matrix> eig(T);
+      const double theta = eig.eigenvalues()(k);
+      // Invariant subspace: the Ritz value might not be the largest one.
+      if (beta(k) <= kLanczosTolerance * std::fabs(alpha(k))) return false;
+      if (std::fabs(beta(k) * eig.eigenvectors()(k, k)) <=
+          kLanczosTolerance * std::fabs(theta)) {
+        *eigenvalue = 1.0 / theta;
+        *eigenvector = Q.leftCols(k + 1) * eig.eigenvectors().col(k);
+        eigenvector->normalize();
+        return true;
+      }
+      if (k + 1u < max_steps) Q.col(k + 1) = w / beta(k);
+    }
+    return false;
+  }
+
+ private:
+  // First column of the band in block row i.
+  inline size_t first(const size_t& i) const {
+    return i > bandwidth_ ? i - bandwidth_ : 0u;
+  }
+
+  // Entry (r, c) of the lower triangle, with r >= c.
+  inline double& coeff(const size_t& r, const size_t& c) {
+    return block(r / BlockSize, c / BlockSize)(r % BlockSize, c % BlockSize);
+  }
+
+  inline size_t index(const size_t& i, const size_t& j) const {
+    DCHECK_GE(i, j);
+    DCHECK_LE(i - j, bandwidth_);
+    DCHECK_LT(i, nr_blocks_);
+    return i * (bandwidth_ + 1u) + (i - j);
+  }
+
+ private:
+  static constexpr size_t kMaxLanczosSteps = 30u;
+  static constexpr double kLanczosTolerance = 1e-8;
+
+  size_t nr_blocks_;
+  size_t bandwidth_;
+  std::vector<Block, Eigen::aligned_allocator<Block>> blocks_;
+};
+
+template <int BlockSize>
+constexpr size_t BlockBandedMatrix<BlockSize>::kMaxLanczosSteps;
+template <int BlockSize>
+constexpr double BlockBandedMatrix<BlockSize>::kLanczosTolerance;
+
+// Information matrices of the feature selector: position, velocity and
+// accelerometer bias at each keyframe of the horizon.
+using SelectorInformationMatrix = BlockBandedMatrix<9>;
+
+}  // namespace VIO
@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureGrid.cpp
+ * @brief  Occupancy of the image by the tracked features, per grid cell.
+ * @author Antoni Rosinol
+ */
+
+#include "FeatureGrid.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+FeatureGrid::FeatureGrid(const cv::Size& img_size,
+                         const int& n_rows,
+                         const int& n_cols,
+                         const int& max_features)
+    : img_size_(img_size),
+      n_rows_(n_rows),
+      n_cols_(n_cols),
+      cell_quota_((max_features + n_rows * n_cols - 1) / (n_rows * n_cols)),
+      occupancy_(n_rows * n_cols, 0) {
+  CHECK_GT(img_size_.width, 0);
+  CHECK_GT(img_size_.height, 0);
+  CHECK_GT(n_rows_, 0);
+  CHECK_GT(n_cols_, 0);
+  CHECK_GE(max_features, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+void FeatureGrid::clear() {
+  std::fill(occupancy_.begin(), occupancy_.end(), 0);
+  nr_features_ = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+void FeatureGrid::add(const KeypointCV& keypoint) {
+  ++occupancy_[getCellIndex(keypoint)];
+  ++nr_features_;
+}
+
+/* -------------------------------------------------------------------------- */
+void FeatureGrid::remove(const KeypointCV& keypoint) {
+  const size_t cell = getCellIndex(keypoint);
+  // Not an error if the grid is out of sync, it gets rebuilt.
+  if (occupancy_[cell] > 0) {
+    --occupancy_[cell];
+    --nr_features_;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void FeatureGrid::move(const KeypointCV& from, const KeypointCV& to) {
+  if (getCellIndex(from) == getCellIndex(to)) return;
+  remove(from);
+  add(to);
+}
+
+/* -------------------------------------------------------------------------- */
+void FeatureGrid::rebuild(const KeypointsCV& keypoints,
+                          const LandmarkIds& landmarks) {
+  CHECK_EQ(keypoints.size(), landmarks.size());
+  clear();
+  for (size_t i = 0u; i < keypoints.size(); i++) {
+    if (landmarks[i] != -1) add(keypoints[i]);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<std::pair<size_t, int>> FeatureGrid::getUnderPopulatedCells()
+    const {
+  std::vector<std::pair<size_t, int>> cells;
+  for (size_t cell = 0u; cell < occupancy_.size(); cell++) {
+    if (occupancy_[cell] < cell_quota_) {
+      cells.push_back(std::make_pair(cell, cell_quota_ - occupancy_[cell]));
+    }
+  }
+  return cells;
+}
+
+/* -------------------------------------------------------------------------- */
+cv::Rect FeatureGrid::getCellRect(const size_t& cell) const {
+  CHECK_LT(cell, occupancy_.size());
+  const int row = static_cast<int>(cell) / n_cols_;
+  const int col = static_cast<int>(cell) % n_cols_;
+  // Pixels p in the cell satisfy floor(p * n_cols_ / width) == col, as in
+  // getCellIndex.
+  const auto first_pixel = [](const int& i, const int& size, const int& n) {
+    return (i * size + n - 1) / n;
+  };
+  const int x0 = first_pixel(col, img_size_.width, n_cols_);
+  const int y0 = first_pixel(row, img_size_.height, n_rows_);
+  const int x1 = first_pixel(col + 1, img_size_.width, n_cols_);
+  const int y1 = first_pixel(row + 1, img_size_.height, n_rows_);
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+/* -------------------------------------------------------------------------- */
+size_t FeatureGrid::getCellIndex(const KeypointCV& keypoint) const {
+  const int x = std::min(std::max(static_cast<int>(keypoint.x), 0),
+                         img_size_.width - 1);
+  const int y = std::min(std::max(static_cast<int>(keypoint.y), 0),
+                         img_size_.height - 1);
+  const int col = x * n_cols_ / img_size_.width;
+  const int row = y * n_rows_ / img_size_.height;
+  return static_cast<size_t>(row * n_cols_ + col);
+}
+
+}  // namespace VIO
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureGrid.h
+ * @brief  Occupancy of the image by the tracked features, per grid cell.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common/vio_types.h"
+
+namespace VIO {
+
+// Splits the image in n_rows x n_cols cells, each with a quota of
+// max_features / (n_rows * n_cols) features, and keeps track of how many
+// features are in each cell, as features are added, moved or lost.
+class FeatureGrid {
+ public:
+  FeatureGrid(const cv::Size& img_size,
+              const int& n_rows,
+              const int& n_cols,
+              const int& max_features);
+  ~FeatureGrid() = default;
+
+  void clear();
+
+  // Keypoints outside of the image (e.g. tracked slightly outside of it) are
+  // counted in the closest cell, so that the grid stays in sync with the
+  // valid keypoints of the frame.
+  void add(const KeypointCV& keypoint);
+  void remove(const KeypointCV& keypoint);
+  void move(const KeypointCV& from, const KeypointCV& to);
+
+  // Recompute the occupancy from scratch with the valid keypoints, only
+  // needed if features are invalidated without updating the grid.
+  void rebuild(const KeypointsCV& keypoints, const LandmarkIds& landmarks);
+
+  // Cells with less features than their quota, and how many features they
+  // are missing.
+  std::vector<std::pair<size_t, int>> getUnderPopulatedCells() const;
+
+  cv::Rect getCellRect(const size_t& cell) const;
+
+  inline size_t getNrCells() const { return occupancy_.size(); }
+  inline int getCellQuota() const { return cell_quota_; }
+  inline int getCellCount(const size_t& cell) const {
+    return occupancy_.at(cell);
+  }
+  inline int getNrFeatures() const { return nr_features_; }
+
+ private:
+  // Keypoints outside of the image are in the closest cell.
+  size_t getCellIndex(const KeypointCV& keypoint) const;
+
+ private:
+  const cv::Size img_size_;
+  const int n_rows_;
+  const int n_cols_;
+  const int cell_quota_;
+  std::vector<int> occupancy_;
+  int nr_features_ = 0;
+};
+
+}  // namespace VIO
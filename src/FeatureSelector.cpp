@@ -17,10 +17,30 @@
  * @author Luca Carlone
  */
 
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+
 #include <boost/filesystem.hpp> // to create folders
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "FeatureSelector.h"
+#include "utils/Diagnostics.h"
+#include "utils/Profiler.h"
+#include "utils/Statistics.h"
+#include "utils/Timer.h"
+
+DEFINE_bool(feature_selection_factor_cache, false,
+            "Reuse the linear vision factors of tracked landmarks across "
+            "keyframes in the feature selector.");
+DEFINE_double(feature_selection_factor_cache_rot_tol, 0.01,
+              "Max change of rotation [rad] of the horizon poses, and of the "
+              "bearing of the landmark from them, to reuse a cached vision "
+              "factor.");
+DEFINE_double(feature_selection_factor_cache_trans_tol, 0.02,
+              "Max change [m] of the landmark in the global frame (plus "
+              "rot_tol times its distance) to reuse a cached vision factor.");
 
 namespace VIO {
 
@@ -29,13 +49,29 @@ static const size_t D = 9;     // "camera" size
 static const size_t ZDim = 6;  // "measurement" size
 static const size_t N = 3;     // size of a point
 
-static bool debug = false;
 static bool testing = false;
 
 static double numericalUpperBound = std::numeric_limits<double>::max();
 // min instead will return a tiny positive number.
 static double numericalLowerBound = -numericalUpperBound;
 
+// Candidates scored per thread between two checks of the lazy stopping
+// condition: larger batches amortize waking up the threads, smaller ones
+// waste fewer evaluations past the stopping point.
+static const size_t kGainBatchPerThread = 2u;
+
+// Calls fn(i) for i in [begin, end), on the thread_pool if any.
+static void ParallelFor(utils::ThreadPool* thread_pool,
+                        const size_t& begin,
+                        const size_t& end,
+                        const std::function<void(const size_t&)>& fn) {
+  if (thread_pool) {
+    thread_pool->parallelFor(begin, end, fn);
+  } else {
+    for (size_t i = begin; i < end; i++) fn(i);
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 StampedPose::StampedPose(const gtsam::Pose3 p, const double t)
     : pose(p), timestampInSec(t) {}
@@ -95,7 +131,16 @@ FeatureSelector::FeatureSelector(const VioFrontEndParams& trackerParams,
       trackerParams.featureSelectionCosineNeighborhood_;
   landmarkDistanceThreshold_ = vioParams.landmarkDistanceThreshold_;
   useLazyEvaluation_ = trackerParams.featureSelectionUseLazyEvaluation_;
+  timeBudget_ = trackerParams.featureSelectionTimeBudget_;
   useSuccessProbabilities_ = trackerParams.useSuccessProbabilities_;
+  CHECK_GE(trackerParams.featureSelectionNrThreads_, 0);
+  thread_pool_ = std::make_shared<utils::ThreadPool>(
+      trackerParams.featureSelectionNrThreads_);
+  if (FLAGS_feature_selection_factor_cache) {
+    vision_factor_cache_ = std::make_shared<LinearVisionFactorCache>(
+        FLAGS_feature_selection_factor_cache_rot_tol,
+        FLAGS_feature_selection_factor_cache_trans_tol);
+  }
   print();
 }
 
@@ -114,6 +159,10 @@ void FeatureSelector::print() const {
             << "landmarkDistanceThreshold_: " << landmarkDistanceThreshold_
             << '\n'
             << "useLazyEvaluation_: " << useLazyEvaluation_ << '\n'
+            << "timeBudget_: " << timeBudget_ << '\n'
+            << "nrThreads: " << thread_pool_->getNrThreads() << '\n'
+            << "visionFactorCache: " << (vision_factor_cache_ != nullptr)
+            << '\n'
             << "useSuccessProbabilities_: " << useSuccessProbabilities_;
 }
 
@@ -151,69 +200,40 @@ FeatureSelector::featureSelectionLinearModel(
     const std::vector<double>& availableCornersDistances,
     const CameraParams& cam_param, const int need_n_corners,
     const FeatureSelectorData& featureSelectionData,
-    const VioFrontEndParams::FeatureSelectionCriterion& criterion) const {
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  double startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
+    const VioFrontEndParams::FeatureSelectionCriterion& criterion,
+    size_t* nrSelectedGreedily) const {
+  VIO_PROFILE_ZONE("FeatureSelector::featureSelectionLinearModel");
+  // the time budget also accounts for the creation of the linear model
+  const auto budgetStart = utils::Timer::tic();
   // create cameras to test reprojection
-  if (debug) {
-    std::cout << "featureSelectionLinearModel: getCameras" << std::endl;
-  }
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "featureSelectionLinearModel: getCameras";
   Cameras left_cameras, right_cameras;
   std::tie(left_cameras, right_cameras) = getCameras(featureSelectionData);
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "getCameras time: "
-            << UtilsOpenCV::GetTimeInSeconds() - startTime << std::endl;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
   // create OmegaBar: includes IMU and existing vision measurements
-  if (debug) {
-    std::cout << "featureSelectionLinearModel: createOmegaBar" << std::endl;
-  }
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "featureSelectionLinearModel: createOmegaBar";
   gtsam::GaussianFactorGraph::shared_ptr OmegaBar =
       createOmegaBar(featureSelectionData, left_cameras, right_cameras);
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "OmegaBar time: " << UtilsOpenCV::GetTimeInSeconds() - startTime
-            << std::endl;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
   // get directions from each (UNCALIBRATED) available corner in left camera at
   // time 0 (cam_param includes also distortion)
-  if (debug) {
-    std::cout << "featureSelectionLinearModel: availableVersors" << std::endl;
-  }
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "featureSelectionLinearModel: availableVersors";
   std::vector<gtsam::Vector3> availableVersors;
   availableVersors.reserve(availableCorners.size());
   for (size_t l = 0; l < availableCorners.size(); l++)
     availableVersors.push_back(
         Frame::CalibratePixel(availableCorners.at(l), cam_param));
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "known points time: "
-            << UtilsOpenCV::GetTimeInSeconds() - startTime << std::endl;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
   // create Deltas for each direction
-  if (debug) {
-    std::cout << "featureSelectionLinearModel: createDeltas" << std::endl;
-  }
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "featureSelectionLinearModel: createDeltas";
   std::vector<gtsam::HessianFactor::shared_ptr> Deltas =
       createDeltas(availableVersors, availableCornersDistances,
                    featureSelectionData, left_cameras, right_cameras);
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "createDeltas time: "
-            << UtilsOpenCV::GetTimeInSeconds() - startTime
-            << "(nr factors, maybe empty: " << Deltas.size() << ")"
-            << std::endl;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
   if (useSuccessProbabilities_) {
     // UtilsOpenCV::PrintVector(successProbabilities,"successProbabilities in
     // selector");
@@ -223,30 +243,38 @@ FeatureSelector::featureSelectionLinearModel(
     }
   }
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "success time: " << UtilsOpenCV::GetTimeInSeconds() - startTime
-            << std::endl;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
   // apply greedy algorithm to select need_n_corners out of the available
   // corners
-  if (debug) {
-    std::cout << "featureSelectionLinearModel: GreedyAlgorithm" << std::endl;
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "featureSelectionLinearModel: GreedyAlgorithm";
+  double remainingTimeBudget = 0.0;
+  if (timeBudget_ > 0.0) {
+    remainingTimeBudget =
+        timeBudget_ -
+        utils::Timer::toc<std::chrono::microseconds>(budgetStart).count() *
+            1e-6;
   }
   std::vector<size_t> selectedIndices;
   std::vector<double> selectedMarginalGains;
-  std::tie(selectedIndices, selectedMarginalGains) = GreedyAlgorithm(
-      OmegaBar, Deltas, need_n_corners, criterion, useLazyEvaluation_);
-
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "Overall time greedy alg: "
-            << UtilsOpenCV::GetTimeInSeconds() - startTime << std::endl;
-#endif
-
-  if (debug) {
-    std::cout << "featureSelectionLinearModel: selectedCorners" << std::endl;
+  if (timeBudget_ > 0.0 && remainingTimeBudget <= 0.0) {
+    // the linear model took the whole budget: select by score
+    VLOG(10) << "featureSelectionLinearModel: time budget of " << timeBudget_
+             << " s expired before the greedy algorithm";
+    const size_t nrToSelect =
+        std::min(size_t(std::max(need_n_corners, 0)), Deltas.size());
+    for (size_t j = 0; j < nrToSelect; j++) {
+      selectedIndices.push_back(j);
+      selectedMarginalGains.push_back(0.0);
+    }
+    if (nrSelectedGreedily) *nrSelectedGreedily = 0;
+  } else {
+    std::tie(selectedIndices, selectedMarginalGains) = GreedyAlgorithm(
+        OmegaBar, Deltas, need_n_corners, criterion, useLazyEvaluation_,
+        thread_pool_.get(), remainingTimeBudget, nrSelectedGreedily);
   }
+
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "featureSelectionLinearModel: selectedCorners";
   KeypointsCV selectedCorners;
   selectedCorners.reserve(selectedIndices.size());
   for (auto ind : selectedIndices)
@@ -276,7 +304,7 @@ FeatureSelector::SortDescending(const std::vector<double>& upperBounds) {
     indValuePairs.push_back(std::make_pair(j, upperBounds.at(j)));
   }
   // sort
-  std::sort(indValuePairs.begin(), indValuePairs.end(), Comparator);
+  std::stable_sort(indValuePairs.begin(), indValuePairs.end(), Comparator);
 
   // unpack into 2 vectors
   std::vector<size_t> ordering;
@@ -329,7 +357,6 @@ FeatureSelector::OrderByUpperBound(
     const VioFrontEndParams::FeatureSelectionCriterion& criterion) {
   std::vector<double> upperBounds;
   upperBounds.reserve(N);  // for lazy evaluation
-  size_t sizeBestOmegaBar = bestOmegaBar->size();
 
   int rank;
   double eigValue;
@@ -339,8 +366,17 @@ FeatureSelector::OrderByUpperBound(
   switch (criterion) {
     case VioFrontEndParams::FeatureSelectionCriterion::MIN_EIG:
       // get eigenvector and smallest eigenvalue of bestOmegaBar
-      boost::tie(rank, eigValue, eigVector) =
-          SmallestEigs(bestOmegaBar->hessian().first);
+      {
+        SelectorInformationMatrix M(0u, 0u);
+        if (!SelectorInformationMatrix::FromFactors(
+                std::vector<gtsam::GaussianFactor::shared_ptr>(
+                    bestOmegaBar->begin(), bestOmegaBar->end()),
+                &M) ||
+            !M.smallestEigenpair(&eigValue, &eigVector)) {
+          boost::tie(rank, eigValue, eigVector) =
+              SmallestEigs(bestOmegaBar->hessian().first);
+        }
+      }
       gainOmegaBar = eigValue;
       for (auto key : bestOmegaBar->keys()) {
         xx.insert(key, eigVector.segment<9>(9 * key));
@@ -359,18 +395,30 @@ FeatureSelector::OrderByUpperBound(
       gainOmegaBar = EvaluateGain(
           bestOmegaBar, boost::make_shared<gtsam::HessianFactor>(), criterion);
       // compute upper bounds det(M) = prod (Mii)
-      for (size_t j = 0; j < Deltas.size(); j++) {  // for each delta
-        if (!Deltas.at(j)->empty()) bestOmegaBar->push_back(Deltas.at(j));
-        gtsam::Vector hessianDiagonal =
-            bestOmegaBar->hessianDiagonal().vector();
-        double sumLogDiag = 0;
+      {
+        // the diagonal of bestOmegaBar + Delta_j is the sum of the diagonals:
+        // only the entries on the keys of Delta_j change, and bestOmegaBar
+        // is not modified
+        const gtsam::VectorValues diagOmegaBar =
+            bestOmegaBar->hessianDiagonal();
+        const gtsam::Vector hessianDiagonal = diagOmegaBar.vector();
+        double sumLogDiagOmegaBar = 0;
         for (size_t k = 0; k < hessianDiagonal.size(); k++) {
-          sumLogDiag += log(hessianDiagonal(k));
+          sumLogDiagOmegaBar += log(hessianDiagonal(k));
+        }
+        for (size_t j = 0; j < Deltas.size(); j++) {  // for each delta
+          double sumLogDiag = sumLogDiagOmegaBar;
+          if (!Deltas.at(j)->empty()) {
+            for (const auto& key_diag : Deltas.at(j)->hessianDiagonal()) {
+              const gtsam::Vector& diag = diagOmegaBar.at(key_diag.first);
+              for (size_t k = 0; k < diag.size(); k++) {
+                sumLogDiag +=
+                    log(diag(k) + key_diag.second(k)) - log(diag(k));
+              }
+            }
+          }
+          upperBounds.push_back(sumLogDiag);
         }
-        upperBounds.push_back(sumLogDiag);
-        bestOmegaBar->resize(
-            sizeBestOmegaBar);  // since bestOmegaBar is a shared pointer, it
-                                // would carry Deltas.at(j)
       }
       break;
     default:
@@ -380,16 +428,17 @@ FeatureSelector::OrderByUpperBound(
   // check that upper bounds are valid
   if (testing) {
     for (size_t j = 0; j < Deltas.size(); j++) {
-      std::cout.precision(20);
-      std::cout << "upb: " << upperBounds.at(j) << " gain: "
-                << EvaluateGain(bestOmegaBar, Deltas.at(j), criterion)
-                << " criterion " << criterion << std::endl;
+      VIO_DIAG(kFeatureSelector, kTrace)
+          << "upb: " << upperBounds.at(j) << " gain: "
+          << EvaluateGain(bestOmegaBar, Deltas.at(j), criterion)
+          << " criterion " << criterion;
       // check with some relative (numerical) tolerance
       if (upperBounds.at(j) <
           (1 - 1e-7) * EvaluateGain(bestOmegaBar, Deltas.at(j), criterion)) {
-        std::cout << "WATCH OUT : upb: " << upperBounds.at(j) << " gain: "
-                  << EvaluateGain(bestOmegaBar, Deltas.at(j), criterion)
-                  << " criterion " << criterion << std::endl;
+        LOG(ERROR) << std::setprecision(20) << "upb: " << upperBounds.at(j)
+                   << " gain: "
+                   << EvaluateGain(bestOmegaBar, Deltas.at(j), criterion)
+                   << " criterion " << criterion;
         throw std::runtime_error("OrderByUpperBound: invalid upper bound");
       }
     }
@@ -408,11 +457,25 @@ FeatureSelector::GreedyAlgorithm(
     const std::vector<gtsam::HessianFactor::shared_ptr>& Deltas,
     const int need_n_corners,
     const VioFrontEndParams::FeatureSelectionCriterion& criterion,
-    const bool useLazyEval) {
+    const bool useLazyEval,
+    utils::ThreadPool* thread_pool,
+    const double timeBudget,
+    size_t* nrSelectedGreedily) {
+  VIO_PROFILE_ZONE("FeatureSelector::GreedyAlgorithm");
   size_t N = Deltas.size();  // nr of available features
+  CHECK_GE(need_n_corners, 0);
+  const size_t nrToSelect = size_t(need_n_corners);
+  // the budget also covers the factorization in the evaluator constructor
+  const auto budgetStart = utils::Timer::tic();
+  const auto budgetExpired = [timeBudget, &budgetStart]() {
+    return timeBudget > 0 &&
+           utils::Timer::toc<std::chrono::microseconds>(budgetStart).count() *
+                   1e-6 >
+               timeBudget;
+  };
 
   // initialize set: we haven't picked any feature yet
-  gtsam::GaussianFactorGraph::shared_ptr bestOmegaBar = OmegaBar->cloneToPtr();
+  IncrementalGainEvaluator evaluator(*OmegaBar, Deltas, criterion);
   std::vector<size_t> selectedIndices;
   std::vector<double> selectedMarginalGains;
   std::vector<size_t> ordering;
@@ -423,68 +486,94 @@ FeatureSelector::GreedyAlgorithm(
   // run greedy
   double nrGainEval = 0;
   double gainOmegaBar = 0;
-  double timeOrdering = 0, timeGreedy = 0;
-  double startTime;
-  for (size_t i = 0; i < need_n_corners;
-       i++) {  // for each feature we have to add
+  bool expired = false;
+  for (size_t i = 0; i < nrToSelect; i++) {  // for each feature we have to add
+    if (budgetExpired()) {
+      expired = true;
+      break;
+    }
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-    startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-    if (useLazyEval) {
-      std::tie(ordering, upperBounds, gainOmegaBar) =
-          OrderByUpperBound(bestOmegaBar, Deltas, criterion);
-    } else {
-      ordering.clear();
-      upperBounds.clear();
-      for (size_t j = 0; j < N; j++) {
-        ordering.push_back(j);  // process sequentially
-        upperBounds.push_back(numericalUpperBound);
+    {
+      VIO_PROFILE_ZONE("FeatureSelector::GreedyAlgorithm ordering");
+      if (useLazyEval) {
+        // the evaluator is only read while scoring: safe to do concurrently
+        upperBounds.assign(N, 0.0);
+        ParallelFor(thread_pool, 0, N, [&evaluator, &upperBounds](
+                                           const size_t& j) {
+          upperBounds[j] = evaluator.upperBound(j);
+        });
+        std::tie(ordering, upperBounds) = SortDescending(upperBounds);
+        gainOmegaBar = evaluator.getGain();
+      } else {
+        ordering.clear();
+        upperBounds.clear();
+        for (size_t j = 0; j < N; j++) {
+          ordering.push_back(j);  // process sequentially
+          upperBounds.push_back(numericalUpperBound);
+        }
+        gainOmegaBar = 0;
       }
-      gainOmegaBar = 0;
     }
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-    timeOrdering += UtilsOpenCV::GetTimeInSeconds() - startTime;
-#endif
 
     int best_j = -1;
     double best_gain_j = numericalLowerBound;
     gtsam::Vector gains = gtsam::Vector::Zero(N);  // only for debug
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-    startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
 
-    // greedly select best index
-    for (size_t indj = 0; indj < N;
-         indj++) {  // loop over all available features and compute gain
-
-      // check lazy stopping condition
-      if (useLazyEval && (best_gain_j > upperBounds.at(indj)))
-        break;  // lazy evaluation is current best is better than sorted upper
-                // bound, then we can stop
-
-      size_t j = ordering.at(
-          indj);  // make sure that we look according to descending upperbounds
-
-      // std::cout << " best_gain_j " << best_gain_j << " best_j " << best_j <<
-      // " j "<< j << " nr keys: " << Deltas.at(j).keys().size() << std::endl;
-      if (inserted(j) == 0 &&
-          (Deltas.at(j)->keys().size() > 0 ||
-           !useLazyEval)) {  // not inserted yet and Delta_j has some info
-        gains(j) = EvaluateGain(bestOmegaBar, Deltas.at(j), criterion);
-        nrGainEval += 1;
-        // std::cout << " gains(j) " << gains(j) << " best_gain_j " <<
-        // best_gain_j << " best_j " << best_j << " j "<< j << std::endl; update
-        // max
-        if (gains(j) > best_gain_j) {
-          best_j = j;
-          best_gain_j = gains(j);
+    // greedly select best index: the gains of a batch of features are
+    // computed concurrently (in descending upperbounds), then the batch is
+    // checked sequentially
+    const size_t batchSize =
+        !useLazyEval ? N
+                     : (thread_pool
+                            ? kGainBatchPerThread * thread_pool->getNrThreads()
+                            : 1);
+    // not inserted yet and Delta_j has some info
+    const auto isCandidate = [&inserted, &Deltas, useLazyEval](size_t j) {
+      return inserted(j) == 0 &&
+             (Deltas.at(j)->keys().size() > 0 || !useLazyEval);
+    };
+    {
+      VIO_PROFILE_ZONE("FeatureSelector::GreedyAlgorithm scoring");
+      for (size_t batchBegin = 0; batchBegin < N; batchBegin += batchSize) {
+        // check lazy stopping condition
+        if (useLazyEval && (best_gain_j > upperBounds.at(batchBegin)))
+          break;  // lazy evaluation is current best is better than sorted upper
+                  // bound, then we can stop
+        // the best feature is unknown until the loop completes: drop it
+        if (budgetExpired()) {
+          expired = true;
+          break;
+        }
+        const size_t batchEnd = std::min(batchBegin + batchSize, N);
+
+        ParallelFor(thread_pool, batchBegin, batchEnd,
+                    [&](const size_t& indj) {
+          size_t j = ordering.at(indj);  // make sure that we look according to
+                                         // descending upperbounds
+          if (isCandidate(j)) {
+            gains(j) = evaluator.evaluateGain(j);
+          } else {          // already selected or empty Delta_j
+            gains(j) = -1;  // we already included this so cannot be selected
+                            // again
+          }
+        });
+
+        for (size_t indj = batchBegin; indj < batchEnd; indj++) {
+          size_t j = ordering.at(indj);
+          nrGainEval += 1;
+          if (!isCandidate(j)) continue;
+          // features past the lazy stopping condition in this batch have
+          // gain <= upperbound < best_gain_j, so they cannot win. Ties go to
+          // the lowest index, whatever the order of evaluation
+          if (gains(j) > best_gain_j ||
+              (gains(j) == best_gain_j && int(j) < best_j)) {
+            best_j = j;
+            best_gain_j = gains(j);
+          }
         }
-      } else {          // already selected or empty Delta_j
-        gains(j) = -1;  // we already included this so cannot be selected again
-        nrGainEval += 1;
       }
     }
+    if (expired) break;
     // if no feature won, pick the first that was not taken (features are
     // ordered by quality)
     if (best_gain_j == numericalLowerBound) {
@@ -498,12 +587,9 @@ FeatureSelector::GreedyAlgorithm(
     // std::cout << "gains.sortDescending(): " << gains.sortDescending() <<
     // std::endl;
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-    timeGreedy += UtilsOpenCV::GetTimeInSeconds() - startTime;
-#endif
     // std::cout << "gains: " << gains.transpose() << std::endl;
     // add to current set
-    bestOmegaBar->push_back(Deltas.at(best_j));
+    evaluator.add(best_j);
     selectedIndices.push_back(best_j);
     selectedMarginalGains.push_back(best_gain_j -
                                     gainOmegaBar);  // marginal gains
@@ -511,16 +597,25 @@ FeatureSelector::GreedyAlgorithm(
     inserted(best_j) = 1;
   }
 
+  if (nrSelectedGreedily) *nrSelectedGreedily = selectedIndices.size();
+  if (expired) {
+    VLOG(10) << "greedyAlgorithm: time budget of " << timeBudget
+             << " s expired after " << selectedIndices.size() << "/"
+             << need_n_corners << " features";
+    // pick the remaining features by score (features are ordered by quality)
+    for (size_t j = 0; j < N && selectedIndices.size() < nrToSelect; j++) {
+      if (inserted(j) == 0) {
+        selectedIndices.push_back(j);
+        selectedMarginalGains.push_back(0.0);
+        inserted(j) = 1;
+      }
+    }
+  }
+
   double relNrGainEval = nrGainEval / double(N * need_n_corners);
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "-- -- greedyAlgorithm: Ordering time: " << timeOrdering
-            << std::endl;
-  std::cout << "-- -- greedyAlgorithm: Greedy time: " << timeGreedy
-            << std::endl;
-#endif
-  std::cout << "-- -- greedyAlgorithm: nrGainEval: " << nrGainEval << "/"
-            << N * need_n_corners << " (relative: " << relNrGainEval << ") "
-            << std::endl;
+  VIO_DIAG(kFeatureSelector, kDebug)
+      << "-- -- greedyAlgorithm: nrGainEval: " << nrGainEval << "/"
+      << N * need_n_corners << " (relative: " << relNrGainEval << ")";
   return std::make_pair(selectedIndices, selectedMarginalGains);
 }
 
@@ -545,17 +640,16 @@ boost::tuple<int, double, gtsam::Vector> FeatureSelector::SmallestEigsPowerIter(
     normx = x.norm();
     x = x / normx;
     if ((x - xold).norm() < tol) {
-      std::cout << "Largest eig: " << normx << "(iters: " << iter << ")"
-                << std::endl;
+      VIO_DIAG(kFeatureSelector, kTrace)
+          << "Largest eig: " << normx << " (iters: " << iter << ")";
       reachedMaxIter = false;
       break;
     }
     xold = x;
   }
   double lambdaMax = normx;
-  if (reachedMaxIter)
-    std::cout << "LargestEigsFast: reached maximum number of iterations"
-              << std::endl;
+  LOG_IF(WARNING, reachedMaxIter)
+      << "LargestEigsFast: reached maximum number of iterations";
 
   for (size_t i = 0; i < M.cols(); ++i) x(i) = rand();
   // B = -(A - lambdaMax * I) = -A + lambdaMax*I
@@ -571,16 +665,15 @@ boost::tuple<int, double, gtsam::Vector> FeatureSelector::SmallestEigsPowerIter(
     normx = x.norm();
     x = x / normx;
     if ((x - xold).norm() < tol) {
-      std::cout << "Smallest eig: " << normx << "(iters: " << iter << ")"
-                << std::endl;
+      VIO_DIAG(kFeatureSelector, kTrace)
+          << "Smallest eig: " << normx << " (iters: " << iter << ")";
       reachedMaxIter = false;
       break;
     }
     xold = x;
   }
-  if (reachedMaxIter)
-    std::cout << "SmallestEigsPowerIter: reached maximum number of iterations"
-              << std::endl;
+  LOG_IF(WARNING, reachedMaxIter)
+      << "SmallestEigsPowerIter: reached maximum number of iterations";
 
   int rank = -1;
   double error = -normx + lambdaMax;
@@ -654,6 +747,28 @@ double FeatureSelector::EvaluateGain(
     const gtsam::HessianFactor::shared_ptr& Deltaj,
     const VioFrontEndParams::FeatureSelectionCriterion& criterion,
     bool useDenseMatrices) {
+  if (useDenseMatrices) {
+    // OmegaBar + Deltaj is block-banded, since the tracks are shorter than
+    // the horizon: factorize it in O(n * bandwidth^2), without touching
+    // OmegaBar. Falls back to the dense routines below otherwise.
+    std::vector<gtsam::GaussianFactor::shared_ptr> factors(OmegaBar->begin(),
+                                                           OmegaBar->end());
+    factors.push_back(Deltaj);
+    SelectorInformationMatrix M(0u, 0u);
+    if (SelectorInformationMatrix::FromFactors(factors, &M)) {
+      double gain;
+      gtsam::Vector eigVector;
+      if (criterion == VioFrontEndParams::FeatureSelectionCriterion::LOGDET &&
+          M.logDeterminant(&gain)) {
+        return gain;
+      }
+      if (criterion == VioFrontEndParams::FeatureSelectionCriterion::MIN_EIG &&
+          M.smallestEigenpair(&gain, &eigVector)) {
+        return gain;
+      }
+    }
+  }
+
   // augment graph
   size_t sizeOmegaBar = OmegaBar->size();
   // gtsam::GaussianFactorGraph::shared_ptr OmegaBar_U_Deltaj = OmegaBar;
@@ -670,8 +785,8 @@ double FeatureSelector::EvaluateGain(
         MIN_EIG:  // picks the best features that maximize the smallest
                   // eigenvalue of the covariance
       if (!useDenseMatrices) {
-        std::cout << "EvaluateGain: useDenseMatrices is deprecated"
-                  << std::endl;
+        LOG_FIRST_N(WARNING, 1)
+            << "EvaluateGain: useDenseMatrices is deprecated";
         // NOTE (Luca): 2x slower than SmallestEigs
         boost::tie(rank, gain, eigVector) =
             SmallestEigsPowerIter(OmegaBar->hessian().first);
@@ -688,8 +803,8 @@ double FeatureSelector::EvaluateGain(
         LOGDET:  // picks the best features that maximize the logdet of the
                  // covariance
       if (!useDenseMatrices) {
-        std::cout << "EvaluateGain: useDenseMatrices is deprecated"
-                  << std::endl;
+        LOG_FIRST_N(WARNING, 1)
+            << "EvaluateGain: useDenseMatrices is deprecated";
         // NOTE (Luca): this seems slightly slower than
         // Logdet(OmegaBar->hessian().first): 0.032 vs 0.030 also, sparse
         // version sometimes gives: terminate called after throwing an instance
@@ -853,9 +968,7 @@ FeatureSelector::createMatricesLinearImuFactor(
 
   // sanity check
   if ((Rj_rot.matrix() - Rh).norm() > 1e-2) {
-    std::cout << "Rj_rot \n"
-              << Rj_rot.matrix() << "\n Rh \n"
-              << Rh << std::endl;
+    LOG(ERROR) << "Rj_rot \n" << Rj_rot.matrix() << "\n Rh \n" << Rh;
     throw std::runtime_error("createOmegaBar: Rh integration is inconsistent");
   }
 
@@ -870,6 +983,7 @@ FeatureSelector::createMatricesLinearImuFactor(
 /* ------------------------------------------------------------------------ */
 gtsam::GaussianFactorGraph FeatureSelector::createOmegaBarImuAndPrior(
     const FeatureSelectorData& featureSelectionData) const {
+  VIO_PROFILE_ZONE("FeatureSelector::createOmegaBarImuAndPrior");
   const KeyframeToStampedPose& posesAtFutureKeyframes =
       featureSelectionData.posesAtFutureKeyframes;
 
@@ -916,9 +1030,8 @@ gtsam::GaussianFactorGraph FeatureSelector::createOmegaBarImuAndPrior(
 // "predict" ground truth measurements
 gtsam::HessianFactor::shared_ptr FeatureSelector::createLinearVisionFactor(
     const gtsam::Point3& pworld_l, const Cameras& left_cameras,
-    const Cameras& right_cameras, double& debugFETime, double& debugSVDTime,
-    double& debugSchurTime,  // debug
-    const int keypointLife, bool hasRightPixel) const {
+    const Cameras& right_cameras, const int keypointLife,
+    bool hasRightPixel) const {
   // compute track lenght, depending on horizon and keypointLife
   size_t nrKeyframesInHorizon =
       std::min(left_cameras.size(), size_t(keypointLife));
@@ -932,107 +1045,117 @@ gtsam::HessianFactor::shared_ptr FeatureSelector::createLinearVisionFactor(
   gtsam::Matrix69 ZeroMat69 = gtsam::Matrix69::Zero();
   gtsam::Vector b = gtsam::Vector::Zero(6 * nrKeyframesInHorizon);
 
-  if (debug) {
-    std::cout << "createLinearVisionFactor: before loop " << std::endl;
-  }
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "createLinearVisionFactor: before loop";
   // reproject in each camera and build corresponding Jacobian
-
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  double startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
   bool featureTrackInterrupted = false;  // unfortunately, we always populate
                                          // the data structures, even with zeros
-  for (size_t c = 0; c < nrKeyframesInHorizon; c++) {
-    keys.push_back(c);
-    FBlocks.push_back(ZeroMat69);  // initialization
-    // try to project point to left camera: if point is in FOV, add to Jacobians
-    boost::optional<gtsam::Unit3> uij_left = FeatureSelector::GetVersorIfInFOV(
-        left_cameras.at(c), pworld_l, landmarkDistanceThreshold_);
-    if (uij_left &&
-        !featureTrackInterrupted) {  // if point was in field of view
-      gtsam::Matrix3 uijx_RkRcamTran =
-          sqrtInfoVision_ * uij_left->skew() *
-          (left_cameras.at(c)).pose().rotation().matrix().transpose();
-      FBlocks.at(c).block<3, 3>(0, 0) = -uijx_RkRcamTran;
-      E.block<3, 3>(6 * c, 0) = uijx_RkRcamTran;
-    } else {
-      featureTrackInterrupted = true;  // we lost the feature track!
-    }
-    if (!hasRightPixel || !useStereo_) {
-      continue;
-    }  // otherwise those blocks remain zeros
-    // try to project point to left camera: if point is in FOV, add to Jacobians
-    boost::optional<gtsam::Unit3> uij_right = FeatureSelector::GetVersorIfInFOV(
-        right_cameras.at(c), pworld_l, landmarkDistanceThreshold_);
-    if (uij_right &&
-        !featureTrackInterrupted) {  // if point was in field of view
-      gtsam::Matrix3 uijx_RkRcamTran =
-          sqrtInfoVision_ * uij_right->skew() *
-          (right_cameras.at(c)).pose().rotation().matrix().transpose();
-      FBlocks.at(c).block<3, 3>(3, 0) = -uijx_RkRcamTran;
-      E.block<3, 3>(6 * c + 3, 0) = uijx_RkRcamTran;
+  {
+    VIO_PROFILE_ZONE("FeatureSelector::createLinearVisionFactor jacobians");
+    for (size_t c = 0; c < nrKeyframesInHorizon; c++) {
+      keys.push_back(c);
+      FBlocks.push_back(ZeroMat69);  // initialization
+      // try to project point to left camera: if point is in FOV, add to
+      // Jacobians
+      boost::optional<gtsam::Unit3> uij_left =
+          FeatureSelector::GetVersorIfInFOV(left_cameras.at(c), pworld_l,
+                                            landmarkDistanceThreshold_);
+      if (uij_left &&
+          !featureTrackInterrupted) {  // if point was in field of view
+        gtsam::Matrix3 uijx_RkRcamTran =
+            sqrtInfoVision_ * uij_left->skew() *
+            (left_cameras.at(c)).pose().rotation().matrix().transpose();
+        FBlocks.at(c).block<3, 3>(0, 0) = -uijx_RkRcamTran;
+        E.block<3, 3>(6 * c, 0) = uijx_RkRcamTran;
+      } else {
+        featureTrackInterrupted = true;  // we lost the feature track!
+      }
+      if (!hasRightPixel || !useStereo_) {
+        continue;
+      }  // otherwise those blocks remain zeros
+      // try to project point to left camera: if point is in FOV, add to
+      // Jacobians
+      boost::optional<gtsam::Unit3> uij_right =
+          FeatureSelector::GetVersorIfInFOV(right_cameras.at(c), pworld_l,
+                                            landmarkDistanceThreshold_);
+      if (uij_right &&
+          !featureTrackInterrupted) {  // if point was in field of view
+        gtsam::Matrix3 uijx_RkRcamTran =
+            sqrtInfoVision_ * uij_right->skew() *
+            (right_cameras.at(c)).pose().rotation().matrix().transpose();
+        FBlocks.at(c).block<3, 3>(3, 0) = -uijx_RkRcamTran;
+        E.block<3, 3>(6 * c + 3, 0) = uijx_RkRcamTran;
+      }
     }
   }
-  if (debug && featureTrackInterrupted) {
-    std::cout << "Feature track was broken before " << nrKeyframesInHorizon
-              << " keyframes" << std::endl;
-  }
-  if (debug) {
-    std::cout << "createLinearVisionFactor: after loop " << std::endl;
-  }
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  debugFETime += UtilsOpenCV::GetTimeInSeconds() - startTime;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
+  VIO_DIAG_IF(kFeatureSelector, kTrace, featureTrackInterrupted)
+      << "Feature track was broken before " << nrKeyframesInHorizon
+      << " keyframes";
+  VIO_DIAG(kFeatureSelector, kTrace) << "createLinearVisionFactor: after loop";
 
   // do Schur complement and populate Hessian factor
-  gtsam::Matrix3 Pinv = E.transpose() * E;
-  if (debug) {
-    std::cout << "Pinv \n " << Pinv << std::endl;
-  }
-  int rank;
-  double minSv;
-  gtsam::Vector eigVector;
-  boost::tie(rank, minSv, eigVector) = SmallestEigs(Pinv);
-  // std::cout << " minSv " << minSv << std::endl;
-  if (minSv < 1e-9)
-    return boost::make_shared<gtsam::HessianFactor>();  // point cannot be
-                                                        // triangulated, factor
-                                                        // is useless
-
-  gtsam::Matrix3 P = Pinv.inverse();
-  if (debug) {
-    std::cout << "P \n " << P << std::endl;
+  gtsam::Matrix3 P;
+  {
+    VIO_PROFILE_ZONE("FeatureSelector::createLinearVisionFactor svd");
+    gtsam::Matrix3 Pinv = E.transpose() * E;
+    VIO_DIAG(kFeatureSelector, kTrace) << "Pinv \n " << Pinv;
+    int rank;
+    double minSv;
+    gtsam::Vector eigVector;
+    boost::tie(rank, minSv, eigVector) = SmallestEigs(Pinv);
+    if (minSv < 1e-9)
+      return boost::make_shared<gtsam::HessianFactor>();  // point cannot be
+                                                          // triangulated,
+                                                          // factor is useless
+
+    P = Pinv.inverse();
+    VIO_DIAG(kFeatureSelector, kTrace) << "P \n " << P;
   }
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  debugSVDTime += UtilsOpenCV::GetTimeInSeconds() - startTime;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
   // get Hessian matrix from Schur Complement (get rid of point pworld_l)
+  VIO_PROFILE_ZONE("FeatureSelector::createLinearVisionFactor schur");
   gtsam::SymmetricBlockMatrix H = SchurComplement(FBlocks, E, P, b);
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  debugSchurTime += UtilsOpenCV::GetTimeInSeconds() - startTime;
-#endif
-
   return boost::make_shared<gtsam::HessianFactor>(keys, H);
 }
 
+/* ------------------------------------------------------------------------ */
+gtsam::HessianFactor::shared_ptr
+FeatureSelector::createLinearVisionFactorCached(
+    const LandmarkId& lmkId, const gtsam::Point3& p_l_camL0,
+    const Cameras& left_cameras, const Cameras& right_cameras,
+    const int keypointLife) const {
+  CHECK(vision_factor_cache_);
+  CHECK(!left_cameras.empty());
+  // the landmark is static in the global frame, which keeps the entries
+  // valid across keyframes while the horizon moves with the robot
+  const gtsam::Point3 pworld_l = left_cameras.at(0).pose() * p_l_camL0;
+  std::vector<gtsam::Pose3> W_Pose_camsL;
+  W_Pose_camsL.reserve(left_cameras.size());
+  for (const Camera& camera : left_cameras) {
+    W_Pose_camsL.push_back(camera.pose());
+  }
+  size_t nrKeyframesInHorizon =
+      std::min(left_cameras.size(), size_t(keypointLife));
+
+  gtsam::HessianFactor::shared_ptr H_l = vision_factor_cache_->find(
+      lmkId, pworld_l, W_Pose_camsL, nrKeyframesInHorizon, true);
+  if (!H_l) {
+    H_l = createLinearVisionFactor(pworld_l, left_cameras, right_cameras,
+                                   keypointLife);
+    vision_factor_cache_->insert(lmkId, pworld_l, W_Pose_camsL,
+                                 nrKeyframesInHorizon, true, H_l);
+  }
+  return H_l;
+}
+
 /* ------------------------------------------------------------------------ */
 gtsam::GaussianFactorGraph::shared_ptr FeatureSelector::createOmegaBar(
     const FeatureSelectorData& featureSelectionData,
     const Cameras& left_cameras, const Cameras& right_cameras) const {
+  VIO_PROFILE_ZONE("FeatureSelector::createOmegaBar");
   // 1) add imu factors
-
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  double startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
-  if (debug) {
-    std::cout << "createOmegaBar: createOmegaBar" << std::endl;
-  }
+  VIO_DIAG(kFeatureSelector, kTrace) << "createOmegaBar: createOmegaBar";
   gtsam::GaussianFactorGraph OmegaBar =
       createOmegaBarImuAndPrior(featureSelectionData);
   if (testing) {
@@ -1042,50 +1165,53 @@ gtsam::GaussianFactorGraph::shared_ptr FeatureSelector::createOmegaBar(
     }
   }
 
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "-- createOmegaBar: createOmegaBar time: "
-            << UtilsOpenCV::GetTimeInSeconds() - startTime << std::endl;
-  startTime = UtilsOpenCV::GetTimeInSeconds();
-#endif
-
-  double debugFETime = 0;
-  double debugSVDTime = 0;
-  double debugSchurTime = 0;
+  const size_t nrCacheLookups =
+      vision_factor_cache_ ? vision_factor_cache_->getNrLookups() : 0;
+  const size_t nrCacheHits =
+      vision_factor_cache_ ? vision_factor_cache_->getNrHits() : 0;
   // 2) add linear vision factors for existing features
-  for (size_t l = 0; l < featureSelectionData.keypoints_3d.size(); l++) {
-    // 3D point in local frame of first camera
-    gtsam::Point3 p_l_camL0 =
-        gtsam::Point3(featureSelectionData.keypoints_3d.at(l));
-    // convert to global frame (point are expressed wrt camera 0)
-    gtsam::Point3 pworld_l =
-        left_cameras.at(0).pose() *
-        p_l_camL0;  // overload for tranform_from (converts to global frame)
-    // add to graph
-    gtsam::HessianFactor::shared_ptr H_l = createLinearVisionFactor(
-        pworld_l, left_cameras, right_cameras, debugFETime, debugSVDTime,
-        debugSchurTime, featureSelectionData.keypointLife.at(l));
-    if (!H_l->empty())  // if not empty
-      OmegaBar.push_back(H_l);
+  {
+    VIO_PROFILE_ZONE("FeatureSelector::createOmegaBar vision factors");
+    for (size_t l = 0; l < featureSelectionData.keypoints_3d.size(); l++) {
+      // 3D point in local frame of first camera
+      gtsam::Point3 p_l_camL0 =
+          gtsam::Point3(featureSelectionData.keypoints_3d.at(l));
+      gtsam::HessianFactor::shared_ptr H_l;
+      if (vision_factor_cache_ && l < featureSelectionData.landmarkIds.size()) {
+        H_l = createLinearVisionFactorCached(
+            featureSelectionData.landmarkIds.at(l), p_l_camL0, left_cameras,
+            right_cameras, featureSelectionData.keypointLife.at(l));
+      } else {
+        // convert to global frame (point are expressed wrt camera 0)
+        gtsam::Point3 pworld_l =
+            left_cameras.at(0).pose() *
+            p_l_camL0;  // overload for tranform_from (converts to global frame)
+        H_l = createLinearVisionFactor(
+            pworld_l, left_cameras, right_cameras,
+            featureSelectionData.keypointLife.at(l));
+      }
+      // add to graph
+      if (!H_l->empty())  // if not empty
+        OmegaBar.push_back(H_l);
+    }
   }
-
-#ifdef FEATURE_SELECTOR_DEBUG_COUT
-  std::cout << "-- createOmegaBar: createLinearVisionFactor time : "
-            << UtilsOpenCV::GetTimeInSeconds() - startTime
-            << "(nr factors: " << featureSelectionData.keypoints_3d.size()
-            << ")" << std::endl;
-  std::cout << "-- -- createLinearVisionFactor: debugFETime_ " << debugFETime
-            << std::endl;
-  std::cout << "-- -- createLinearVisionFactor: debugSVDTime_ " << debugSVDTime
-            << std::endl;
-  std::cout << "-- -- createLinearVisionFactor: debugSchurTime_ "
-            << debugSchurTime << std::endl;
-  std::cout << "-- -- createLinearVisionFactor: sum "
-            << debugFETime + debugSVDTime + debugSchurTime << std::endl;
-#endif
-
-  if (debug) {
-    std::cout << "createOmegaBar: done createLinearVisionFactor" << std::endl;
+  if (vision_factor_cache_) {
+    // landmarks that were not observed anymore are not tracked
+    vision_factor_cache_->removeUnused();
+    const size_t nrLookups =
+        vision_factor_cache_->getNrLookups() - nrCacheLookups;
+    const size_t nrHits = vision_factor_cache_->getNrHits() - nrCacheHits;
+    if (nrLookups > 0) {
+      VLOG(10) << "createOmegaBar: vision factor cache hits: " << nrHits
+               << "/" << nrLookups << " (overall hit rate: "
+               << vision_factor_cache_->getHitRate() << ")";
+      utils::StatsCollector("FeatureSelector Vision Factor Cache Hit Rate [%]")
+          .AddSample(100.0 * double(nrHits) / double(nrLookups));
+    }
   }
+
+  VIO_DIAG(kFeatureSelector, kTrace)
+      << "createOmegaBar: done createLinearVisionFactor";
   gtsam::HessianFactor OmegaBar_H = gtsam::HessianFactor(
       OmegaBar);  // convert the factor graph into a single factor
   OmegaBar.resize(0);
@@ -1106,6 +1232,7 @@ std::vector<gtsam::HessianFactor::shared_ptr> FeatureSelector::createDeltas(
     const std::vector<double>& availableCornersDistances,
     const FeatureSelectorData& featureSelectionData,
     const Cameras& left_cameras, const Cameras& right_cameras) const {
+  VIO_PROFILE_ZONE("FeatureSelector::createDeltas");
   // sanity check:
   if (availableVersors.size() != availableCornersDistances.size())
     throw std::runtime_error("createDeltas: distance vector size mismatch");
@@ -1150,13 +1277,10 @@ std::vector<gtsam::HessianFactor::shared_ptr> FeatureSelector::createDeltas(
 
     // add to Deltas
     // NOTE: we always need to push_back to Deltas since order is important here
-    double debugFETime = 0;
-    double debugSVDTime = 0;
-    double debugSchurTime = 0;
-    Deltas.push_back(createLinearVisionFactor(
-        pworld_l, left_cameras, right_cameras, debugFETime, debugSVDTime,
-        debugSchurTime, 1e9,  // infinite life
-        hasRightPixel));
+    Deltas.push_back(createLinearVisionFactor(pworld_l, left_cameras,
+                                              right_cameras,
+                                              1e9,  // infinite life
+                                              hasRightPixel));
   }
   return Deltas;
 }
@@ -1259,7 +1383,9 @@ FeatureSelector::splitTrackedAndNewFeatures_Select_Display(
     const int& nrFeaturesToSelect, const int& maxFeatureAge,
     const KeyframeToStampedPose& posesAtFutureKeyframes,
     const gtsam::Matrix& curr_state_cov, const std::string& dataset_name,
-    const Frame& frame_km1) {
+    const Frame& frame_km1, size_t* nrSelectedGreedily, bool* budgetExpired) {
+  if (nrSelectedGreedily) *nrSelectedGreedily = 0;
+  if (budgetExpired) *budgetExpired = false;
   // ToDo init to invalid value.
   gtsam::Matrix currNavStateCovariance;
   if (criterion != VioFrontEndParams::FeatureSelectionCriterion::QUALITY) {
@@ -1409,6 +1535,7 @@ FeatureSelector::splitTrackedAndNewFeatures_Select_Display(
       VLOG(20) << "Selector: populating data about existing feature tracks.";
       // Current 3D points.
       featureSelectionData.keypoints_3d = trackedkeypoints_3d;
+      featureSelectionData.landmarkIds = trackedLmks;
       featureSelectionData.keypointLife.reserve(trackedLandmarksAge.size());
       for (const int& age : trackedLandmarksAge) {
         // Compute age as maxFeatureAge_ - current age.
@@ -1432,8 +1559,8 @@ FeatureSelector::splitTrackedAndNewFeatures_Select_Display(
       featureSelectionData.right_undistRectCameraMatrix =
           stereoFrame_km1->getRightUndistRectCamMat();
       // ------------------ DATA ABOUT NEW FEATURES: ----------------- //
-      std::cout << "selector: populating data about new feature tracks"
-                << std::endl;
+      VIO_DIAG(kFeatureSelector, kDebug)
+          << "selector: populating data about new feature tracks";
       KeypointsCV corners;
       std::vector<double> successProbabilities;
       if (newlyAvailableKeypointsScore.size() !=
@@ -1450,8 +1577,10 @@ FeatureSelector::splitTrackedAndNewFeatures_Select_Display(
             newlyAvailableKeypointsScore.at(
                 0));  // normalized wrt largest (starting from 1 and decreasing)
       }
-      UtilsOpenCV::PrintVector<double>(successProbabilities,
-                                       "successProbabilities");
+      if (VIO_DIAG_ENABLED(kFeatureSelector, kTrace)) {
+        UtilsOpenCV::PrintVector<double>(successProbabilities,
+                                         "successProbabilities");
+      }
 
       // featureSelectionData.print();
       const gtsam::Cal3_S2& K = stereoFrame_km1->getLeftUndistRectCamMat();
@@ -1466,18 +1595,28 @@ FeatureSelector::splitTrackedAndNewFeatures_Select_Display(
       cam_param.distortion_coeff_ =
           cv::Mat::zeros(1, 5, CV_64F);  // undistorted points
 
-      std::cout << "selector: calling selector" << std::endl;
+      VIO_DIAG(kFeatureSelector, kDebug) << "selector: calling selector";
       double startTime = UtilsOpenCV::GetTimeInSeconds();
+      size_t nrGreedy = 0;
       std::tie(corners, selectedIndices, selectedGains) =
           featureSelectionLinearModel(
               corners,                          // undistorted and rectified
               successProbabilities,             // in [0,1] for each corner
               newlyAvailableKeypointsDistance,  // 0 if not available
               cam_param,  // note: corners are undistorted and rectified
-              need_nr_features, featureSelectionData, criterion);
+              need_nr_features, featureSelectionData, criterion, &nrGreedy);
       featureSelectionTime = UtilsOpenCV::GetTimeInSeconds() - startTime;
-      UtilsOpenCV::PrintVector<size_t>(selectedIndices, "selectedIndices");
-      UtilsOpenCV::PrintVector<double>(selectedGains, "selectedGains");
+      if (nrSelectedGreedily) *nrSelectedGreedily = nrGreedy;
+      const bool expired = nrGreedy < size_t(need_nr_features);
+      if (budgetExpired) *budgetExpired = expired;
+      if (expired) {
+        utils::StatsCollector("FeatureSelector Time Budget Expired [#]")
+            .AddSample(1);
+      }
+      if (VIO_DIAG_ENABLED(kFeatureSelector, kTrace)) {
+        UtilsOpenCV::PrintVector<size_t>(selectedIndices, "selectedIndices");
+        UtilsOpenCV::PrintVector<double>(selectedGains, "selectedGains");
+      }
     }
 
     //////////////////////////////////////////////////////////////////////////
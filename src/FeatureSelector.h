@@ -19,6 +19,7 @@
 #ifndef FeatureSelector_H_
 #define FeatureSelector_H_
 
+#include <memory>
 #include <random>
 
 // TODO clean number of include files, adds extra dependencies for ppl that
@@ -30,11 +31,15 @@
 #include <gtsam/geometry/CameraSet.h>
 #include <gtsam/inference/Symbol.h>
 
+#include "BlockBandedMatrix.h"
+#include "IncrementalGainEvaluator.h"
+#include "LinearVisionFactorCache.h"
 #include "VioBackEndParams.h"
 #include "VioFrontEndParams.h"
 #include "Frame.h"
 #include "StereoFrame.h"
 #include "UtilsOpenCV.h"
+#include "utils/ThreadPool.h"
 
 //#define useSpectra
 #ifdef useSpectra
@@ -44,8 +49,6 @@
 #include <MatOp/DenseSymShiftSolve.h>
 #endif
 
-//#define FEATURE_SELECTOR_DEBUG_COUT
-
 namespace VIO {
 struct StampedPose{
 public:
@@ -72,6 +75,7 @@ public:
 
   std::vector<gtsam::Vector3> keypoints_3d;
   std::vector<int> keypointLife; // for each keypoint, based on their age and the max track length
+  LandmarkIds landmarkIds; // for each keypoint, to cache its vision factor (optional)
 
   FeatureSelectorData();
 
@@ -96,9 +100,14 @@ public:
   double imuDeltaT_;
   bool useStereo_;
   bool useLazyEvaluation_;
+  double timeBudget_;  // 0: no budget
   double featureSelectionDefaultDepth_, featureSelectionCosineNeighborhood_,
   landmarkDistanceThreshold_;
   bool useSuccessProbabilities_;
+  // Scores the candidates of the greedy selection, shared by copies.
+  std::shared_ptr<utils::ThreadPool> thread_pool_;
+  // Vision factors of the tracked landmarks, null if caching is disabled.
+  std::shared_ptr<LinearVisionFactorCache> vision_factor_cache_;
 
   // Constructor.
   FeatureSelector(const VioFrontEndParams& trackerParams = VioFrontEndParams(),
@@ -122,7 +131,8 @@ public:
       const CameraParams& cam_param,
       const int need_n_corners,
       const FeatureSelectorData& featureSelectionData,
-      const VioFrontEndParams::FeatureSelectionCriterion& criterion) const;
+      const VioFrontEndParams::FeatureSelectionCriterion& criterion,
+      size_t* nrSelectedGreedily = nullptr) const;
 
   /* ------------------------------------------------------------------------ */
   static bool Comparator(const std::pair<size_t,double>& l,
@@ -130,7 +140,7 @@ public:
 
   /* ------------------------------------------------------------------------ */
   // Sort upperBounds in descending order, storing the corresponding indices in the second
-  // output argument (as in matlab sort).
+  // output argument (as in matlab sort). Equal upper bounds keep their order.
   static std::pair< std::vector<size_t>,std::vector<double> >
   SortDescending(const std::vector<double>& upperBounds);
 
@@ -148,12 +158,25 @@ public:
                     const VioFrontEndParams::FeatureSelectionCriterion& criterion);
 
   /* ------------------------------------------------------------------------ */
+  // Gains are evaluated incrementally by an IncrementalGainEvaluator,
+  // equivalent to EvaluateGain on OmegaBar plus the selected Deltas.
+  // If a thread_pool is given, upper bounds and gains are evaluated
+  // concurrently (gains in batches, in descending order of upper bound, when
+  // using lazy evaluation). Ties are broken by the lowest index, so the
+  // selection does not depend on the number of threads.
+  // If timeBudget [s] is positive and expires, the features selected so far
+  // are kept and the remaining ones are the first available ones (features
+  // are ordered by score), with zero marginal gain. nrSelectedGreedily is the
+  // number of features that were selected greedily.
   static std::pair< std::vector<size_t>,std::vector<double> >
   GreedyAlgorithm(const gtsam::GaussianFactorGraph::shared_ptr& OmegaBar,
                   const std::vector<gtsam::HessianFactor::shared_ptr>& Deltas,
                   const int need_n_corners,
                   const VioFrontEndParams::FeatureSelectionCriterion& criterion,
-                  const bool useLazyEval = true);
+                  const bool useLazyEval = true,
+                  utils::ThreadPool* thread_pool = nullptr,
+                  const double timeBudget = 0.0,
+                  size_t* nrSelectedGreedily = nullptr);
 
   /* ------------------------------------------------------------------------ */
   static boost::tuple<int, double, gtsam::Vector>
@@ -200,9 +223,20 @@ public:
       const gtsam::Point3& pworld_l,
       const Cameras& left_cameras,
       const Cameras& right_cameras,
-      double &debugFETime, double &debugSVDTime, double &debugSchurTime, // debug
       const int keypointLife = 1e9, bool hasRightPixel = true) const;
 
+  /* ------------------------------------------------------------------------ */
+  // Same as createLinearVisionFactor for the tracked landmark lmkId (p_l_camL0
+  // is in the frame of the first left camera), reusing its factor from the
+  // vision_factor_cache_ if the landmark and the horizon poses in the global
+  // frame did not change much.
+  gtsam::HessianFactor::shared_ptr createLinearVisionFactorCached(
+      const LandmarkId& lmkId,
+      const gtsam::Point3& p_l_camL0,
+      const Cameras& left_cameras,
+      const Cameras& right_cameras,
+      const int keypointLife = 1e9) const;
+
   /* ------------------------------------------------------------------------ */
   gtsam::GaussianFactorGraph::shared_ptr createOmegaBar(
       const FeatureSelectorData& featureSelectionData,
@@ -240,6 +274,8 @@ public:
   /* ------------------------------------------------------------------------ */
   // Before starting feature selection: returns selected smart measurements
   // (included tracked ones) and actual time it took for the selection.
+  // nrSelectedGreedily and budgetExpired report whether the time budget of
+  // the greedy selection expired (always false for QUALITY and RANDOM).
   std::pair<SmartStereoMeasurements,double> splitTrackedAndNewFeatures_Select_Display(
       std::shared_ptr<StereoFrame>& stereoFrame_km1, // not constant since we discard nonselected lmks
       const SmartStereoMeasurements& smartStereoMeasurements,
@@ -251,7 +287,9 @@ public:
       const KeyframeToStampedPose& posesAtFutureKeyframes,
       const gtsam::Matrix& curr_state_cov,
       const std::string& dataset_name,
-      const Frame& frame_km1);
+      const Frame& frame_km1,
+      size_t* nrSelectedGreedily = nullptr,
+      bool* budgetExpired = nullptr);
 };
 
 } // End of VIO namespace.
@@ -0,0 +1,324 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalGainEvaluator.cpp
+ * @brief  Incremental evaluation of the gains of the greedy feature selection.
+ * @author Luca Carlone
+ */
+
+#include "IncrementalGainEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Eigenvalues>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+// Eigenvalues of a Delta below this (relative to its largest) are dropped.
+static const double kRankTolerance = 1e-9;
+// Lanczos stops when the residual of the Ritz pair is below this (relative
+// to the Ritz value), and falls back to a dense eigendecomposition after
+// kMaxLanczosSteps.
+static const double kLanczosTolerance = 1e-8;
+static const size_t kMaxLanczosSteps = 30u;
+static const int kBlockSize = SelectorInformationMatrix::Block::RowsAtCompileTime;
+
+/* -------------------------------------------------------------------------- */
+IncrementalGainEvaluator::IncrementalGainEvaluator(
+    const gtsam::GaussianFactorGraph& OmegaBar,
+    const std::vector<gtsam::HessianFactor::shared_ptr>& Deltas,
+    const VioFrontEndParams::FeatureSelectionCriterion& criterion)
+    : criterion_(criterion), omega_(0u, 0u), cholesky_(0u, 0u) {
+  CHECK(criterion_ == VioFrontEndParams::FeatureSelectionCriterion::LOGDET ||
+        criterion_ == VioFrontEndParams::FeatureSelectionCriterion::MIN_EIG)
+      << "IncrementalGainEvaluator: wrong choice of criterion";
+  CHECK(SelectorInformationMatrix::FromFactors(
+      std::vector<gtsam::GaussianFactor::shared_ptr>(OmegaBar.begin(),
+                                                     OmegaBar.end()),
+      &omega_))
+      << "IncrementalGainEvaluator: OmegaBar is not on keys 0, ..., n - 1 of "
+         "dimension 9";
+  omega_diagonal_ = omega_.diagonal();
+
+  candidates_.reserve(Deltas.size());
+  for (const gtsam::HessianFactor::shared_ptr& Delta : Deltas) {
+    CHECK(Delta);
+    candidates_.push_back(makeCandidate(*Delta));
+  }
+  factorize();
+}
+
+/* -------------------------------------------------------------------------- */
+double IncrementalGainEvaluator::evaluateGain(const size_t& j) const {
+  const Candidate& candidate = candidates_.at(j);
+  // Empty Delta, or without information.
+  if (candidate.U_.cols() == 0) return gain_;
+  if (criterion_ == VioFrontEndParams::FeatureSelectionCriterion::LOGDET) {
+    return evaluateLogdet(candidate);
+  }
+  return evaluateMinEig(candidate);
+}
+
+/* -------------------------------------------------------------------------- */
+double IncrementalGainEvaluator::upperBound(const size_t& j) const {
+  const Candidate& candidate = candidates_.at(j);
+  if (criterion_ == VioFrontEndParams::FeatureSelectionCriterion::LOGDET) {
+    // Hadamard: det(M) <= prod(M_ii).
+    double sum_log_diag = omega_diagonal_.array().log().sum();
+    for (size_t a = 0u; a < candidate.rows_.size(); a++) {
+      const double omega_ii = omega_diagonal_(candidate.rows_[a]);
+      sum_log_diag += std::log(omega_ii + candidate.U_.row(a).squaredNorm()) -
+                      std::log(omega_ii);
+    }
+    return sum_log_diag;
+  }
+  // Rayleigh quotient of the current eigenvector.
+  if (candidate.U_.cols() == 0) return min_eig_;
+  return min_eig_ +
+         projectOnCandidate(candidate, min_eig_vector_).squaredNorm();
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalGainEvaluator::add(const size_t& j) {
+  const Candidate& candidate = candidates_.at(j);
+  if (candidate.U_.cols() == 0) return;
+  // The eigenvector is warm-started from the one of the selected set.
+  if (criterion_ == VioFrontEndParams::FeatureSelectionCriterion::MIN_EIG) {
+    min_eig_ = evaluateMinEig(candidate, &min_eig_vector_);
+    gain_ = min_eig_;
+  }
+
+  // A Delta couples the keyframes along its track: widen the band if needed.
+  const auto minmax_block =
+      std::minmax_element(candidate.blocks_.begin(), candidate.blocks_.end());
+  const size_t span = *minmax_block.second - *minmax_block.first;
+  if (span > omega_.getBandwidth()) {
+    omega_ = omega_.withBandwidth(span);
+    cholesky_ = cholesky_.withBandwidth(span);
+  }
+  const gtsam::Matrix UUt = candidate.U_ * candidate.U_.transpose();
+  for (size_t a = 0u; a < candidate.blocks_.size(); a++) {
+    for (size_t b = 0u; b <= a; b++) {
+      omega_.addBlock(candidate.blocks_[a], candidate.blocks_[b],
+                      UUt.block<kBlockSize, kBlockSize>(a * kBlockSize,
+                                                        b * kBlockSize));
+    }
+  }
+  omega_diagonal_ = omega_.diagonal();
+  // Rank-k update of the Cholesky factor, one column of P U at a time.
+  const gtsam::Matrix PU = embedCandidate(candidate);
+  for (size_t k = 0u; k < PU.cols(); k++) {
+    CHECK(cholesky_.choleskyRankUpdate(PU.col(k)))
+        << "IncrementalGainEvaluator: Cholesky update failed";
+  }
+
+  if (criterion_ == VioFrontEndParams::FeatureSelectionCriterion::LOGDET) {
+    logdet_ = cholesky_.logDeterminantFromCholesky();
+    gain_ = logdet_;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+IncrementalGainEvaluator::Candidate IncrementalGainEvaluator::makeCandidate(
+    const gtsam::HessianFactor& Delta) const {
+  Candidate candidate;
+  if (Delta.empty()) return candidate;
+  for (gtsam::HessianFactor::const_iterator it = Delta.begin();
+       it != Delta.end(); ++it) {
+    CHECK_LT(*it, omega_.getNrBlocks())
+        << "IncrementalGainEvaluator: Delta involves a key not in OmegaBar";
+    CHECK_EQ(Delta.getDim(it), kBlockSize);
+    candidate.blocks_.push_back(*it);
+    for (size_t d = 0u; d < kBlockSize; d++) {
+      candidate.rows_.push_back(*it * kBlockSize + d);
+    }
+  }
+
+  // Deltas are Schur complements of a few observations: low rank.
+  Eigen::SelfAdjointEigenSolver<gtsam::Matrix> eig(Delta.information());
+  const gtsam::Vector& eigenvalues = eig.eigenvalues();
+  const double tol = kRankTolerance * std::max(eigenvalues.maxCoeff(), 0.0);
+  size_t rank = 0u;
+  for (size_t i = 0u; i < eigenvalues.size(); i++) {
+    if (eigenvalues(i) > tol) rank++;
+  }
+  candidate.U_.resize(candidate.rows_.size(), rank);
+  for (size_t i = eigenvalues.size() - rank, k = 0u; i < eigenvalues.size();
+       i++, k++) {
+    candidate.U_.col(k) =
+        eig.eigenvectors().col(i) * std::sqrt(eigenvalues(i));
+  }
+  return candidate;
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalGainEvaluator::factorize() {
+  CHECK(omega_.cholesky(&cholesky_))
+      << "IncrementalGainEvaluator: information matrix is not positive "
+         "definite";
+  if (criterion_ == VioFrontEndParams::FeatureSelectionCriterion::LOGDET) {
+    logdet_ = cholesky_.logDeterminantFromCholesky();
+    gain_ = logdet_;
+  } else {
+    if (!omega_.smallestEigenpair(&min_eig_, &min_eig_vector_)) {
+      Eigen::SelfAdjointEigenSolver<gtsam::Matrix> eig(omega_.toDense());
+      min_eig_ = eig.eigenvalues()(0);
+      min_eig_vector_ = eig.eigenvectors().col(0);
+    }
+    gain_ = min_eig_;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+double IncrementalGainEvaluator::evaluateLogdet(
+    const Candidate& candidate) const {
+  // det(Omega + P U U' P') = det(Omega) * det(I + U' P' Omega^-1 P U).
+  gtsam::Matrix W;
+  Eigen::LLT<gtsam::Matrix> K_llt;
+  computeWoodbury(candidate, &W, &K_llt);
+  return logdet_ + 2.0 * K_llt.matrixLLT().diagonal().array().log().sum();
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalGainEvaluator::computeWoodbury(
+    const Candidate& candidate,
+    gtsam::Matrix* W,
+    Eigen::LLT<gtsam::Matrix>* K_llt) const {
+  CHECK_NOTNULL(W);
+  CHECK_NOTNULL(K_llt);
+  // One banded solve per column of P U: the covariance is never formed.
+  const gtsam::Matrix PU = embedCandidate(candidate);
+  W->resize(PU.rows(), PU.cols());
+  for (size_t k = 0u; k < PU.cols(); k++) {
+    W->col(k) = cholesky_.solveWithCholesky(PU.col(k));
+  }
+  gtsam::Matrix K = projectOnCandidate(candidate, *W);
+  K.diagonal().array() += 1.0;
+  K_llt->compute(K);
+}
+
+/* -------------------------------------------------------------------------- */
+double IncrementalGainEvaluator::evaluateMinEig(
+    const Candidate& candidate, gtsam::Vector* eigenvector) const {
+  // Largest eigenvalue of the covariance with the Delta, from Woodbury.
+  const size_t n = omega_.rows();
+  const size_t m = candidate.rows_.size();
+  gtsam::Matrix W;
+  Eigen::LLT<gtsam::Matrix> K_llt;
+  computeWoodbury(candidate, &W, &K_llt);
+  const auto apply = [this, &W, &K_llt](const gtsam::Vector& x) {
+    return gtsam::Vector(cholesky_.solveWithCholesky(x) -
+                         W * K_llt.solve(W.transpose() * x));
+  };
+
+  // Lanczos with full reorthogonalization, from the current eigenvector:
+  // the Delta is a low-rank update, so it is close to the new one.
+  const size_t max_steps = std::min(n, kMaxLanczosSteps);
+  gtsam::Matrix Q(n, max_steps);
+  gtsam::Vector alpha(max_steps), beta(max_steps);
+  Q.col(0) = min_eig_vector_.normalized();
+  // On an invariant subspace the Ritz pairs are exact: keep the largest one
+  // and restart from the part of P U outside the subspace, since the Delta
+  // only changes the covariance there. Columns block_begin, ..., k of Q are
+  // those since the last restart.
+  size_t block_begin = 0u;
+  double best_theta = 0.0;
+  gtsam::Vector best_vector;
+  for (size_t k = 0u; k < max_steps; k++) {
+    gtsam::Vector w = apply(Q.col(k));
+    alpha(k) = Q.col(k).dot(w);
+    for (size_t pass = 0u; pass < 2u; pass++) {
+      w -= Q.leftCols(k + 1) * (Q.leftCols(k + 1).transpose() * w);
+    }
+    beta(k) = w.norm();
+
+    const size_t size = k + 1u - block_begin;
+    gtsam::Matrix T = gtsam::Matrix::Zero(size, size);
+    T.diagonal() = alpha.segment(block_begin, size);
+    if (size > 1u) {
+      T.diagonal(1) = beta.segment(block_begin, size - 1u);
+      T.diagonal(-1) = beta.segment(block_begin, size - 1u);
+    }
+    Eigen::SelfAdjointEigenSolver<gtsam::Matrix> eig(T);
+    const double theta = eig.eigenvalues()(size - 1u);
+    const bool invariant = beta(k) <= kLanczosTolerance * std::fabs(alpha(k));
+    const bool converged =
+        std::fabs(beta(k) * eig.eigenvectors()(size - 1u, size - 1u)) <=
+        kLanczosTolerance * std::fabs(theta);
+    if (invariant || converged) {
+      if (theta > best_theta) {
+        best_theta = theta;
+        best_vector = Q.middleCols(block_begin, size) *
+                      eig.eigenvectors().col(size - 1u);
+      }
+      // The Delta only lowers the covariance, whose largest eigenvalue is
+      // 1 / min_eig_: reaching it (e.g. the Delta does not touch the current
+      // eigenvector) is the largest one too.
+      if (!invariant || best_theta * min_eig_ >= 1.0 - kLanczosTolerance) {
+        if (eigenvector) *eigenvector = best_vector.normalized();
+        return 1.0 / best_theta;
+      }
+      if (k + 1 == max_steps) break;
+      gtsam::Matrix R = embedCandidate(candidate);
+      const double R_norm = R.norm();
+      for (size_t pass = 0u; pass < 2u; pass++) {
+        R -= Q.leftCols(k + 1) * (Q.leftCols(k + 1).transpose() * R);
+      }
+      size_t r = 0u;
+      const double r_norm = R.colwise().norm().maxCoeff(&r);
+      // The Delta is within the subspace: nothing to restart from.
+      if (r_norm <= kLanczosTolerance * R_norm) break;
+      Q.col(k + 1) = R.col(r) / r_norm;
+      beta(k) = 0.0;
+      block_begin = k + 1u;
+      continue;
+    }
+    if (k + 1 < max_steps) Q.col(k + 1) = w / beta(k);
+  }
+
+  VLOG(10) << "IncrementalGainEvaluator: Lanczos did not converge, using a "
+              "dense eigendecomposition.";
+  gtsam::Matrix omega_j = omega_.toDense();
+  const gtsam::Matrix UUt = candidate.U_ * candidate.U_.transpose();
+  for (size_t a = 0u; a < m; a++) {
+    for (size_t b = 0u; b < m; b++) {
+      omega_j(candidate.rows_[a], candidate.rows_[b]) += UUt(a, b);
+    }
+  }
+  Eigen::SelfAdjointEigenSolver<gtsam::Matrix> eig(
+      omega_j, eigenvector ? Eigen::ComputeEigenvectors
+                           : Eigen::EigenvaluesOnly);
+  if (eigenvector) *eigenvector = eig.eigenvectors().col(0);
+  return eig.eigenvalues()(0);
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Matrix IncrementalGainEvaluator::embedCandidate(
+    const Candidate& candidate) const {
+  gtsam::Matrix PU = gtsam::Matrix::Zero(omega_.rows(), candidate.U_.cols());
+  for (size_t a = 0u; a < candidate.rows_.size(); a++) {
+    PU.row(candidate.rows_[a]) = candidate.U_.row(a);
+  }
+  return PU;
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Matrix IncrementalGainEvaluator::projectOnCandidate(
+    const Candidate& candidate, const gtsam::Matrix& x) {
+  gtsam::Matrix x_rows(candidate.rows_.size(), x.cols());
+  for (size_t a = 0u; a < candidate.rows_.size(); a++) {
+    x_rows.row(a) = x.row(candidate.rows_[a]);
+  }
+  return candidate.U_.transpose() * x_rows;
+}
+
+}  // namespace VIO
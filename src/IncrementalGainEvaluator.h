@@ -0,0 +1,118 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalGainEvaluator.h
+ * @brief  Incremental evaluation of the gains of the greedy feature selection.
+ * @author Luca Carlone
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Cholesky>
+
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/HessianFactor.h>
+
+#include "BlockBandedMatrix.h"
+#include "VioFrontEndParams.h"
+
+namespace VIO {
+
+// Keeps the block-banded information matrix of the selected set (OmegaBar
+// plus the selected Deltas) and its banded Cholesky factor, and evaluates the
+// gain of adding each candidate Delta without re-assembling nor
+// re-factorizing the information matrix:
+// - LOGDET: matrix determinant lemma on the low-rank factor of the Delta,
+//   with one banded solve against the Cholesky factor per column of it.
+// - MIN_EIG: Lanczos iteration on the covariance with the Delta (Woodbury
+//   update of the banded solves), warm-started with the eigenvector of the
+//   smallest eigenvalue of the selected set.
+// The (dense) covariance of the selected set is never formed.
+// Gains are the same as FeatureSelector::EvaluateGain on the selected set.
+// Keys are the keyframes 0, ..., n - 1 of the horizon, as in the selector.
+// The evaluation functions are const, and can be called concurrently.
+class IncrementalGainEvaluator {
+ public:
+  IncrementalGainEvaluator(
+      const gtsam::GaussianFactorGraph& OmegaBar,
+      const std::vector<gtsam::HessianFactor::shared_ptr>& Deltas,
+      const VioFrontEndParams::FeatureSelectionCriterion& criterion);
+
+  // Gain of the selected set.
+  inline double getGain() const { return gain_; }
+
+  // Gain of the selected set augmented with Deltas[j].
+  double evaluateGain(const size_t& j) const;
+
+  // Upper bound on evaluateGain(j), cheaper to compute, for lazy evaluation.
+  double upperBound(const size_t& j) const;
+
+  // Adds Deltas[j] to the selected set.
+  void add(const size_t& j);
+
+  inline size_t getNrCandidates() const { return candidates_.size(); }
+  inline gtsam::Matrix getInformation() const { return omega_.toDense(); }
+
+ private:
+  // Information of a Delta: Delta = U * U' on the given rows of the
+  // information matrix, which are those of the blocks (keys) of the Delta.
+  struct Candidate {
+    std::vector<size_t> rows_;
+    gtsam::Matrix U_;
+    std::vector<size_t> blocks_;
+  };
+
+  Candidate makeCandidate(const gtsam::HessianFactor& Delta) const;
+
+  // Computes the factorization of the selected set from scratch.
+  void factorize();
+
+  // Woodbury update of the covariance with a candidate:
+  // (Omega + P U U' P')^-1 = Sigma - W K^-1 W', with W = Sigma P U and
+  // K = I + U' P' Sigma P U. W is computed with banded solves.
+  void computeWoodbury(const Candidate& candidate,
+                       gtsam::Matrix* W,
+                       Eigen::LLT<gtsam::Matrix>* K_llt) const;
+
+  double evaluateLogdet(const Candidate& candidate) const;
+  // Smallest eigenvalue of the selected set with the candidate, and its
+  // eigenvector if requested.
+  double evaluateMinEig(const Candidate& candidate,
+                        gtsam::Vector* eigenvector = nullptr) const;
+
+  // P * U: factor of the Delta on all the rows of the information matrix.
+  gtsam::Matrix embedCandidate(const Candidate& candidate) const;
+
+  // U' * x(rows, :), for a candidate.
+  static gtsam::Matrix projectOnCandidate(const Candidate& candidate,
+                                         const gtsam::Matrix& x);
+
+ private:
+  const VioFrontEndParams::FeatureSelectionCriterion criterion_;
+  std::vector<Candidate> candidates_;
+
+  // Information matrix of the selected set, and its diagonal.
+  SelectorInformationMatrix omega_;
+  gtsam::Vector omega_diagonal_;
+  double gain_ = 0.0;
+
+  // Banded Cholesky factor of the selected set, updated with each selected
+  // Delta (rank updates).
+  SelectorInformationMatrix cholesky_;
+  // LOGDET: log determinant of the selected set.
+  double logdet_ = 0.0;
+
+  // MIN_EIG: smallest eigenvalue of the selected set and its eigenvector.
+  double min_eig_ = 0.0;
+  gtsam::Vector min_eig_vector_;
+};
+
+}  // namespace VIO
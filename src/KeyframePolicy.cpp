@@ -0,0 +1,286 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   KeyframePolicy.cpp
+ * @brief  Policies deciding when the frontend creates a new keyframe.
+ * @author Antoni Rosinol
+ */
+
+#include "KeyframePolicy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_int32(keyframe_policy, 0,
+             "Keyframe policy:\n"
+             "0: time, keyframe every intra_keyframe_time seconds.\n"
+             "1: parallax, keyframe when the median parallax since the last "
+             "keyframe exceeds keyframe_min_parallax.\n"
+             "2: overlap, keyframe when the ratio of landmarks of the last "
+             "keyframe still tracked is below keyframe_min_overlap_ratio.\n"
+             "All policies create a keyframe if there are too few features.");
+DEFINE_double(keyframe_min_parallax, 20.0,
+              "Median parallax triggering a keyframe (in pixels).");
+DEFINE_double(keyframe_min_overlap_ratio, 0.7,
+              "Ratio of tracked landmarks triggering a keyframe.");
+DEFINE_double(keyframe_max_time, 1.0,
+              "Maximum time between keyframes for the parallax and overlap "
+              "policies (in seconds).");
+DEFINE_bool(keyframe_load_adaptive, false,
+            "Postpone keyframes while the backend is loaded.");
+DEFINE_double(keyframe_backend_time_budget, 0.0,
+              "The backend is loaded if it took more than this to process "
+              "the last keyframe (in ms). If 0, intra_keyframe_time is used.");
+DEFINE_double(keyframe_max_stretch, 3.0,
+              "Maximum stretch of the keyframe spacing when the backend is "
+              "loaded.");
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+bool KeyframePolicy::decideCritical(const KeyframePolicyInput& input,
+                                    KeyframeDecision* decision) const {
+  CHECK_NOTNULL(decision);
+  if (input.is_user_keyframe_) {
+    decision->is_keyframe_ = true;
+    decision->is_critical_ = true;
+    decision->reason_ = "user enforced";
+    return true;
+  }
+  if (input.nr_valid_features_ <= min_number_features_) {
+    decision->is_keyframe_ = true;
+    decision->is_critical_ = true;
+    std::stringstream reason;
+    reason << "low nr of features (" << input.nr_valid_features_
+           << " <= " << min_number_features_ << ")";
+    decision->reason_ = reason.str();
+    return true;
+  }
+  return false;
+}
+
+/* -------------------------------------------------------------------------- */
+TimeKeyframePolicy::TimeKeyframePolicy(const double& intra_keyframe_time,
+                                       const size_t& min_number_features)
+    : KeyframePolicy(min_number_features),
+      intra_keyframe_time_(intra_keyframe_time) {}
+
+/* -------------------------------------------------------------------------- */
+KeyframeDecision TimeKeyframePolicy::decide(
+    const KeyframePolicyInput& input) const {
+  KeyframeDecision decision;
+  if (decideCritical(input, &decision)) return decision;
+  if (input.time_since_keyframe_ >= intra_keyframe_time_) {
+    decision.is_keyframe_ = true;
+    decision.reason_ = "max time elapsed";
+  }
+  return decision;
+}
+
+/* -------------------------------------------------------------------------- */
+ParallaxKeyframePolicy::ParallaxKeyframePolicy(
+    const double& min_parallax,
+    const double& max_keyframe_time,
+    const size_t& min_number_features)
+    : KeyframePolicy(min_number_features),
+      min_parallax_(min_parallax),
+      max_keyframe_time_(max_keyframe_time) {
+  CHECK_GT(min_parallax_, 0.0);
+}
+
+/* -------------------------------------------------------------------------- */
+KeyframeDecision ParallaxKeyframePolicy::decide(
+    const KeyframePolicyInput& input) const {
+  KeyframeDecision decision;
+  if (decideCritical(input, &decision)) return decision;
+  if (input.median_parallax_ >= min_parallax_) {
+    decision.is_keyframe_ = true;
+    std::stringstream reason;
+    reason << "parallax (" << input.median_parallax_ << " px)";
+    decision.reason_ = reason.str();
+  } else if (input.time_since_keyframe_ >= max_keyframe_time_) {
+    decision.is_keyframe_ = true;
+    decision.reason_ = "max time elapsed";
+  }
+  return decision;
+}
+
+/* -------------------------------------------------------------------------- */
+OverlapKeyframePolicy::OverlapKeyframePolicy(
+    const double& min_overlap_ratio,
+    const double& max_keyframe_time,
+    const size_t& min_number_features)
+    : KeyframePolicy(min_number_features),
+      min_overlap_ratio_(min_overlap_ratio),
+      max_keyframe_time_(max_keyframe_time) {
+  CHECK_GT(min_overlap_ratio_, 0.0);
+  CHECK_LE(min_overlap_ratio_, 1.0);
+}
+
+/* -------------------------------------------------------------------------- */
+KeyframeDecision OverlapKeyframePolicy::decide(
+    const KeyframePolicyInput& input) const {
+  KeyframeDecision decision;
+  if (decideCritical(input, &decision)) return decision;
+  if (input.feature_overlap_ratio_ < min_overlap_ratio_) {
+    decision.is_keyframe_ = true;
+    std::stringstream reason;
+    reason << "low feature overlap (" << input.feature_overlap_ratio_ << ")";
+    decision.reason_ = reason.str();
+  } else if (input.time_since_keyframe_ >= max_keyframe_time_) {
+    decision.is_keyframe_ = true;
+    decision.reason_ = "max time elapsed";
+  }
+  return decision;
+}
+
+/* -------------------------------------------------------------------------- */
+LoadAdaptiveKeyframePolicy::LoadAdaptiveKeyframePolicy(
+    KeyframePolicy::UniquePtr policy,
+    const double& min_keyframe_time,
+    const double& backend_time_budget,
+    const double& max_stretch,
+    const size_t& min_number_features)
+    : KeyframePolicy(min_number_features),
+      policy_(std::move(policy)),
+      min_keyframe_time_(min_keyframe_time),
+      backend_time_budget_(backend_time_budget),
+      max_stretch_(max_stretch) {
+  CHECK(policy_);
+  CHECK_GT(backend_time_budget_, 0.0);
+  CHECK_GE(max_stretch_, 1.0);
+}
+
+/* -------------------------------------------------------------------------- */
+double LoadAdaptiveKeyframePolicy::getStretch(
+    const BackendLoad& backend_load) const {
+  // One more keyframe spacing per keyframe waiting in the backend queue.
+  double stretch = 1.0 + static_cast<double>(backend_load.queue_size_);
+  if (backend_load.last_spin_time_ > backend_time_budget_) {
+    stretch =
+        std::max(stretch, backend_load.last_spin_time_ / backend_time_budget_);
+  }
+  return std::min(stretch, max_stretch_);
+}
+
+/* -------------------------------------------------------------------------- */
+KeyframeDecision LoadAdaptiveKeyframePolicy::decide(
+    const KeyframePolicyInput& input) const {
+  KeyframeDecision decision = policy_->decide(input);
+  if (!decision.is_keyframe_ || decision.is_critical_) return decision;
+
+  const double stretch = getStretch(input.backend_load_);
+  if (stretch <= 1.0) return decision;
+
+  std::stringstream reason;
+  if (input.time_since_keyframe_ < stretch * min_keyframe_time_) {
+    decision.is_keyframe_ = false;
+    reason << "postponed " << decision.reason_;
+  } else {
+    reason << decision.reason_;
+  }
+  reason << " (backend loaded: " << input.backend_load_.queue_size_
+         << " queued, " << input.backend_load_.last_spin_time_
+         << " ms, stretch " << stretch << ")";
+  decision.reason_ = reason.str();
+  return decision;
+}
+
+/* -------------------------------------------------------------------------- */
+KeyframePolicy::UniquePtr createKeyframePolicy(
+    const VioFrontEndParams& tracker_params) {
+  KeyframePolicy::UniquePtr policy;
+  switch (FLAGS_keyframe_policy) {
+    case 0:
+      policy = VIO::make_unique<TimeKeyframePolicy>(
+          tracker_params.intra_keyframe_time_,
+          tracker_params.min_number_features_);
+      break;
+    case 1:
+      policy = VIO::make_unique<ParallaxKeyframePolicy>(
+          FLAGS_keyframe_min_parallax,
+          FLAGS_keyframe_max_time,
+          tracker_params.min_number_features_);
+      break;
+    case 2:
+      policy = VIO::make_unique<OverlapKeyframePolicy>(
+          FLAGS_keyframe_min_overlap_ratio,
+          FLAGS_keyframe_max_time,
+          tracker_params.min_number_features_);
+      break;
+    default:
+      LOG(FATAL) << "Unknown keyframe policy: " << FLAGS_keyframe_policy;
+  }
+
+  if (FLAGS_keyframe_load_adaptive) {
+    const double backend_time_budget =
+        FLAGS_keyframe_backend_time_budget > 0.0
+            ? FLAGS_keyframe_backend_time_budget
+            : 1000.0 * tracker_params.intra_keyframe_time_;
+    policy = VIO::make_unique<LoadAdaptiveKeyframePolicy>(
+        std::move(policy),
+        tracker_params.intra_keyframe_time_,
+        backend_time_budget,
+        FLAGS_keyframe_max_stretch,
+        tracker_params.min_number_features_);
+  }
+  LOG(INFO) << "Using " << policy->getName() << " keyframe policy.";
+  return policy;
+}
+
+/* -------------------------------------------------------------------------- */
+void computeKeyframeFeatureStats(const Frame& keyframe,
+                                 const Frame& frame,
+                                 double* median_parallax,
+                                 double* feature_overlap_ratio) {
+  CHECK_NOTNULL(median_parallax);
+  CHECK_NOTNULL(feature_overlap_ratio);
+  CHECK_EQ(keyframe.landmarks_.size(), keyframe.keypoints_.size());
+  CHECK_EQ(frame.landmarks_.size(), frame.keypoints_.size());
+
+  std::unordered_map<LandmarkId, size_t> keyframe_lmk_idx;
+  keyframe_lmk_idx.reserve(keyframe.landmarks_.size());
+  for (size_t i = 0u; i < keyframe.landmarks_.size(); i++) {
+    if (keyframe.landmarks_[i] != -1) {
+      keyframe_lmk_idx[keyframe.landmarks_[i]] = i;
+    }
+  }
+
+  std::vector<double> parallaxes;
+  parallaxes.reserve(frame.landmarks_.size());
+  for (size_t i = 0u; i < frame.landmarks_.size(); i++) {
+    if (frame.landmarks_[i] == -1) continue;
+    const auto& it = keyframe_lmk_idx.find(frame.landmarks_[i]);
+    if (it == keyframe_lmk_idx.end()) continue;
+    const KeypointCV& kp_keyframe = keyframe.keypoints_[it->second];
+    const KeypointCV& kp_frame = frame.keypoints_[i];
+    parallaxes.push_back(std::hypot(kp_frame.x - kp_keyframe.x,
+                                    kp_frame.y - kp_keyframe.y));
+  }
+
+  *feature_overlap_ratio =
+      keyframe_lmk_idx.empty()
+          ? 1.0
+          : static_cast<double>(parallaxes.size()) / keyframe_lmk_idx.size();
+  if (parallaxes.empty()) {
+    *median_parallax = 0.0;
+    return;
+  }
+  auto median = parallaxes.begin() + parallaxes.size() / 2;
+  std::nth_element(parallaxes.begin(), median, parallaxes.end());
+  *median_parallax = *median;
+}
+
+}  // namespace VIO
@@ -0,0 +1,173 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   KeyframePolicy.h
+ * @brief  Policies deciding when the frontend creates a new keyframe.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "Frame.h"
+#include "VioFrontEndParams.h"
+
+namespace VIO {
+
+// Load of the backend, as seen by the frontend.
+struct BackendLoad {
+  // Keyframes waiting to be processed by the backend.
+  size_t queue_size_ = 0u;
+  // Time the backend took to process the last keyframe [ms].
+  double last_spin_time_ = 0.0;
+};
+using BackendLoadCallback = std::function<BackendLoad()>;
+
+// What a keyframe policy knows about the current frame.
+struct KeyframePolicyInput {
+  // Time since the last keyframe [s].
+  double time_since_keyframe_ = 0.0;
+  size_t nr_valid_features_ = 0u;
+  // Median displacement of the features tracked since the last keyframe [px].
+  double median_parallax_ = 0.0;
+  // Fraction of the landmarks of the last keyframe still tracked.
+  double feature_overlap_ratio_ = 1.0;
+  // The user requires a keyframe.
+  bool is_user_keyframe_ = false;
+  BackendLoad backend_load_;
+};
+
+struct KeyframeDecision {
+  bool is_keyframe_ = false;
+  // The keyframe cannot be postponed without risking to lose track.
+  bool is_critical_ = false;
+  std::string reason_ = "none";
+};
+
+// Decides if the current frame must be a keyframe.
+class KeyframePolicy {
+ public:
+  typedef std::unique_ptr<KeyframePolicy> UniquePtr;
+
+  explicit KeyframePolicy(const size_t& min_number_features)
+      : min_number_features_(min_number_features) {}
+  virtual ~KeyframePolicy() = default;
+
+  virtual KeyframeDecision decide(const KeyframePolicyInput& input) const = 0;
+
+  virtual std::string getName() const = 0;
+
+  // Whether decide uses the median parallax and feature overlap ratio, which
+  // are only computed for the policies that need them.
+  virtual bool needsFeatureStats() const { return false; }
+
+ protected:
+  // Keyframes enforced by the user, or required to keep tracking (too few
+  // features), whatever the policy.
+  bool decideCritical(const KeyframePolicyInput& input,
+                      KeyframeDecision* decision) const;
+
+ private:
+  const size_t min_number_features_;
+};
+
+// Keyframe every intra_keyframe_time seconds.
+class TimeKeyframePolicy : public KeyframePolicy {
+ public:
+  TimeKeyframePolicy(const double& intra_keyframe_time,
+                     const size_t& min_number_features);
+
+  KeyframeDecision decide(const KeyframePolicyInput& input) const override;
+  std::string getName() const override { return "time"; }
+
+ private:
+  const double intra_keyframe_time_;
+};
+
+// Keyframe when the features moved more than min_parallax pixels since the
+// last keyframe, or after max_keyframe_time seconds.
+class ParallaxKeyframePolicy : public KeyframePolicy {
+ public:
+  ParallaxKeyframePolicy(const double& min_parallax,
+                         const double& max_keyframe_time,
+                         const size_t& min_number_features);
+
+  KeyframeDecision decide(const KeyframePolicyInput& input) const override;
+  std::string getName() const override { return "parallax"; }
+  bool needsFeatureStats() const override { return true; }
+
+ private:
+  const double min_parallax_;
+  const double max_keyframe_time_;
+};
+
+// Keyframe when less than min_overlap_ratio of the landmarks of the last
+// keyframe are still tracked, or after max_keyframe_time seconds.
+class OverlapKeyframePolicy : public KeyframePolicy {
+ public:
+  OverlapKeyframePolicy(const double& min_overlap_ratio,
+                        const double& max_keyframe_time,
+                        const size_t& min_number_features);
+
+  KeyframeDecision decide(const KeyframePolicyInput& input) const override;
+  std::string getName() const override { return "overlap"; }
+  bool needsFeatureStats() const override { return true; }
+
+ private:
+  const double min_overlap_ratio_;
+  const double max_keyframe_time_;
+};
+
+// Postpones the keyframes of another policy while the backend is loaded:
+// keyframes waiting in the backend queue, or last keyframe processed in more
+// than backend_time_budget ms. The keyframe spacing is stretched up to
+// max_stretch times min_keyframe_time. Critical keyframes are never
+// postponed.
+class LoadAdaptiveKeyframePolicy : public KeyframePolicy {
+ public:
+  LoadAdaptiveKeyframePolicy(KeyframePolicy::UniquePtr policy,
+                             const double& min_keyframe_time,
+                             const double& backend_time_budget,
+                             const double& max_stretch,
+                             const size_t& min_number_features);
+
+  KeyframeDecision decide(const KeyframePolicyInput& input) const override;
+  std::string getName() const override {
+    return "load-adaptive " + policy_->getName();
+  }
+  bool needsFeatureStats() const override {
+    return policy_->needsFeatureStats();
+  }
+
+  // How much the keyframe spacing is stretched given the backend load.
+  double getStretch(const BackendLoad& backend_load) const;
+
+ private:
+  const KeyframePolicy::UniquePtr policy_;
+  const double min_keyframe_time_;
+  const double backend_time_budget_;
+  const double max_stretch_;
+};
+
+// Keyframe policy selected with FLAGS_keyframe_policy, wrapped in a
+// LoadAdaptiveKeyframePolicy if FLAGS_keyframe_load_adaptive.
+KeyframePolicy::UniquePtr createKeyframePolicy(
+    const VioFrontEndParams& tracker_params);
+
+// Median parallax [px] and ratio of landmarks of the keyframe still tracked
+// in the current frame.
+void computeKeyframeFeatureStats(const Frame& keyframe,
+                                 const Frame& frame,
+                                 double* median_parallax,
+                                 double* feature_overlap_ratio);
+
+}  // namespace VIO
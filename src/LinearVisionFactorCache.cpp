@@ -0,0 +1,168 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LinearVisionFactorCache.cpp
+ * @brief  Cache of the linear vision factors of the feature selector.
+ * @author Luca Carlone
+ */
+
+#include "LinearVisionFactorCache.h"
+
+#include <cmath>
+#include <numeric>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+LinearVisionFactorCache::LinearVisionFactorCache(const double& rot_tol,
+                                                 const double& trans_tol)
+    : rot_tol_(rot_tol), trans_tol_(trans_tol) {
+  CHECK_GE(rot_tol_, 0.0);
+  CHECK_GE(trans_tol_, 0.0);
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::HessianFactor::shared_ptr LinearVisionFactorCache::find(
+    const LandmarkId& lmk_id,
+    const gtsam::Point3& W_p,
+    const std::vector<gtsam::Pose3>& W_Pose_camsL,
+    const size_t& nr_keyframes,
+    const bool& has_right_pixel) {
+  nr_lookups_++;
+  const auto it = entries_.find(lmk_id);
+  if (it == entries_.end()) return nullptr;
+  it->second.used_ = true;
+  const Entry& entry = it->second;
+  if (!isValid(entry, W_p, W_Pose_camsL, nr_keyframes, has_right_pixel)) {
+    return nullptr;
+  }
+  nr_hits_++;
+  if (nr_keyframes < entry.nr_keyframes_) {
+    return KeepFirstKeys(*entry.factor_, nr_keyframes);
+  }
+  return entry.factor_;
+}
+
+/* -------------------------------------------------------------------------- */
+void LinearVisionFactorCache::insert(
+    const LandmarkId& lmk_id,
+    const gtsam::Point3& W_p,
+    const std::vector<gtsam::Pose3>& W_Pose_camsL,
+    const size_t& nr_keyframes,
+    const bool& has_right_pixel,
+    const gtsam::HessianFactor::shared_ptr& factor) {
+  CHECK(factor);
+  Entry& entry = entries_[lmk_id];
+  entry.W_p_ = W_p;
+  entry.W_Pose_camsL_ = W_Pose_camsL;
+  entry.nr_keyframes_ = nr_keyframes;
+  entry.has_right_pixel_ = has_right_pixel;
+  entry.factor_ = factor;
+  entry.used_ = true;
+}
+
+/* -------------------------------------------------------------------------- */
+void LinearVisionFactorCache::removeUnused() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.used_) {
+      it->second.used_ = false;
+      ++it;
+    } else {
+      it = entries_.erase(it);
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+double LinearVisionFactorCache::getHitRate() const {
+  return nr_lookups_ == 0u ? 0.0 : double(nr_hits_) / double(nr_lookups_);
+}
+
+/* -------------------------------------------------------------------------- */
+void LinearVisionFactorCache::resetStats() {
+  nr_lookups_ = 0u;
+  nr_hits_ = 0u;
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::HessianFactor::shared_ptr LinearVisionFactorCache::KeepFirstKeys(
+    const gtsam::HessianFactor& factor, const size_t& nr_keys) {
+  const size_t nr_all_keys = factor.keys().size();
+  if (factor.empty() || nr_keys >= nr_all_keys) {
+    return boost::make_shared<gtsam::HessianFactor>(factor);
+  }
+  const gtsam::SymmetricBlockMatrix& info = factor.info();
+  // +1 for the linear term, which is the last block.
+  std::vector<gtsam::DenseIndex> dims(nr_keys + 1);
+  for (size_t i = 0; i < nr_keys; i++) {
+    dims[i] = info.getDim(i);
+  }
+  dims.back() = 1;
+  const gtsam::DenseIndex M1 =
+      std::accumulate(dims.begin(), dims.end(), gtsam::DenseIndex(0));
+  gtsam::SymmetricBlockMatrix kept(dims, gtsam::Matrix::Zero(M1, M1));
+  for (size_t i = 0; i < nr_keys; i++) {
+    kept.setDiagonalBlock(i, info.block(i, i));
+    for (size_t j = i + 1; j < nr_keys; j++) {
+      kept.setOffDiagonalBlock(i, j, info.block(i, j));
+    }
+    kept.setOffDiagonalBlock(i, nr_keys, info.block(i, nr_all_keys));
+  }
+  kept.setDiagonalBlock(nr_keys, info.block(nr_all_keys, nr_all_keys));
+  const gtsam::FastVector<gtsam::Key> keys(factor.keys().begin(),
+                                           factor.keys().begin() + nr_keys);
+  return boost::make_shared<gtsam::HessianFactor>(keys, kept);
+}
+
+/* -------------------------------------------------------------------------- */
+bool LinearVisionFactorCache::isValid(
+    const Entry& entry,
+    const gtsam::Point3& W_p,
+    const std::vector<gtsam::Pose3>& W_Pose_camsL,
+    const size_t& nr_keyframes,
+    const bool& has_right_pixel) const {
+  // The track may only get shorter: the cached factor is then restricted to
+  // the remaining keyframes.
+  if (entry.has_right_pixel_ != has_right_pixel ||
+      nr_keyframes > entry.nr_keyframes_ || nr_keyframes == 0u ||
+      W_Pose_camsL.size() < nr_keyframes) {
+    return false;
+  }
+  const gtsam::Vector3 W_t_camL0 = W_Pose_camsL[0].translation().vector();
+  const double point_tol =
+      trans_tol_ + rot_tol_ * (W_p.vector() - W_t_camL0).norm();
+  if ((entry.W_p_.vector() - W_p.vector()).norm() > point_tol) {
+    return false;
+  }
+  // Only the horizon poses in which the landmark is tracked matter.
+  for (size_t c = 0; c < nr_keyframes; c++) {
+    const gtsam::Pose3& cached_pose = entry.W_Pose_camsL_[c];
+    const gtsam::Pose3& pose = W_Pose_camsL[c];
+    if (gtsam::Rot3::Logmap(
+            cached_pose.rotation().between(pose.rotation())).norm() >
+        rot_tol_) {
+      return false;
+    }
+    const gtsam::Vector3 cached_bearing =
+        entry.W_p_.vector() - cached_pose.translation().vector();
+    const gtsam::Vector3 bearing =
+        W_p.vector() - pose.translation().vector();
+    const double bearing_change =
+        std::atan2(cached_bearing.cross(bearing).norm(),
+                   cached_bearing.dot(bearing));
+    if (bearing_change > rot_tol_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace VIO
@@ -0,0 +1,105 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LinearVisionFactorCache.h
+ * @brief  Cache of the linear vision factors of the feature selector.
+ * @author Luca Carlone
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <gtsam/geometry/Point3.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/HessianFactor.h>
+
+#include "common/vio_types.h"
+
+namespace VIO {
+
+// Caches the linear vision factor (Schur complement of the landmark) of each
+// tracked landmark, so that it can be reused at the next keyframes.
+// The vision factor only depends on the rotations of the cameras of the
+// horizon and on the bearings of the landmark from them, so that factors are
+// stored in the global frame, together with the landmark and the predicted
+// horizon poses they were computed from. An entry stays valid while the
+// landmark moves less than the translation tolerance and each rotation and
+// bearing of the horizon changes less than the rotation tolerance: this
+// holds across consecutive keyframes while moving, as long as the motion
+// between keyframes is small compared to the distance to the landmark.
+class LinearVisionFactorCache {
+ public:
+  // rot_tol [rad] bounds the change of rotation of the horizon cameras and of
+  // the bearing of the landmark from them, trans_tol [m] the change of the
+  // landmark (together with rot_tol * distance to the first camera).
+  LinearVisionFactorCache(const double& rot_tol, const double& trans_tol);
+
+  // Returns the cached factor of the landmark (in the global frame), or a
+  // null pointer if there is none or it is outdated.
+  // W_Pose_camsL are the predicted poses of the left cameras of the horizon,
+  // and nr_keyframes the length of the track in the horizon. A track that is
+  // shorter than the cached one (the landmark gets older at each keyframe)
+  // reuses the cached factor restricted to its first nr_keyframes states.
+  gtsam::HessianFactor::shared_ptr find(
+      const LandmarkId& lmk_id,
+      const gtsam::Point3& W_p,
+      const std::vector<gtsam::Pose3>& W_Pose_camsL,
+      const size_t& nr_keyframes,
+      const bool& has_right_pixel);
+
+  void insert(const LandmarkId& lmk_id,
+              const gtsam::Point3& W_p,
+              const std::vector<gtsam::Pose3>& W_Pose_camsL,
+              const size_t& nr_keyframes,
+              const bool& has_right_pixel,
+              const gtsam::HessianFactor::shared_ptr& factor);
+
+  // Removes the landmarks that were not looked up since the last call (they
+  // are not tracked anymore).
+  void removeUnused();
+
+  inline size_t size() const { return entries_.size(); }
+  inline size_t getNrLookups() const { return nr_lookups_; }
+  inline size_t getNrHits() const { return nr_hits_; }
+  // Hit rate of the lookups since the last call to resetStats, 0 if none.
+  double getHitRate() const;
+  void resetStats();
+
+  // Factor restricted to its first nr_keys keys (and the linear term).
+  static gtsam::HessianFactor::shared_ptr KeepFirstKeys(
+      const gtsam::HessianFactor& factor, const size_t& nr_keys);
+
+ private:
+  struct Entry {
+    gtsam::Point3 W_p_;
+    std::vector<gtsam::Pose3> W_Pose_camsL_;
+    size_t nr_keyframes_;
+    bool has_right_pixel_;
+    gtsam::HessianFactor::shared_ptr factor_;
+    bool used_;
+  };
+
+  bool isValid(const Entry& entry,
+               const gtsam::Point3& W_p,
+               const std::vector<gtsam::Pose3>& W_Pose_camsL,
+               const size_t& nr_keyframes,
+               const bool& has_right_pixel) const;
+
+ private:
+  const double rot_tol_;
+  const double trans_tol_;
+  std::unordered_map<LandmarkId, Entry> entries_;
+
+  size_t nr_lookups_ = 0u;
+  size_t nr_hits_ = 0u;
+};
+
+}  // namespace VIO
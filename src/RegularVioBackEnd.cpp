@@ -26,6 +26,7 @@
 #include <gtsam/slam/ProjectionFactor.h>
 
 #include "factors/PointPlaneFactor.h"
+#include "utils/Diagnostics.h"
 
 DEFINE_int32(min_num_of_observations, 2,
              "Minimum number of observations for a feature track to be added "
@@ -91,7 +92,9 @@ RegularVioBackEnd::RegularVioBackEnd(const Pose3& leftCamPose,
                                      const Timestamp& timestamp,
                                      const VioBackEndParams& vioParams,
                                      const bool& log_timing,
-                                     const BackendModality& backend_modality)
+                                     const BackendModality& backend_modality,
+                                     const boost::optional<gtsam::Matrix>&
+                                         initial_imu_bias_covariance)
     : regular_vio_params_(RegularVioBackEndParams::safeCast(vioParams)),
       backend_modality_(backend_modality),
       VioBackEnd(leftCamPose,
@@ -100,7 +103,8 @@ RegularVioBackEnd::RegularVioBackEnd(const Pose3& leftCamPose,
                  initial_state_seed,
                  timestamp,
                  vioParams,
-                 log_timing) {
+                 log_timing,
+                 initial_imu_bias_covariance) {
   LOG(INFO) << "Using Regular VIO backend.\n";
 
   // Set type of mono_noise_ for generic projection factors.
@@ -142,7 +146,7 @@ void RegularVioBackEnd::addVisualInertialStateAndOptimize(
       << "Consider using normal VIO instead of regular VIO if you are not "
          "passing planes...";
 
-  std::cout << "addVisual Inertial State And Optimize" << std::endl;
+  VIO_DIAG(kBackend, kDebug) << "addVisual Inertial State And Optimize";
   debug_info_.resetAddedFactorsStatistics();
 
   // if (VLOG_IS_ON(20)) {
@@ -222,7 +226,6 @@ void RegularVioBackEnd::addVisualInertialStateAndOptimize(
       if (kfTrackingStatus_mono == TrackingStatus::VALID) {
         // Extract lmk ids that are involved in a regularity.
         VLOG(10) << "Starting extracting lmk ids from set of planes...";
-        std::cout << "Starting extracting lmk ids from set of planes..." << std::endl;
         LandmarkIds lmk_ids_with_regularity;
         switch (backend_modality_) {
           case BackendModality::STRUCTURELESS: {
@@ -248,14 +251,15 @@ void RegularVioBackEnd::addVisualInertialStateAndOptimize(
           case BackendModality::PROJECTION_AND_REGULARITY: {
             // Keep the planes, but change all smart factors to projection
             // factors.
-            std::cout << "PROJECTION_AND_REGULARITY" << std::endl;
+            VIO_DIAG(kBackend, kDebug) << "PROJECTION_AND_REGULARITY";
             lmk_ids_with_regularity = lmks_kf;
             break;
           }
           case BackendModality::STRUCTURELESS_PROJECTION_AND_REGULARITY: {
             // Act as usual, keep planes, and transform smart factors to projj
             // factors for those that will have regularities.
-            std::cout << "STRUCTURELESS_PROJECTION_AND_REGULARITY" << std::endl;
+            VIO_DIAG(kBackend, kDebug)
+                << "STRUCTURELESS_PROJECTION_AND_REGULARITY";
             extractLmkIdsFromPlanes(*planes, &lmk_ids_with_regularity);
             break;
           }
@@ -303,7 +307,6 @@ void RegularVioBackEnd::addVisualInertialStateAndOptimize(
             const PlaneId& plane_key = plane.getPlaneSymbol().key();
 
             VLOG(10) << "Adding regularity factors.";
-            std::cout << "Adding regularity factors." << std::endl;
             addRegularityFactors(
                 plane,
                 // Creates a new entry if the plane key was not found.
@@ -778,6 +781,13 @@ void RegularVioBackEnd::deleteLmkFromExtraStructures(const LandmarkId& lmk_id) {
   }
 }
 
+/* -------------------------------------------------------------------------- */
+void RegularVioBackEnd::resetExtraStructures() {
+  lmk_id_is_smart_.clear();
+  plane_id_to_lmk_id_reg_type_.clear();
+  delete_slots_of_converted_smart_factors_.clear();
+}
+
 /* -------------------------------------------------------------------------- */
 void RegularVioBackEnd::addProjectionFactor(
     const LandmarkId& lmk_id, const std::pair<FrameId, StereoPoint2>& new_obs,
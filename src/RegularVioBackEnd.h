@@ -50,7 +50,9 @@ public:
       const VioBackEndParams& vioParams = VioBackEndParams(),
       const bool& log_timing = false,
       const BackendModality& backend_modality =
-          BackendModality::STRUCTURELESS_PROJECTION_AND_REGULARITY);
+          BackendModality::STRUCTURELESS_PROJECTION_AND_REGULARITY,
+      const boost::optional<gtsam::Matrix>& initial_imu_bias_covariance =
+          boost::none);
 
   /* ------------------------------------------------------------------------ */
   ~RegularVioBackEnd() = default;
@@ -141,6 +143,9 @@ private:
   /* ------------------------------------------------------------------------ */
   virtual void deleteLmkFromExtraStructures(const LandmarkId& lmk_id);
 
+  /* ------------------------------------------------------------------------ */
+  virtual void resetExtraStructures();
+
   /* ------------------------------------------------------------------------ */
   void addProjectionFactor(
       const LandmarkId& lmk_id,
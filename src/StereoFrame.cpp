@@ -14,6 +14,7 @@
 
 #include "StereoFrame.h"
 #include "glog/logging.h"
+#include "utils/Diagnostics.h"
 
 DEFINE_bool(images_rectified, false, "Input image data already rectified.");
 
@@ -602,7 +603,9 @@ void StereoFrame::filterTrianglesWithGradients(
     // If no high-grad pixels exist,
     // then this triangle is assumed to be a plane.
     if (keypoints_with_high_gradient.size() <= max_keypoints_with_gradient) {
-        std::cout << "keypoints_with_high_gradient.size(): " << keypoints_with_high_gradient.size() << std::endl;
+      VIO_DIAG(kStereoFrame, kTrace)
+          << "keypoints_with_high_gradient.size(): "
+          << keypoints_with_high_gradient.size();
       filtered_triangulation_2D->push_back(triangle);
     }
   }
@@ -906,8 +909,9 @@ void StereoFrame::getRightKeypointsLKunrectified() {
     LOG(FATAL)
         << "computeStereo: error -  length of computeStereo is incorrect";
 
-  std::cout << "stereo matching: matched  " << nrValidDepths << " out of "
-            << ref_frame.keypoints_.size() << " keypoints" << std::endl;
+  VIO_DIAG(kStereoFrame, kDebug)
+      << "stereo matching: matched " << nrValidDepths << " out of "
+      << ref_frame.keypoints_.size() << " keypoints";
 }
 
 /* -------------------------------------------------------------------------- */
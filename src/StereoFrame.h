@@ -295,6 +295,7 @@ public:
     return B_Pose_camLrect_;
   }
   inline double getBaseline() const {return baseline_;}
+  inline const gtsam::Pose3& getCamLPoseCamR() const {return camL_Pose_camR;}
   inline StereoMatchingParams getSparseStereoParams() const {
     return sparse_stereo_params_;
   }
@@ -14,9 +14,12 @@
 
 #pragma once
 
+#include <boost/optional.hpp>
+
 #include "StereoFrame-definitions.h"
 #include "Tracker.h"
 #include "common/vio_types.h"
+#include "datasource/DataSource-definitions.h"
 #include "imu-frontend/ImuFrontEnd.h"
 
 namespace VIO {
@@ -31,6 +34,9 @@ public:
   // invalid output: meaning we still don't have a keyframe.
   // Note that this should be done with a unique_ptr and only push to the output
   // queue once we have a keyframe.
+  // reinit_state is only set for the first keyframe after a hot
+  // re-initialization of the frontend: it carries the state the backend has to
+  // be reset to.
   StereoFrontEndOutputPayload(
       const bool is_keyframe,
       const StatusSmartStereoMeasurements& statusSmartStereoMeasurements,
@@ -38,14 +44,16 @@ public:
       const gtsam::Pose3& relative_pose_body_stereo,
       const StereoFrame& stereo_frame_lkf,
       const ImuFrontEnd::PreintegratedImuMeasurements& pim,
-      const DebugTrackerInfo& debug_tracker_info)
+      const DebugTrackerInfo& debug_tracker_info,
+      const boost::optional<VioNavState>& reinit_state = boost::none)
     : is_keyframe_(is_keyframe),
       statusSmartStereoMeasurements_(statusSmartStereoMeasurements),
       tracker_status_(tracker_status),
       relative_pose_body_stereo_(relative_pose_body_stereo),
       stereo_frame_lkf_(stereo_frame_lkf),
       pim_(pim),
-      debug_tracker_info_(debug_tracker_info) {}
+      debug_tracker_info_(debug_tracker_info),
+      reinit_state_(reinit_state) {}
 
 public:
   const bool is_keyframe_;
@@ -55,6 +63,7 @@ public:
   const StereoFrame stereo_frame_lkf_;
   const ImuFrontEnd::PreintegratedImuMeasurements pim_;
   const DebugTrackerInfo debug_tracker_info_;
+  const boost::optional<VioNavState> reinit_state_;
 
   inline DebugTrackerInfo getTrackerInfo() {
     return debug_tracker_info_;
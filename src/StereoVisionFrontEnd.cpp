@@ -18,6 +18,8 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "utils/Profiler.h"
+
 DEFINE_int32(save_frontend_images_option,
              0,
              "Display/Save images in frontend for debugging (only use if "
@@ -49,6 +51,9 @@ StereoVisionFrontEnd::StereoVisionFrontEnd(
   // Instantiate IMU frontend.
   imu_frontend_ = VIO::make_unique<ImuFrontEnd>(imu_params, imu_initial_bias);
 
+  // Instantiate keyframe policy.
+  keyframe_policy_ = createKeyframePolicy(tracker_params);
+
   tracker_.trackerParams_.print();
 }
 
@@ -68,7 +73,10 @@ bool StereoVisionFrontEnd::spin(
     is_thread_working_ = true;
     if (input) {
       auto tic = utils::Timer::tic();
-      const StereoFrontEndOutputPayload& output = spinOnce(input);
+      // Packets with the re-initialization flag reset the frontend in place,
+      // so that the thread is kept alive.
+      const StereoFrontEndOutputPayload& output =
+          input->getReinitFlag() ? reinitialize(*input) : spinOnce(input);
       if (output.is_keyframe_) {
         VLOG(2) << "Frontend output is a keyframe: pushing to output queue.";
         output_queue.push(output);
@@ -96,6 +104,7 @@ bool StereoVisionFrontEnd::spin(
 /* -------------------------------------------------------------------------- */
 StereoFrontEndOutputPayload StereoVisionFrontEnd::spinOnce(
     const std::shared_ptr<StereoFrontEndInputPayload>& input) {
+  VIO_PROFILE_ZONE("StereoVisionFrontEnd::spinOnce");
   const StereoFrame& stereoFrame_k = input->getStereoFrame();
   const auto& k = stereoFrame_k.getFrameId();
   LOG(INFO) << "------------------- Processing frame k = " << k
@@ -196,6 +205,39 @@ StereoFrontEndOutputPayload StereoVisionFrontEnd::spinOnce(
   }
 }
 
+/* -------------------------------------------------------------------------- */
+StereoFrontEndOutputPayload StereoVisionFrontEnd::reinitialize(
+    const StereoFrontEndInputPayload& input) {
+  const ReinitPacket& reinit_packet = input.getReinitPacket();
+  CHECK(reinit_packet.getReinitFlag());
+  LOG(WARNING) << "Hot re-initialization of frontend with frame k = "
+               << input.getStereoFrame().getFrameId();
+
+  // Drop tracking state. Landmark ids keep increasing to avoid clashes with
+  // landmarks still alive in the mesher/visualizer.
+  stereoFrame_k_.reset();
+  stereoFrame_km1_.reset();
+  stereoFrame_lkf_.reset();
+  trackerStatusSummary_ = TrackerStatusSummary();
+  tracker_.debugInfo_ = DebugTrackerInfo();
+  last_landmark_count_ = tracker_.landmark_count_;
+
+  // Preintegrate from now on with the re-initialization bias.
+  imu_frontend_->updateBias(reinit_packet.getReinitBias());
+
+  // Detect features in the new frame and reset the preintegration.
+  processFirstStereoFrame(input.getStereoFrame());
+
+  // The backend has to be re-seeded at the timestamp of this keyframe.
+  return StereoFrontEndOutputPayload(
+      true, StatusSmartStereoMeasurements(trackerStatusSummary_,
+                                          SmartStereoMeasurements()),
+      TrackingStatus::INVALID, gtsam::Pose3(), *stereoFrame_lkf_,
+      imu_frontend_->getCurrentPIM(), getTrackerInfo(),
+      VioNavState(reinit_packet.getReinitPose(), reinit_packet.getReinitVel(),
+                  reinit_packet.getReinitBias()));
+}
+
 /* -------------------------------------------------------------------------- */
 // TODO this can be greatly improved, but we need to get rid of global variables
 // stereoFrame_km1_, stereoFrame_lkf_, stereoFrame_k_, etc...
@@ -215,8 +257,7 @@ StereoFrame StereoVisionFrontEnd::processFirstStereoFrame(
 
   // Initialize mask: this is allocated but it does not play a role
   // in this function.
-  cv::Size imgSize = left_frame->img_.size();
-  tracker_.camMask_ = cv::Mat(imgSize, CV_8UC1, cv::Scalar(255));
+  tracker_.setCamMask(left_frame->img_.size());
 
   // Perform feature detection.
   tracker_.featureDetection(left_frame);
@@ -251,16 +292,20 @@ StatusSmartStereoMeasurements StereoVisionFrontEnd::processStereoFrame(
           << " (timestamp diff: "
           << cur_frame.getTimestamp() - stereoFrame_km1_->getTimestamp() << ")";
 
-  double start_time = UtilsOpenCV::GetTimeInSeconds();
+  VIO_PROFILE_ZONE("StereoVisionFrontEnd::processStereoFrame");
   double time_to_clone_rect_params = 0;
 
-  // TODO this copies the stereo frame!!
-  stereoFrame_k_ = std::make_shared<StereoFrame>(cur_frame);
+  {
+    VIO_PROFILE_ZONE("StereoVisionFrontEnd cloneStereoFrame");
+    utils::ScopedTimer timer;
+    // TODO this copies the stereo frame!!
+    stereoFrame_k_ = std::make_shared<StereoFrame>(cur_frame);
 
-  // Copy rectification from previous frame to avoid recomputing it.
-  // TODO avoid copying altogether...
-  stereoFrame_k_->cloneRectificationParameters(*stereoFrame_km1_);
-  time_to_clone_rect_params = UtilsOpenCV::GetTimeInSeconds() - start_time;
+    // Copy rectification from previous frame to avoid recomputing it.
+    // TODO avoid copying altogether...
+    stereoFrame_k_->cloneRectificationParameters(*stereoFrame_km1_);
+    time_to_clone_rect_params = timer.elapsedSeconds();
+  }
 
   // Only for visualization.
   int verbosityFrames = FLAGS_save_frontend_images_option;
@@ -275,6 +320,12 @@ StatusSmartStereoMeasurements StereoVisionFrontEnd::processStereoFrame(
   Frame* left_frame_km1 = stereoFrame_km1_->getLeftFrameMutable();
   Frame* left_frame_k = stereoFrame_k_->getLeftFrameMutable();
   tracker_.featureTracking(left_frame_km1, left_frame_k);
+  utils::StatsCollector("StereoFrontEnd Pruned Tracks KLT [#]")
+      .AddSample(tracker_.getTrackerDebugInfo().nrPrunedKltTracks_);
+  if (tracker_.trackerParams_.klt_fb_check_) {
+    utils::StatsCollector("StereoFrontEnd Rejected Tracks KLT FB [#]")
+        .AddSample(tracker_.getTrackerDebugInfo().nrKltFbRejected_);
+  }
   if (verbosityFrames > 0) {
     // TODO this won't work in parallel mode...
     tracker_.displayFrame(*left_frame_km1, *left_frame_k, false);
@@ -288,31 +339,35 @@ StatusSmartStereoMeasurements StereoVisionFrontEnd::processStereoFrame(
   // This will be the info we actually care about
   SmartStereoMeasurements smartStereoMeasurements;
 
-  const bool max_time_elapsed =
-      UtilsOpenCV::NsecToSec(stereoFrame_k_->getTimestamp() -
-                             last_keyframe_timestamp_) >=
-      tracker_.trackerParams_.intra_keyframe_time_;
-  const size_t nr_valid_features = left_frame_k->getNrValidKeypoints();
-  const bool nr_features_low =
-      nr_valid_features <= tracker_.trackerParams_.min_number_features_;
-
+  // Decide if this frame is a keyframe.
+  KeyframePolicyInput keyframe_policy_input;
+  keyframe_policy_input.time_since_keyframe_ = UtilsOpenCV::NsecToSec(
+      stereoFrame_k_->getTimestamp() - last_keyframe_timestamp_);
+  keyframe_policy_input.nr_valid_features_ =
+      left_frame_k->getNrValidKeypoints();
+  if (keyframe_policy_->needsFeatureStats()) {
+    computeKeyframeFeatureStats(stereoFrame_lkf_->getLeftFrame(),
+                                *left_frame_k,
+                                &keyframe_policy_input.median_parallax_,
+                                &keyframe_policy_input.feature_overlap_ratio_);
+  }
   // Also if the user requires the keyframe to be enforced
-  if (stereoFrame_k_->isKeyframe())
-    LOG(WARNING) << "User inforced keyframe!";
-  // If max time elaspsed and not able to track feature -> create new keyframe
-  if (max_time_elapsed || nr_features_low || stereoFrame_k_->isKeyframe()) {
+  keyframe_policy_input.is_user_keyframe_ = stereoFrame_k_->isKeyframe();
+  if (backend_load_callback_) {
+    keyframe_policy_input.backend_load_ = backend_load_callback_();
+  }
+  const KeyframeDecision keyframe_decision =
+      keyframe_policy_->decide(keyframe_policy_input);
+  VLOG(1) << "Frame " << stereoFrame_k_->getFrameId() << ": "
+          << (keyframe_decision.is_keyframe_ ? "keyframe" : "no keyframe")
+          << ", reason: " << keyframe_decision.reason_;
+
+  if (keyframe_decision.is_keyframe_) {
     ++keyframe_count_; // mainly for debugging
 
     VLOG(2) << "+++++++++++++++++++++++++++++++++++++++++++++++++++"
             << "Keyframe after: "
-            << UtilsOpenCV::NsecToSec(stereoFrame_k_->getTimestamp() -
-                                      last_keyframe_timestamp_)
-            << " sec.";
-
-    VLOG_IF(2, max_time_elapsed) << "Keyframe reason: max time elapsed.";
-    VLOG_IF(2, nr_features_low)
-        << "Keyframe reason: low nr of features (" << nr_valid_features << " < "
-        << tracker_.trackerParams_.min_number_features_ << ").";
+            << keyframe_policy_input.time_since_keyframe_ << " sec.";
 
     if (!tracker_.trackerParams_.useRANSAC_) {
       trackerStatusSummary_.kfTrackingStatus_mono_ = TrackingStatus::DISABLED;
@@ -360,9 +415,12 @@ StatusSmartStereoMeasurements StereoVisionFrontEnd::processStereoFrame(
 
       ////////////////// STEREO geometric outlier rejection ////////////////
       // get 3D points via stereo
-      start_time = UtilsOpenCV::GetTimeInSeconds();
-      stereoFrame_k_->sparseStereoMatching();
-      timeSparseStereo = UtilsOpenCV::GetTimeInSeconds() - start_time;
+      {
+        VIO_PROFILE_ZONE("StereoFrame::sparseStereoMatching");
+        utils::ScopedTimer timer;
+        stereoFrame_k_->sparseStereoMatching();
+        timeSparseStereo = timer.elapsedSeconds();
+      }
 
       std::pair<TrackingStatus, gtsam::Pose3> statusPoseStereo;
       gtsam::Matrix infoMatStereoTranslation = gtsam::Matrix3::Zero();
@@ -404,9 +462,12 @@ StatusSmartStereoMeasurements StereoVisionFrontEnd::processStereoFrame(
 
     // Get 3D points via stereo, including newly extracted
     // (this might be only for the visualization).
-    start_time = UtilsOpenCV::GetTimeInSeconds();
-    stereoFrame_k_->sparseStereoMatching();
-    timeSparseStereo += UtilsOpenCV::GetTimeInSeconds() - start_time;
+    {
+      VIO_PROFILE_ZONE("StereoFrame::sparseStereoMatching");
+      utils::ScopedTimer timer;
+      stereoFrame_k_->sparseStereoMatching();
+      timeSparseStereo += timer.elapsedSeconds();
+    }
 
     // Show results.
     // verbosityKeyframes = 1;
@@ -418,14 +479,23 @@ StatusSmartStereoMeasurements StereoVisionFrontEnd::processStereoFrame(
     // Populate statistics.
     tracker_.checkStatusRightKeypoints(stereoFrame_k_->right_keypoints_status_);
 
+    // Stop tracks that keep failing stereo before they reach the backend.
+    const size_t nr_pruned_tracks = tracker_.pruneTracks(stereoFrame_k_.get());
+    utils::StatsCollector("StereoFrontEnd Pruned Tracks Stereo [#]")
+        .AddSample(nr_pruned_tracks);
+
     // Move on.
     last_landmark_count_ = tracker_.landmark_count_;
     stereoFrame_lkf_ = stereoFrame_k_;
 
     // Get relevant info for keyframe.
-    start_time = UtilsOpenCV::GetTimeInSeconds();
-    smartStereoMeasurements = getSmartStereoMeasurements(*stereoFrame_k_.get());
-    timeGetMeasurements = UtilsOpenCV::GetTimeInSeconds() - start_time;
+    {
+      VIO_PROFILE_ZONE("StereoVisionFrontEnd::getSmartStereoMeasurements");
+      utils::ScopedTimer timer;
+      smartStereoMeasurements =
+          getSmartStereoMeasurements(*stereoFrame_k_.get());
+      timeGetMeasurements = timer.elapsedSeconds();
+    }
 
     VLOG(2) << "timeClone: " << time_to_clone_rect_params << '\n'
             << "timeSparseStereo: " << timeSparseStereo << '\n'
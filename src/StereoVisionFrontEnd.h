@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <boost/shared_ptr.hpp> // used for opengv
 
 #include <opencv2/opencv.hpp>
@@ -21,6 +23,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "KeyframePolicy.h"
 #include "StereoFrame.h"
 #include "StereoImuSyncPacket.h"
 #include "StereoVisionFrontEnd-definitions.h"
@@ -89,6 +92,14 @@ public:
     return imu_frontend_->getCurrentImuBias();
   }
 
+  /* ------------------------------------------------------------------------ */
+  // Register callback querying the load of the backend, used by the
+  // load-adaptive keyframe policy. Register it before spinning.
+  inline void registerBackendLoadCallback(
+      const BackendLoadCallback& backend_load_callback) {
+    backend_load_callback_ = backend_load_callback;
+  }
+
   /* ------------------------------------------------------------------------ */
   // Update Imu Bias and reset pre-integration during initialization.
   // This is not thread-safe! (no multi-thread during initialization)
@@ -97,6 +108,20 @@ public:
     imu_frontend_->resetIntegrationWithCachedBias();
   }
 
+  /* ------------------------------------------------------------------------ */
+  // Restore the landmark counter (e.g. from a checkpoint), so that new
+  // landmark ids do not clash with the ones of a previous run.
+  // This is not thread-safe! (no multi-thread during initialization)
+  inline void setLandmarkCount(const LandmarkId& landmark_count) {
+    tracker_.landmark_count_ = landmark_count;
+    last_landmark_count_ = landmark_count;
+  }
+
+  /* ------------------------------------------------------------------------ */
+  // Next landmark id to be assigned by the tracker, as of the last keyframe.
+  // Thread-safe, e.g. to checkpoint it from the backend thread.
+  inline LandmarkId getLandmarkCount() const { return last_landmark_count_; }
+
   /* ------------------------------------------------------------------------ */
   // Prepare frontend for initial bundle adjustment for online alignment
   void prepareFrontendForOnlineAlignment() {
@@ -160,6 +185,16 @@ public:
   StereoFrontEndOutputPayload spinOnce(
       const std::shared_ptr<StereoFrontEndInputPayload>& input);
 
+  /* ------------------------------------------------------------------------ */
+  // Hot re-initialization of the frontend: drops the tracking state, resets
+  // the IMU preintegration with the re-initialization bias, and processes the
+  // frame in the input as a first frame. Returns a keyframe output that
+  // carries the re-initialization state for the backend.
+  // Call it from the thread spinning the frontend (it is called by spin when
+  // the input has the re-initialization flag on).
+  StereoFrontEndOutputPayload reinitialize(
+      const StereoFrontEndInputPayload& input);
+
   /* ------------------------------------------------------------------------ */
   // Get IMU Params for IMU Frontend.
   gtsam::PreintegratedImuMeasurements::Params getImuFrontEndParams() {
@@ -258,13 +293,17 @@ private:
   // keyframe counte.
   int keyframe_count_;
   // Previous number of landmarks (used for what is new landmark.
-  int last_landmark_count_;
+  std::atomic<int> last_landmark_count_;
   // Timestamp of last keyframe.
   Timestamp last_keyframe_timestamp_;
 
   // Set of functionalities for tracking.
   Tracker tracker_;
 
+  // Decides which frames are keyframes.
+  KeyframePolicy::UniquePtr keyframe_policy_;
+  BackendLoadCallback backend_load_callback_;
+
   // IMU frontend.
   std::unique_ptr<ImuFrontEnd> imu_frontend_;
 
@@ -65,6 +65,12 @@ public:
   size_t nrValidRKP_ = 0, nrNoLeftRectRKP_ = 0, nrNoRightRectRKP_ = 0;
   size_t nrNoDepthRKP_ = 0, nrFailedArunRKP_ = 0;
 
+  // Info about pruned tracks: because of a high KLT error (last frame), or
+  // because of repeated stereo failures (last keyframe).
+  size_t nrPrunedKltTracks_ = 0, nrPrunedStereoTracks_ = 0;
+  // Tracks rejected by the forward-backward KLT check (last frame).
+  size_t nrKltFbRejected_ = 0;
+
   // Info about timing.
   double featureDetectionTime_ = 0, featureTrackingTime_ = 0;
   double monoRansacTime_ = 0, stereoRansacTime_ = 0;
@@ -72,6 +78,10 @@ public:
   // Info about feature selector.
   double featureSelectionTime_ = 0;
   size_t extracted_corners_ = 0, need_n_corners_ = 0;
+  // Features selected greedily, and whether the time budget of the selection
+  // expired (the rest were selected by score).
+  size_t nrGreedySelected_ = 0;
+  bool featureSelectionBudgetExpired_ = false;
 
   void printTimes() const {
     LOG(INFO) << "featureDetectionTime_: " << featureDetectionTime_ << " s\n"
@@ -94,7 +104,13 @@ public:
               << "nrNoLeftRectRKP_: " << nrNoLeftRectRKP_ << "\n"
               << "nrNoRightRectRKP_: " << nrNoRightRectRKP_ << "\n"
               << "nrNoDepthRKP_: " << nrNoDepthRKP_ << "\n"
-              << "nrFailedArunRKP_: " << nrFailedArunRKP_;
+              << "nrFailedArunRKP_: " << nrFailedArunRKP_ << "\n"
+              << "nrPrunedKltTracks_: " << nrPrunedKltTracks_ << "\n"
+              << "nrPrunedStereoTracks_: " << nrPrunedStereoTracks_ << "\n"
+              << "nrKltFbRejected_: " << nrKltFbRejected_ << "\n"
+              << "nrGreedySelected_: " << nrGreedySelected_ << "\n"
+              << "featureSelectionBudgetExpired_: "
+              << featureSelectionBudgetExpired_;
   }
 
 };
@@ -6,7 +6,9 @@
 
 #include "Tracker.h"
 
+#include <cmath>
 #include <string>
+#include <numeric>     // for iota
 #include <algorithm>   // for sort
 #include <map>         // for map<>
 #include <memory>      // for shared_ptr<>
@@ -14,6 +16,14 @@
 #include <vector>      // for vector<>
 #include <functional>  // for less<>
 
+#include <gflags/gflags.h>
+
+#include "utils/Profiler.h"
+
+DEFINE_string(frontend_roi_mask_path, "",
+              "Optional image with the region of interest of the left camera "
+              "(non-zero pixels): no features are detected outside of it.");
+
 #define TRACKER_VERBOSITY 0  // Should be 1
 
 namespace VIO {
@@ -23,8 +33,72 @@ Tracker::Tracker(const VioFrontEndParams& trackerParams)
       // Only for debugging and visualization:
       outputImagesPath_("./outputImages/"),
       landmark_count_(0),
+      processing_scale_(trackerParams.processing_scale_),
       pixelOffset_(),
-      verbosity_(TRACKER_VERBOSITY) {}
+      verbosity_(TRACKER_VERBOSITY) {
+  CHECK_GT(processing_scale_, 0.0);
+  CHECK_LE(processing_scale_, 1.0);
+}
+
+/* -------------------------------------------------------------------------- */
+void Tracker::setCamMask(const cv::Size& img_size) {
+  camMask_ = cv::Mat(img_size, CV_8UC1, cv::Scalar(255));
+  if (trackerParams_.feature_grid_rows_ > 0 &&
+      trackerParams_.feature_grid_cols_ > 0) {
+    feature_grid_ = VIO::make_unique<FeatureGrid>(
+        img_size, trackerParams_.feature_grid_rows_,
+        trackerParams_.feature_grid_cols_,
+        trackerParams_.maxFeaturesPerFrame_);
+  }
+  if (FLAGS_frontend_roi_mask_path.empty()) return;
+
+  // Merge static region of interest.
+  cv::Mat roi_mask =
+      cv::imread(FLAGS_frontend_roi_mask_path, cv::IMREAD_GRAYSCALE);
+  CHECK(!roi_mask.empty()) << "Cannot read ROI mask: "
+                           << FLAGS_frontend_roi_mask_path;
+  if (roi_mask.size() != img_size) {
+    LOG(WARNING) << "Resizing ROI mask from " << roi_mask.size() << " to "
+                 << img_size;
+    cv::resize(roi_mask, roi_mask, img_size, 0, 0, cv::INTER_NEAREST);
+  }
+  cv::bitwise_and(camMask_, roi_mask > 0, camMask_);
+}
+
+/* -------------------------------------------------------------------------- */
+cv::Mat Tracker::getProcessingImage(const Frame& frame) {
+  if (processing_scale_ == 1.0) return frame.img_;
+  // Frames are used twice in a row: as current and as reference frame.
+  for (size_t i = 0u; i < processing_imgs_.size(); i++) {
+    if (processing_imgs_[i].first == frame.timestamp_ &&
+        !processing_imgs_[i].second.empty()) {
+      last_processing_img_ = i;
+      return processing_imgs_[i].second;
+    }
+  }
+  last_processing_img_ = 1u - last_processing_img_;
+  std::pair<Timestamp, cv::Mat>& processing_img =
+      processing_imgs_[last_processing_img_];
+  processing_img.first = frame.timestamp_;
+  cv::resize(frame.img_, processing_img.second, cv::Size(), processing_scale_,
+             processing_scale_, cv::INTER_AREA);
+  return processing_img.second;
+}
+
+/* -------------------------------------------------------------------------- */
+void Tracker::refineKeypointsSubPix(const cv::Mat& img,
+                                    const double& processing_scale,
+                                    KeypointsCV* keypoints) {
+  CHECK_NOTNULL(keypoints);
+  if (keypoints->empty()) return;
+  // Search within one pixel of the processed image.
+  const int half_win = std::max(1, static_cast<int>(std::ceil(
+                                       1.0 / processing_scale)));
+  cv::cornerSubPix(
+      img, *keypoints, cv::Size(half_win, half_win), cv::Size(-1, -1),
+      cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 10,
+                       0.01));
+}
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 // TODO(Toni) Optimize this function.
@@ -50,13 +124,27 @@ void Tracker::featureDetection(Frame* cur_frame) {
   ///////////////// FEATURE DETECTION //////////////////////
   // If feature FeatureSelectionCriterion is quality, just extract what you
   // need:
-  double start_time = UtilsOpenCV::GetTimeInSeconds();
-  auto corners_with_scores = Tracker::featureDetection(
-      *cur_frame, trackerParams_, camMask_, nr_corners_needed);
-  if (verbosity_ >= 5) {
-    debugInfo_.featureDetectionTime_ =
-        UtilsOpenCV::GetTimeInSeconds() - start_time;
+  VIO_PROFILE_ZONE("Tracker::featureDetection");
+  utils::ScopedTimer detection_timer;
+  std::pair<KeypointsCV, std::vector<double>> corners_with_scores;
+  if (feature_grid_) {
+    // The grid is updated as features are tracked, lost or rejected: only
+    // rebuild it if features were invalidated outside of the tracker.
+    if (feature_grid_->getNrFeatures() != n_existing) {
+      VLOG(5) << "Rebuilding feature grid: " << feature_grid_->getNrFeatures()
+              << " features in grid vs " << n_existing << " in frame.";
+      feature_grid_->rebuild(cur_frame->keypoints_, cur_frame->landmarks_);
+    }
+    corners_with_scores = featureDetectionGrid(*cur_frame, nr_corners_needed);
+    for (const KeypointCV& corner : corners_with_scores.first) {
+      feature_grid_->add(corner);
+    }
+  } else {
+    corners_with_scores = Tracker::featureDetection(
+        *cur_frame, trackerParams_, camMask_, nr_corners_needed,
+        getProcessingImage(*cur_frame), processing_scale_);
   }
+  debugInfo_.featureDetectionTime_ = detection_timer.elapsedSeconds();
   debugInfo_.extracted_corners_ = corners_with_scores.first.size();
 
   ///////////////// STORE NEW KEYPOINTS  //////////////////////
@@ -97,30 +185,229 @@ void Tracker::featureDetection(Frame* cur_frame) {
    */
   std::pair<KeypointsCV, std::vector<double>> Tracker::featureDetection(
       const Frame& cur_frame, const VioFrontEndParams& tracker_params,
-      const cv::Mat& cam_mask, const int need_n_corners) {
+      const cv::Mat& cam_mask, const int need_n_corners,
+      const cv::Mat& processing_img, const double& processing_scale) {
+    const bool is_scaled = processing_scale != 1.0 && !processing_img.empty();
+    const double scale = is_scaled ? processing_scale : 1.0;
+
     // Create mask such that new keypoints are not close to old ones.
+    const cv::Mat mask = computeDetectionMask(
+        cur_frame, tracker_params, cam_mask,
+        is_scaled ? processing_img.size() : cam_mask.size(), scale);
+
+    // Find new features and corresponding scores.
+    std::pair<KeypointsCV, std::vector<double>> corners_with_scores;
+    if (need_n_corners > 0) {
+      UtilsOpenCV::MyGoodFeaturesToTrackSubPix(
+          is_scaled ? processing_img : cur_frame.img_, need_n_corners,
+          tracker_params.quality_level_, tracker_params.min_distance_ * scale,
+          mask, tracker_params.block_size_,
+          tracker_params.use_harris_detector_, tracker_params.k_,
+          &corners_with_scores);
+    }
+
+    if (is_scaled) {
+      // Back to full resolution, only refine the new corners.
+      for (KeypointCV& corner : corners_with_scores.first) {
+        corner = fromProcessingScale(corner, scale);
+      }
+      refineKeypointsSubPix(cur_frame.img_, scale, &corners_with_scores.first);
+    }
+
+    return corners_with_scores;
+  }
+
+  /* --------------------------------------------------------------------------
+   */
+  cv::Mat Tracker::computeDetectionMask(const Frame& cur_frame,
+                                        const VioFrontEndParams& tracker_params,
+                                        const cv::Mat& cam_mask,
+                                        const cv::Size& mask_size,
+                                        const double& scale) {
     cv::Mat mask;
-    cam_mask.copyTo(mask);
+    if (mask_size != cam_mask.size()) {
+      cv::resize(cam_mask, mask, mask_size, 0, 0, cv::INTER_NEAREST);
+    } else {
+      cam_mask.copyTo(mask);
+    }
     for (size_t i = 0; i < cur_frame.keypoints_.size(); ++i) {
       if (cur_frame.landmarks_.at(i) != -1) {
-        cv::circle(mask, cur_frame.keypoints_.at(i),
-                   tracker_params.min_distance_, cv::Scalar(0), CV_FILLED);
+        cv::circle(mask,
+                   toProcessingScale(cur_frame.keypoints_.at(i), scale),
+                   tracker_params.min_distance_ * scale, cv::Scalar(0),
+                   CV_FILLED);
       }
     }
+    return mask;
+  }
 
-    // Find new features and corresponding scores.
+  /* --------------------------------------------------------------------------
+   */
+  std::pair<KeypointsCV, std::vector<double>> Tracker::featureDetectionGrid(
+      const Frame& cur_frame, const int need_n_corners) {
+    CHECK(feature_grid_);
     std::pair<KeypointsCV, std::vector<double>> corners_with_scores;
-    if (need_n_corners > 0) {
+    if (need_n_corners <= 0) return corners_with_scores;
+
+    const cv::Mat processing_img = getProcessingImage(cur_frame);
+    const double scale = processing_scale_;
+    // Masks the surroundings of all the existing keypoints, whatever their
+    // cell, and of the new corners of the cells already processed.
+    cv::Mat mask = computeDetectionMask(
+        cur_frame, trackerParams_, camMask_, processing_img.size(), scale);
+    const cv::Rect img_rect(cv::Point(0, 0), processing_img.size());
+
+    // Only detect in the cells missing features, on the cell's crop.
+    size_t n_cells_detected = 0u;
+    for (const std::pair<size_t, int>& cell :
+         feature_grid_->getUnderPopulatedCells()) {
+      const cv::Rect cell_rect = feature_grid_->getCellRect(cell.first);
+      const cv::Rect roi =
+          cv::Rect(cv::Point(std::floor(cell_rect.x * scale),
+                             std::floor(cell_rect.y * scale)),
+                   cv::Point(std::ceil(cell_rect.br().x * scale),
+                             std::ceil(cell_rect.br().y * scale))) &
+          img_rect;
+      // Too small for the corner detector.
+      if (roi.width <= trackerParams_.block_size_ + 2 ||
+          roi.height <= trackerParams_.block_size_ + 2) {
+        continue;
+      }
+      if (cv::countNonZero(mask(roi)) == 0) continue;
+
+      std::pair<KeypointsCV, std::vector<double>> cell_corners;
       UtilsOpenCV::MyGoodFeaturesToTrackSubPix(
-          cur_frame.img_, need_n_corners, tracker_params.quality_level_,
-          tracker_params.min_distance_, mask, tracker_params.block_size_,
-          tracker_params.use_harris_detector_, tracker_params.k_,
-          &corners_with_scores);
+          processing_img(roi), cell.second, trackerParams_.quality_level_,
+          trackerParams_.min_distance_ * scale, mask(roi),
+          trackerParams_.block_size_, trackerParams_.use_harris_detector_,
+          trackerParams_.k_, &cell_corners);
+      ++n_cells_detected;
+      for (size_t i = 0u; i < cell_corners.first.size(); i++) {
+        const KeypointCV corner =
+            cell_corners.first[i] + cv::Point2f(roi.x, roi.y);
+        // Enforce the minimum distance across cell borders.
+        cv::circle(mask, corner, trackerParams_.min_distance_ * scale,
+                   cv::Scalar(0), CV_FILLED);
+        corners_with_scores.first.push_back(corner);
+        corners_with_scores.second.push_back(cell_corners.second[i]);
+      }
+    }
+    VLOG(5) << "Feature grid: detected " << corners_with_scores.first.size()
+            << " corners in " << n_cells_detected << " of "
+            << feature_grid_->getNrCells() << " cells.";
+
+    // Cell quotas are rounded up: keep the best corners.
+    if (corners_with_scores.first.size() >
+        static_cast<size_t>(need_n_corners)) {
+      std::vector<size_t> idx(corners_with_scores.first.size());
+      std::iota(idx.begin(), idx.end(), 0u);
+      std::partial_sort(
+          idx.begin(), idx.begin() + need_n_corners, idx.end(),
+          [&corners_with_scores](const size_t& a, const size_t& b) {
+            return corners_with_scores.second[a] >
+                   corners_with_scores.second[b];
+          });
+      std::pair<KeypointsCV, std::vector<double>> best_corners;
+      for (int i = 0; i < need_n_corners; i++) {
+        best_corners.first.push_back(corners_with_scores.first[idx[i]]);
+        best_corners.second.push_back(corners_with_scores.second[idx[i]]);
+      }
+      corners_with_scores = std::move(best_corners);
     }
 
+    if (scale != 1.0) {
+      // Back to full resolution, only refine the new corners.
+      for (KeypointCV& corner : corners_with_scores.first) {
+        corner = fromProcessingScale(corner, scale);
+      }
+      refineKeypointsSubPix(cur_frame.img_, scale, &corners_with_scores.first);
+    }
     return corners_with_scores;
   }
 
+  /* --------------------------------------------------------------------------
+   */
+  int Tracker::getKltMaxLevel() const {
+    return std::max(
+        0, trackerParams_.klt_max_level_ -
+               static_cast<int>(std::round(-std::log2(processing_scale_))));
+  }
+
+  /* --------------------------------------------------------------------------
+   */
+  std::vector<cv::Mat> Tracker::getKltPyramid(const Frame& frame) {
+    // Frames are used twice in a row: as current and as reference frame.
+    for (size_t i = 0u; i < klt_pyramids_.size(); i++) {
+      if (klt_pyramids_[i].first == frame.timestamp_ &&
+          !klt_pyramids_[i].second.empty()) {
+        last_klt_pyramid_ = i;
+        return klt_pyramids_[i].second;
+      }
+    }
+    last_klt_pyramid_ = 1u - last_klt_pyramid_;
+    std::pair<Timestamp, std::vector<cv::Mat>>& klt_pyramid =
+        klt_pyramids_[last_klt_pyramid_];
+    klt_pyramid.first = frame.timestamp_;
+    klt_pyramid.second.clear();
+    cv::buildOpticalFlowPyramid(
+        getProcessingImage(frame), klt_pyramid.second,
+        cv::Size2i(trackerParams_.klt_win_size_, trackerParams_.klt_win_size_),
+        getKltMaxLevel());
+    return klt_pyramid.second;
+  }
+
+  /* --------------------------------------------------------------------------
+   */
+  size_t Tracker::forwardBackwardCheck(const std::vector<cv::Mat>& ref_pyramid,
+                                       const std::vector<cv::Mat>& cur_pyramid,
+                                       const KeypointsCV& px_ref,
+                                       const KeypointsCV& px_cur,
+                                       std::vector<uchar>* status) const {
+    CHECK_NOTNULL(status);
+    CHECK_EQ(px_ref.size(), px_cur.size());
+    CHECK_EQ(px_ref.size(), status->size());
+    // Only track back the keypoints that survived the forward pass.
+    std::vector<size_t> survivors;
+    survivors.reserve(px_cur.size());
+    KeypointsCV px_cur_survivors, px_back;
+    px_cur_survivors.reserve(px_cur.size());
+    px_back.reserve(px_cur.size());
+    for (size_t i = 0u; i < px_cur.size(); i++) {
+      if ((*status)[i]) {
+        survivors.push_back(i);
+        px_cur_survivors.push_back(px_cur[i]);
+        px_back.push_back(px_ref[i]);
+      }
+    }
+    if (survivors.empty()) return 0u;
+
+    std::vector<uchar> status_back;
+    std::vector<float> error_back;
+    cv::calcOpticalFlowPyrLK(
+        cur_pyramid, ref_pyramid, px_cur_survivors, px_back, status_back,
+        error_back,
+        cv::Size2i(trackerParams_.klt_win_size_, trackerParams_.klt_win_size_),
+        getKltMaxLevel(),
+        cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+                         trackerParams_.klt_max_iter_, trackerParams_.klt_eps_),
+        cv::OPTFLOW_USE_INITIAL_FLOW);
+
+    // Threshold is in full resolution pixels.
+    const double max_error = trackerParams_.klt_fb_max_error_ *
+                             processing_scale_;
+    size_t nr_rejected = 0u;
+    for (size_t j = 0u; j < survivors.size(); j++) {
+      if (!status_back[j] ||
+          cv::norm(px_back[j] - px_ref[survivors[j]]) > max_error) {
+        (*status)[survivors[j]] = 0;
+        ++nr_rejected;
+      }
+    }
+    VLOG(10) << "Forward-backward KLT check: rejected " << nr_rejected
+             << " of " << survivors.size() << " tracks.";
+    return nr_rejected;
+  }
+
   /* --------------------------------------------------------------------------
    */
   // TODO(Toni) a pity that this function is not const just because
@@ -128,7 +415,8 @@ void Tracker::featureDetection(Frame* cur_frame) {
   void Tracker::featureTracking(Frame * ref_frame, Frame * cur_frame) {
     CHECK_NOTNULL(ref_frame);
     CHECK_NOTNULL(cur_frame);
-    double start_time = UtilsOpenCV::GetTimeInSeconds();  // Log timing.
+    VIO_PROFILE_ZONE("Tracker::featureTracking");
+    utils::ScopedTimer timer;
 
     // Fill up structure for reference pixels and their labels.
     KeypointsCV px_ref;
@@ -151,15 +439,40 @@ void Tracker::featureDetection(Frame* cur_frame) {
 
     // Initialize to old locations
     KeypointsCV px_cur = px_ref;
+    debugInfo_.nrKltFbRejected_ = 0;
     if (px_cur.size() > 0) {
       // Do the actual tracking, so px_cur becomes the new pixel locations.
       VLOG(2) << "Sarting Optical Flow Pyr LK tracking...";
-      cv::calcOpticalFlowPyrLK(ref_frame->img_, cur_frame->img_, px_ref, px_cur,
-                               status, error,
+      // Track on the images at the processing scale, with the pyramid levels
+      // that are already covered by the downsampling removed.
+      KeypointsCV px_ref_scaled = px_ref;
+      if (processing_scale_ != 1.0) {
+        for (KeypointCV& px : px_ref_scaled) {
+          px = toProcessingScale(px, processing_scale_);
+        }
+      }
+      KeypointsCV px_cur_scaled = px_ref_scaled;
+      const std::vector<cv::Mat> ref_pyramid = getKltPyramid(*ref_frame);
+      const std::vector<cv::Mat> cur_pyramid = getKltPyramid(*cur_frame);
+      cv::calcOpticalFlowPyrLK(ref_pyramid, cur_pyramid, px_ref_scaled,
+                               px_cur_scaled, status, error,
                                cv::Size2i(trackerParams_.klt_win_size_,
                                           trackerParams_.klt_win_size_),
-                               trackerParams_.klt_max_level_, termcrit,
+                               getKltMaxLevel(), termcrit,
                                cv::OPTFLOW_USE_INITIAL_FLOW);
+      if (trackerParams_.klt_fb_check_) {
+        debugInfo_.nrKltFbRejected_ = forwardBackwardCheck(
+            ref_pyramid, cur_pyramid, px_ref_scaled, px_cur_scaled, &status);
+      }
+      if (processing_scale_ == 1.0) {
+        px_cur = px_cur_scaled;
+      } else {
+        // Back to full resolution. KLT is already subpixel: only the new
+        // corners are refined.
+        for (size_t i = 0; i < px_cur_scaled.size(); ++i) {
+          px_cur[i] = fromProcessingScale(px_cur_scaled[i], processing_scale_);
+        }
+      }
       VLOG(2) << "Finished Optical Flow Pyr LK tracking.";
 
       if (cur_frame->keypoints_.empty()) {  // Do we really need this check?
@@ -168,8 +481,15 @@ void Tracker::featureDetection(Frame* cur_frame) {
         cur_frame->keypoints_.reserve(px_ref.size());
         cur_frame->scores_.reserve(px_ref.size());
         cur_frame->versors_.reserve(px_ref.size());
+        debugInfo_.nrPrunedKltTracks_ = 0;
         for (size_t i = 0, n = 0; i < indices.size(); ++i) {
           const size_t& i_ref = indices[i];
+          // Hopeless track: do not compute its versor nor match it in stereo.
+          if (status[i] && trackerParams_.track_max_klt_error_ > 0.0 &&
+              error[i] > trackerParams_.track_max_klt_error_) {
+            status[i] = 0;
+            ++debugInfo_.nrPrunedKltTracks_;
+          }
           // If we failed to track mark off that landmark
           if (!status[i] ||
               ref_frame->landmarksAge_[i_ref] >
@@ -179,8 +499,10 @@ void Tracker::featureDetection(Frame* cur_frame) {
             ref_frame->landmarks_[i_ref] =
                 -1;  // we are marking this bad in the ref_frame since features
                      // in the ref frame guide feature detection later on
+            if (feature_grid_) feature_grid_->remove(px_ref[i]);
             continue;
           }
+          if (feature_grid_) feature_grid_->move(px_ref[i], px_cur[i]);
           cur_frame->landmarks_.push_back(ref_frame->landmarks_[i_ref]);
           cur_frame->landmarksAge_.push_back(ref_frame->landmarksAge_[i_ref]);
           cur_frame->scores_.push_back(ref_frame->scores_[i_ref]);
@@ -202,9 +524,7 @@ void Tracker::featureDetection(Frame* cur_frame) {
       }
     }
     debugInfo_.nrTrackerFeatures_ = cur_frame->keypoints_.size();
-    if (verbosity_ >= 5)
-      debugInfo_.featureTrackingTime_ =
-          UtilsOpenCV::GetTimeInSeconds() - start_time;
+    debugInfo_.featureTrackingTime_ = timer.elapsedSeconds();
   }
 
   /* --------------------------------------------------------------------------
@@ -213,7 +533,8 @@ void Tracker::featureDetection(Frame* cur_frame) {
   Tracker::geometricOutlierRejectionMono(Frame * ref_frame, Frame * cur_frame) {
     CHECK_NOTNULL(ref_frame);
     CHECK_NOTNULL(cur_frame);
-    double start_time = UtilsOpenCV::GetTimeInSeconds();
+    VIO_PROFILE_ZONE("Tracker::geometricOutlierRejectionMono");
+    utils::ScopedTimer timer;
 
     std::vector<std::pair<size_t, size_t>> matches_ref_cur;
     findMatchingKeypoints(*ref_frame, *cur_frame, &matches_ref_cur);
@@ -290,9 +611,7 @@ void Tracker::featureDetection(Frame* cur_frame) {
     //      gtsam::Pose3(camLrect_R_camL_cut.inverse(),Point3());
     //}
 
-    if (verbosity_ >= 5) {
-      debugInfo_.monoRansacTime_ = UtilsOpenCV::GetTimeInSeconds() - start_time;
-    }
+    debugInfo_.monoRansacTime_ = timer.elapsedSeconds();
     debugInfo_.nrMonoInliers_ = ransac.inliers_.size();
     debugInfo_.nrMonoPutatives_ = matches_ref_cur.size();
     debugInfo_.monoRansacIters_ = ransac.iterations_;
@@ -307,8 +626,9 @@ void Tracker::featureDetection(Frame* cur_frame) {
     CHECK_NOTNULL(ref_frame);
     CHECK_NOTNULL(cur_frame);
 
-    // To log the time taken to perform this function.
-    double start_time = UtilsOpenCV::GetTimeInSeconds();
+    VIO_PROFILE_ZONE(
+        "Tracker::geometricOutlierRejectionMonoGivenRotation");
+    utils::ScopedTimer timer;
 
     std::vector<std::pair<size_t, size_t>> matches_ref_cur;
     findMatchingKeypoints(*ref_frame, *cur_frame, &matches_ref_cur);
@@ -412,10 +732,7 @@ void Tracker::featureDetection(Frame* cur_frame) {
           gtsam::Pose3(camLrect_R_camL_cut.inverse(), Point3());
     }
 
-    if (verbosity_ >= 5) {
-      // TODO(Toni) remove verbosity parameters, use gflags instead.
-      debugInfo_.monoRansacTime_ = UtilsOpenCV::GetTimeInSeconds() - start_time;
-    }
+    debugInfo_.monoRansacTime_ = timer.elapsedSeconds();
     debugInfo_.nrMonoInliers_ = ransac.inliers_.size();
     debugInfo_.nrMonoPutatives_ = matches_ref_cur.size();
     debugInfo_.monoRansacIters_ = ransac.iterations_;
@@ -466,7 +783,9 @@ void Tracker::featureDetection(Frame* cur_frame) {
   Tracker::geometricOutlierRejectionStereoGivenRotation(
       StereoFrame & ref_stereoFrame, StereoFrame & cur_stereoFrame,
       const gtsam::Rot3& R) {
-    double start_time = UtilsOpenCV::GetTimeInSeconds();
+    VIO_PROFILE_ZONE(
+        "Tracker::geometricOutlierRejectionStereoGivenRotation");
+    utils::ScopedTimer timer;
 
     std::vector<std::pair<size_t, size_t>> matches_ref_cur;
     findMatchingStereoKeypoints(ref_stereoFrame, cur_stereoFrame,
@@ -489,11 +808,6 @@ void Tracker::featureDetection(Frame* cur_frame) {
     // In the ref frame of the left camera.
     gtsam::StereoCamera stereoCam = gtsam::StereoCamera(gtsam::Pose3(), K);
 
-    double timeMatchingAndAllocation_p = 0;
-    if (verbosity_ >= 5) {
-      timeMatchingAndAllocation_p = UtilsOpenCV::GetTimeInSeconds();
-    }
-
     //============================================================================
     // CREATE DATA STRUCTURES
     //============================================================================
@@ -517,28 +831,27 @@ void Tracker::featureDetection(Frame* cur_frame) {
     Matrices3f cov_relTranf;
     cov_relTranf.reserve(nrMatches);
 
-    for (const std::pair<size_t, size_t>& it : matches_ref_cur) {
-      // Get reference vector and covariance:
-      std::tie(f_ref_i, cov_ref_i) = Tracker::getPoint3AndCovariance(
-          ref_stereoFrame, stereoCam, it.first, stereoPtCov);
-      // Get current vectors and covariance:
-      std::tie(R_f_cur_i, cov_R_cur_i) = Tracker::getPoint3AndCovariance(
-          cur_stereoFrame, stereoCam, it.second, stereoPtCov, R.matrix());
-
-      // Populate relative translation estimates and their covariances.
-      Vector3 v = f_ref_i - R_f_cur_i;
-      Matrix3 M = cov_R_cur_i + cov_ref_i;
-
-      relTran.push_back(v);
-      cov_relTran.push_back(M);
-
-      relTranf.push_back(v.cast<float>());
-      cov_relTranf.push_back(M.cast<float>());
-    }
-
-    double timeCreatePointsAndCov_p = 0;
-    if (verbosity_ >= 5) {
-      timeCreatePointsAndCov_p = UtilsOpenCV::GetTimeInSeconds();
+    {
+      VIO_PROFILE_ZONE(
+          "Tracker::geometricOutlierRejectionStereoGivenRotation points");
+      for (const std::pair<size_t, size_t>& it : matches_ref_cur) {
+        // Get reference vector and covariance:
+        std::tie(f_ref_i, cov_ref_i) = Tracker::getPoint3AndCovariance(
+            ref_stereoFrame, stereoCam, it.first, stereoPtCov);
+        // Get current vectors and covariance:
+        std::tie(R_f_cur_i, cov_R_cur_i) = Tracker::getPoint3AndCovariance(
+            cur_stereoFrame, stereoCam, it.second, stereoPtCov, R.matrix());
+
+        // Populate relative translation estimates and their covariances.
+        Vector3 v = f_ref_i - R_f_cur_i;
+        Matrix3 M = cov_R_cur_i + cov_ref_i;
+
+        relTran.push_back(v);
+        cov_relTran.push_back(M);
+
+        relTranf.push_back(v.cast<float>());
+        cov_relTranf.push_back(M.cast<float>());
+      }
     }
 
     //============================================================================
@@ -552,67 +865,69 @@ void Tracker::featureDetection(Frame* cur_frame) {
 
     size_t maxCoherentSetSize = 0;
     size_t maxCoherentSetId = 0;
-    // double timeMahalanobis = 0, timeAllocate = 0, timePushBack = 0,
-    // timeMaxSet = 0;
-    float threshold =
-      static_cast<float>(trackerParams_
-          .ransac_threshold_stereo_);  // residual should be distributed
-                                               // according to chi-square
-                                               // distribution with 3 dofs,
-    // considering a tail probability of 0.1, we get this value (x =
-    // chi2inv(0.9,3) = 6.2514
-
-    Vector3f v;
-    Matrix3f O;  // allocate just once
-    Vector3f relTran_i;
-    Matrix3f cov_relTran_i;
-    float dinv, innovationMahalanobisNorm;  // define just once
-    for (size_t i = 0; i < nrMatches; i++) {
-      relTran_i = relTranf.at(i);
-      cov_relTran_i = cov_relTranf.at(i);
-      coherentSet.at(i).push_back(
-          i);  // vector is coherent with itself for sure
-      for (size_t j = i + 1; j < nrMatches;
-           j++) {  // look at the other vectors (quadratic complexity)
-        // timeBefore = UtilsOpenCV::GetTimeInSeconds();
-        v = relTran_i - relTranf.at(j);          // relTranMismatch_ij
-        O = cov_relTran_i + cov_relTranf.at(j);  // cov_relTran_j
-        // timeAllocate += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
-
-        // see testTracker for different implementations and timing for the
-        // mahalanobis distance
-        // timeBefore = UtilsOpenCV::GetTimeInSeconds();
-        dinv = 1 / (O(0, 0) * (O(1, 1) * O(2, 2) - O(1, 2) * O(2, 1)) -
-                    O(1, 0) * (O(0, 1) * O(2, 2) - O(0, 2) * O(2, 1)) +
-                    O(2, 0) * (O(0, 1) * O(1, 2) - O(1, 1) * O(0, 2)));
-        innovationMahalanobisNorm =
-            dinv * v(0) *
-                (v(0) * (O(1, 1) * O(2, 2) - O(1, 2) * O(2, 1)) -
-                 v(1) * (O(0, 1) * O(2, 2) - O(0, 2) * O(2, 1)) +
-                 v(2) * (O(0, 1) * O(1, 2) - O(1, 1) * O(0, 2))) +
-            dinv * v(1) *
-                (O(0, 0) * (v(1) * O(2, 2) - O(1, 2) * v(2)) -
-                 O(1, 0) * (v(0) * O(2, 2) - O(0, 2) * v(2)) +
-                 O(2, 0) * (v(0) * O(1, 2) - v(1) * O(0, 2))) +
-            dinv * v(2) *
-                (O(0, 0) * (O(1, 1) * v(2) - v(1) * O(2, 1)) -
-                 O(1, 0) * (O(0, 1) * v(2) - v(0) * O(2, 1)) +
-                 O(2, 0) * (O(0, 1) * v(1) - O(1, 1) * v(0)));
-        // timeMahalanobis += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
-
+    {
+      VIO_PROFILE_ZONE(
+          "Tracker::geometricOutlierRejectionStereoGivenRotation voting");
+      // double timeMahalanobis = 0, timeAllocate = 0, timePushBack = 0,
+      // timeMaxSet = 0;
+      // Residual should be distributed according to chi-square distribution
+      // with 3 dofs, considering a tail probability of 0.1, we get this value
+      // (x = chi2inv(0.9,3) = 6.2514).
+      float threshold =
+          static_cast<float>(trackerParams_.ransac_threshold_stereo_);
+
+      Vector3f v;
+      Matrix3f O;  // allocate just once
+      Vector3f relTran_i;
+      Matrix3f cov_relTran_i;
+      float dinv, innovationMahalanobisNorm;  // define just once
+      for (size_t i = 0; i < nrMatches; i++) {
+        relTran_i = relTranf.at(i);
+        cov_relTran_i = cov_relTranf.at(i);
+        coherentSet.at(i).push_back(
+            i);  // vector is coherent with itself for sure
+        for (size_t j = i + 1; j < nrMatches;
+             j++) {  // look at the other vectors (quadratic complexity)
+          // timeBefore = UtilsOpenCV::GetTimeInSeconds();
+          v = relTran_i - relTranf.at(j);          // relTranMismatch_ij
+          O = cov_relTran_i + cov_relTranf.at(j);  // cov_relTran_j
+          // timeAllocate += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
+
+          // see testTracker for different implementations and timing for the
+          // mahalanobis distance
+          // timeBefore = UtilsOpenCV::GetTimeInSeconds();
+          dinv = 1 / (O(0, 0) * (O(1, 1) * O(2, 2) - O(1, 2) * O(2, 1)) -
+                      O(1, 0) * (O(0, 1) * O(2, 2) - O(0, 2) * O(2, 1)) +
+                      O(2, 0) * (O(0, 1) * O(1, 2) - O(1, 1) * O(0, 2)));
+          innovationMahalanobisNorm =
+              dinv * v(0) *
+                  (v(0) * (O(1, 1) * O(2, 2) - O(1, 2) * O(2, 1)) -
+                   v(1) * (O(0, 1) * O(2, 2) - O(0, 2) * O(2, 1)) +
+                   v(2) * (O(0, 1) * O(1, 2) - O(1, 1) * O(0, 2))) +
+              dinv * v(1) *
+                  (O(0, 0) * (v(1) * O(2, 2) - O(1, 2) * v(2)) -
+                   O(1, 0) * (v(0) * O(2, 2) - O(0, 2) * v(2)) +
+                   O(2, 0) * (v(0) * O(1, 2) - v(1) * O(0, 2))) +
+              dinv * v(2) *
+                  (O(0, 0) * (O(1, 1) * v(2) - v(1) * O(2, 1)) -
+                   O(1, 0) * (O(0, 1) * v(2) - v(0) * O(2, 1)) +
+                   O(2, 0) * (O(0, 1) * v(1) - O(1, 1) * v(0)));
+          // timeMahalanobis += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
+
+          // timeBefore = UtilsOpenCV::GetTimeInSeconds();
+          if (innovationMahalanobisNorm < threshold) {
+            coherentSet.at(i).push_back(j);
+            coherentSet.at(j).push_back(i);  // norm is symmetric
+          }
+          // timePushBack += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
+        }
         // timeBefore = UtilsOpenCV::GetTimeInSeconds();
-        if (innovationMahalanobisNorm < threshold) {
-          coherentSet.at(i).push_back(j);
-          coherentSet.at(j).push_back(i);  // norm is symmetric
+        if (coherentSet.at(i).size() > maxCoherentSetSize) {
+          maxCoherentSetSize = coherentSet.at(i).size();
+          maxCoherentSetId = i;
         }
-        // timePushBack += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
-      }
-      // timeBefore = UtilsOpenCV::GetTimeInSeconds();
-      if (coherentSet.at(i).size() > maxCoherentSetSize) {
-        maxCoherentSetSize = coherentSet.at(i).size();
-        maxCoherentSetId = i;
+        // timeMaxSet += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
       }
-      // timeMaxSet += UtilsOpenCV::GetTimeInSeconds() - timeBefore;
     }
     // std::cout << "timeMahalanobis: " << timeMahalanobis << std::endl
     //<< "timeAllocate: " << timeAllocate << std::endl
@@ -620,11 +935,6 @@ void Tracker::featureDetection(Frame* cur_frame) {
     //<< "timeMaxSet: " << timeMaxSet << std::endl
     //<< " relTran.size(): " << relTran.size() << std::endl;
 
-    double timeVoting_p = 0;
-    if (verbosity_ >= 5) {
-      timeVoting_p = UtilsOpenCV::GetTimeInSeconds();
-    }
-
     VLOG(10) << "geometricOutlierRejectionStereoGivenRot: voting complete.";
 
     //============================================================================
@@ -670,18 +980,7 @@ void Tracker::featureDetection(Frame* cur_frame) {
     }
     t = totalInfo.inverse() * t;
 
-    if (verbosity_ >= 5) {
-      double timeTranslationComputation_p = UtilsOpenCV::GetTimeInSeconds();
-      VLOG(10) << " timeMatchingAndAllocation: "
-               << timeMatchingAndAllocation_p - start_time
-               << " timeCreatePointsAndCov: "
-               << timeCreatePointsAndCov_p - timeMatchingAndAllocation_p
-               << " timeVoting: " << timeVoting_p - timeCreatePointsAndCov_p
-               << " timeTranslationComputation: "
-               << timeTranslationComputation_p - timeVoting_p;
-      debugInfo_.stereoRansacTime_ =
-          UtilsOpenCV::GetTimeInSeconds() - start_time;
-    }
+    debugInfo_.stereoRansacTime_ = timer.elapsedSeconds();
     debugInfo_.nrStereoInliers_ = inliers.size();
     debugInfo_.nrStereoPutatives_ = matches_ref_cur.size();
     debugInfo_.stereoRansacIters_ = iterations;
@@ -696,7 +995,8 @@ void Tracker::featureDetection(Frame* cur_frame) {
   std::pair<TrackingStatus, gtsam::Pose3>
   Tracker::geometricOutlierRejectionStereo(StereoFrame & ref_stereoFrame,
                                            StereoFrame & cur_stereoFrame) {
-    double start_time = UtilsOpenCV::GetTimeInSeconds();
+    VIO_PROFILE_ZONE("Tracker::geometricOutlierRejectionStereo");
+    utils::ScopedTimer timer;
 
     std::vector<std::pair<size_t, size_t>> matches_ref_cur;
     findMatchingStereoKeypoints(ref_stereoFrame, cur_stereoFrame,
@@ -748,10 +1048,7 @@ void Tracker::featureDetection(Frame* cur_frame) {
     // Get the resulting transformation: a 3x4 matrix [R t].
     opengv::transformation_t best_transformation = ransac.model_coefficients_;
 
-    if (verbosity_ >= 5) {
-      debugInfo_.stereoRansacTime_ =
-          UtilsOpenCV::GetTimeInSeconds() - start_time;
-    }
+    debugInfo_.stereoRansacTime_ = timer.elapsedSeconds();
     debugInfo_.nrStereoInliers_ = ransac.inliers_.size();
     debugInfo_.nrStereoPutatives_ = matches_ref_cur.size();
     debugInfo_.stereoRansacIters_ = ransac.iterations_;
@@ -815,6 +1112,43 @@ void Tracker::featureDetection(Frame* cur_frame) {
     }
   }
 
+  /* --------------------------------------------------------------------------
+   */
+  size_t Tracker::pruneTracks(StereoFrame* stereo_frame) {
+    CHECK_NOTNULL(stereo_frame);
+    Frame* left_frame = stereo_frame->getLeftFrameMutable();
+    const std::vector<Kstatus>& right_keypoints_status =
+        stereo_frame->right_keypoints_status_;
+    CHECK_EQ(left_frame->landmarks_.size(), right_keypoints_status.size());
+
+    // Tracks not in this keyframe are forgotten.
+    std::unordered_map<LandmarkId, size_t> nr_stereo_failures;
+    size_t nr_pruned = 0u;
+    for (size_t i = 0u; i < left_frame->landmarks_.size(); i++) {
+      LandmarkId& lmk_id = left_frame->landmarks_[i];
+      if (lmk_id == -1 || right_keypoints_status[i] == Kstatus::VALID) {
+        continue;
+      }
+      const auto it = nr_stereo_failures_.find(lmk_id);
+      const size_t nr_failures =
+          (it == nr_stereo_failures_.end() ? 0u : it->second) + 1u;
+      if (trackerParams_.track_max_stereo_failures_ > 0 &&
+          nr_failures >= static_cast<size_t>(
+                             trackerParams_.track_max_stereo_failures_)) {
+        if (feature_grid_) feature_grid_->remove(left_frame->keypoints_[i]);
+        lmk_id = -1;
+        ++nr_pruned;
+      } else {
+        nr_stereo_failures[lmk_id] = nr_failures;
+      }
+    }
+    nr_stereo_failures_.swap(nr_stereo_failures);
+    debugInfo_.nrPrunedStereoTracks_ = nr_pruned;
+    VLOG(10) << "pruneTracks: pruned " << nr_pruned << " tracks, "
+             << nr_stereo_failures_.size() << " tracks failed stereo.";
+    return nr_pruned;
+  }
+
   /* --------------------------------------------------------------------------
    */
   void Tracker::removeOutliersMono(
@@ -831,7 +1165,12 @@ void Tracker::featureDetection(Frame* cur_frame) {
     // int.
     for (const size_t& i : outliers) {
       ref_frame->landmarks_.at(matches_ref_cur[i].first) = -1;
-      cur_frame->landmarks_.at(matches_ref_cur[i].second) = -1;
+      LandmarkId& cur_lmk = cur_frame->landmarks_.at(matches_ref_cur[i].second);
+      if (feature_grid_ && cur_lmk != -1) {
+        feature_grid_->remove(
+            cur_frame->keypoints_.at(matches_ref_cur[i].second));
+      }
+      cur_lmk = -1;
     }
     VLOG(10) << "RANSAC (MONO): #iter = " << iterations
              << ", #inliers = " << inliers.size()
@@ -863,6 +1202,19 @@ void Tracker::featureDetection(Frame* cur_frame) {
       cur_stereoFrame.keypoints_depth_.at(matches_ref_cur[i].second) = 0.0;
       cur_stereoFrame.keypoints_3d_.at(matches_ref_cur[i].second) =
           Vector3::Zero();
+
+      // With the feature grid, drop the track so that its cell gets a new
+      // feature at the next detection.
+      if (feature_grid_) {
+        Frame* cur_left_frame = cur_stereoFrame.getLeftFrameMutable();
+        LandmarkId& cur_lmk =
+            cur_left_frame->landmarks_.at(matches_ref_cur[i].second);
+        if (cur_lmk != -1) {
+          feature_grid_->remove(
+              cur_left_frame->keypoints_.at(matches_ref_cur[i].second));
+          cur_lmk = -1;
+        }
+      }
     }
     VLOG(10) << "RANSAC (STEREO): #iter = " << iterations
              << ", #inliers = " << inliers.size()
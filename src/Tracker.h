@@ -17,6 +17,10 @@
 
 #include <time.h>
 
+#include <array>
+#include <unordered_map>
+#include <utility>
+
 #include <boost/shared_ptr.hpp> // used for opengv
 #include <boost/filesystem.hpp> // to create folders
 
@@ -28,6 +32,7 @@
 #include <gtsam/geometry/StereoCamera.h>
 
 #include "UtilsOpenCV.h"
+#include "FeatureGrid.h"
 #include "Frame.h"
 #include "StereoFrame.h"
 #include "Tracker-definitions.h"
@@ -66,6 +71,10 @@ public:
                        Frame* cur_frame);
   void featureDetection(Frame* cur_frame);
 
+  // Reset the mask for feature detection, restricted to the region of
+  // interest in FLAGS_frontend_roi_mask_path if any.
+  void setCamMask(const cv::Size& img_size);
+
   std::pair<TrackingStatus, gtsam::Pose3>
   geometricOutlierRejectionMono(Frame* ref_frame,
                                 Frame* cur_frame);
@@ -105,6 +114,13 @@ public:
   void checkStatusRightKeypoints(
       const std::vector<Kstatus>& right_keypoints_status);
 
+  // Updates the stereo history of the tracks with the stereo matching of a
+  // keyframe, and invalidates the tracks that failed stereo matching (or
+  // stereo RANSAC) in too many consecutive keyframes, so that they are not
+  // tracked, matched nor sent to the backend anymore.
+  // Returns the number of pruned tracks.
+  size_t pruneTracks(StereoFrame* stereo_frame);
+
   /* ---------------------------- CONST FUNCTIONS --------------------------- */
   // returns frame with markers
   cv::Mat displayFrame(
@@ -142,11 +158,42 @@ public:
 
   // Returns landmark_count (updated from the new keypoints),
   // and nr or extracted corners.
+  // If a processing_img is given, corners are detected on it (the image of
+  // cur_frame downsampled by processing_scale), and refined on the full
+  // resolution image.
   static std::pair<KeypointsCV, std::vector<double>>
   featureDetection(const Frame& cur_frame,
                    const VioFrontEndParams& trackerParams,
                    const cv::Mat& cam_mask,
-                   const int need_n_corners);
+                   const int need_n_corners,
+                   const cv::Mat& processing_img = cv::Mat(),
+                   const double& processing_scale = 1.0);
+
+  // Mask of the pixels where new features can be detected: inside the camera
+  // mask and far enough from the valid keypoints, at the given scale.
+  static cv::Mat computeDetectionMask(const Frame& cur_frame,
+                                      const VioFrontEndParams& trackerParams,
+                                      const cv::Mat& cam_mask,
+                                      const cv::Size& mask_size,
+                                      const double& scale);
+
+  // Subpixel refinement on the full resolution image of keypoints found on
+  // an image downsampled by processing_scale.
+  static void refineKeypointsSubPix(const cv::Mat& img,
+                                    const double& processing_scale,
+                                    KeypointsCV* keypoints);
+
+  // Pixel coordinates at full resolution to the image downsampled by scale
+  // with cv::INTER_AREA, and back: pixel centers are shifted by half a pixel.
+  static inline KeypointCV toProcessingScale(const KeypointCV& px,
+                                             const double& scale) {
+    return (px + KeypointCV(0.5f, 0.5f)) * scale - KeypointCV(0.5f, 0.5f);
+  }
+  static inline KeypointCV fromProcessingScale(const KeypointCV& px,
+                                               const double& scale) {
+    return (px + KeypointCV(0.5f, 0.5f)) * (1.0 / scale) -
+           KeypointCV(0.5f, 0.5f);
+  }
 
   static std::pair< Vector3, Matrix3 > getPoint3AndCovariance(
       const StereoFrame& stereoFrame,
@@ -159,6 +206,48 @@ public:
   inline DebugTrackerInfo getTrackerDebugInfo() { return debugInfo_; }
 
  private:
+  // Image of the frame at the processing scale (cached for the current and
+  // reference frames).
+  cv::Mat getProcessingImage(const Frame& frame);
+
+  // Max pyramid level for KLT at the processing scale.
+  int getKltMaxLevel() const;
+
+  // KLT pyramid of the image of the frame at the processing scale (cached
+  // for the current and reference frames).
+  std::vector<cv::Mat> getKltPyramid(const Frame& frame);
+
+  // Tracks back the keypoints tracked from ref to cur (status set), and
+  // unsets the status of the ones that do not land close enough to their
+  // reference keypoint. Keypoints are at the processing scale.
+  // Returns the number of rejected keypoints.
+  size_t forwardBackwardCheck(const std::vector<cv::Mat>& ref_pyramid,
+                              const std::vector<cv::Mat>& cur_pyramid,
+                              const KeypointsCV& px_ref,
+                              const KeypointsCV& px_cur,
+                              std::vector<uchar>* status) const;
+
+  // Detect new features only in the cells of the feature grid that are
+  // missing features, up to their quota.
+  std::pair<KeypointsCV, std::vector<double>> featureDetectionGrid(
+      const Frame& cur_frame, const int need_n_corners);
+
+ private:
+  // Scale of the images used for detection and tracking.
+  const double processing_scale_;
+  std::array<std::pair<Timestamp, cv::Mat>, 2> processing_imgs_;
+  size_t last_processing_img_ = 0u;
+  std::array<std::pair<Timestamp, std::vector<cv::Mat>>, 2> klt_pyramids_;
+  size_t last_klt_pyramid_ = 0u;
+
+  // Occupancy of the image by the features tracked in the last frame, only
+  // if grid-based feature detection is enabled.
+  std::unique_ptr<FeatureGrid> feature_grid_ = {nullptr};
+
+  // Consecutive keyframes without valid stereo match, per landmark (only
+  // for landmarks that failed in the last keyframe).
+  std::unordered_map<LandmarkId, size_t> nr_stereo_failures_;
+
   // Pixel offset for using center of image
   cv::Point2f pixelOffset_;
 
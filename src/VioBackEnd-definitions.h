@@ -29,6 +29,7 @@
 #include "Tracker-definitions.h"
 #include "UtilsOpenCV.h"
 #include "common/vio_types.h"
+#include "datasource/DataSource-definitions.h"
 #include "imu-frontend/ImuFrontEnd-definitions.h"
 #include "imu-frontend/ImuFrontEnd.h"
 
@@ -220,14 +221,16 @@ struct VioBackEndInputPayload {
           stereo_tracking_status,  // stereo_vision_frontend_->trackerStatusSummary_.kfTrackingStatus_stereo_;
       const ImuFrontEnd::PreintegratedImuMeasurements& pim,
       boost::optional<gtsam::Pose3> stereo_ransac_body_pose = boost::none,
-      std::vector<Plane>* planes = nullptr)
+      std::vector<Plane>* planes = nullptr,
+      boost::optional<VioNavState> reinit_state = boost::none)
       : timestamp_kf_nsec_(timestamp_kf_nsec),
         status_smart_stereo_measurements_kf_(
             status_smart_stereo_measurements_kf),
         stereo_tracking_status_(stereo_tracking_status),
         pim_(pim),
         planes_(planes),
-        stereo_ransac_body_pose_(stereo_ransac_body_pose) {}
+        stereo_ransac_body_pose_(stereo_ransac_body_pose),
+        reinit_state_(reinit_state) {}
   const Timestamp timestamp_kf_nsec_;
   const StatusSmartStereoMeasurements status_smart_stereo_measurements_kf_;
   const TrackingStatus
@@ -238,6 +241,9 @@ struct VioBackEndInputPayload {
   const gtsam::PreintegratedImuMeasurements pim_;
   std::vector<Plane>* planes_;
   boost::optional<gtsam::Pose3> stereo_ransac_body_pose_;
+  // If set, the backend resets its smoother and state to this seed at
+  // timestamp_kf_nsec_ instead of adding a new keyframe (hot re-init).
+  boost::optional<VioNavState> reinit_state_;
 
  public:
   void print() const {
@@ -266,6 +272,7 @@ struct VioBackEndInputPayload {
     LOG_IF(INFO, planes_ != nullptr) << "Number of planes: " << planes_->size();
     LOG_IF(INFO, stereo_ransac_body_pose_)
         << "Stereo Ransac Body Pose: " << *stereo_ransac_body_pose_;
+    if (reinit_state_) reinit_state_->print("Re-initialization state: ");
   }
 };
 
@@ -24,10 +24,14 @@
 
 #include "VioBackEnd.h"
 
+#include <sstream>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "datasource/DataSource-definitions.h"  // Only for gtNavState ...
+#include "utils/Diagnostics.h"
+#include "utils/Profiler.h"
 #include "utils/Statistics.h"
 #include "utils/Timer.h"
 
@@ -53,7 +57,9 @@ VioBackEnd::VioBackEnd(const Pose3& leftCamPose,
                        const VioNavState& initial_state_seed,
                        const Timestamp& timestamp_k,
                        const VioBackEndParams& vioParams,
-                       const bool& log_output)
+                       const bool& log_output,
+                       const boost::optional<gtsam::Matrix>&
+                           initial_imu_bias_covariance)
     : vio_params_(vioParams),
       timestamp_lkf_(-1),
       imu_bias_lkf_(ImuBias()),
@@ -75,6 +81,11 @@ VioBackEnd::VioBackEnd(const Pose3& leftCamPose,
       logger_(nullptr),
       verbosity_(0) {
   if (log_output_) logger_ = VIO::make_unique<BackendLogger>();
+  if (initial_imu_bias_covariance) {
+    CHECK_EQ(initial_imu_bias_covariance->rows(), 6);
+    CHECK_EQ(initial_imu_bias_covariance->cols(), 6);
+    initial_imu_bias_covariance_ = initial_imu_bias_covariance;
+  }
 
     // TODO the parsing of the params should be done inside here out from the
     // path to the params file, otherwise other derived VIO backends will be
@@ -89,18 +100,7 @@ VioBackEnd::VioBackEnd(const Pose3& leftCamPose,
 
     //////////////////////////////////////////////////////////////////////////////
     // Initialize smoother.
-#ifdef INCREMENTAL_SMOOTHER
-  gtsam::ISAM2Params isam_param;
-  setIsam2Params(vioParams, &isam_param);
-
-  smoother_ = std::make_shared<Smoother>(vioParams.horizon_, isam_param);
-#else  // BATCH SMOOTHER
-  gtsam::LevenbergMarquardtParams lmParams;
-  lmParams.setlambdaInitial(0.0);     // same as GN
-  lmParams.setlambdaLowerBound(0.0);  // same as GN
-  lmParams.setlambdaUpperBound(0.0);  // same as GN)
-  smoother_ = std::make_shared<Smoother>(vioParams.horizon_, lmParams);
-#endif
+  setSmoother(vioParams, &smoother_);
 
   // Set parameters for all factors.
   setFactorsParams(vioParams, &smart_noise_, &smart_factors_params_,
@@ -174,6 +174,7 @@ bool VioBackEnd::spin(ThreadsafeQueue<VioBackEndInputPayload>& input_queue,
       VLOG(2) << "Push backend output payload.";
       output_queue.push(spinOnce(input));
       auto spin_duration = utils::Timer::toc(tic).count();
+      last_spin_duration_ = spin_duration;
       LOG(WARNING) << "Current Backend frequency: " << 1000.0 / spin_duration
                    << " Hz. (" << spin_duration << " ms).";
       stat_backend_timing.AddSample(spin_duration);
@@ -193,11 +194,19 @@ bool VioBackEnd::spin(ThreadsafeQueue<VioBackEndInputPayload>& input_queue,
 /* -------------------------------------------------------------------------- */
 VioBackEndOutputPayload VioBackEnd::spinOnce(
     const std::shared_ptr<VioBackEndInputPayload>& input) {
+  VIO_PROFILE_ZONE("VioBackEnd::spinOnce");
   CHECK(input) << "No VioBackEnd Input Payload received.";
   if (VLOG_IS_ON(10)) input->print();
 
-  // Process data with VIO.
-  addVisualInertialStateAndOptimize(input);
+  if (input->reinit_state_) {
+    // Hot re-initialization: re-seed the backend at this keyframe.
+    LOG(WARNING) << "Hot re-initialization of backend at timestamp: "
+                 << input->timestamp_kf_nsec_;
+    resetStateAndSetPriors(input->timestamp_kf_nsec_, *input->reinit_state_);
+  } else {
+    // Process data with VIO.
+    addVisualInertialStateAndOptimize(input);
+  }
 
   // Update imu bias for the frontend! Note that this should be done asap
   // ideally just when the optimization finishes, so that the frontend might
@@ -274,6 +283,53 @@ void VioBackEnd::initStateAndSetPriors(const Timestamp& timestamp_kf_nsec,
   optimize(timestamp_kf_nsec, curr_kf_id_, vio_params_.numOptimize_);
 }
 
+/* -------------------------------------------------------------------------- */
+void VioBackEnd::restoreStateAndSetPriors(const Timestamp& timestamp_kf_nsec,
+                                          const VioNavState& state,
+                                          const gtsam::Matrix& state_covariance,
+                                          const int& kf_id) {
+  LOG(INFO) << "Restoring backend state at keyframe " << kf_id
+            << " (timestamp: " << timestamp_kf_nsec << ").";
+  // Priors of the restored state, from its marginal covariance if computed.
+  const bool has_covariance = state_covariance.rows() == 15 &&
+                              state_covariance.cols() == 15 &&
+                              state_covariance.trace() > 0.0;
+  if (has_covariance) initial_state_covariance_ = state_covariance;
+  resetStateAndSetPriors(timestamp_kf_nsec, state, kf_id);
+  initial_state_covariance_ = boost::none;
+  if (has_covariance) state_covariance_lkf_ = state_covariance;
+}
+
+/* -------------------------------------------------------------------------- */
+void VioBackEnd::resetStateAndSetPriors(const Timestamp& timestamp_kf_nsec,
+                                        const VioNavState& reinit_state,
+                                        const int& kf_id) {
+  // Start from a new smoother, since the old graph is not valid anymore.
+  setSmoother(vio_params_, &smoother_);
+
+  // Drop everything that refers to the old graph.
+  state_.clear();
+  new_values_.clear();
+  new_imu_prior_and_other_factors_.resize(0);
+  new_smart_factors_.clear();
+  old_smart_factors_.clear();
+  feature_tracks_.clear();
+  resetExtraStructures();
+  // The re-initialization bias is not the one the prior covariance is for.
+  initial_imu_bias_covariance_ = boost::none;
+
+  // Keyframe ids restart with the new graph. Landmark count is kept.
+  last_kf_id_ = -1;
+  curr_kf_id_ = kf_id;
+  state_covariance_lkf_ = gtsam::zeros(15, 15);
+  resetDebugInfo(&debug_info_);
+
+  initStateAndSetPriors(timestamp_kf_nsec,
+                        reinit_state.pose_,
+                        reinit_state.velocity_,
+                        reinit_state.imu_bias_);
+}
+
 /* --------------------------------------------------------------------------
  */
 // Workhorse that stores data and optimizes at each keyframe.
@@ -418,11 +474,9 @@ void VioBackEnd::addLandmarksToGraph(const LandmarkIds& landmarks_kf) {
     }
   }
 
-  if (verbosity_ >= 7) {
-    std::cout << "Added " << n_new_landmarks << " new landmarks" << std::endl;
-    std::cout << "Updated " << n_updated_landmarks << " landmarks in graph"
-              << std::endl;
-  }
+  VIO_DIAG_IF(kBackend, kDebug, verbosity_ >= 7)
+      << "Added " << n_new_landmarks << " new landmarks, updated "
+      << n_updated_landmarks << " landmarks in graph";
 }
 
 /* --------------------------------------------------------------------------
@@ -436,23 +490,18 @@ void VioBackEnd::addLandmarkToGraph(const LandmarkId& lm_id,
       boost::make_shared<SmartStereoFactor>(smart_noise_, smart_factors_params_,
                                             B_Pose_leftCam_);
 
-  if (verbosity_ >= 9) {
-    std::cout << "Adding landmark with: " << ft.obs_.size()
-              << " landmarks to graph, with keys: ";
-  }
-  if (verbosity_ >= 9) {
-    new_factor->print();
-  }
-
   // add observations to smart factor
   for (const std::pair<FrameId, StereoPoint2>& obs : ft.obs_) {
     new_factor->add(obs.second, gtsam::Symbol('x', obs.first), stereo_cal_);
-    if (verbosity_ >= 9) {
-      std::cout << " " << obs.first;
-    }
   }
-  if (verbosity_ >= 9) {
-    std::cout << std::endl;
+  if (VIO_DIAG_ENABLED(kBackend, kTrace) && verbosity_ >= 9) {
+    std::stringstream keys;
+    for (const std::pair<FrameId, StereoPoint2>& obs : ft.obs_) {
+      keys << " " << obs.first;
+    }
+    VIO_DIAG(kBackend, kTrace) << "Adding landmark with: " << ft.obs_.size()
+                               << " observations to graph, with keys:"
+                               << keys.str();
   }
   // add new factor to suitable structures:
   new_smart_factors_.insert(std::make_pair(lm_id, new_factor));
@@ -486,10 +535,8 @@ void VioBackEnd::updateLandmarkInGraph(
                   "be already != -1! \n";
   }
   old_smart_factors_it->second.first = new_factor;
-  if (verbosity_ >= 8) {
-    std::cout << "updateLandmarkInGraph: added observation to point: " << lmk_id
-              << std::endl;
-  }
+  VIO_DIAG_IF(kBackend, kTrace, verbosity_ >= 8)
+      << "updateLandmarkInGraph: added observation to point: " << lmk_id;
 }
 
 /* --------------------------------------------------------------------------
@@ -828,10 +875,8 @@ void VioBackEnd::addNoMotionFactor(const FrameId& from_id,
 
   debug_info_.numAddedNoMotionF_++;
 
-  if (verbosity_ >= 7) {
-    std::cout << "No motion detected, adding no relative motion prior"
-              << std::endl;
-  }
+  VIO_DIAG_IF(kBackend, kDebug, verbosity_ >= 7)
+      << "No motion detected, adding no relative motion prior";
 }
 
 /* --------------------------------------------------------------------------
@@ -854,6 +899,7 @@ void VioBackEnd::optimize(
     const Timestamp& timestamp_kf_nsec, const FrameId& cur_id,
     const size_t& max_extra_iterations,
     gtsam::FactorIndices extra_factor_slots_to_delete) {
+  VIO_PROFILE_ZONE("VioBackEnd::optimize");
   DCHECK(smoother_.get()) << "Incremental smoother is a null pointer.";
 
   // Only for statistics and debugging.
@@ -929,7 +975,8 @@ void VioBackEnd::optimize(
     start_time = utils::Timer::tic();
   }
 
-  if (verbosity_ >= 5) {
+  // Only built when the error before optimization is printed (postDebug).
+  if (VIO_DIAG_ENABLED(kBackend, kDebug) && verbosity_ >= 5) {
     // Get state before optimization to compute error.
     debug_info_.stateBeforeOpt = gtsam::Values(state_);
     BOOST_FOREACH (const gtsam::Values::ConstKeyValuePair& key_value,
@@ -944,7 +991,8 @@ void VioBackEnd::optimize(
   }
 
   // Recreate the graph before marginalization.
-  if (verbosity_ >= 5 || FLAGS_debug_graph_before_opt) {
+  if ((VIO_DIAG_ENABLED(kBackend, kDebug) && verbosity_ >= 5) ||
+      FLAGS_debug_graph_before_opt) {
     debug_info_.graphBeforeOpt = smoother_->getFactors();
     debug_info_.graphToBeDeleted = gtsam::NonlinearFactorGraph();
     debug_info_.graphToBeDeleted.resize(delete_slots.size());
@@ -1054,6 +1102,32 @@ void VioBackEnd::optimize(
 /// Private methods.
 /* -------------------------------------------------------------------------- */
 void VioBackEnd::addInitialPriorFactors(const FrameId& frame_id) {
+  if (initial_state_covariance_) {
+    // E.g. restored from a checkpoint: marginal covariance in xvb order,
+    // the pose block already in the body frame.
+    const gtsam::Matrix& covariance = *initial_state_covariance_;
+    CHECK_EQ(covariance.rows(), 15);
+    CHECK_EQ(covariance.cols(), 15);
+    new_imu_prior_and_other_factors_.push_back(
+        boost::make_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+            gtsam::Symbol('x', frame_id), W_Pose_B_lkf_,
+            gtsam::noiseModel::Gaussian::Covariance(
+                covariance.block<6, 6>(0, 0))));
+    new_imu_prior_and_other_factors_.push_back(
+        boost::make_shared<gtsam::PriorFactor<gtsam::Vector3>>(
+            gtsam::Symbol('v', frame_id), W_Vel_B_lkf_,
+            gtsam::noiseModel::Gaussian::Covariance(
+                covariance.block<3, 3>(6, 6))));
+    new_imu_prior_and_other_factors_.push_back(
+        boost::make_shared<gtsam::PriorFactor<gtsam::imuBias::ConstantBias>>(
+            gtsam::Symbol('b', frame_id), imu_bias_lkf_,
+            gtsam::noiseModel::Gaussian::Covariance(
+                covariance.block<6, 6>(9, 9))));
+    VLOG(2) << "Added initial priors from the state covariance for frame "
+            << frame_id;
+    return;
+  }
+
   // Set initial covariance for inertial factors
   // W_Pose_Blkf_ set by motion capture to start with
   Matrix3 B_Rot_W = W_Pose_B_lkf_.rotation().matrix().transpose();
@@ -1096,12 +1170,19 @@ void VioBackEnd::addInitialPriorFactors(const FrameId& frame_id) {
           gtsam::Symbol('v', frame_id), W_Vel_B_lkf_, noise_init_vel_prior));
 
   // Add initial bias priors:
-  Vector6 prior_biasSigmas;
-  prior_biasSigmas.head<3>().setConstant(vio_params_.initialAccBiasSigma_);
-  prior_biasSigmas.tail<3>().setConstant(vio_params_.initialGyroBiasSigma_);
-  // TODO(Toni): Make this noise model a member constant.
-  gtsam::SharedNoiseModel imu_bias_prior_noise =
-      gtsam::noiseModel::Diagonal::Sigmas(prior_biasSigmas);
+  gtsam::SharedNoiseModel imu_bias_prior_noise;
+  if (initial_imu_bias_covariance_) {
+    // E.g. warm start from the bias estimated in a previous run.
+    imu_bias_prior_noise =
+        gtsam::noiseModel::Gaussian::Covariance(*initial_imu_bias_covariance_);
+  } else {
+    Vector6 prior_biasSigmas;
+    prior_biasSigmas.head<3>().setConstant(vio_params_.initialAccBiasSigma_);
+    prior_biasSigmas.tail<3>().setConstant(vio_params_.initialGyroBiasSigma_);
+    // TODO(Toni): Make this noise model a member constant.
+    imu_bias_prior_noise =
+        gtsam::noiseModel::Diagonal::Sigmas(prior_biasSigmas);
+  }
   if (VLOG_IS_ON(10)) {
     LOG(INFO) << "Imu bias for backend prior:";
     imu_bias_lkf_.print();
@@ -1275,7 +1356,8 @@ void VioBackEnd::updateSmoother(Smoother::Result* result,
       VLOG(10) << "Finished cleanCheiralityLmk.";
 
       // Recreate the graph before marginalization.
-      if (verbosity_ >= 5 || FLAGS_debug_graph_before_opt) {
+      if ((VIO_DIAG_ENABLED(kBackend, kDebug) && verbosity_ >= 5) ||
+          FLAGS_debug_graph_before_opt) {
         debug_info_.graphBeforeOpt = graph;
         debug_info_.graphToBeDeleted = gtsam::NonlinearFactorGraph();
         debug_info_.graphToBeDeleted.resize(delete_slots_cheirality.size());
@@ -1379,6 +1461,11 @@ void VioBackEnd::deleteLmkFromExtraStructures(const LandmarkId& lmk_id) {
   return;
 }
 
+/* -------------------------------------------------------------------------- */
+void VioBackEnd::resetExtraStructures() {
+  VLOG(10) << "There are no extra structures to reset.";
+}
+
 /* --------------------------------------------------------------------------
  */
 // BOOKKEEPING: updates the SlotIdx in the old_smart_factors such that
@@ -1433,6 +1520,25 @@ void VioBackEnd::updateNewSmartFactorsSlots(
   }
 }
 
+/* -------------------------------------------------------------------------- */
+// Create a new smoother (incremental or batch depending on the build).
+void VioBackEnd::setSmoother(const VioBackEndParams& vio_params,
+                             std::shared_ptr<Smoother>* smoother) {
+  CHECK_NOTNULL(smoother);
+#ifdef INCREMENTAL_SMOOTHER
+  gtsam::ISAM2Params isam_param;
+  setIsam2Params(vio_params, &isam_param);
+
+  *smoother = std::make_shared<Smoother>(vio_params.horizon_, isam_param);
+#else  // BATCH SMOOTHER
+  gtsam::LevenbergMarquardtParams lmParams;
+  lmParams.setlambdaInitial(0.0);     // same as GN
+  lmParams.setlambdaLowerBound(0.0);  // same as GN
+  lmParams.setlambdaUpperBound(0.0);  // same as GN)
+  *smoother = std::make_shared<Smoother>(vio_params.horizon_, lmParams);
+#endif
+}
+
 /* --------------------------------------------------------------------------
  */
 // Set parameters for ISAM 2 incremental smoother.
@@ -1943,13 +2049,16 @@ void VioBackEnd::postDebug(
         << "Optimize: time measurement mismatch."
            "The sum of the parts is not equal to the total.";
 
-    // Print error.
-    gtsam::NonlinearFactorGraph graph = gtsam::NonlinearFactorGraph(
-        smoother_->getFactors());  // clone, expensive but safer!
-    VLOG(10) << "Optimization Errors:\n"
-             << " - Error before :" << graph.error(debug_info_.stateBeforeOpt)
-             << '\n'
-             << " - Error after  :" << graph.error(state_);
+    // Print error, if the state before optimization was kept.
+    if (VIO_DIAG_ENABLED(kBackend, kDebug) && verbosity_ >= 5) {
+      gtsam::NonlinearFactorGraph graph = gtsam::NonlinearFactorGraph(
+          smoother_->getFactors());  // clone, expensive but safer!
+      VIO_DIAG(kBackend, kDebug)
+          << "Optimization Errors:\n"
+          << " - Error before :" << graph.error(debug_info_.stateBeforeOpt)
+          << '\n'
+          << " - Error after  :" << graph.error(state_);
+    }
   }
 }
 
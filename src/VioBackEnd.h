@@ -78,13 +78,18 @@ class VioBackEnd {
   // Create and initialize VioBackEnd.
   /// @param: [in] initial_state_seed: information about the initial pose.
   /// @param: timestamp: timestamp of the initial state.
+  /// @param: initial_imu_bias_covariance: covariance of the initial IMU bias
+  /// prior (e.g. from a previous run), uses the initial bias sigmas in
+  /// vioParams if not given.
   VioBackEnd(const Pose3& leftCamPose,
              const Cal3_S2& leftCameraCalRectified,
              const double& baseline,
              const VioNavState& initial_state_seed,
              const Timestamp& timestamp,
              const VioBackEndParams& vioParams,
-             const bool& log_output = false);
+             const bool& log_output = false,
+             const boost::optional<gtsam::Matrix>& initial_imu_bias_covariance =
+                 boost::none);
 
   /* ------------------------------------------------------------------------ */
   // Create and initialize VioBackEnd, without initiating pose.
@@ -127,6 +132,9 @@ class VioBackEnd {
   // Checks if the thread is waiting for the input_queue or working.
   inline bool isWorking() const { return is_thread_working_; }
 
+  // Time it took to process the last input [ms].
+  inline double getLastSpinDuration() const { return last_spin_duration_; }
+
   /* ------------------------------------------------------------------------ */
   // Register (and trigger!) callback that will be called as soon as the backend
   // comes up with a new IMU bias update.
@@ -135,6 +143,16 @@ class VioBackEnd {
   void registerImuBiasUpdateCallback(
       const std::function<void(const ImuBias&)>& imu_bias_update_callback);
 
+  /* ------------------------------------------------------------------------ */
+  // Restarts the graph at a restored state (e.g. from a checkpoint), before
+  // spinning: keyframe ids continue from kf_id, and the priors use the
+  // marginal covariance of the state (15x15, as getCurrentStateCovariance),
+  // or the initial sigmas in the params if it is zero.
+  void restoreStateAndSetPriors(const Timestamp& timestamp_kf_nsec,
+                                const VioNavState& state,
+                                const gtsam::Matrix& state_covariance,
+                                const int& kf_id);
+
   /* ------------------------------------------------------------------------ */
   // Get valid 3D points - TODO: this copies the graph.
   void get3DPoints(std::vector<gtsam::Point3>* points_3d) const;
@@ -249,6 +267,14 @@ class VioBackEnd {
                              const Vector3& initialVel,
                              const ImuBias& initialBias);
 
+  /* ------------------------------------------------------------------------ */
+  // Hot re-initialization: drops the current graph and smoother, and sets
+  // the initial state at the given state as in initStateAndSetPriors, with
+  // keyframe id kf_id.
+  void resetStateAndSetPriors(const Timestamp& timestamp_kf_nsec,
+                              const VioNavState& reinit_state,
+                              const int& kf_id = 0);
+
   /* ------------------------------------------------------------------------ */
   // Add initial prior factors.
   void addInitialPriorFactors(const FrameId& frame_id);
@@ -312,12 +338,21 @@ class VioBackEnd {
   /* ------------------------------------------------------------------------ */
   virtual void deleteLmkFromExtraStructures(const LandmarkId& lmk_id);
 
+  /* ------------------------------------------------------------------------ */
+  // Clear the extra structures of derived classes on re-initialization.
+  virtual void resetExtraStructures();
+
   /* ------------------------------------------------------------------------ */
   void updateNewSmartFactorsSlots(
       const std::vector<LandmarkId>& lmk_ids_of_new_smart_factors_tmp,
       SmartFactorMap* old_smart_factors);
 
   /// Private setters.
+  /* ------------------------------------------------------------------------ */
+  // Create a new smoother (incremental or batch depending on the build).
+  void setSmoother(const VioBackEndParams& vio_params,
+                   std::shared_ptr<Smoother>* smoother);
+
   /* ------------------------------------------------------------------------ */
   // Set parameters for ISAM 2 incremental smoother.
   void setIsam2Params(const VioBackEndParams& vio_params,
@@ -454,6 +489,12 @@ class VioBackEnd {
   // State covariance. (initialize to zero)
   gtsam::Matrix state_covariance_lkf_ = gtsam::zeros(15, 15);
 
+  // Covariance of the initial IMU bias prior (6x6), if not from the params.
+  boost::optional<gtsam::Matrix> initial_imu_bias_covariance_;
+  // Covariance of all the initial priors (15x15, pose, velocity and IMU
+  // bias), if not from the params. Overrides the one of the IMU bias.
+  boost::optional<gtsam::Matrix> initial_state_covariance_;
+
   // Vision params.
   gtsam::SmartStereoProjectionParams smart_factors_params_;
   gtsam::SharedNoiseModel smart_noise_;
@@ -518,6 +559,7 @@ class VioBackEnd {
   // Thread related members.
   std::atomic_bool shutdown_ = {false};
   std::atomic_bool is_thread_working_ = {false};
+  std::atomic<double> last_spin_duration_ = {0.0};
 };
 
 // Template implementations.
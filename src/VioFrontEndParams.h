@@ -39,6 +39,9 @@ public:
       : // tracking params
         klt_win_size_(24), klt_max_iter_(30), klt_max_level_(4),
         klt_eps_(0.1), // Before tuning: 0.001
+        klt_fb_check_(false),
+        klt_fb_max_error_(1.0), // in pixels
+        track_max_klt_error_(0.0), track_max_stereo_failures_(0),
         maxFeatureAge_(
             25), // upper bounded by horizon / min intra_keyframe_time_
         // detection params
@@ -48,6 +51,7 @@ public:
         min_distance_(10.0),   // Minimum allowable distance (in pixels) between
                                // feature detections // Before tuning: 20
         block_size_(3), use_harris_detector_(false), k_(0.04),
+        processing_scale_(1.0), feature_grid_rows_(0), feature_grid_cols_(0),
         // Stereo matching.
         stereo_matching_params_(),
         // Selector params.
@@ -61,6 +65,8 @@ public:
         featureSelectionCosineNeighborhood_(
             cos((10 * M_PI) / (180.0))), // 10 degrees
         featureSelectionUseLazyEvaluation_(true),
+        featureSelectionNrThreads_(1),
+        featureSelectionTimeBudget_(0.0),
         useSuccessProbabilities_(true),
         // RANSAC params:
         useRANSAC_(true), // if false RANSAC is completely disabled
@@ -86,6 +92,17 @@ public:
   int klt_max_iter_;  // max iterations
   int klt_max_level_;
   double klt_eps_;    // @TODO: add comments on each parameter
+  // Track keypoints back to the reference frame, and reject them if they
+  // land further than klt_fb_max_error_ pixels from where they started.
+  bool klt_fb_check_;
+  double klt_fb_max_error_;
+  // Tracks with a KLT error (mean absolute intensity difference of the patch,
+  // at the processing scale) above this are pruned before stereo matching
+  // (0: disabled).
+  double track_max_klt_error_;
+  // Tracks without a valid stereo match (including stereo RANSAC outliers) in
+  // this many consecutive keyframes are pruned (0: disabled).
+  int track_max_stereo_failures_;
   int maxFeatureAge_; // we cut feature tracks longer than that
 
   // Detection parameters
@@ -96,6 +113,14 @@ public:
   int block_size_;
   bool use_harris_detector_;
   double k_;
+  // Scale of the images used for feature detection and tracking (e.g. 0.5
+  // for half resolution). New corners are refined at full resolution.
+  double processing_scale_;
+  // Grid used to spread features over the image: new features are only
+  // detected in cells with less features than their quota
+  // (maxFeaturesPerFrame_ / nr of cells), and the outliers of the stereo
+  // RANSAC are dropped to free their cell (0 rows or cols: no grid).
+  int feature_grid_rows_, feature_grid_cols_;
 
   // Encapsulate StereoMatchingParams.
   StereoMatchingParams stereo_matching_params_;
@@ -106,6 +131,12 @@ public:
   double featureSelectionHorizon_, featureSelectionImuRate_;
   double featureSelectionDefaultDepth_, featureSelectionCosineNeighborhood_;
   bool featureSelectionUseLazyEvaluation_;
+  // Threads scoring the candidates of the greedy selection (0: one per
+  // hardware thread, 1: sequential).
+  int featureSelectionNrThreads_;
+  // Time budget [s] of the selection: when it expires, the remaining features
+  // are selected by score instead of greedily (0: no budget).
+  double featureSelectionTimeBudget_;
   bool useSuccessProbabilities_;
 
   // RANSAC parameters
@@ -158,6 +189,10 @@ public:
            (klt_max_iter_ == tp2.klt_max_iter_) &&
            (klt_max_level_ == tp2.klt_max_level_) &&
            (fabs(klt_eps_ - tp2.klt_eps_) <= tol) &&
+           (klt_fb_check_ == tp2.klt_fb_check_) &&
+           (fabs(klt_fb_max_error_ - tp2.klt_fb_max_error_) <= tol) &&
+           (fabs(track_max_klt_error_ - tp2.track_max_klt_error_) <= tol) &&
+           (track_max_stereo_failures_ == tp2.track_max_stereo_failures_) &&
            (maxFeatureAge_ == tp2.maxFeatureAge_) &&
            // detection parameters
            (maxFeaturesPerFrame_ == tp2.maxFeaturesPerFrame_) &&
@@ -166,6 +201,9 @@ public:
            (block_size_ == tp2.block_size_) &&
            (use_harris_detector_ == tp2.use_harris_detector_) &&
            (fabs(k_ - tp2.k_) <= tol) &&
+           (fabs(processing_scale_ - tp2.processing_scale_) <= tol) &&
+           (feature_grid_rows_ == tp2.feature_grid_rows_) &&
+           (feature_grid_cols_ == tp2.feature_grid_cols_) &&
            // stereo matching
            stereo_matching_params_.equals(tp2.stereo_matching_params_, tol) &&
            // Selection params
@@ -182,6 +220,9 @@ public:
                  tp2.featureSelectionCosineNeighborhood_) <= tol) &&
            (featureSelectionUseLazyEvaluation_ ==
             tp2.featureSelectionUseLazyEvaluation_) &&
+           (featureSelectionNrThreads_ == tp2.featureSelectionNrThreads_) &&
+           (fabs(featureSelectionTimeBudget_ -
+                 tp2.featureSelectionTimeBudget_) <= tol) &&
            (useSuccessProbabilities_ == tp2.useSuccessProbabilities_) &&
            // RANSAC parameters
            (useRANSAC_ == tp2.useRANSAC_) &&
@@ -218,6 +259,11 @@ public:
               << "klt_max_iter_: " << klt_max_iter_ << '\n'
               << "klt_max_level_: " << klt_max_level_ << '\n'
               << "klt_eps_: " << klt_eps_ << '\n'
+              << "klt_fb_check_: " << klt_fb_check_ << '\n'
+              << "klt_fb_max_error_: " << klt_fb_max_error_ << '\n'
+              << "track_max_klt_error_: " << track_max_klt_error_ << '\n'
+              << "track_max_stereo_failures_: " << track_max_stereo_failures_
+              << '\n'
               << "maxFeatureAge_: " << maxFeatureAge_ << '\n'
 
               << "** Feature detection parameters **\n"
@@ -226,7 +272,10 @@ public:
               << "min_distance_: " << min_distance_ << '\n'
               << "block_size_: " << block_size_ << '\n'
               << "use_harris_detector_: " << use_harris_detector_ << '\n'
-              << "k_: " << k_;
+              << "k_: " << k_ << '\n'
+              << "processing_scale_: " << processing_scale_ << '\n'
+              << "feature_grid_rows_: " << feature_grid_rows_ << '\n'
+              << "feature_grid_cols_: " << feature_grid_cols_;
 
     stereo_matching_params_.print();
 
@@ -243,6 +292,10 @@ public:
         << featureSelectionCosineNeighborhood_ << '\n'
         << "featureSelectionUseLazyEvaluation_: "
         << featureSelectionUseLazyEvaluation_ << '\n'
+        << "featureSelectionNrThreads_: " << featureSelectionNrThreads_
+        << '\n'
+        << "featureSelectionTimeBudget_: " << featureSelectionTimeBudget_
+        << '\n'
         << "useSuccessProbabilities_: " << useSuccessProbabilities_ << '\n'
 
         << "** RANSAC parameters **\n"
@@ -273,6 +326,11 @@ public:
     yaml_parser_->getYamlParam("klt_max_iter", &klt_max_iter_);
     yaml_parser_->getYamlParam("klt_max_level", &klt_max_level_);
     yaml_parser_->getYamlParam("klt_eps", &klt_eps_);
+    yaml_parser_->getYamlParam("klt_fb_check", &klt_fb_check_);
+    yaml_parser_->getYamlParam("klt_fb_max_error", &klt_fb_max_error_);
+    yaml_parser_->getYamlParam("track_max_klt_error", &track_max_klt_error_);
+    yaml_parser_->getYamlParam("track_max_stereo_failures",
+                               &track_max_stereo_failures_);
     yaml_parser_->getYamlParam("maxFeatureAge", &maxFeatureAge_);
 
     yaml_parser_->getYamlParam("maxFeaturesPerFrame", &maxFeaturesPerFrame_);
@@ -281,6 +339,9 @@ public:
     yaml_parser_->getYamlParam("block_size", &block_size_);
     yaml_parser_->getYamlParam("use_harris_detector", &use_harris_detector_);
     yaml_parser_->getYamlParam("k", &k_);
+    yaml_parser_->getYamlParam("processing_scale", &processing_scale_);
+    yaml_parser_->getYamlParam("feature_grid_rows", &feature_grid_rows_);
+    yaml_parser_->getYamlParam("feature_grid_cols", &feature_grid_cols_);
 
     yaml_parser_->getYamlParam("equalizeImage",
                                &stereo_matching_params_.equalize_image_);
@@ -338,6 +399,10 @@ public:
                                &featureSelectionCosineNeighborhood_);
     yaml_parser_->getYamlParam("featureSelectionUseLazyEvaluation",
                                &featureSelectionUseLazyEvaluation_);
+    yaml_parser_->getYamlParam("featureSelectionNrThreads",
+                               &featureSelectionNrThreads_);
+    yaml_parser_->getYamlParam("featureSelectionTimeBudget",
+                               &featureSelectionTimeBudget_);
 
     yaml_parser_->getYamlParam("useSuccessProbabilities",
                                &useSuccessProbabilities_);
@@ -0,0 +1,135 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   CachedDataSource.cpp
+ * @brief  Replays a dataset cache (see DatasetCache.h), for repeated benchmark
+ *         runs without decoding images or parsing text files.
+ * @author Antoni Rosinol
+ */
+
+#include "datasource/CachedDataSource.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "StereoFrame.h"
+
+DEFINE_string(dataset_cache_path, "",
+              "Dataset cache (.dscache) to replay, as written by "
+              "buildDatasetCache.");
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+CachedDataProvider::CachedDataProvider()
+    : CachedDataProvider(FLAGS_dataset_cache_path) {}
+
+/* -------------------------------------------------------------------------- */
+CachedDataProvider::CachedDataProvider(const std::string& cache_path)
+    : DataProvider() {
+  CHECK(!cache_path.empty()) << "Missing --dataset_cache_path.";
+  CHECK(cache_.open(cache_path)) << "Could not open dataset cache: "
+                                 << cache_path;
+
+  // Only the noise and shift: the gravity is set with the backend params.
+  const ImuParams& imu_params = cache_.getImuParams();
+  pipeline_params_.imu_params_.gyro_noise_ = imu_params.gyro_noise_;
+  pipeline_params_.imu_params_.gyro_walk_ = imu_params.gyro_walk_;
+  pipeline_params_.imu_params_.acc_noise_ = imu_params.acc_noise_;
+  pipeline_params_.imu_params_.acc_walk_ = imu_params.acc_walk_;
+  pipeline_params_.imu_params_.imu_shift_ = imu_params.imu_shift_;
+
+  // Parse backend/frontend parameters.
+  parseBackendParams();
+  parseFrontendParams();
+
+  // Images can be equalized here, but not un-equalized.
+  const bool equalize_image = pipeline_params_.frontend_params_
+                                  .getStereoMatchingParams()
+                                  .equalize_image_;
+  LOG_IF(FATAL, cache_.isEqualized() && !equalize_image)
+      << "Dataset cache " << cache_path << " has equalized images, but the "
+      << "frontend parameters do not equalize them: rebuild the cache.";
+  equalize_images_ = equalize_image && !cache_.isEqualized();
+  LOG_IF(WARNING, equalize_images_)
+      << "Dataset cache " << cache_path << " has images not equalized: "
+      << "equalizing each frame, rebuild the cache to avoid it.";
+
+  // Send first ground-truth pose to VIO for initialization if requested.
+  if (pipeline_params_.backend_params_->autoInitialize_ == 0) {
+    CHECK(isGroundTruthAvailable())
+        << "Initialization from ground truth requested, but dataset cache "
+        << cache_path << " has no ground truth.";
+    size_t i = 0u;
+    while (i < cache_.nrFrames() && cache_.frame(i).id_ < initial_k_) i++;
+    CHECK_LT(i, cache_.nrFrames())
+        << "No frame from initial_k (" << initial_k_ << ") in dataset cache.";
+    pipeline_params_.backend_params_->initial_ground_truth_state_ =
+        getGroundTruthState(cache_.frame(i).timestamp_);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+CachedDataProvider::~CachedDataProvider() {
+  LOG(INFO) << "CachedDataProvider destructor called.";
+}
+
+/* -------------------------------------------------------------------------- */
+bool CachedDataProvider::spin() {
+  CHECK(vio_callback_) << "Missing VIO callback registration. Call "
+                          " registerVioCallback before spinning the dataset.";
+  const StereoMatchingParams& stereo_matching_params =
+      pipeline_params_.frontend_params_.getStereoMatchingParams();
+  const CameraParams& left_cam_info = cache_.getLeftCamInfo();
+  const CameraParams& right_cam_info = cache_.getRightCamInfo();
+  const gtsam::Pose3& camL_Pose_camR = cache_.getCamLPoseCamR();
+  for (size_t i = 0u; i < cache_.nrFrames(); i++) {
+    const DatasetCacheFrame& frame = cache_.frame(i);
+    if (frame.id_ < initial_k_) continue;
+    if (frame.id_ >= final_k_) break;
+
+    // Headers into the cache, unless they have to be equalized.
+    cv::Mat left_img, right_img;
+    if (equalize_images_) {
+      cv::equalizeHist(cache_.leftImage(i), left_img);
+      cv::equalizeHist(cache_.rightImage(i), right_img);
+    } else {
+      left_img = cache_.leftImage(i);
+      right_img = cache_.rightImage(i);
+    }
+    ImuStampS imu_stamps;
+    ImuAccGyrS imu_accgyr;
+    cache_.getImu(i, &imu_stamps, &imu_accgyr);
+
+    VLOG(10) << "Call VIO processing for frame k: " << frame.id_
+             << " with timestamp: " << frame.timestamp_;
+    vio_callback_(StereoImuSyncPacket(
+        StereoFrame(frame.id_, frame.timestamp_, left_img, left_cam_info,
+                    right_img, right_cam_info, camL_Pose_camR,
+                    stereo_matching_params),
+        imu_stamps, imu_accgyr));
+    VLOG(10) << "Finished VIO processing for frame k = " << frame.id_;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+VioNavState CachedDataProvider::getGroundTruthState(
+    const Timestamp& timestamp) const {
+  const std::map<Timestamp, VioNavState>& map_to_gt =
+      cache_.getGroundTruth().map_to_gt_;
+  CHECK(!map_to_gt.empty());
+  auto it = map_to_gt.lower_bound(timestamp);
+  if (it == map_to_gt.end()) --it;
+  return it->second;
+}
+
+}  // namespace VIO
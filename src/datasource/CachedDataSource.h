@@ -0,0 +1,55 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   CachedDataSource.h
+ * @brief  Replays a dataset cache (see DatasetCache.h), for repeated benchmark
+ *         runs without decoding images or parsing text files.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include "datasource/DataSource.h"
+#include "datasource/DatasetCache.h"
+
+namespace VIO {
+
+/*
+ * Serves the frames of a dataset cache with ids in [initial_k, final_k), with
+ * the IMU measurements and calibration stored with them.
+ * The images of the packets point into the mapped cache: the provider must
+ * outlive the pipeline (and whatever keeps the frames).
+ */
+class CachedDataProvider : public DataProvider {
+ public:
+  // The cache at FLAGS_dataset_cache_path.
+  CachedDataProvider();
+  explicit CachedDataProvider(const std::string& cache_path);
+  virtual ~CachedDataProvider();
+
+  bool spin() override;
+
+  // Whether the cache has ground truth.
+  inline bool isGroundTruthAvailable() const {
+    return !cache_.getGroundTruth().map_to_gt_.empty();
+  }
+  // Ground truth state at the closest, non-lesser timestamp.
+  VioNavState getGroundTruthState(const Timestamp& timestamp) const;
+
+  inline const DatasetCache& getCache() const { return cache_; }
+
+ private:
+  DatasetCache cache_;
+  // Whether to equalize the images, which the cache has not.
+  bool equalize_images_ = false;
+};
+
+}  // namespace VIO
@@ -0,0 +1,382 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   CsvParser.cpp
+ * @brief  Fast parsing of the dataset text files: memory-mapped, without
+ *         allocations per line or field, and in parallel for large files.
+ * @author Antoni Rosinol
+ */
+
+#include "datasource/CsvParser.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "utils/ThreadPool.h"
+
+DEFINE_int32(dataset_parse_threads, 0,
+             "Number of threads used to parse the large dataset files (e.g. "
+             "EuRoC IMU and ground-truth csv files), 0: one per hardware "
+             "thread.");
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+MappedFile::MappedFile(const std::string& filename, const bool& copy_on_write)
+    : copy_on_write_(copy_on_write) {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+    ::close(fd);
+    return;
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ > 0u) {
+    const int protection =
+        copy_on_write_ ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* data = ::mmap(nullptr, size_, protection, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      size_ = 0u;
+      ::close(fd);
+      return;
+    }
+    // Files are parsed front to back: read ahead aggressively.
+    ::madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<char*>(data);
+  }
+  // The mapping stays valid once the file is closed.
+  ::close(fd);
+  is_open_ = true;
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    ::munmap(data_, size_);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+static inline bool isBlank(const char& c) { return c == ' ' || c == '\t'; }
+static inline bool isDigit(const char& c) { return c >= '0' && c <= '9'; }
+
+const char* parseInt64(const char* begin, const char* end, int64_t* value) {
+  CHECK_NOTNULL(value);
+  const char* it = begin;
+  while (it < end && isBlank(*it)) ++it;
+  bool negative = false;
+  if (it < end && (*it == '-' || *it == '+')) {
+    negative = *it == '-';
+    ++it;
+  }
+  if (it == end || !isDigit(*it)) return nullptr;
+  // Accumulate negatively, to also parse the lowest int64.
+  static constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+  int64_t result = 0;
+  for (; it < end && isDigit(*it); ++it) {
+    const int digit = *it - '0';
+    if (result < (kMin + digit) / 10) return nullptr;
+    result = result * 10 - digit;
+  }
+  if (!negative) {
+    if (result == kMin) return nullptr;
+    result = -result;
+  }
+  *value = result;
+  return it;
+}
+
+// Powers of ten exactly representable as doubles.
+static const double kExactPowersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Same with the extended precision of x87, where long double has a 64-bit
+// significand: any mantissa of 19 digits is exact.
+static const long double kExactLongPowersOf10[] = {
+    1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,
+    1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+    1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L};
+static constexpr bool kHasExtendedPrecision =
+    std::numeric_limits<long double>::digits == 64;
+
+// Parses with strtod a copy of [begin, end), which holds at most one number.
+static const char* parseDoubleSlow(const char* begin, const char* end,
+                                   double* value) {
+  char buffer[128];
+  std::string long_number;
+  const size_t length = end - begin;
+  const char* number = buffer;
+  if (length < sizeof(buffer)) {
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+  } else {
+    long_number.assign(begin, end);
+    number = long_number.c_str();
+  }
+  char* number_end = nullptr;
+  errno = 0;
+  const double result = std::strtod(number, &number_end);
+  // std::stod fails on out of range values as well.
+  if (number_end == number || errno == ERANGE) return nullptr;
+  *value = result;
+  return begin + (number_end - number);
+}
+
+const char* parseDouble(const char* begin, const char* end, double* value) {
+  CHECK_NOTNULL(value);
+  const char* it = begin;
+  while (it < end && isBlank(*it)) ++it;
+  const char* number_begin = it;
+  bool negative = false;
+  if (it < end && (*it == '-' || *it == '+')) {
+    negative = *it == '-';
+    ++it;
+  }
+
+  // Decimal mantissa and exponent, as long as the mantissa fits in 19 digits.
+  uint64_t mantissa = 0u;
+  int nr_significant_digits = 0;
+  int exponent = 0;
+  bool has_digits = false;
+  bool truncated = false;
+  for (; it < end && isDigit(*it); ++it) {
+    has_digits = true;
+    if (nr_significant_digits < 19) {
+      mantissa = mantissa * 10u + (*it - '0');
+      if (mantissa != 0u) nr_significant_digits++;
+    } else {
+      truncated = true;
+    }
+  }
+  if (it < end && *it == '.') {
+    ++it;
+    for (; it < end && isDigit(*it); ++it) {
+      has_digits = true;
+      if (nr_significant_digits < 19) {
+        mantissa = mantissa * 10u + (*it - '0');
+        if (mantissa != 0u) nr_significant_digits++;
+        exponent--;
+      } else {
+        truncated = true;
+      }
+    }
+  }
+  if (!has_digits) {
+    // Not a decimal number, but it may still be e.g. "nan" or "inf".
+    return parseDoubleSlow(number_begin,
+                           std::min(end, number_begin + 64), value);
+  }
+  if (it < end && (*it == 'e' || *it == 'E')) {
+    const char* exponent_it = it + 1;
+    bool negative_exponent = false;
+    if (exponent_it < end && (*exponent_it == '-' || *exponent_it == '+')) {
+      negative_exponent = *exponent_it == '-';
+      ++exponent_it;
+    }
+    // Otherwise the 'e' is not part of the number.
+    if (exponent_it < end && isDigit(*exponent_it)) {
+      int explicit_exponent = 0;
+      for (; exponent_it < end && isDigit(*exponent_it); ++exponent_it) {
+        // Saturate, the slow path handles the values out of range.
+        if (explicit_exponent < 100000) {
+          explicit_exponent = explicit_exponent * 10 + (*exponent_it - '0');
+        }
+      }
+      exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+      it = exponent_it;
+    }
+  }
+
+  // Both the mantissa and the power of ten are exact doubles, hence a single
+  // multiplication or division is correctly rounded, as strtod.
+  if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 &&
+      exponent <= 22) {
+    double result = static_cast<double>(mantissa);
+    if (exponent < 0) {
+      result /= kExactPowersOf10[-exponent];
+    } else {
+      result *= kExactPowersOf10[exponent];
+    }
+    *value = negative ? -result : result;
+    return it;
+  }
+  // Datasets often print 17 digits or more, which do not fit in a double.
+  // The extended result is rounded twice, which only differs from rounding
+  // once if the first rounding lands on a tie between two doubles: that
+  // case is left to strtod.
+  if (kHasExtendedPrecision && !truncated && exponent >= -27 &&
+      exponent <= 27) {
+    long double result = static_cast<long double>(mantissa);
+    if (exponent < 0) {
+      result /= kExactLongPowersOf10[-exponent];
+    } else {
+      result *= kExactLongPowersOf10[exponent];
+    }
+    int binary_exponent = 0;
+    const uint64_t significand = static_cast<uint64_t>(
+        std::ldexp(std::frexp(result, &binary_exponent), 64));
+    // The 11 bits dropped when rounding to the 53 bits of a double.
+    if ((significand & 0x7FFu) != 0x400u) {
+      const double rounded = static_cast<double>(result);
+      *value = negative ? -rounded : rounded;
+      return it;
+    }
+  }
+  return parseDoubleSlow(number_begin, it, value);
+}
+
+/* -------------------------------------------------------------------------- */
+// End of the field starting at begin.
+static inline const char* fieldEnd(const char* begin, const char* end,
+                                   const char& delimiter) {
+  const char* field_end =
+      static_cast<const char*>(std::memchr(begin, delimiter, end - begin));
+  return field_end == nullptr ? end : field_end;
+}
+
+bool parseDoubles(const char* begin, const char* end, const char& delimiter,
+                  const size_t& nr_values, double* values) {
+  const char* field = begin;
+  for (size_t i = 0u; i < nr_values; i++) {
+    const char* field_end = fieldEnd(field, end, delimiter);
+    // As std::stod, ignores what follows the number in the field.
+    if (parseDouble(field, field_end, &values[i]) == nullptr) return false;
+    if (field_end == end) {
+      // Less fields than values.
+      return i + 1u == nr_values;
+    }
+    field = field_end + 1;
+  }
+  return true;
+}
+
+// Parses the lines in [begin, end) of a timestamped csv. Returns false at
+// the first malformed line.
+static bool parseTimestampedLines(const std::string& filename,
+                                  const char* begin,
+                                  const char* end,
+                                  const size_t& nr_values,
+                                  TimestampedCsv* csv) {
+  const char* line = begin;
+  while (line < end) {
+    const char* line_end =
+        static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if (line_end == nullptr) line_end = end;
+    const char* next_line = line_end < end ? line_end + 1 : end;
+    if (line_end > line && *(line_end - 1) == '\r') line_end--;
+    if (line_end == line || *line == '#') {
+      line = next_line;
+      continue;
+    }
+
+    Timestamp timestamp = 0;
+    const char* timestamp_end = fieldEnd(line, line_end, ',');
+    bool valid = parseInt64(line, timestamp_end, &timestamp) != nullptr;
+    if (valid && nr_values > 0u) {
+      valid = timestamp_end < line_end;
+    }
+    if (valid && nr_values > 0u) {
+      const size_t row_begin = csv->values_.size();
+      csv->values_.resize(row_begin + nr_values);
+      valid = parseDoubles(timestamp_end + 1, line_end, ',', nr_values,
+                           csv->values_.data() + row_begin);
+    }
+    if (!valid) {
+      LOG(ERROR) << "Malformed line in " << filename << ": "
+                 << std::string(line, line_end);
+      return false;
+    }
+    csv->timestamps_.push_back(timestamp);
+    line = next_line;
+  }
+  return true;
+}
+
+bool parseTimestampedCsv(const std::string& filename,
+                         const size_t& nr_values,
+                         const size_t& nr_threads,
+                         TimestampedCsv* csv,
+                         const size_t& min_chunk_size) {
+  CHECK_NOTNULL(csv);
+  CHECK_GT(min_chunk_size, 0u);
+  csv->timestamps_.clear();
+  csv->values_.clear();
+  csv->nr_values_per_row_ = nr_values;
+
+  MappedFile file(filename);
+  if (!file.isOpen()) {
+    LOG(ERROR) << "Cannot open file: " << filename;
+    return false;
+  }
+  if (file.size() == 0u) return true;
+  // Skip the first line, containing the header.
+  const char* data =
+      static_cast<const char*>(std::memchr(file.begin(), '\n', file.size()));
+  if (data == nullptr) return true;
+  data++;
+  const size_t data_size = file.end() - data;
+
+  size_t nr_chunks = std::max<size_t>(data_size / min_chunk_size, 1u);
+  if (nr_chunks == 1u || nr_threads == 1u) {
+    // Rows are about 10 bytes per value.
+    csv->timestamps_.reserve(data_size / (10u * (nr_values + 1u)));
+    csv->values_.reserve(csv->timestamps_.capacity() * nr_values);
+    return parseTimestampedLines(filename, data, file.end(), nr_values, csv);
+  }
+
+  utils::ThreadPool thread_pool(nr_threads);
+  nr_chunks = std::min(nr_chunks, thread_pool.getNrThreads());
+  // Chunks of about the same size, that end at the end of a line.
+  std::vector<const char*> chunk_begins(nr_chunks + 1u, file.end());
+  chunk_begins[0] = data;
+  for (size_t i = 1u; i < nr_chunks; i++) {
+    const char* nominal_begin =
+        std::max(data + i * (data_size / nr_chunks), chunk_begins[i - 1]);
+    const char* line_end = static_cast<const char*>(
+        std::memchr(nominal_begin, '\n', file.end() - nominal_begin));
+    chunk_begins[i] = line_end == nullptr ? file.end() : line_end + 1;
+  }
+
+  std::vector<TimestampedCsv> chunks(nr_chunks);
+  std::vector<char> chunk_valid(nr_chunks, false);
+  thread_pool.parallelFor(0u, nr_chunks, [&](const size_t& i) {
+    chunk_valid[i] = parseTimestampedLines(
+        filename, chunk_begins[i], chunk_begins[i + 1], nr_values, &chunks[i]);
+  });
+
+  size_t nr_rows = 0u;
+  for (size_t i = 0u; i < nr_chunks; i++) {
+    if (!chunk_valid[i]) return false;
+    nr_rows += chunks[i].nrRows();
+  }
+  csv->timestamps_.reserve(nr_rows);
+  csv->values_.reserve(nr_rows * nr_values);
+  for (const TimestampedCsv& chunk : chunks) {
+    csv->timestamps_.insert(csv->timestamps_.end(), chunk.timestamps_.begin(),
+                            chunk.timestamps_.end());
+    csv->values_.insert(csv->values_.end(), chunk.values_.begin(),
+                        chunk.values_.end());
+  }
+  return true;
+}
+
+}  // namespace VIO
@@ -0,0 +1,101 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   CsvParser.h
+ * @brief  Fast parsing of the dataset text files: memory-mapped, without
+ *         allocations per line or field, and in parallel for large files.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "common/vio_types.h"
+
+namespace VIO {
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+// A copy-on-write mapping can also be written to, without changing the file.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename,
+                      const bool& copy_on_write = false);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // False if the file could not be opened or mapped.
+  inline bool isOpen() const { return is_open_; }
+  // Empty files are open, with begin() == end().
+  inline const char* begin() const { return data_; }
+  inline const char* end() const { return data_ + size_; }
+  inline size_t size() const { return size_; }
+  // Only for copy-on-write mappings.
+  inline char* mutableBegin() const {
+    CHECK(copy_on_write_) << "Read-only mapping.";
+    return data_;
+  }
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0u;
+  bool is_open_ = false;
+  const bool copy_on_write_;
+};
+
+// Parse the number at the start of [begin, end), after optional blanks.
+// Return the end of the number, or nullptr if there is none (or it
+// overflows). They neither allocate nor depend on a null terminator, and
+// parseDouble returns the same values as std::stod.
+const char* parseInt64(const char* begin, const char* end, int64_t* value);
+const char* parseDouble(const char* begin, const char* end, double* value);
+
+// Parses nr_values numbers separated by delimiter from the line [begin, end),
+// ignoring the fields after those. False if a field is not a number or there
+// are less than nr_values fields.
+bool parseDoubles(const char* begin, const char* end, const char& delimiter,
+                  const size_t& nr_values, double* values);
+
+// Rows of a timestamped CSV file, stored contiguously.
+struct TimestampedCsv {
+  inline size_t nrRows() const { return timestamps_.size(); }
+  // The nr_values_per_row_ values of the i-th row.
+  inline const double* row(const size_t& i) const {
+    return values_.data() + i * nr_values_per_row_;
+  }
+
+  std::vector<Timestamp> timestamps_;
+  // Row-major.
+  std::vector<double> values_;
+  size_t nr_values_per_row_ = 0u;
+};
+
+// Files smaller than this are parsed on the calling thread.
+static constexpr size_t kMinParallelChunkSize = 1u << 20;
+
+// Parses a CSV file whose rows are a timestamp [ns] followed by at least
+// nr_values numbers, as in EuRoC: the first line (header), empty lines and
+// lines starting with '#' are skipped. Files of more than min_chunk_size
+// bytes are split in chunks parsed by up to nr_threads threads
+// (0: one per hardware thread). Logs the first malformed line and returns
+// false if there is one, or the file can not be read.
+bool parseTimestampedCsv(const std::string& filename,
+                         const size_t& nr_values,
+                         const size_t& nr_threads,
+                         TimestampedCsv* csv,
+                         const size_t& min_chunk_size = kMinParallelChunkSize);
+
+}  // namespace VIO
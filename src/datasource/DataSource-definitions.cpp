@@ -13,11 +13,13 @@
  */
 #include "datasource/DataSource-definitions.h"
 
-#include <fstream>
+#include <string>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "datasource/CsvParser.h"
+
 namespace VIO {
 
 VioNavState::VioNavState(const gtsam::Pose3& pose,
@@ -47,25 +49,18 @@ bool CameraImageLists::parseCamImgList(const std::string& folderpath,
                                        const std::string& filename) {
   image_folder_path_ = folderpath;  // stored, only for debug
   const std::string fullname = folderpath + "/" + filename;
-  std::ifstream fin(fullname.c_str());
-  LOG_IF(FATAL, !fin.is_open()) << "Cannot open file: " << fullname;
-
-  // Skip the first line, containing the header.
-  std::string item;
-  std::getline(fin, item);
-
-  // Read/store list of image names.
-  while (std::getline(fin, item)) {
-    // Print the item!
-    int idx = item.find_first_of(',');
-    Timestamp timestamp = std::stoll(item.substr(0, idx));
+  // Only the timestamps: the image names are built from them.
+  TimestampedCsv image_csv;
+  LOG_IF(FATAL, !parseTimestampedCsv(fullname, 0u, 1u, &image_csv))
+      << "Cannot parse file: " << fullname;
+
+  // Store list of image names.
+  img_lists.reserve(img_lists.size() + image_csv.nrRows());
+  for (const Timestamp& timestamp : image_csv.timestamps_) {
     std::string imageFilename =
-        folderpath + "/data/" + item.substr(0, idx) + ".png";
-    // Strangely, on mac, it does not work if we use: item.substr(idx + 1);
-    // maybe different string termination characters???
+        folderpath + "/data/" + std::to_string(timestamp) + ".png";
     img_lists.push_back(make_pair(timestamp, imageFilename));
   }
-  fin.close();
   return true;
 }
 
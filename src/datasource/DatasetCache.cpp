@@ -0,0 +1,485 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DatasetCache.cpp
+ * @brief  Pre-decoded dataset in a single memory-mappable file: grayscale
+ *         frames, IMU, ground truth and calibration, to replay a sequence
+ *         without decoding images or parsing text files.
+ * @author Antoni Rosinol
+ */
+
+#include "datasource/DatasetCache.h"
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include <glog/logging.h>
+
+#include "StereoFrame.h"
+
+namespace VIO {
+
+static const char kMagic[8] = {'S', 'V', 'I', 'O', 'D', 'S', 'E', 'T'};
+static const uint32_t kVersion = 1u;
+
+// The records are mapped as they are written.
+static_assert(std::is_trivially_copyable<DatasetCacheHeader>::value &&
+                  sizeof(DatasetCacheHeader) <= kDatasetCachePageSize,
+              "Unexpected dataset cache header layout.");
+static_assert(sizeof(DatasetCacheFrame) == 64u,
+              "Unexpected dataset cache frame layout.");
+static_assert(sizeof(DatasetCacheGtState) == 8u + 21u * sizeof(double),
+              "Unexpected dataset cache ground-truth layout.");
+static_assert(sizeof(Timestamp) == sizeof(int64_t), "Unexpected timestamp.");
+
+/* -------------------------------------------------------------------------- */
+// Serialization of the calibration.
+template <typename T>
+static void writeValue(const T& value, std::string* bytes) {
+  bytes->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void writeString(const std::string& value, std::string* bytes) {
+  writeValue(static_cast<uint32_t>(value.size()), bytes);
+  bytes->append(value);
+}
+
+static void writeMat(const cv::Mat& mat, std::string* bytes) {
+  const cv::Mat continuous = mat.isContinuous() ? mat : mat.clone();
+  writeValue(static_cast<int32_t>(continuous.rows), bytes);
+  writeValue(static_cast<int32_t>(continuous.cols), bytes);
+  writeValue(static_cast<int32_t>(continuous.type()), bytes);
+  bytes->append(reinterpret_cast<const char*>(continuous.data),
+                continuous.total() * continuous.elemSize());
+}
+
+static void writePose(const gtsam::Pose3& pose, std::string* bytes) {
+  const gtsam::Matrix3 R = pose.rotation().matrix();
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) writeValue(R(i, j), bytes);
+  }
+  writeValue(pose.translation().x(), bytes);
+  writeValue(pose.translation().y(), bytes);
+  writeValue(pose.translation().z(), bytes);
+}
+
+static void writeCameraParams(const CameraParams& cam_params,
+                              std::string* bytes) {
+  writeValue(static_cast<uint32_t>(cam_params.intrinsics_.size()), bytes);
+  for (const double& intrinsic : cam_params.intrinsics_) {
+    writeValue(intrinsic, bytes);
+  }
+  writePose(cam_params.body_Pose_cam_, bytes);
+  writeValue(cam_params.frame_rate_, bytes);
+  writeValue(static_cast<int32_t>(cam_params.image_size_.width), bytes);
+  writeValue(static_cast<int32_t>(cam_params.image_size_.height), bytes);
+  const gtsam::Vector9 calibration = cam_params.calibration_.vector();
+  for (int i = 0; i < 9; i++) writeValue(calibration(i), bytes);
+  writeMat(cam_params.camera_matrix_, bytes);
+  writeString(cam_params.distortion_model_, bytes);
+  writeMat(cam_params.distortion_coeff_, bytes);
+  writeMat(cam_params.undistRect_map_x_, bytes);
+  writeMat(cam_params.undistRect_map_y_, bytes);
+  writeMat(cam_params.R_rectify_, bytes);
+  writeMat(cam_params.P_, bytes);
+}
+
+// Reads values from the calibration, failing instead of reading past its end.
+class CalibrationReader {
+ public:
+  CalibrationReader(const char* begin, const char* end)
+      : it_(begin), end_(end) {}
+
+  template <typename T>
+  bool read(T* value) {
+    if (remaining() < sizeof(T)) return false;
+    std::memcpy(value, it_, sizeof(T));
+    it_ += sizeof(T);
+    return true;
+  }
+  bool readString(std::string* value) {
+    uint32_t size;
+    if (!read(&size) || remaining() < size) return false;
+    value->assign(it_, size);
+    it_ += size;
+    return true;
+  }
+  bool readMat(cv::Mat* mat) {
+    int32_t rows, cols, type;
+    if (!read(&rows) || !read(&cols) || !read(&type) || rows < 0 ||
+        cols < 0 || (type & ~CV_MAT_TYPE_MASK) != 0) {
+      return false;
+    }
+    if (rows == 0 || cols == 0) {
+      *mat = cv::Mat();
+      return true;
+    }
+    const size_t size = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+    if (remaining() < size) return false;
+    *mat = cv::Mat(rows, cols, type);
+    std::memcpy(mat->data, it_, size);
+    it_ += size;
+    return true;
+  }
+  bool readPose(gtsam::Pose3* pose) {
+    gtsam::Matrix3 R;
+    gtsam::Vector3 t;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        if (!read(&R(i, j))) return false;
+      }
+    }
+    for (int i = 0; i < 3; i++) {
+      if (!read(&t(i))) return false;
+    }
+    *pose = gtsam::Pose3(gtsam::Rot3(R), gtsam::Point3(t(0), t(1), t(2)));
+    return true;
+  }
+  bool readCameraParams(CameraParams* cam_params) {
+    uint32_t nr_intrinsics;
+    if (!read(&nr_intrinsics) || remaining() < nr_intrinsics * sizeof(double)) {
+      return false;
+    }
+    cam_params->intrinsics_.resize(nr_intrinsics);
+    for (double& intrinsic : cam_params->intrinsics_) read(&intrinsic);
+    int32_t width, height;
+    double calibration[9];
+    if (!readPose(&cam_params->body_Pose_cam_) ||
+        !read(&cam_params->frame_rate_) || !read(&width) || !read(&height)) {
+      return false;
+    }
+    for (double& value : calibration) {
+      if (!read(&value)) return false;
+    }
+    cam_params->image_size_ = cv::Size(width, height);
+    cam_params->calibration_ = gtsam::Cal3DS2(
+        calibration[0], calibration[1], calibration[2], calibration[3],
+        calibration[4], calibration[5], calibration[6], calibration[7],
+        calibration[8]);
+    return readMat(&cam_params->camera_matrix_) &&
+           readString(&cam_params->distortion_model_) &&
+           readMat(&cam_params->distortion_coeff_) &&
+           readMat(&cam_params->undistRect_map_x_) &&
+           readMat(&cam_params->undistRect_map_y_) &&
+           readMat(&cam_params->R_rectify_) && readMat(&cam_params->P_);
+  }
+
+  inline size_t remaining() const { return end_ - it_; }
+
+ private:
+  const char* it_;
+  const char* end_;
+};
+
+/* -------------------------------------------------------------------------- */
+DatasetCacheWriter::DatasetCacheWriter(const std::string& filename,
+                                       const bool& images_equalized)
+    : file_(filename, std::ios::binary | std::ios::trunc),
+      filename_(filename),
+      images_equalized_(images_equalized),
+      imu_params_(),
+      gt_data_() {
+  CHECK(file_.is_open()) << "Cannot open dataset cache: " << filename_;
+  // Placeholder for the header, written once the rest is.
+  const std::vector<char> header(kDatasetCachePageSize, 0);
+  write(header.data(), header.size());
+}
+
+DatasetCacheWriter::~DatasetCacheWriter() {
+  if (!is_finished_) finish();
+}
+
+void DatasetCacheWriter::addPacket(const StereoImuSyncPacket& packet) {
+  CHECK(!is_finished_);
+  const StereoFrame& stereo_frame = packet.getStereoFrame();
+  if (!has_calibration_) {
+    left_cam_params_ = stereo_frame.getLeftFrame().cam_param_;
+    right_cam_params_ = stereo_frame.getRightFrame().cam_param_;
+    camL_Pose_camR_ = stereo_frame.getCamLPoseCamR();
+    has_calibration_ = true;
+  }
+  CHECK(frames_.empty() ||
+        stereo_frame.getTimestamp() > frames_.back().timestamp_)
+      << "Packets not ordered by timestamp.";
+
+  DatasetCacheFrame frame;
+  frame.id_ = stereo_frame.getFrameId();
+  frame.timestamp_ = stereo_frame.getTimestamp();
+  writeImage(stereo_frame.getLeftFrame().img_, &frame.left_offset_,
+             &frame.left_rows_, &frame.left_cols_);
+  writeImage(stereo_frame.getRightFrame().img_, &frame.right_offset_,
+             &frame.right_rows_, &frame.right_cols_);
+
+  const ImuStampS& imu_stamps = packet.getImuStamps();
+  const ImuAccGyrS& imu_accgyr = packet.getImuAccGyr();
+  CHECK_EQ(imu_stamps.cols(), imu_accgyr.cols());
+  frame.imu_begin_ = imu_timestamps_.size();
+  imu_timestamps_.insert(imu_timestamps_.end(), imu_stamps.data(),
+                         imu_stamps.data() + imu_stamps.size());
+  imu_values_.insert(imu_values_.end(), imu_accgyr.data(),
+                     imu_accgyr.data() + imu_accgyr.size());
+  frame.imu_end_ = imu_timestamps_.size();
+  frames_.push_back(frame);
+}
+
+void DatasetCacheWriter::setImuParams(const ImuParams& imu_params) {
+  imu_params_ = imu_params;
+}
+
+void DatasetCacheWriter::setGroundTruth(const GroundTruthData& gt_data) {
+  gt_data_.body_Pose_cam_ = gt_data.body_Pose_cam_;
+  gt_data_.gt_rate_ = gt_data.gt_rate_;
+  gt_states_.clear();
+  gt_states_.reserve(gt_data.map_to_gt_.size());
+  for (const auto& timestamp_and_state : gt_data.map_to_gt_) {
+    const VioNavState& state = timestamp_and_state.second;
+    DatasetCacheGtState gt_state;
+    gt_state.timestamp_ = timestamp_and_state.first;
+    const gtsam::Matrix3 R = state.pose_.rotation().matrix();
+    const gtsam::Point3& t = state.pose_.translation();
+    gt_state.translation_[0] = t.x();
+    gt_state.translation_[1] = t.y();
+    gt_state.translation_[2] = t.z();
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) gt_state.rotation_[3 * i + j] = R(i, j);
+      gt_state.velocity_[i] = state.velocity_(i);
+      gt_state.acc_bias_[i] = state.imu_bias_.accelerometer()(i);
+      gt_state.gyro_bias_[i] = state.imu_bias_.gyroscope()(i);
+    }
+    gt_states_.push_back(gt_state);
+  }
+}
+
+bool DatasetCacheWriter::finish() {
+  CHECK(!is_finished_);
+  is_finished_ = true;
+  if (!has_calibration_) {
+    LOG(ERROR) << "No frames for dataset cache: " << filename_;
+    return false;
+  }
+
+  DatasetCacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+  header.version_ = kVersion;
+  header.equalized_ = images_equalized_ ? 1u : 0u;
+  header.nr_frames_ = frames_.size();
+  header.nr_imu_ = imu_timestamps_.size();
+  header.nr_gt_ = gt_states_.size();
+
+  pad(kDatasetCacheAlignment);
+  header.frames_offset_ = nr_bytes_written_;
+  write(frames_.data(), frames_.size() * sizeof(DatasetCacheFrame));
+  pad(kDatasetCacheAlignment);
+  header.imu_timestamps_offset_ = nr_bytes_written_;
+  write(imu_timestamps_.data(), imu_timestamps_.size() * sizeof(Timestamp));
+  pad(kDatasetCacheAlignment);
+  header.imu_values_offset_ = nr_bytes_written_;
+  write(imu_values_.data(), imu_values_.size() * sizeof(double));
+  pad(kDatasetCacheAlignment);
+  header.gt_offset_ = nr_bytes_written_;
+  write(gt_states_.data(), gt_states_.size() * sizeof(DatasetCacheGtState));
+  pad(kDatasetCacheAlignment);
+
+  std::string calibration;
+  writeCameraParams(left_cam_params_, &calibration);
+  writeCameraParams(right_cam_params_, &calibration);
+  writePose(camL_Pose_camR_, &calibration);
+  writeValue(imu_params_.gyro_noise_, &calibration);
+  writeValue(imu_params_.gyro_walk_, &calibration);
+  writeValue(imu_params_.acc_noise_, &calibration);
+  writeValue(imu_params_.acc_walk_, &calibration);
+  writeValue(imu_params_.imu_shift_, &calibration);
+  writePose(gt_data_.body_Pose_cam_, &calibration);
+  writeValue(gt_data_.gt_rate_, &calibration);
+  header.calibration_offset_ = nr_bytes_written_;
+  header.calibration_size_ = calibration.size();
+  write(calibration.data(), calibration.size());
+
+  // Now that the rest is complete.
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.close();
+  if (file_.fail()) {
+    LOG(ERROR) << "Could not write dataset cache: " << filename_;
+    return false;
+  }
+  LOG(INFO) << "Wrote " << frames_.size() << " frames, "
+            << imu_timestamps_.size() << " IMU measurements and "
+            << gt_states_.size() << " ground-truth states to dataset cache "
+            << filename_ << " (" << nr_bytes_written_ / (1u << 20) << " MB).";
+  return true;
+}
+
+void DatasetCacheWriter::writeImage(const cv::Mat& img, uint64_t* offset,
+                                    int32_t* rows, int32_t* cols) {
+  CHECK_EQ(img.type(), CV_8UC1) << "Dataset cache images must be grayscale.";
+  *offset = nr_bytes_written_;
+  *rows = img.rows;
+  *cols = img.cols;
+  for (int r = 0; r < img.rows; r++) {
+    write(img.ptr<uint8_t>(r), img.cols);
+  }
+  pad(kDatasetCacheAlignment);
+}
+
+void DatasetCacheWriter::pad(const size_t& alignment) {
+  static const char kZeros[kDatasetCachePageSize] = {};
+  CHECK_LE(alignment, kDatasetCachePageSize);
+  const size_t remainder = nr_bytes_written_ % alignment;
+  if (remainder != 0u) write(kZeros, alignment - remainder);
+}
+
+void DatasetCacheWriter::write(const void* data, const size_t& size) {
+  file_.write(static_cast<const char*>(data), size);
+  nr_bytes_written_ += size;
+}
+
+/* -------------------------------------------------------------------------- */
+bool DatasetCache::open(const std::string& filename) {
+  nr_frames_ = 0u;
+  // Copy-on-write, so that the images can be given as non-const cv::Mat.
+  file_.reset(new MappedFile(filename, true));
+  if (!file_->isOpen()) {
+    LOG(ERROR) << "Cannot open dataset cache: " << filename;
+    return false;
+  }
+  const size_t file_size = file_->size();
+  // Whether [offset, offset + size) is in the file, aligned for its records.
+  auto isInFile = [file_size](const uint64_t& offset, const uint64_t& size) {
+    return offset % sizeof(uint64_t) == 0u && offset <= file_size &&
+           size <= file_size - offset;
+  };
+
+  DatasetCacheHeader header;
+  if (file_size < kDatasetCachePageSize ||
+      std::memcmp(file_->begin(), kMagic, sizeof(kMagic)) != 0) {
+    LOG(ERROR) << "Not a dataset cache: " << filename;
+    return false;
+  }
+  std::memcpy(&header, file_->begin(), sizeof(header));
+  // The sizes of the sections, without overflows.
+  static constexpr uint64_t kMaxRecords =
+      std::numeric_limits<uint64_t>::max() / (6u * sizeof(double));
+  if (header.version_ != kVersion || header.nr_frames_ > kMaxRecords ||
+      header.nr_imu_ > kMaxRecords || header.nr_gt_ > kMaxRecords ||
+      !isInFile(header.frames_offset_,
+                header.nr_frames_ * sizeof(DatasetCacheFrame)) ||
+      !isInFile(header.imu_timestamps_offset_,
+                header.nr_imu_ * sizeof(Timestamp)) ||
+      !isInFile(header.imu_values_offset_,
+                header.nr_imu_ * 6u * sizeof(double)) ||
+      !isInFile(header.gt_offset_,
+                header.nr_gt_ * sizeof(DatasetCacheGtState)) ||
+      !isInFile(header.calibration_offset_, header.calibration_size_)) {
+    LOG(ERROR) << "Corrupted dataset cache: " << filename;
+    return false;
+  }
+
+  const char* begin = file_->begin();
+  nr_frames_ = header.nr_frames_;
+  frames_ =
+      reinterpret_cast<const DatasetCacheFrame*>(begin + header.frames_offset_);
+  imu_timestamps_ =
+      reinterpret_cast<const Timestamp*>(begin + header.imu_timestamps_offset_);
+  imu_values_ =
+      reinterpret_cast<const double*>(begin + header.imu_values_offset_);
+  equalized_ = header.equalized_ != 0u;
+  for (size_t i = 0u; i < nr_frames_; i++) {
+    const DatasetCacheFrame& frame = frames_[i];
+    if (frame.left_rows_ < 0 || frame.left_cols_ < 0 ||
+        frame.right_rows_ < 0 || frame.right_cols_ < 0 ||
+        !isInFile(frame.left_offset_,
+                  static_cast<uint64_t>(frame.left_rows_) * frame.left_cols_) ||
+        !isInFile(frame.right_offset_, static_cast<uint64_t>(
+                                           frame.right_rows_) *
+                                           frame.right_cols_) ||
+        frame.imu_begin_ > frame.imu_end_ || frame.imu_end_ > header.nr_imu_ ||
+        (i > 0u && frame.timestamp_ <= frames_[i - 1u].timestamp_)) {
+      LOG(ERROR) << "Corrupted frame " << i << " in dataset cache: "
+                 << filename;
+      return false;
+    }
+  }
+
+  // Ground truth is looked up by timestamp: decode it once.
+  const DatasetCacheGtState* gt_states =
+      reinterpret_cast<const DatasetCacheGtState*>(begin + header.gt_offset_);
+  gt_data_.map_to_gt_.clear();
+  for (size_t i = 0u; i < header.nr_gt_; i++) {
+    const DatasetCacheGtState& gt_state = gt_states[i];
+    gtsam::Matrix3 R;
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) R(r, c) = gt_state.rotation_[3 * r + c];
+    }
+    gt_data_.map_to_gt_.emplace_hint(
+        gt_data_.map_to_gt_.end(), gt_state.timestamp_,
+        VioNavState(
+            gtsam::Pose3(gtsam::Rot3(R),
+                         gtsam::Point3(gt_state.translation_[0],
+                                       gt_state.translation_[1],
+                                       gt_state.translation_[2])),
+            gtsam::Vector3(gt_state.velocity_[0], gt_state.velocity_[1],
+                           gt_state.velocity_[2]),
+            gtsam::imuBias::ConstantBias(
+                gtsam::Vector3(gt_state.acc_bias_[0], gt_state.acc_bias_[1],
+                               gt_state.acc_bias_[2]),
+                gtsam::Vector3(gt_state.gyro_bias_[0], gt_state.gyro_bias_[1],
+                               gt_state.gyro_bias_[2]))));
+  }
+
+  if (!readCalibration(begin + header.calibration_offset_,
+                       begin + header.calibration_offset_ +
+                           header.calibration_size_)) {
+    LOG(ERROR) << "Corrupted calibration in dataset cache: " << filename;
+    return false;
+  }
+  return true;
+}
+
+bool DatasetCache::readCalibration(const char* begin, const char* end) {
+  CalibrationReader reader(begin, end);
+  return reader.readCameraParams(&left_cam_params_) &&
+         reader.readCameraParams(&right_cam_params_) &&
+         reader.readPose(&camL_Pose_camR_) &&
+         reader.read(&imu_params_.gyro_noise_) &&
+         reader.read(&imu_params_.gyro_walk_) &&
+         reader.read(&imu_params_.acc_noise_) &&
+         reader.read(&imu_params_.acc_walk_) &&
+         reader.read(&imu_params_.imu_shift_) &&
+         reader.readPose(&gt_data_.body_Pose_cam_) &&
+         reader.read(&gt_data_.gt_rate_);
+}
+
+cv::Mat DatasetCache::leftImage(const size_t& i) const {
+  const DatasetCacheFrame& f = frame(i);
+  return cv::Mat(f.left_rows_, f.left_cols_, CV_8UC1,
+                 file_->mutableBegin() + f.left_offset_);
+}
+
+cv::Mat DatasetCache::rightImage(const size_t& i) const {
+  const DatasetCacheFrame& f = frame(i);
+  return cv::Mat(f.right_rows_, f.right_cols_, CV_8UC1,
+                 file_->mutableBegin() + f.right_offset_);
+}
+
+void DatasetCache::getImu(const size_t& i, ImuStampS* imu_stamps,
+                          ImuAccGyrS* imu_accgyr) const {
+  CHECK_NOTNULL(imu_stamps);
+  CHECK_NOTNULL(imu_accgyr);
+  const DatasetCacheFrame& f = frame(i);
+  const Eigen::Index nr_imu = f.imu_end_ - f.imu_begin_;
+  *imu_stamps = Eigen::Map<const ImuStampS>(imu_timestamps_ + f.imu_begin_,
+                                            nr_imu);
+  *imu_accgyr = Eigen::Map<const ImuAccGyrS>(
+      imu_values_ + 6u * f.imu_begin_, 6, nr_imu);
+}
+
+}  // namespace VIO
@@ -0,0 +1,200 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DatasetCache.h
+ * @brief  Pre-decoded dataset in a single memory-mappable file: grayscale
+ *         frames, IMU, ground truth and calibration, to replay a sequence
+ *         without decoding images or parsing text files.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "CameraParams.h"
+#include "StereoImuSyncPacket.h"
+#include "common/vio_types.h"
+#include "datasource/CsvParser.h"
+#include "datasource/DataSource-definitions.h"
+#include "imu-frontend/ImuFrontEnd-definitions.h"
+#include "imu-frontend/ImuFrontEndParams.h"
+
+namespace VIO {
+
+///
+// Dataset cache format (.dscache), little-endian:
+//
+// Header:  DatasetCacheHeader, padded to kDatasetCachePageSize bytes, so that
+//          the images are page-aligned.
+// Images:  per frame, the left then the right image: rows * cols bytes
+//          (CV_8UC1), each padded to kDatasetCacheAlignment bytes.
+// Frames:  nr_frames DatasetCacheFrame records.
+// IMU:     nr_imu int64 timestamps, then nr_imu acc-gyr 6-vectors (double),
+//          the ones of each frame contiguous, as in ImuAccGyrS.
+// GT:      nr_gt DatasetCacheGtState records, by increasing timestamp.
+// Calib:   left and right CameraParams, camL_Pose_camR, ImuParams and the
+//          GroundTruthData extrinsics and rate, serialized.
+//
+// The header is written last: an incomplete file is not a dataset cache.
+
+static constexpr size_t kDatasetCachePageSize = 4096u;
+static constexpr size_t kDatasetCacheAlignment = 64u;
+
+struct DatasetCacheHeader {
+  char magic_[8];
+  uint32_t version_;
+  // Whether the images are histogram-equalized.
+  uint32_t equalized_;
+  uint64_t nr_frames_;
+  uint64_t nr_imu_;
+  uint64_t nr_gt_;
+  uint64_t frames_offset_;
+  uint64_t imu_timestamps_offset_;
+  uint64_t imu_values_offset_;
+  uint64_t gt_offset_;
+  uint64_t calibration_offset_;
+  uint64_t calibration_size_;
+};
+
+struct DatasetCacheFrame {
+  int64_t id_;
+  int64_t timestamp_;
+  uint64_t left_offset_;
+  uint64_t right_offset_;
+  int32_t left_rows_, left_cols_;
+  int32_t right_rows_, right_cols_;
+  // IMU measurements of the frame: [imu_begin_, imu_end_).
+  uint64_t imu_begin_;
+  uint64_t imu_end_;
+};
+
+struct DatasetCacheGtState {
+  int64_t timestamp_;
+  // World_Pose_body: row-major rotation matrix and translation.
+  double rotation_[9];
+  double translation_[3];
+  double velocity_[3];
+  double acc_bias_[3];
+  double gyro_bias_[3];
+};
+
+// Writes the packets of a data provider, as they are produced, in a dataset
+// cache. The calibration is the one of the first packet.
+class DatasetCacheWriter {
+ public:
+  // images_equalized: whether the images of the packets are equalized.
+  DatasetCacheWriter(const std::string& filename,
+                     const bool& images_equalized);
+  ~DatasetCacheWriter();
+
+  DatasetCacheWriter(const DatasetCacheWriter&) = delete;
+  DatasetCacheWriter& operator=(const DatasetCacheWriter&) = delete;
+
+  // Packets must be given by increasing timestamp.
+  void addPacket(const StereoImuSyncPacket& packet);
+  void setImuParams(const ImuParams& imu_params);
+  void setGroundTruth(const GroundTruthData& gt_data);
+
+  // Writes the index, IMU, ground truth and calibration, and the header.
+  // Returns false if the file could not be written.
+  bool finish();
+
+  inline size_t nrFrames() const { return frames_.size(); }
+
+ private:
+  void writeImage(const cv::Mat& img, uint64_t* offset, int32_t* rows,
+                  int32_t* cols);
+  // Pads the file with zeros up to a multiple of alignment.
+  void pad(const size_t& alignment);
+  void write(const void* data, const size_t& size);
+
+ private:
+  std::ofstream file_;
+  const std::string filename_;
+  const bool images_equalized_;
+  bool is_finished_ = false;
+  uint64_t nr_bytes_written_ = 0u;
+
+  std::vector<DatasetCacheFrame> frames_;
+  std::vector<Timestamp> imu_timestamps_;
+  std::vector<double> imu_values_;
+  std::vector<DatasetCacheGtState> gt_states_;
+
+  bool has_calibration_ = false;
+  CameraParams left_cam_params_;
+  CameraParams right_cam_params_;
+  gtsam::Pose3 camL_Pose_camR_;
+  ImuParams imu_params_;
+  GroundTruthData gt_data_;
+};
+
+// Memory-mapped dataset cache. The images are served as cv::Mat headers
+// pointing into the (copy-on-write) mapping: they are only valid while the
+// cache is.
+class DatasetCache {
+ public:
+  // Maps the dataset cache, returns false if it is not one.
+  bool open(const std::string& filename);
+
+  inline size_t nrFrames() const { return nr_frames_; }
+  inline const DatasetCacheFrame& frame(const size_t& i) const {
+    DCHECK_LT(i, nr_frames_);
+    return frames_[i];
+  }
+  inline bool isEqualized() const { return equalized_; }
+
+  // Headers of the images of the i-th frame, without copies.
+  cv::Mat leftImage(const size_t& i) const;
+  cv::Mat rightImage(const size_t& i) const;
+  // IMU measurements of the i-th frame.
+  void getImu(const size_t& i, ImuStampS* imu_stamps,
+              ImuAccGyrS* imu_accgyr) const;
+
+  inline const CameraParams& getLeftCamInfo() const {
+    return left_cam_params_;
+  }
+  inline const CameraParams& getRightCamInfo() const {
+    return right_cam_params_;
+  }
+  inline const gtsam::Pose3& getCamLPoseCamR() const { return camL_Pose_camR_; }
+  // Only the noise and the IMU shift: the gravity comes from the backend.
+  inline const ImuParams& getImuParams() const { return imu_params_; }
+  // Empty if the dataset has no ground truth.
+  inline const GroundTruthData& getGroundTruth() const { return gt_data_; }
+
+ private:
+  bool readCalibration(const char* begin, const char* end);
+
+ private:
+  std::unique_ptr<MappedFile> file_;
+  size_t nr_frames_ = 0u;
+  const DatasetCacheFrame* frames_ = nullptr;
+  const Timestamp* imu_timestamps_ = nullptr;
+  const double* imu_values_ = nullptr;
+  bool equalized_ = false;
+
+  CameraParams left_cam_params_;
+  CameraParams right_cam_params_;
+  gtsam::Pose3 camL_Pose_camR_;
+  ImuParams imu_params_;
+  GroundTruthData gt_data_;
+};
+
+}  // namespace VIO
@@ -17,10 +17,12 @@
 #include "datasource/ETH_parser.h"
 
 #include "StereoFrame.h"
+#include "datasource/CsvParser.h"
 #include "imu-frontend/ImuFrontEnd-definitions.h"
 
 DEFINE_int32(skip_n_start_frames, 10, "Number of initial frames to skip.");
 DEFINE_int32(skip_n_end_frames, 100, "Number of final frames to skip.");
+DECLARE_int32(dataset_parse_threads);
 
 namespace VIO {
 
@@ -220,36 +222,28 @@ bool ETHDatasetParser::parseImuData(const std::string& input_dataset_path,
   // a_RS_S_x [m s^-2],a_RS_S_y [m s^-2],a_RS_S_z [m s^-2]
   std::string filename_data =
       input_dataset_path + "/mav0/" + imuName + "/data.csv";
-  std::ifstream fin(filename_data.c_str());
-  LOG_IF(FATAL, !fin.is_open()) << "Cannot open file: " << filename_data;
-
-  // Skip the first line, containing the header.
-  std::string line;
-  std::getline(fin, line);
+  TimestampedCsv imu_csv;
+  LOG_IF(FATAL, !parseTimestampedCsv(filename_data, 6u,
+                                     FLAGS_dataset_parse_threads, &imu_csv))
+      << "Cannot parse file: " << filename_data;
+  const size_t nr_measurements = imu_csv.nrRows();
+  LOG_IF(FATAL, nr_measurements == 0u) << "No IMU data in: " << filename_data;
 
   size_t deltaCount = 0u;
   Timestamp sumOfDelta = 0;
   double stdDelta = 0;
   double imu_rate_maxMismatch = 0;
   double maxNormAcc = 0, maxNormRotRate = 0;  // only for debugging
-  Timestamp previous_timestamp = -1;
-
-  // Read/store imu measurements, line by line.
-  while (std::getline(fin, line)) {
-    Timestamp timestamp = 0;
-    gtsam::Vector6 gyroAccData;
-    for (size_t i = 0; i < 7; i++) {
-      int idx = line.find_first_of(',');
-      if (i == 0) {
-        timestamp = std::stoll(line.substr(0, idx));
-      } else {
-        gyroAccData(i - 1) = std::stod(line.substr(0, idx));
-      }
-      line = line.substr(idx + 1);
-    }
-    Vector6 imu_accgyr;
+
+  // Store all imu measurements at once.
+  ImuStampS imu_timestamps(1, nr_measurements);
+  ImuAccGyrS imu_accgyr(6, nr_measurements);
+  for (size_t i = 0u; i < nr_measurements; i++) {
+    const Timestamp& timestamp = imu_csv.timestamps_[i];
+    Eigen::Map<const gtsam::Vector6> gyroAccData(imu_csv.row(i));
+    imu_timestamps(i) = timestamp;
     // Acceleration first!
-    imu_accgyr << gyroAccData.tail(3), gyroAccData.head(3);
+    imu_accgyr.col(i) << gyroAccData.tail(3), gyroAccData.head(3);
 
     double normAcc = gyroAccData.tail(3).norm();
     if (normAcc > maxNormAcc) maxNormAcc = normAcc;
@@ -257,11 +251,8 @@ bool ETHDatasetParser::parseImuData(const std::string& input_dataset_path,
     double normRotRate = gyroAccData.head(3).norm();
     if (normRotRate > maxNormRotRate) maxNormRotRate = normRotRate;
 
-    imu_data_.imu_buffer_.addMeasurement(timestamp, imu_accgyr);
-    if (previous_timestamp == -1) {
-      // Do nothing.
-      previous_timestamp = timestamp;
-    } else {
+    if (i != 0u) {
+      const Timestamp& previous_timestamp = imu_csv.timestamps_[i - 1u];
       sumOfDelta += (timestamp - previous_timestamp);
       double deltaMismatch = std::fabs(
           double(timestamp - previous_timestamp - imu_data_.nominal_imu_rate_) *
@@ -269,9 +260,9 @@ bool ETHDatasetParser::parseImuData(const std::string& input_dataset_path,
       stdDelta += std::pow(deltaMismatch, 2);
       imu_rate_maxMismatch = std::max(imu_rate_maxMismatch, deltaMismatch);
       deltaCount += 1u;
-      previous_timestamp = timestamp;
     }
   }
+  imu_data_.imu_buffer_.addMeasurements(imu_timestamps, imu_accgyr);
 
   LOG_IF(FATAL, deltaCount != imu_data_.imu_buffer_.size() - 1u)
       << "parseImuData: wrong nr of deltaCount: deltaCount " << deltaCount
@@ -284,7 +275,6 @@ bool ETHDatasetParser::parseImuData(const std::string& input_dataset_path,
   imu_data_.imu_rate_std_ =
       std::sqrt(stdDelta / static_cast<double>(deltaCount - 1u));
   imu_data_.imu_rate_maxMismatch_ = imu_rate_maxMismatch;
-  fin.close();
 
   LOG(INFO) << "Maximum measured rotation rate (norm):" << maxNormRotRate << '-'
             << "Maximum measured acceleration (norm): " << maxNormAcc;
@@ -333,39 +323,23 @@ bool ETHDatasetParser::parseGTdata(const std::string& input_dataset_path,
   // b_a_RS_S_x [m s^-2], b_a_RS_S_y [m s^-2], b_a_RS_S_z [m s^-2]
   std::string filename_data =
       input_dataset_path + "/mav0/" + gtSensorName + "/data.csv";
-  std::ifstream fin(filename_data.c_str());
-  LOG_IF(FATAL, !fin.is_open()) << "Cannot open file: " << filename_data << '\n'
-                                << "Assuming dataset has no ground truth...";
-
-  // Skip the first line, containing the header.
-  std::string line;
-  std::getline(fin, line);
+  TimestampedCsv gt_csv;
+  LOG_IF(FATAL, !parseTimestampedCsv(filename_data, 16u,
+                                     FLAGS_dataset_parse_threads, &gt_csv))
+      << "Cannot parse file: " << filename_data << '\n'
+      << "Assuming dataset has no ground truth...";
 
   size_t deltaCount = 0u;
   Timestamp sumOfDelta = 0;
-  Timestamp previous_timestamp = -1;
 
-  // Read/store gt, line by line.
+  // Read/store gt, row by row.
   double maxGTvel = 0;
-  while (std::getline(fin, line)) {
-    Timestamp timestamp = 0;
-    std::vector<double> gtDataRaw;
-    for (size_t i = 0; i < 17; i++) {
-      int idx = line.find_first_of(',');
-      if (i == 0)
-        timestamp = std::stoll(line.substr(0, idx));
-      else
-        gtDataRaw.push_back(std::stod(line.substr(0, idx)));
-      line = line.substr(idx + 1);
-    }
-    if (previous_timestamp == -1) {
-      previous_timestamp = timestamp;  // do nothing
-    } else {
-      sumOfDelta += (timestamp - previous_timestamp);
-      // std::cout << "time diff (sec): " << (timestamp - previous_timestamp) *
-      // 1e-9 << std::endl;
+  for (size_t i = 0u; i < gt_csv.nrRows(); i++) {
+    const Timestamp& timestamp = gt_csv.timestamps_[i];
+    const double* gtDataRaw = gt_csv.row(i);
+    if (i != 0u) {
+      sumOfDelta += (timestamp - gt_csv.timestamps_[i - 1u]);
       deltaCount += 1u;
-      previous_timestamp = timestamp;
     }
 
     VioNavState gt_curr;
@@ -401,12 +375,12 @@ bool ETHDatasetParser::parseGTdata(const std::string& input_dataset_path,
         gtsam::Vector3(gtDataRaw[13], gtDataRaw[14], gtDataRaw[15]);
     gt_curr.imu_bias_ = gtsam::imuBias::ConstantBias(accBias, gyroBias);
 
-    gt_data_.map_to_gt_.insert(
-        std::pair<Timestamp, VioNavState>(timestamp, gt_curr));
+    gt_data_.map_to_gt_.emplace_hint(gt_data_.map_to_gt_.end(), timestamp,
+                                     gt_curr);
 
     double normVel = gt_curr.velocity_.norm();
     if (normVel > maxGTvel) maxGTvel = normVel;
-  }  // End of while loop.
+  }  // End of for loop.
 
   LOG_IF(FATAL, deltaCount != gt_data_.map_to_gt_.size() - 1u)
       << "parseGTdata: wrong nr of deltaCount: deltaCount " << deltaCount
@@ -416,7 +390,6 @@ bool ETHDatasetParser::parseGTdata(const std::string& input_dataset_path,
   // Converted in seconds.
   // TODO(TONI): this looks horrible.
   gt_data_.gt_rate_ = (double(sumOfDelta) / double(deltaCount)) * 1e-9;
-  fin.close();
 
   LOG(INFO) << "Maximum ground truth velocity: " << maxGTvel;
   return true;
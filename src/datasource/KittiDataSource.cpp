@@ -13,10 +13,17 @@
  */
 #include "datasource/KittiDataSource.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <opencv2/core/core.hpp>
 
 #include "StereoFrame.h"
 #include "StereoImuSyncPacket.h"
+#include "datasource/CsvParser.h"
+#include "utils/ThreadPool.h"
+
+DECLARE_int32(dataset_parse_threads);
 
 namespace VIO {
 
@@ -233,31 +240,40 @@ void KittiDataProvider::parseKittiData(const std::string& kitti_sequence_path,
 bool KittiDataProvider::parseTimestamps(
     const std::string& timestamps_file,
     std::vector<Timestamp>& timestamps_list) const {
-  std::ifstream times_stream;
-  times_stream.open(timestamps_file.c_str());
-  CHECK(times_stream.is_open())
+  MappedFile times_file(timestamps_file);
+  CHECK(times_file.isOpen())
       << "Could not open timestamps file: " << timestamps_file;
   timestamps_list.clear();
   static constexpr int seconds_per_hour = 3600u;
   static constexpr int seconds_per_minute = 60u;
   static constexpr long int seconds_to_nanoseconds = 1e9;
-  // Loop through timestamps text file
-  while (!times_stream.eof()) {
-    std::string line;
-    getline(times_stream, line);
-    if (!line.empty()) {
-      std::stringstream ss;
-      std::replace(line.begin(), line.end(), ':', ' ');
-      ss << line;
-      std::string date;
+  // Loop through timestamps text file, with lines as
+  // 2011-09-26 13:02:25.594360375
+  const char* line = times_file.begin();
+  while (line < times_file.end()) {
+    const char* line_end = static_cast<const char*>(
+        std::memchr(line, '\n', times_file.end() - line));
+    if (line_end == nullptr) line_end = times_file.end();
+    const char* next_line =
+        line_end < times_file.end() ? line_end + 1 : times_file.end();
+    if (line_end > line && *(line_end - 1) == '\r') line_end--;
+    if (line_end != line) {
+      const char* time =
+          static_cast<const char*>(std::memchr(line, ' ', line_end - line));
       double hr, min, sec;
-      ss >> date >> hr >> min >> sec;
+      const char* it = time == nullptr ? nullptr
+                                       : parseDouble(time, line_end, &hr);
+      if (it != nullptr && *it == ':') it = parseDouble(it + 1, line_end, &min);
+      if (it != nullptr && *it == ':') it = parseDouble(it + 1, line_end, &sec);
+      CHECK(it != nullptr) << "Malformed line in " << timestamps_file << ": "
+                           << std::string(line, line_end);
       // formate time into Timestamp (in nanosecs)
       Timestamp timestamp =
           (hr * seconds_per_hour + min * seconds_per_minute + sec) *
           seconds_to_nanoseconds;
       timestamps_list.push_back(timestamp);
     }
+    line = next_line;
   }
   return true;
 }
@@ -421,13 +437,6 @@ bool KittiDataProvider::parseImuData(const std::string& input_dataset_path,
   // dataset_path/oxts/data/0000000000.txt extract imu data according to kitti
   // readme
 
-  size_t deltaCount = 0u;
-  Timestamp sumOfDelta = 0;
-  double stdDelta = 0;
-  double imu_rate_maxMismatch = 0;
-  double maxNormAcc = 0, maxNormRotRate = 0;  // only for debugging
-  size_t oxts_timestamp_size = oxts_timestamps.size();
-
   std::vector<std::pair<Timestamp, int> > timestamp_ind_pairs;
   for (size_t i = 0; i < oxts_timestamps.size(); i++) {
     std::pair<Timestamp, int> tip;
@@ -437,65 +446,65 @@ bool KittiDataProvider::parseImuData(const std::string& input_dataset_path,
   }
   std::sort(timestamp_ind_pairs.begin(), timestamp_ind_pairs.end(),
             Earlier_time_imu);
-  oxts_timestamps.clear();
-
-  int count = 0;
-  for (size_t i = 0; i < oxts_timestamp_size; i++) {
+  // Keep a single measurement per timestamp.
+  timestamp_ind_pairs.erase(
+      std::unique(timestamp_ind_pairs.begin(), timestamp_ind_pairs.end(),
+                  [](const std::pair<Timestamp, int>& a,
+                     const std::pair<Timestamp, int>& b) {
+                    return a.first == b.first;
+                  }),
+      timestamp_ind_pairs.end());
+  const size_t nr_measurements = timestamp_ind_pairs.size();
+
+  // Parse the measurement files in parallel, each one in its own column.
+  ImuStampS imu_timestamps(1, nr_measurements);
+  ImuAccGyrS imu_accgyr(6, nr_measurements);
+  utils::ThreadPool thread_pool(FLAGS_dataset_parse_threads);
+  thread_pool.parallelFor(0u, nr_measurements, [&](const size_t& i) {
     std::stringstream ss;
-    if (timestamp_ind_pairs[i].first != oxts_timestamps[count - 1]) {
-      oxts_timestamps.push_back(timestamp_ind_pairs[i].first);
-      ss << std::setfill('0') << std::setw(10) << timestamp_ind_pairs[i].second;
-      std::string oxts_file_i = oxtsdata_filename + ss.str() + ".txt";
-      std::ifstream oxts_data_i;
-      oxts_data_i.open(oxts_file_i.c_str());
-      LOG_IF(FATAL, !oxts_data_i.is_open())
-          << "Cannot open oxts file: " << oxts_file_i;
-
-      // All information should be on one line (according example file)
-      // Store words in vector for easy access by index
-      std::vector<std::string> oxts_data_str;
-      std::string item;
-      while (getline(oxts_data_i, item, ' ')) {
-        oxts_data_str.push_back(item);
-      }
+    ss << std::setfill('0') << std::setw(10) << timestamp_ind_pairs[i].second;
+    std::string oxts_file_i = oxtsdata_filename + ss.str() + ".txt";
+    MappedFile oxts_data_i(oxts_file_i);
+    LOG_IF(FATAL, !oxts_data_i.isOpen())
+        << "Cannot open oxts file: " << oxts_file_i;
+
+    // All information should be on one line (according example file)
+    // terms 11~13 (starting from 0) are ax, ay, az
+    // terms 17~19 (starting from 0) are wx, wy, wz
+    double oxts_data[20];
+    LOG_IF(FATAL, !parseDoubles(oxts_data_i.begin(), oxts_data_i.end(), ' ',
+                                20u, oxts_data))
+        << "Cannot parse oxts file: " << oxts_file_i;
+    imu_timestamps(i) = timestamp_ind_pairs[i].first;
+    // Acceleration first!
+    imu_accgyr.col(i) << oxts_data[11], oxts_data[12], oxts_data[13],
+        oxts_data[17], oxts_data[18], oxts_data[19];
+  });
 
-      // Read/store imu measurements
-      gtsam::Vector6 gyroAccData;
-      gtsam::Vector6 imu_accgyr;
-      // terms 17~19 (starting from 0) are wx, wy, wz
-      for (int k = 0; k < 3; k++) {
-        gyroAccData(k) = std::stod(oxts_data_str[k + 17]);
-        imu_accgyr(k + 3) = std::stod(oxts_data_str[k + 17]);
-      }
-      // terms 11~13 (starting from 0) are ax, ay, az
-      for (int k = 3; k < 6; k++) {
-        gyroAccData(k) = std::stod(oxts_data_str[k + 8]);
-        imu_accgyr(k - 3) = std::stod(oxts_data_str[k + 8]);
-      }
-      // Acceleration first!
-      double normAcc = gyroAccData.tail(3).norm();
-      if (normAcc > maxNormAcc) maxNormAcc = normAcc;
-
-      double normRotRate = gyroAccData.head(3).norm();
-      if (normRotRate > maxNormRotRate) maxNormRotRate = normRotRate;
-
-      kitti_data->imuData_.imu_buffer_.addMeasurement(oxts_timestamps[count],
-                                                      imu_accgyr);
-
-      if (count != 0) {
-        sumOfDelta += (oxts_timestamps[count] - oxts_timestamps[count - 1]);
-        double deltaMismatch = std::fabs(
-            double(oxts_timestamps[count] - oxts_timestamps[count - 1] -
-                   kitti_data->imuData_.nominal_imu_rate_) *
-            1e-9);
-        stdDelta += std::pow(deltaMismatch, 2);
-        imu_rate_maxMismatch = std::max(imu_rate_maxMismatch, deltaMismatch);
-        deltaCount += 1u;
-      }
-      count++;
-      oxts_data_i.close();
+  size_t deltaCount = 0u;
+  Timestamp sumOfDelta = 0;
+  double stdDelta = 0;
+  double imu_rate_maxMismatch = 0;
+  double maxNormAcc = 0, maxNormRotRate = 0;  // only for debugging
+  for (size_t i = 0; i < nr_measurements; i++) {
+    double normAcc = imu_accgyr.col(i).head(3).norm();
+    if (normAcc > maxNormAcc) maxNormAcc = normAcc;
+
+    double normRotRate = imu_accgyr.col(i).tail(3).norm();
+    if (normRotRate > maxNormRotRate) maxNormRotRate = normRotRate;
+
+    if (i != 0) {
+      sumOfDelta += (imu_timestamps(i) - imu_timestamps(i - 1));
+      double deltaMismatch =
+          std::fabs(double(imu_timestamps(i) - imu_timestamps(i - 1) -
+                           kitti_data->imuData_.nominal_imu_rate_) *
+                    1e-9);
+      stdDelta += std::pow(deltaMismatch, 2);
+      imu_rate_maxMismatch = std::max(imu_rate_maxMismatch, deltaMismatch);
+      deltaCount += 1u;
     }
   }
+  kitti_data->imuData_.imu_buffer_.addMeasurements(imu_timestamps, imu_accgyr);
 
   LOG_IF(FATAL, deltaCount != kitti_data->imuData_.imu_buffer_.size() - 1u)
       << "parseImuData: wrong nr of deltaCount: deltaCount " << deltaCount
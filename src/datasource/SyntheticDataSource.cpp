@@ -0,0 +1,380 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SyntheticDataSource.cpp
+ * @brief  Synthetic stereo + IMU dataset, rendered on the fly: for reproducible
+ *         runs at any resolution and rate, without downloading a dataset.
+ * @author Antoni Rosinol
+ */
+
+#include "datasource/SyntheticDataSource.h"
+
+#include <cmath>
+#include <limits>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "StereoFrame.h"
+#include "utils/Statistics.h"
+#include "utils/Timer.h"
+
+DEFINE_int32(synthetic_image_width, 752, "Width of the synthetic images.");
+DEFINE_int32(synthetic_image_height, 480, "Height of the synthetic images.");
+DEFINE_double(synthetic_camera_rate_hz, 20.0,
+              "Frame rate of the synthetic stereo camera.");
+DEFINE_double(synthetic_imu_rate_hz, 200.0,
+              "Rate of the synthetic IMU, ideally a multiple of the camera "
+              "rate.");
+DEFINE_double(synthetic_baseline, 0.11,
+              "Baseline of the synthetic stereo camera [m].");
+DEFINE_double(synthetic_trajectory_radius, 1.0,
+              "Radius of the circular trajectory in the synthetic room [m].");
+DEFINE_double(synthetic_angular_velocity, 0.3,
+              "Angular velocity along the circular trajectory [rad/s].");
+DEFINE_bool(synthetic_imu_noise, true,
+            "Add white noise and bias random walk to the synthetic IMU, as "
+            "given by the IMU parameters.");
+DEFINE_int32(synthetic_seed, 0,
+             "Seed of the synthetic texture and IMU noise.");
+
+DECLARE_int32(skip_n_start_frames);
+
+namespace VIO {
+
+namespace {
+
+// Half extents of the room, centered at the origin [m].
+const gtsam::Vector3 kRoomHalfExtents(5.0, 5.0, 3.0);
+// Size of the squares of the wall texture, coarse and fine [m].
+constexpr double kCoarseCellSize = 0.5;
+constexpr double kFineCellSize = 0.1;
+// Amplitudes of the oscillations along the trajectory.
+constexpr double kHeightAmplitude = 0.2;  // [m]
+constexpr double kRollPitchAmplitude = 0.1;  // [rad]
+
+// Cheap integer hash (splitmix64 finalizer), to texture the walls
+// deterministically without storing anything.
+uint8_t HashToIntensity(int64_t x, int64_t y, int face, int seed) {
+  uint64_t h = static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull ^
+               static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full ^
+               static_cast<uint64_t>(face * 131 + seed) * 0x165667B19E3779F9ull;
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+  return static_cast<uint8_t>(h ^ (h >> 31));
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+SyntheticTrajectory::SyntheticTrajectory(const double& radius,
+                                         const double& angular_velocity)
+    : radius_(radius), angular_velocity_(angular_velocity) {
+  CHECK_GE(radius_, 0.0);
+  CHECK_LT(radius_, kRoomHalfExtents.head<2>().minCoeff())
+      << "The trajectory must lie inside the room.";
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Pose3 SyntheticTrajectory::pose(const double& t) const {
+  const double w = angular_velocity_;
+  const gtsam::Vector3 rpy = angles(t);
+  return gtsam::Pose3(
+      gtsam::Rot3::Ypr(rpy(2), rpy(1), rpy(0)),
+      gtsam::Point3(radius_ * std::cos(w * t), radius_ * std::sin(w * t),
+                    kHeightAmplitude * std::sin(2.0 * w * t)));
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Vector3 SyntheticTrajectory::velocity(const double& t) const {
+  const double w = angular_velocity_;
+  return gtsam::Vector3(-radius_ * w * std::sin(w * t),
+                        radius_ * w * std::cos(w * t),
+                        2.0 * w * kHeightAmplitude * std::cos(2.0 * w * t));
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Vector3 SyntheticTrajectory::acceleration(const double& t) const {
+  const double w = angular_velocity_;
+  return gtsam::Vector3(
+      -radius_ * w * w * std::cos(w * t), -radius_ * w * w * std::sin(w * t),
+      -4.0 * w * w * kHeightAmplitude * std::sin(2.0 * w * t));
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Vector3 SyntheticTrajectory::angularVelocity(const double& t) const {
+  // Body rates from ZYX Euler rates.
+  const gtsam::Vector3 rpy = angles(t);
+  const gtsam::Vector3 rpy_rate = anglesRate(t);
+  const double sr = std::sin(rpy(0)), cr = std::cos(rpy(0));
+  const double sp = std::sin(rpy(1)), cp = std::cos(rpy(1));
+  return gtsam::Vector3(rpy_rate(0) - rpy_rate(2) * sp,
+                        rpy_rate(1) * cr + rpy_rate(2) * cp * sr,
+                        rpy_rate(2) * cp * cr - rpy_rate(1) * sr);
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Vector3 SyntheticTrajectory::angles(const double& t) const {
+  // Yaw follows the circle so that the camera looks outwards.
+  const double w = angular_velocity_;
+  return gtsam::Vector3(kRollPitchAmplitude * std::sin(2.0 * w * t),
+                        kRollPitchAmplitude * std::sin(3.0 * w * t), w * t);
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Vector3 SyntheticTrajectory::anglesRate(const double& t) const {
+  const double w = angular_velocity_;
+  return gtsam::Vector3(
+      2.0 * w * kRollPitchAmplitude * std::cos(2.0 * w * t),
+      3.0 * w * kRollPitchAmplitude * std::cos(3.0 * w * t), w);
+}
+
+/* -------------------------------------------------------------------------- */
+SyntheticDataProvider::SyntheticDataProvider()
+    : DataProvider(),
+      trajectory_(FLAGS_synthetic_trajectory_radius,
+                  FLAGS_synthetic_angular_velocity),
+      camera_period_(std::llround(1e9 / FLAGS_synthetic_camera_rate_hz)),
+      imu_period_(std::llround(1e9 / FLAGS_synthetic_imu_rate_hz)),
+      seed_(FLAGS_synthetic_seed),
+      random_engine_(FLAGS_synthetic_seed) {
+  CHECK_GT(camera_period_, 0);
+  CHECK_GT(imu_period_, 0);
+  LOG_IF(WARNING, imu_period_ > camera_period_)
+      << "Synthetic IMU rate is lower than the camera rate: some frames will "
+         "not have IMU measurements of their own.";
+  CHECK_GE(initial_k_, FLAGS_skip_n_start_frames)
+      << "Initial frame " << initial_k_ << " has to be larger than "
+      << FLAGS_skip_n_start_frames << " (needed for IMU calibration)";
+
+  generateCameraParams();
+
+  // Same IMU as in EuRoC (ADIS16448), so that the EuRoC vio parameters apply.
+  pipeline_params_.imu_params_.gyro_noise_ = 1.6968e-04;
+  pipeline_params_.imu_params_.gyro_walk_ = 1.9393e-05;
+  pipeline_params_.imu_params_.acc_noise_ = 2.0000e-03;
+  pipeline_params_.imu_params_.acc_walk_ = 3.0000e-03;
+  pipeline_params_.imu_params_.imu_shift_ = 0.0;
+  imu_data_.nominal_imu_rate_ = imu_period_ * 1e-9;
+
+  // Parse backend/frontend parameters, they set the gravity for the IMU.
+  parseBackendParams();
+  parseFrontendParams();
+
+  generateImuData();
+
+  // Send first ground-truth pose to VIO for initialization if requested.
+  if (pipeline_params_.backend_params_->autoInitialize_ == 0) {
+    pipeline_params_.backend_params_->initial_ground_truth_state_ =
+        getGroundTruthState(timestampAtFrame(initial_k_));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+SyntheticDataProvider::~SyntheticDataProvider() {
+  LOG(INFO) << "SyntheticDataProvider destructor called.";
+}
+
+/* -------------------------------------------------------------------------- */
+bool SyntheticDataProvider::spin() {
+  CHECK(vio_callback_) << "Missing VIO callback registration. Call "
+                          " registerVioCallback before spinning the dataset.";
+  const StereoMatchingParams& stereo_matching_params =
+      pipeline_params_.frontend_params_.getStereoMatchingParams();
+  Timestamp timestamp_last_frame =
+      timestampAtFrame(initial_k_ - FLAGS_skip_n_start_frames);
+  for (FrameId k = initial_k_; k < final_k_; k++) {
+    const Timestamp timestamp_frame_k = timestampAtFrame(k);
+    ImuMeasurements imu_meas;
+    CHECK(utils::ThreadsafeImuBuffer::QueryResult::kDataAvailable ==
+          imu_data_.imu_buffer_.getImuDataInterpolatedUpperBorder(
+              timestamp_last_frame, timestamp_frame_k, &imu_meas.timestamps_,
+              &imu_meas.measurements_));
+    timestamp_last_frame = timestamp_frame_k;
+
+    // Render.
+    auto tic = utils::Timer::tic();
+    const gtsam::Pose3 world_Pose_body =
+        trajectory_.pose(timestamp_frame_k * 1e-9);
+    cv::Mat left_img = renderImage(
+        left_cam_info_, world_Pose_body.compose(left_cam_info_.body_Pose_cam_));
+    cv::Mat right_img =
+        renderImage(right_cam_info_,
+                    world_Pose_body.compose(right_cam_info_.body_Pose_cam_));
+    static utils::StatsCollector render_timing("Synthetic Render Timing [ms]");
+    render_timing.AddSample(utils::Timer::toc(tic).count());
+
+    VLOG(10) << "Call VIO processing for frame k: " << k
+             << " with timestamp: " << timestamp_frame_k;
+    vio_callback_(StereoImuSyncPacket(
+        StereoFrame(k, timestamp_frame_k, left_img, left_cam_info_, right_img,
+                    right_cam_info_, camL_Pose_camR_, stereo_matching_params),
+        imu_meas.timestamps_, imu_meas.measurements_));
+    VLOG(10) << "Finished VIO processing for frame k = " << k;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+cv::Mat SyntheticDataProvider::renderImage(
+    const CameraParams& cam_params, const gtsam::Pose3& world_Pose_cam) const {
+  const double fx = cam_params.intrinsics_.at(0);
+  const double fy = cam_params.intrinsics_.at(1);
+  const double cx = cam_params.intrinsics_.at(2);
+  const double cy = cam_params.intrinsics_.at(3);
+  const gtsam::Matrix3 R = world_Pose_cam.rotation().matrix();
+  const gtsam::Vector3 origin = world_Pose_cam.translation().vector();
+
+  cv::Mat img(cam_params.image_size_, CV_8UC1);
+  for (int v = 0; v < img.rows; v++) {
+    uint8_t* row = img.ptr<uint8_t>(v);
+    // Ray direction in world frame, incrementally along the row.
+    const gtsam::Vector3 row_start =
+        R.col(2) + R.col(1) * ((v - cy) / fy) - R.col(0) * (cx / fx);
+    const gtsam::Vector3 step = R.col(0) / fx;
+    for (int u = 0; u < img.cols; u++) {
+      const gtsam::Vector3 ray = row_start + step * u;
+      // Closest wall of the room, seen from inside.
+      double min_distance = std::numeric_limits<double>::max();
+      int axis = 0;
+      for (int i = 0; i < 3; i++) {
+        if (ray(i) == 0.0) continue;
+        const double wall = ray(i) > 0.0 ? kRoomHalfExtents(i)
+                                         : -kRoomHalfExtents(i);
+        const double distance = (wall - origin(i)) / ray(i);
+        if (distance < min_distance) {
+          min_distance = distance;
+          axis = i;
+        }
+      }
+      row[u] = textureAt(origin + min_distance * ray,
+                         2 * axis + (ray(axis) > 0.0 ? 1 : 0));
+    }
+  }
+  // Smooth the texture edges, as real optics would, to help subpixel tracking.
+  cv::GaussianBlur(img, img, cv::Size(3, 3), 0.0);
+  return img;
+}
+
+/* -------------------------------------------------------------------------- */
+uint8_t SyntheticDataProvider::textureAt(const gtsam::Vector3& point,
+                                         const int& face) const {
+  // Coordinates along the wall.
+  const int axis = face / 2;
+  const double x = point((axis + 1) % 3);
+  const double y = point((axis + 2) % 3);
+  const int coarse = HashToIntensity(std::floor(x / kCoarseCellSize),
+                                     std::floor(y / kCoarseCellSize), face,
+                                     seed_);
+  const int fine = HashToIntensity(std::floor(x / kFineCellSize),
+                                   std::floor(y / kFineCellSize), face, seed_);
+  // Avoid saturation, in case of image equalization.
+  return static_cast<uint8_t>(30 + (3 * coarse + 2 * fine) / 5 * 195 / 255);
+}
+
+/* -------------------------------------------------------------------------- */
+VioNavState SyntheticDataProvider::getGroundTruthState(
+    const Timestamp& timestamp) const {
+  CHECK(!gt_data_.map_to_gt_.empty());
+  auto it = gt_data_.map_to_gt_.lower_bound(timestamp);
+  if (it == gt_data_.map_to_gt_.end()) --it;
+  const double t = timestamp * 1e-9;
+  return VioNavState(trajectory_.pose(t), trajectory_.velocity(t),
+                     it->second.imu_bias_);
+}
+
+/* -------------------------------------------------------------------------- */
+void SyntheticDataProvider::generateCameraParams() {
+  CHECK_GT(FLAGS_synthetic_image_width, 0);
+  CHECK_GT(FLAGS_synthetic_image_height, 0);
+  CHECK_GT(FLAGS_synthetic_baseline, 0.0);
+  // Same field of view as EuRoC, at any resolution.
+  const double focal_length = 0.61 * FLAGS_synthetic_image_width;
+  CameraParams cam_params;
+  cam_params.intrinsics_ = {focal_length, focal_length,
+                            0.5 * FLAGS_synthetic_image_width,
+                            0.5 * FLAGS_synthetic_image_height};
+  cam_params.image_size_ =
+      cv::Size(FLAGS_synthetic_image_width, FLAGS_synthetic_image_height);
+  cam_params.frame_rate_ = camera_period_ * 1e-9;
+  cam_params.camera_matrix_ = cv::Mat::eye(3, 3, CV_64F);
+  cam_params.camera_matrix_.at<double>(0, 0) = cam_params.intrinsics_[0];
+  cam_params.camera_matrix_.at<double>(1, 1) = cam_params.intrinsics_[1];
+  cam_params.camera_matrix_.at<double>(0, 2) = cam_params.intrinsics_[2];
+  cam_params.camera_matrix_.at<double>(1, 2) = cam_params.intrinsics_[3];
+  // Perfect pinhole.
+  cam_params.distortion_model_ = "radtan";
+  cam_params.distortion_coeff_ = cv::Mat::zeros(1, 5, CV_64F);
+  cam_params.calibration_ = gtsam::Cal3DS2(
+      cam_params.intrinsics_[0], cam_params.intrinsics_[1], 0.0,
+      cam_params.intrinsics_[2], cam_params.intrinsics_[3], 0.0, 0.0, 0.0, 0.0);
+
+  // The cameras look along the body x axis, with the IMU as body frame.
+  const gtsam::Rot3 body_R_cam(0.0, 0.0, 1.0,
+                               -1.0, 0.0, 0.0,
+                               0.0, -1.0, 0.0);
+  const double half_baseline = 0.5 * FLAGS_synthetic_baseline;
+  left_cam_info_ = cam_params;
+  left_cam_info_.body_Pose_cam_ =
+      gtsam::Pose3(body_R_cam, gtsam::Point3(0.0, half_baseline, 0.0));
+  right_cam_info_ = cam_params;
+  right_cam_info_.body_Pose_cam_ =
+      gtsam::Pose3(body_R_cam, gtsam::Point3(0.0, -half_baseline, 0.0));
+  camL_Pose_camR_ =
+      left_cam_info_.body_Pose_cam_.between(right_cam_info_.body_Pose_cam_);
+  gt_data_.body_Pose_cam_ = gtsam::Pose3();
+}
+
+/* -------------------------------------------------------------------------- */
+void SyntheticDataProvider::generateImuData() {
+  const ImuParams& imu_params = pipeline_params_.imu_params_;
+  const double dt = imu_period_ * 1e-9;
+  std::normal_distribution<double> normal(0.0, 1.0);
+  auto gaussian = [&normal, this](const double& sigma) {
+    return gtsam::Vector3(sigma * normal(random_engine_),
+                          sigma * normal(random_engine_),
+                          sigma * normal(random_engine_));
+  };
+
+  // Beyond the last frame, to interpolate at its timestamp.
+  const Timestamp last_timestamp = timestampAtFrame(final_k_) + imu_period_;
+  gtsam::Vector3 acc_bias = gtsam::Vector3::Zero();
+  gtsam::Vector3 gyro_bias = gtsam::Vector3::Zero();
+  for (Timestamp timestamp = kInitialTimestamp; timestamp <= last_timestamp;
+       timestamp += imu_period_) {
+    const double t = timestamp * 1e-9;
+    const gtsam::Pose3 world_Pose_body = trajectory_.pose(t);
+    const ImuBias imu_bias(acc_bias, gyro_bias);
+    gt_data_.map_to_gt_[timestamp] =
+        VioNavState(world_Pose_body, trajectory_.velocity(t), imu_bias);
+
+    // Specific force and angular velocity in body frame.
+    gtsam::Vector3 acc =
+        world_Pose_body.rotation().matrix().transpose() *
+        (trajectory_.acceleration(t) - imu_params.n_gravity_);
+    gtsam::Vector3 gyro = trajectory_.angularVelocity(t);
+    if (FLAGS_synthetic_imu_noise) {
+      // Discrete-time noise from the continuous-time densities.
+      acc += acc_bias + gaussian(imu_params.acc_noise_ / std::sqrt(dt));
+      gyro += gyro_bias + gaussian(imu_params.gyro_noise_ / std::sqrt(dt));
+      acc_bias += gaussian(imu_params.acc_walk_ * std::sqrt(dt));
+      gyro_bias += gaussian(imu_params.gyro_walk_ * std::sqrt(dt));
+    }
+    ImuAccGyr imu_accgyr;
+    imu_accgyr << acc, gyro;
+    imu_data_.imu_buffer_.addMeasurement(timestamp, imu_accgyr);
+  }
+  gt_data_.gt_rate_ = dt;
+  LOG(INFO) << "Generated " << gt_data_.map_to_gt_.size()
+            << " synthetic IMU measurements.";
+}
+
+}  // namespace VIO
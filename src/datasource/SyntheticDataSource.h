@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SyntheticDataSource.h
+ * @brief  Synthetic stereo + IMU dataset, rendered on the fly: for reproducible
+ *         runs at any resolution and rate, without downloading a dataset.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <random>
+
+#include <opencv2/core/core.hpp>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "CameraParams.h"
+#include "StereoImuSyncPacket.h"
+#include "datasource/DataSource-definitions.h"
+#include "datasource/DataSource.h"
+#include "imu-frontend/ImuFrontEnd.h"
+
+namespace VIO {
+
+/*
+ * Smooth body trajectory inside the synthetic room: a circle with vertical,
+ * roll and pitch oscillations, while yawing to look outwards.
+ * All derivatives are analytic, so that the IMU is exact up to the noise.
+ */
+class SyntheticTrajectory {
+ public:
+  SyntheticTrajectory(const double& radius, const double& angular_velocity);
+
+  // World_Pose_body at time t [s].
+  gtsam::Pose3 pose(const double& t) const;
+  // Velocity of the body in world frame.
+  gtsam::Vector3 velocity(const double& t) const;
+  // Acceleration of the body in world frame.
+  gtsam::Vector3 acceleration(const double& t) const;
+  // Angular velocity of the body in body frame (what a gyro measures).
+  gtsam::Vector3 angularVelocity(const double& t) const;
+
+ private:
+  // Roll, pitch and yaw angles (ZYX convention), and their derivatives.
+  gtsam::Vector3 angles(const double& t) const;
+  gtsam::Vector3 anglesRate(const double& t) const;
+
+ private:
+  const double radius_;
+  const double angular_velocity_;
+};
+
+/*
+ * Renders a stereo camera moving inside a room with procedurally textured
+ * walls, and simulates the IMU along the same trajectory, with the noise
+ * and bias random walk given by the IMU parameters.
+ * Everything is seeded, so two runs with the same flags are identical.
+ */
+class SyntheticDataProvider : public DataProvider {
+ public:
+  SyntheticDataProvider();
+  virtual ~SyntheticDataProvider();
+
+  bool spin() override;
+
+  // Renders the image seen by a camera at world_Pose_cam.
+  cv::Mat renderImage(const CameraParams& cam_params,
+                      const gtsam::Pose3& world_Pose_cam) const;
+
+  // Retrieve absolute state at timestamp (pose and velocity are exact,
+  // the bias is the one of the closest IMU sample).
+  VioNavState getGroundTruthState(const Timestamp& timestamp) const;
+
+  inline Timestamp timestampAtFrame(const FrameId& frame_number) const {
+    return kInitialTimestamp + frame_number * camera_period_;
+  }
+  inline const CameraParams& getLeftCamInfo() const { return left_cam_info_; }
+  inline const CameraParams& getRightCamInfo() const {
+    return right_cam_info_;
+  }
+  inline const gtsam::Pose3& getCamLPoseCamR() const { return camL_Pose_camR_; }
+
+ public:
+  // Ground truth data, at IMU rate.
+  GroundTruthData gt_data_;
+
+  // IMU data.
+  ImuData imu_data_;
+
+ private:
+  void generateCameraParams();
+  void generateImuData();
+
+  // Texture at a 3D point on the given face of the room: 2 * normal axis,
+  // plus one for the wall on the positive side.
+  uint8_t textureAt(const gtsam::Vector3& point, const int& face) const;
+
+ private:
+  // Avoids timestamps close to zero, which are special for some modules.
+  static constexpr Timestamp kInitialTimestamp = 1000000000;
+
+  const SyntheticTrajectory trajectory_;
+  const Timestamp camera_period_;
+  const Timestamp imu_period_;
+
+  CameraParams left_cam_info_;
+  CameraParams right_cam_info_;
+  gtsam::Pose3 camL_Pose_camR_;
+
+  // Seeds both the texture and the IMU noise.
+  const int seed_;
+  std::mt19937 random_engine_;
+};
+
+}  // namespace VIO
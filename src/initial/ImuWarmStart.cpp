@@ -0,0 +1,146 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImuWarmStart.cpp
+ * @brief  Persist IMU bias and gravity estimates of a run, to warm-start the
+ * next one.
+ * @author Antoni Rosinol
+ */
+
+#include "initial/ImuWarmStart.h"
+
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <opencv2/core/core.hpp>
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+void ImuWarmStartState::print() const {
+  LOG(INFO) << "IMU warm start state:\n"
+            << " - IMU bias: " << imu_bias_ << '\n'
+            << " - Gravity: " << n_gravity_.transpose() << '\n'
+            << " - IMU bias sigmas: "
+            << imu_bias_covariance_.diagonal().cwiseSqrt().transpose() << '\n'
+            << " - Cold start convergence time [s]: "
+            << cold_start_convergence_time_;
+}
+
+/* -------------------------------------------------------------------------- */
+bool saveImuWarmStartState(const ImuWarmStartState& state,
+                           const std::string& filename) {
+  cv::FileStorage fs(filename, cv::FileStorage::WRITE);
+  if (!fs.isOpened()) {
+    LOG(ERROR) << "Cannot open IMU warm start file: " << filename;
+    return false;
+  }
+  CHECK_EQ(state.imu_bias_covariance_.rows(), 6);
+  CHECK_EQ(state.imu_bias_covariance_.cols(), 6);
+  const Vector6 imu_bias = state.imu_bias_.vector();
+  fs << "imu_bias" << std::vector<double>(imu_bias.data(), imu_bias.data() + 6);
+  fs << "n_gravity"
+     << std::vector<double>(state.n_gravity_.data(),
+                            state.n_gravity_.data() + 3);
+  // Eigen is column-major, the covariance is symmetric anyway.
+  fs << "imu_bias_covariance"
+     << std::vector<double>(state.imu_bias_covariance_.data(),
+                            state.imu_bias_covariance_.data() + 36);
+  fs << "cold_start_convergence_time" << state.cold_start_convergence_time_;
+  fs.release();
+  VLOG(1) << "Saved IMU warm start state to: " << filename;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+bool loadImuWarmStartState(const std::string& filename,
+                           ImuWarmStartState* state) {
+  CHECK_NOTNULL(state);
+  cv::FileStorage fs;
+  try {
+    fs.open(filename, cv::FileStorage::READ);
+  } catch (const cv::Exception& e) {
+    LOG(ERROR) << "Cannot parse IMU warm start file " << filename << ": "
+               << e.what();
+    return false;
+  }
+  if (!fs.isOpened()) {
+    LOG(ERROR) << "Cannot open IMU warm start file: " << filename;
+    return false;
+  }
+
+  std::vector<double> imu_bias, n_gravity, imu_bias_covariance;
+  fs["imu_bias"] >> imu_bias;
+  fs["n_gravity"] >> n_gravity;
+  fs["imu_bias_covariance"] >> imu_bias_covariance;
+  if (imu_bias.size() != 6u || n_gravity.size() != 3u ||
+      imu_bias_covariance.size() != 36u) {
+    LOG(ERROR) << "Invalid IMU warm start file: " << filename;
+    return false;
+  }
+  const Vector6 bias = Eigen::Map<const Vector6>(imu_bias.data());
+  state->imu_bias_ = ImuBias(bias.head<3>(), bias.tail<3>());
+  state->n_gravity_ = Eigen::Map<const Vector3>(n_gravity.data());
+  state->imu_bias_covariance_ =
+      Eigen::Map<const gtsam::Matrix>(imu_bias_covariance.data(), 6, 6);
+  state->cold_start_convergence_time_ = -1.0;
+  if (!fs["cold_start_convergence_time"].empty()) {
+    fs["cold_start_convergence_time"] >> state->cold_start_convergence_time_;
+  }
+  LOG(INFO) << "Loaded IMU warm start state from: " << filename;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+ImuBiasConvergenceMonitor::ImuBiasConvergenceMonitor(
+    const double& max_bias_rate,
+    const size_t& n_keyframes)
+    : max_bias_rate_(max_bias_rate), n_keyframes_(n_keyframes) {
+  CHECK_GT(max_bias_rate_, 0.0);
+  CHECK_GT(n_keyframes_, 0u);
+}
+
+/* -------------------------------------------------------------------------- */
+bool ImuBiasConvergenceMonitor::update(const Timestamp& timestamp,
+                                       const ImuBias& imu_bias) {
+  if (is_converged_) return false;
+  if (n_updates_++ == 0u) {
+    first_timestamp_ = timestamp;
+  } else if (timestamp > last_timestamp_) {
+    const double dt = 1e-9 * static_cast<double>(timestamp - last_timestamp_);
+    const double bias_rate =
+        (imu_bias.vector() - last_imu_bias_.vector()).norm() / dt;
+    n_steady_keyframes_ = bias_rate < max_bias_rate_ ? n_steady_keyframes_ + 1u
+                                                     : 0u;
+  }
+  last_timestamp_ = timestamp;
+  last_imu_bias_ = imu_bias;
+
+  if (n_steady_keyframes_ >= n_keyframes_) {
+    is_converged_ = true;
+    convergence_time_ =
+        1e-9 * static_cast<double>(timestamp - first_timestamp_);
+    return true;
+  }
+  return false;
+}
+
+/* -------------------------------------------------------------------------- */
+void ImuBiasConvergenceMonitor::reset() {
+  first_timestamp_ = 0;
+  last_timestamp_ = 0;
+  last_imu_bias_ = ImuBias();
+  n_updates_ = 0u;
+  n_steady_keyframes_ = 0u;
+  is_converged_ = false;
+  convergence_time_ = -1.0;
+}
+
+}  // namespace VIO
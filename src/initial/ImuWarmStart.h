@@ -0,0 +1,84 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImuWarmStart.h
+ * @brief  Persist IMU bias and gravity estimates of a run, to warm-start the
+ * next one.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include <gtsam/base/Matrix.h>
+
+#include "common/vio_types.h"
+#include "imu-frontend/ImuFrontEnd-definitions.h"
+
+namespace VIO {
+
+// IMU calibration estimated at the end of a run.
+struct ImuWarmStartState {
+  ImuBias imu_bias_;
+  // Gravity in the world frame, as estimated at initialization.
+  Vector3 n_gravity_ = Vector3::Zero();
+  // Marginal covariance of the IMU bias, same order as ImuBias::vector():
+  // accelerometer first, then gyroscope. Zero if it was not computed.
+  gtsam::Matrix imu_bias_covariance_ = gtsam::Matrix::Zero(6, 6);
+  // Time it took for the bias to converge in the cold-started run this state
+  // comes from [s], negative if unknown.
+  double cold_start_convergence_time_ = -1.0;
+
+  void print() const;
+};
+
+// Writes the warm start state as a small YAML file.
+// Returns false if the file could not be written.
+bool saveImuWarmStartState(const ImuWarmStartState& state,
+                           const std::string& filename);
+
+// Reads a state written by saveImuWarmStartState.
+// Returns false if the file does not exist or is not valid.
+bool loadImuWarmStartState(const std::string& filename,
+                           ImuWarmStartState* state);
+
+// Detects when the IMU bias estimated by the backend has converged: the bias
+// rate of change between consecutive keyframes has to stay below
+// max_bias_rate for n_keyframes keyframes in a row.
+class ImuBiasConvergenceMonitor {
+ public:
+  ImuBiasConvergenceMonitor(const double& max_bias_rate,
+                            const size_t& n_keyframes);
+  ~ImuBiasConvergenceMonitor() = default;
+
+  // Returns true only at the keyframe where convergence is detected.
+  bool update(const Timestamp& timestamp, const ImuBias& imu_bias);
+
+  void reset();
+
+  inline bool isConverged() const { return is_converged_; }
+
+  // Time since the first update until convergence [s].
+  inline double getConvergenceTime() const { return convergence_time_; }
+
+ private:
+  const double max_bias_rate_;
+  const size_t n_keyframes_;
+
+  Timestamp first_timestamp_ = 0;
+  Timestamp last_timestamp_ = 0;
+  ImuBias last_imu_bias_;
+  size_t n_updates_ = 0u;
+  size_t n_steady_keyframes_ = 0u;
+  bool is_converged_ = false;
+  double convergence_time_ = -1.0;
+};
+
+}  // namespace VIO
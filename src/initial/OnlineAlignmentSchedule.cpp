@@ -0,0 +1,62 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   OnlineAlignmentSchedule.cpp
+ * @brief  Sliding window and retries of the online gravity alignment.
+ * @author Antoni Rosinol
+ */
+
+#include "initial/OnlineAlignmentSchedule.h"
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+OnlineAlignmentSchedule::OnlineAlignmentSchedule(const size_t& window_size,
+                                                 const size_t& retry_interval)
+    : window_size_(window_size), retry_interval_(retry_interval) {
+  CHECK_GT(window_size_, 0u);
+  CHECK_GT(retry_interval_, 0u);
+}
+
+/* -------------------------------------------------------------------------- */
+void OnlineAlignmentSchedule::addFrame() {
+  ++nr_frames_;
+  ++nr_new_frames_;
+}
+
+/* -------------------------------------------------------------------------- */
+size_t OnlineAlignmentSchedule::slide() {
+  if (nr_frames_ <= window_size_) return 0u;
+  const size_t nr_dropped = nr_frames_ - window_size_;
+  nr_frames_ = window_size_;
+  return nr_dropped;
+}
+
+/* -------------------------------------------------------------------------- */
+bool OnlineAlignmentSchedule::shouldLaunch() const {
+  if (nr_frames_ < window_size_) return false;
+  return nr_attempts_ == 0u || nr_new_frames_ >= retry_interval_;
+}
+
+/* -------------------------------------------------------------------------- */
+void OnlineAlignmentSchedule::launch() {
+  ++nr_attempts_;
+  nr_new_frames_ = 0u;
+}
+
+/* -------------------------------------------------------------------------- */
+void OnlineAlignmentSchedule::reset() {
+  nr_frames_ = 0u;
+  nr_attempts_ = 0u;
+  nr_new_frames_ = 0u;
+}
+
+}  // namespace VIO
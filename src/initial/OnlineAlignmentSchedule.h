@@ -0,0 +1,61 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   OnlineAlignmentSchedule.h
+ * @brief  Sliding window and retries of the online gravity alignment.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace VIO {
+
+// Schedules the bundle adjustment and gravity alignment of the online
+// initialization over a sliding window of the last window_size frames.
+// The first attempt is made as soon as the window is full; after a failure,
+// the next one only once retry_interval new frames are in the window.
+// Only counts frames: the caller owns the window itself.
+class OnlineAlignmentSchedule {
+ public:
+  OnlineAlignmentSchedule(const size_t& window_size,
+                          const size_t& retry_interval);
+  ~OnlineAlignmentSchedule() = default;
+
+  // A new frame has been pushed at the back of the window.
+  void addFrame();
+
+  // Number of oldest frames to pop from the front of the window, so that it
+  // holds the last window_size frames. Only call it while no alignment is
+  // running, as it works on its own copy of the window.
+  size_t slide();
+
+  // Whether to launch an alignment on the current window.
+  bool shouldLaunch() const;
+
+  // An alignment has been launched on the current window.
+  void launch();
+
+  void reset();
+
+  inline size_t nrFrames() const { return nr_frames_; }
+  inline size_t nrAttempts() const { return nr_attempts_; }
+
+ private:
+  const size_t window_size_;
+  const size_t retry_interval_;
+
+  size_t nr_frames_ = 0u;
+  size_t nr_attempts_ = 0u;
+  // Frames added since the last launch.
+  size_t nr_new_frames_ = 0u;
+};
+
+}  // namespace VIO
@@ -67,6 +67,10 @@ DEFINE_double(gravity_tolerance_refinement,
 DEFINE_double(camera_pim_delta_difference,
               5e-3,
               "Maximum tolerable difference in time interval.");
+DEFINE_bool(use_incremental_gravity_alignment,
+            true,
+            "Use the incremental normal equations solver for the linear"
+            " gyroscope bias and gravity alignment (not with AHRS).");
 
 namespace VIO {
 
@@ -116,6 +120,19 @@ bool OnlineGravityAlignment::alignVisualInertialEstimates(
   CHECK_NOTNULL(gyro_bias);
   CHECK_NOTNULL(g_iter);
   VLOG(10) << "Online gravity alignment called.";
+  if (FLAGS_use_incremental_gravity_alignment && !FLAGS_use_ahrs_estimator) {
+    CHECK_EQ(estimated_body_poses_.size() - 1, delta_t_camera_.size());
+    CHECK_EQ(delta_t_camera_.size(), pims_.size());
+    IncrementalGravityAlignment incremental_alignment(g_world_, pims_.size());
+    for (size_t i = 0; i < pims_.size(); i++) {
+      incremental_alignment.addFrame(estimated_body_poses_.at(i),
+                                     estimated_body_poses_.at(i + 1),
+                                     delta_t_camera_.at(i),
+                                     pims_.at(i));
+    }
+    return incremental_alignment.alignVisualInertialEstimates(
+        gyro_bias, g_iter, init_navstate, estimate_bias);
+  }
   VisualInertialFrames vi_frames;
   gtsam::Velocity3 init_velocity;
 
@@ -616,4 +633,284 @@ bool OnlineGravityAlignment::estimateGyroscopeBiasOnly(
   return true;
 }
 
+/* -------------------------------------------------------------------------- */
+// Constructor for incremental visual inertial alignment.
+// [in] global gravity vector in world frame.
+// [in] expected number of frames, to preallocate the normal equations.
+IncrementalGravityAlignment::IncrementalGravityAlignment(
+    const gtsam::Vector3 &g_world,
+    const size_t &expected_nr_frames)
+    : g_world_(g_world) {
+  velocities_.reserve(expected_nr_frames + 1u);
+  edges_.reserve(expected_nr_frames);
+  elim_H_.reserve(expected_nr_frames + 1u);
+  elim_b_.reserve(expected_nr_frames + 1u);
+  elim_G_.reserve(expected_nr_frames + 1u);
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalGravityAlignment::reset() {
+  velocities_.clear();
+  edges_.clear();
+  H_gg_.setZero();
+  b_g_.setZero();
+  B_g_.setZero();
+  H_bg_.setZero();
+  b_bg_.setZero();
+  sum_dR_.setZero();
+  sum_J_dR_.setZero();
+}
+
+/* -------------------------------------------------------------------------- */
+// Adds the residuals of one frame to the normal equations.
+// The residuals are the same as in VisualInertialFrame (A11..A23, b1, b2),
+// where b1 and b2 are affine in the gyroscope bias:
+//   b1(bg) = b1 + J_alpha * bg, b2(bg) = b2 + J_beta * bg.
+// [in] body poses from Bundle-Adjustment at k and k+1.
+// [in] delta_t between camera frames k and k+1.
+// [in] pre-integration between k and k+1 (at zero bias).
+void IncrementalGravityAlignment::addFrame(
+    const gtsam::Pose3 &b0_T_bk,
+    const gtsam::Pose3 &b0_T_bkp1,
+    const double &delta_t_camera,
+    const gtsam::PreintegratedImuMeasurements &pim) {
+  if (velocities_.empty()) {
+    b0_T_bfirst_ = b0_T_bk;
+    velocities_.push_back(VelocityBlock());
+  } else {
+    CHECK(b0_T_blast_.equals(b0_T_bk)) << "Frames must be consecutive.";
+  }
+  b0_T_blast_ = b0_T_bkp1;
+
+  // Pre-integrated delta state and its jacobians wrt. gyro_bias.
+  // pim.deltaXij() corresponds to bodyLkf_X_bodyK_imu
+  const gtsam::NavState delta_state(pim.deltaXij());
+  const double delta_t_pim = pim.deltaTij();
+#ifdef GTSAM_TANGENT_PREINTEGRATION
+  const gtsam::Matrix dbg_J_dPIM = pim.preintegrated_H_biasOmega();
+  const gtsam::Matrix3 dbg_J_dR = dbg_J_dPIM.block<3, 3>(0, 0);
+  const gtsam::Matrix3 dbg_J_dP = dbg_J_dPIM.block<3, 3>(3, 0);
+  const gtsam::Matrix3 dbg_J_dV = dbg_J_dPIM.block<3, 3>(6, 0);
+#else
+  const gtsam::Matrix3 dbg_J_dR = pim.delRdelBiasOmega();
+  const gtsam::Matrix3 dbg_J_dP = pim.delPdelBiasOmega();
+  const gtsam::Matrix3 dbg_J_dV = pim.delVdelBiasOmega();
+#endif
+  CHECK_GT(FLAGS_camera_pim_delta_difference,
+           std::abs(delta_t_pim - delta_t_camera));
+
+  const gtsam::Matrix3 bk_R_b0 = b0_T_bk.rotation().matrix().transpose();
+  const gtsam::Matrix3 b0_R_bkp1 = b0_T_bkp1.rotation().matrix();
+
+  ///////////////////////////// GYRO BIAS //////////////////////////////////////
+  // Rotation error between pre-integrated and visual estimates (dR_bkp1).
+  const gtsam::Vector3 dR = gtsam::Rot3::Logmap(gtsam::Rot3(
+      delta_state.pose().rotation().matrix().transpose() * bk_R_b0 *
+      b0_R_bkp1));
+  H_bg_.noalias() += dbg_J_dR.transpose() * dbg_J_dR;
+  b_bg_.noalias() += dbg_J_dR.transpose() * dR;
+  sum_dR_ += dR;
+  sum_J_dR_ += dbg_J_dR;
+
+  ///////////////////////////// VELOCITIES AND GRAVITY /////////////////////////
+  // TODO(Toni): remove hardcoded, same as in VisualInertialFrame.
+  const double dt_bk = 0.5 * (delta_t_camera + delta_t_pim);
+  const gtsam::Matrix3 A11 = -dt_bk * bk_R_b0;
+  const gtsam::Matrix3 A13 = 0.5 * dt_bk * dt_bk * bk_R_b0;
+  const gtsam::Matrix3 A21 = -bk_R_b0;
+  const gtsam::Matrix3 A22 = bk_R_b0;
+  const gtsam::Matrix3 A23 = dt_bk * bk_R_b0;
+  const gtsam::Vector3 b1 =
+      gtsam::Vector3(delta_state.pose().translation()) -
+      bk_R_b0 * (b0_T_bkp1.translation() - b0_T_bk.translation());
+  const gtsam::Vector3 b2 = delta_state.velocity();
+
+  VelocityBlock &v_k = velocities_.back();
+  v_k.H_vv.noalias() += A11.transpose() * A11 + A21.transpose() * A21;
+  v_k.H_vg.noalias() += A11.transpose() * A13 + A21.transpose() * A23;
+  v_k.b_v.noalias() += A11.transpose() * b1 + A21.transpose() * b2;
+  v_k.B_v.noalias() +=
+      A11.transpose() * dbg_J_dP + A21.transpose() * dbg_J_dV;
+
+  VelocityBlock v_kp1;
+  v_kp1.H_vv.noalias() = A22.transpose() * A22;
+  v_kp1.H_vg.noalias() = A22.transpose() * A23;
+  v_kp1.b_v.noalias() = A22.transpose() * b2;
+  v_kp1.B_v.noalias() = A22.transpose() * dbg_J_dV;
+  velocities_.push_back(v_kp1);
+  edges_.push_back(A21.transpose() * A22);
+
+  H_gg_.noalias() += A13.transpose() * A13 + A23.transpose() * A23;
+  b_g_.noalias() += A13.transpose() * b1 + A23.transpose() * b2;
+  B_g_.noalias() += A13.transpose() * dbg_J_dP + A23.transpose() * dbg_J_dV;
+}
+
+/* -------------------------------------------------------------------------- */
+// Performs visual-inertial alignment and gravity estimate.
+// [out] initial gyro bias estimate.
+// [out] estimate of gravity vector in initial body pose (g_b0).
+// [out] initial nav state for initialization.
+// [optional] flag to estimate gyroscope bias.
+bool IncrementalGravityAlignment::alignVisualInertialEstimates(
+    gtsam::Vector3 *gyro_bias,
+    gtsam::Vector3 *g_iter,
+    gtsam::NavState *init_navstate,
+    const bool &estimate_bias) {
+  CHECK_NOTNULL(gyro_bias);
+  CHECK_NOTNULL(g_iter);
+  CHECK_NOTNULL(init_navstate);
+  CHECK_GT(size(), 0u);
+  VLOG(10) << "Incremental gravity alignment called with " << size()
+           << " frames.";
+
+  // Estimate gyroscope bias if requested
+  if (estimate_bias) {
+    if (!estimateGyroscopeBias(gyro_bias)) {
+      LOG(ERROR) << "Gyroscope bias estimation failed!";
+      return false;
+    }
+  } else {
+    LOG(WARNING) << "Gyroscope bias estimation skipped!";
+  }
+
+  // Align visual and inertial estimates
+  gtsam::Vector3 g_b0;
+  gtsam::Velocity3 init_velocity;
+  alignEstimatesLinearly(*gyro_bias, &g_b0, &init_velocity);
+
+  // We want the gravity vector and not the measured acceleration
+  // by the IMU, hence multiply estimated value by -1.
+  *g_iter = -g_b0;
+  VLOG(5) << "Final gravity estimate:\n"
+          << *g_iter << " with norm: " << g_iter->norm();
+  if (std::abs(g_iter->norm() - g_world_.norm()) >
+      FLAGS_gravity_tolerance_refinement) {
+    LOG(ERROR) << "Online gravity alignment failed!";
+    return false;
+  }
+
+  // Align gravity vectors and estimate initial pose
+  gtsam::Rot3 w0_R_b0 =
+      UtilsOpenCV::AlignGravityVectors(*g_iter, g_world_, false);
+  gtsam::Pose3 w0_T_b0(w0_R_b0, gtsam::Point3());
+  // Create initial navstate and rotate velocity in world frame
+  *init_navstate = gtsam::NavState(w0_T_b0 * b0_T_bfirst_,
+                                   w0_T_b0.rotation() * init_velocity);
+  LOG(INFO) << "Online gravity alignment successful with:\n"
+            << "pose: " << init_navstate->pose() << '\n'
+            << "velocity: " << init_navstate->velocity() << '\n'
+            << "gravity: " << *g_iter << '\n'
+            << "with norm: " << g_iter->norm() << '\n'
+            << "gyroscope bias: " << *gyro_bias << '\n';
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+// Closed-form solution of the linear gyroscope bias estimator.
+// [out] new estimated value for gyroscope bias (has to be zero as input).
+bool IncrementalGravityAlignment::estimateGyroscopeBias(
+    gtsam::Vector3 *gyro_bias) const {
+  CHECK_NOTNULL(gyro_bias);
+  if (gyro_bias->norm() != 0.0) {
+    LOG(ERROR) << "Non-zero PIM gyro bias:\n" << *gyro_bias;
+    return false;
+  }
+  const Eigen::LDLT<gtsam::Matrix3> H_bg_ldlt(H_bg_);
+  if (H_bg_ldlt.info() != Eigen::Success) {
+    LOG(ERROR) << "Degenerate gyroscope bias normal equations.";
+    return false;
+  }
+  const gtsam::Vector3 delta_bg = H_bg_ldlt.solve(b_bg_);
+  *gyro_bias += delta_bg;
+  VLOG(5) << "Gyro bias estimation:\n" << delta_bg;
+
+  // Residuals after bias update, to first order.
+  const gtsam::Vector3 residuals = sum_dR_ - sum_J_dR_ * delta_bg;
+  VLOG(5) << "Residuals after bias correction: \n" << residuals;
+  if (residuals.norm() > FLAGS_gyroscope_residuals) {
+    LOG(ERROR) << "High residuals after bias update.";
+    return false;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+// Solves the normal equations [H_vv H_vg; H_vg' H_gg] [V; g] = [b_v; b_g],
+// with H_vv block-tridiagonal, by block forward elimination and back
+// substitution of [b_v, H_vg], followed by the Schur complement on g.
+// If the norm of g is off, g is refined on the tangent space of the
+// normalized g as in OnlineGravityAlignment::refineGravity, which only
+// requires the (3x3) Schur complement.
+// [in] gyroscope bias to correct the delta states with.
+// [out] gravity vector expressed in initial body frame.
+// [out] initial velocity expressed in initial body frame.
+void IncrementalGravityAlignment::alignEstimatesLinearly(
+    const gtsam::Vector3 &gyro_bias,
+    gtsam::Vector3 *g_b0,
+    gtsam::Velocity3 *init_vel) {
+  CHECK_NOTNULL(g_b0);
+  CHECK_NOTNULL(init_vel);
+  const size_t n_vel = velocities_.size();
+  CHECK_EQ(n_vel, edges_.size() + 1u);
+  elim_H_.resize(n_vel);
+  elim_b_.resize(n_vel);
+  elim_G_.resize(n_vel);
+
+  // Forward elimination.
+  for (size_t k = 0; k < n_vel; k++) {
+    const VelocityBlock &v_k = velocities_[k];
+    elim_H_[k] = v_k.H_vv;
+    elim_b_[k] = v_k.b_v + v_k.B_v * gyro_bias;
+    elim_G_[k] = v_k.H_vg;
+    if (k > 0u) {
+      // L = E' * H_km1^-1, with E the V_km1, V_k block.
+      const gtsam::Matrix3 L =
+          elim_H_[k - 1].ldlt().solve(edges_[k - 1]).transpose();
+      elim_H_[k].noalias() -= L * edges_[k - 1];
+      elim_b_[k].noalias() -= L * elim_b_[k - 1];
+      elim_G_[k].noalias() -= L * elim_G_[k - 1];
+    }
+  }
+
+  // Back substitution: elim_b_ and elim_G_ become H_vv^-1 * [b_v, H_vg].
+  for (size_t k = n_vel; k-- > 0u;) {
+    if (k + 1u < n_vel) {
+      elim_b_[k].noalias() -= edges_[k] * elim_b_[k + 1];
+      elim_G_[k].noalias() -= edges_[k] * elim_G_[k + 1];
+    }
+    const Eigen::LDLT<gtsam::Matrix3> H_k_ldlt(elim_H_[k]);
+    elim_b_[k] = H_k_ldlt.solve(elim_b_[k]);
+    elim_G_[k] = H_k_ldlt.solve(elim_G_[k]);
+  }
+
+  // Schur complement on gravity: S * g = s.
+  gtsam::Matrix3 S = H_gg_;
+  gtsam::Vector3 s = b_g_ + B_g_ * gyro_bias;
+  for (size_t k = 0; k < n_vel; k++) {
+    S.noalias() -= velocities_[k].H_vg.transpose() * elim_G_[k];
+    s.noalias() -= velocities_[k].H_vg.transpose() * elim_b_[k];
+  }
+  gtsam::Vector3 g = S.ldlt().solve(s);
+  *init_vel = elim_b_[0] - elim_G_[0] * g;
+
+  // Refine gravity alignment if necessary
+  if (std::abs(g.norm() - g_world_.norm()) > FLAGS_gravity_tolerance_linear) {
+    // Define current gravity estimate (normalized)
+    gtsam::Vector3 g0 = g.normalized() * g_world_.norm();
+    // Create tangent basis to g (g = g0 + txty*dxdy)
+    const Eigen::Matrix<double, 3, 2> txty =
+        OnlineGravityAlignment::createTangentBasis(g0);
+    const Eigen::Matrix2d S_tangent = txty.transpose() * S * txty;
+    for (int l = 0; l < FLAGS_num_iterations_gravity_refinement; l++) {
+      const Eigen::Vector2d dxdy =
+          S_tangent.ldlt().solve(txty.transpose() * (s - S * g0));
+      const gtsam::Vector3 g_refined = g0 + txty * dxdy;
+      *init_vel = elim_b_[0] - elim_G_[0] * g_refined;
+      g0 = g_refined.normalized() * g_world_.norm();
+    }
+    g = g0;
+  }
+  *g_b0 = g;
+}
+
 }  // namespace VIO
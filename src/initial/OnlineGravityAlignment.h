@@ -118,4 +118,94 @@ class OnlineGravityAlignment {
   const InitialAHRSPims ahrs_pims_;
 };
 
+// Linear alignment solver that accumulates the normal equations frame by
+// frame, instead of building dense systems over all frames at once:
+//  - gyroscope bias: 3x3 normal equations of the rotation errors.
+//  - velocities and gravity: block-tridiagonal (3N+3) system in the N+1
+//    velocities, coupled to gravity. Solved in O(N) by block elimination
+//    and a Schur complement on gravity.
+// Delta states are kept affine in the gyroscope bias (first order, same as
+// updateDeltaStates), so frames are never re-linearized and the alignment
+// can be re-attempted after every new frame.
+class IncrementalGravityAlignment {
+ public:
+  /* ------------------------------------------------------------------------ */
+  IncrementalGravityAlignment(const gtsam::Vector3 &g_world,
+                              const size_t &expected_nr_frames = 0u);
+
+  /* ------------------------------------------------------------------------ */
+  ~IncrementalGravityAlignment() = default;
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  // Adds the frame between consecutive body poses b0_T_bk and b0_T_bkp1
+  // (from Bundle-Adjustment), with the pre-integration between them.
+  void addFrame(const gtsam::Pose3 &b0_T_bk,
+                const gtsam::Pose3 &b0_T_bkp1,
+                const double &delta_t_camera,
+                const gtsam::PreintegratedImuMeasurements &pim);
+
+  /* ------------------------------------------------------------------------ */
+  // Drops all frames, keeps the allocated memory.
+  void reset();
+
+  /* ------------------------------------------------------------------------ */
+  inline size_t size() const { return edges_.size(); }
+
+  /* ------------------------------------------------------------------------ */
+  // Same as OnlineGravityAlignment::alignVisualInertialEstimates.
+  bool alignVisualInertialEstimates(gtsam::Vector3 *gyro_bias,
+                                    gtsam::Vector3 *g_iter,
+                                    gtsam::NavState *init_navstate,
+                                    const bool &estimate_bias = true);
+
+  /* ------------------------------------------------------------------------ */
+  // Closed-form gyroscope bias, with check on the linearized residuals.
+  bool estimateGyroscopeBias(gtsam::Vector3 *gyro_bias) const;
+
+ private:
+  /* ------------------------------------------------------------------------ */
+  // Solves the velocity/gravity normal equations for the given gyro bias.
+  // Returns the gravity in the initial body frame (refined if its norm is
+  // not the expected one) and the initial velocity.
+  void alignEstimatesLinearly(const gtsam::Vector3 &gyro_bias,
+                              gtsam::Vector3 *g_b0,
+                              gtsam::Velocity3 *init_vel);
+
+ private:
+  // Normal equation blocks of one velocity V_k.
+  struct VelocityBlock {
+    gtsam::Matrix3 H_vv = gtsam::Matrix3::Zero();  // V_k, V_k
+    gtsam::Matrix3 H_vg = gtsam::Matrix3::Zero();  // V_k, g
+    gtsam::Vector3 b_v = gtsam::Vector3::Zero();   // rhs at zero gyro bias
+    gtsam::Matrix3 B_v = gtsam::Matrix3::Zero();   // rhs jacobian wrt bias
+  };
+
+  const gtsam::Vector3 g_world_;
+
+  // Velocity/gravity normal equations.
+  // edges_[k] is the V_k, V_k+1 block.
+  std::vector<VelocityBlock> velocities_;
+  std::vector<gtsam::Matrix3> edges_;
+  gtsam::Matrix3 H_gg_ = gtsam::Matrix3::Zero();
+  gtsam::Vector3 b_g_ = gtsam::Vector3::Zero();
+  gtsam::Matrix3 B_g_ = gtsam::Matrix3::Zero();
+
+  // Gyroscope bias normal equations, and sums for the residual check.
+  gtsam::Matrix3 H_bg_ = gtsam::Matrix3::Zero();
+  gtsam::Vector3 b_bg_ = gtsam::Vector3::Zero();
+  gtsam::Vector3 sum_dR_ = gtsam::Vector3::Zero();
+  gtsam::Matrix3 sum_J_dR_ = gtsam::Matrix3::Zero();
+
+  // First and last body poses, for the initial state and to check that
+  // frames are consecutive.
+  gtsam::Pose3 b0_T_bfirst_;
+  gtsam::Pose3 b0_T_blast_;
+
+  // Block elimination buffers, preallocated with the frames.
+  std::vector<gtsam::Matrix3> elim_H_;
+  std::vector<gtsam::Vector3> elim_b_;
+  std::vector<gtsam::Matrix3> elim_G_;
+};
+
 }  // namespace VIO
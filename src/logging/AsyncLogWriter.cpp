@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AsyncLogWriter.cpp
+ * @brief  Asynchronous, batched logging of run outputs: producers enqueue
+ *         binary records, formatted and written by a background thread.
+ * @author Antoni Rosinol
+ */
+
+#include "logging/AsyncLogWriter.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_int32(async_log_flush_interval_ms, 200,
+             "Period at which the logged records are written to the output "
+             "files, in milliseconds.");
+DEFINE_int32(async_log_ring_size, 1024,
+             "Number of records each output file can buffer between two "
+             "writes (rounded up to a power of 2). Records logged when it is "
+             "full are dropped.");
+DEFINE_bool(log_output_binary, false,
+            "Write the output logs as binary run logs (.runlog) instead of "
+            "CSV, see scripts/plotting/run_log.py to read them.");
+DEFINE_int32(run_log_rows_per_chunk, 4096,
+             "Number of rows per chunk of the binary run logs.");
+DEFINE_bool(run_log_compression, true,
+            "Compress the chunks of the binary run logs with LZ4, if "
+            "SparkVio was built with LZ4.");
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+size_t asyncLogRingSize() {
+  CHECK_GT(FLAGS_async_log_ring_size, 0);
+  size_t ring_size = 1u;
+  while (ring_size < static_cast<size_t>(FLAGS_async_log_ring_size)) {
+    ring_size <<= 1u;
+  }
+  return ring_size;
+}
+
+/* -------------------------------------------------------------------------- */
+// Replaces the extension of the file by .runlog for binary run logs.
+static std::string logFilename(const std::string& filename) {
+  if (!FLAGS_log_output_binary) return filename;
+  return filename.substr(0u, filename.rfind('.')) + ".runlog";
+}
+
+AsyncLogSink::AsyncLogSink(const std::string& filename,
+                           const RunLogSchema& schema)
+    : filename_(logFilename(filename)), file_(filename_) {
+  if (FLAGS_log_output_binary) {
+    CHECK_GT(FLAGS_run_log_rows_per_chunk, 0);
+    // The stream is named after the file, without extension.
+    row_writer_ = VIO::make_unique<RunLogWriter>(
+        filename.substr(0u, filename.rfind('.')), schema, &file_.ofstream_,
+        FLAGS_run_log_rows_per_chunk, FLAGS_run_log_compression);
+  } else {
+    row_writer_ = VIO::make_unique<CsvRowWriter>(schema, &file_.ofstream_);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+AsyncLogWriter& AsyncLogWriter::Instance() {
+  static AsyncLogWriter instance;
+  return instance;
+}
+
+AsyncLogWriter::AsyncLogWriter() : thread_(&AsyncLogWriter::spin, this) {}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  shutdown_cond_.notify_one();
+  thread_.join();
+}
+
+void AsyncLogWriter::addSink(AsyncLogSink* sink) {
+  CHECK_NOTNULL(sink);
+  std::lock_guard<std::mutex> lock(mutex_);
+  sinks_.push_back(sink);
+}
+
+void AsyncLogWriter::removeSink(AsyncLogSink* sink) {
+  CHECK_NOTNULL(sink);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find(sinks_.begin(), sinks_.end(), sink);
+  CHECK(it != sinks_.end()) << "Log not registered: " << sink->filename();
+  sinks_.erase(it);
+  sink->drain();
+  sink->row_writer_->flush();
+  LOG_IF(WARNING, sink->nrDropped() > 0u)
+      << "Dropped " << sink->nrDropped() << " records of log "
+      << sink->filename()
+      << ", consider increasing --async_log_ring_size or decreasing "
+         "--async_log_flush_interval_ms.";
+}
+
+void AsyncLogWriter::flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  writeSinks(true);
+}
+
+void AsyncLogWriter::spin() {
+  const std::chrono::milliseconds flush_interval(
+      std::max(FLAGS_async_log_flush_interval_ms, 1));
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!shutdown_) {
+    shutdown_cond_.wait_for(lock, flush_interval);
+    writeSinks(false);
+  }
+}
+
+void AsyncLogWriter::writeSinks(bool flush_all) {
+  for (AsyncLogSink* sink : sinks_) {
+    sink->drain();
+    if (flush_all) {
+      sink->row_writer_->flush();
+    } else {
+      sink->row_writer_->writeBuffered();
+    }
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,193 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AsyncLogWriter.h
+ * @brief  Asynchronous, batched logging of run outputs: producers enqueue
+ *         binary records, formatted and written by a background thread.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "logging/Logger.h"
+#include "logging/RunLog.h"
+
+namespace VIO {
+
+///
+// Example usage:
+//
+// struct PoseRecord { Timestamp timestamp; double x, y, z; };
+// void writePose(const PoseRecord& record, RunLogRowWriter* row) {
+//   row->addInt64(record.timestamp);
+//   row->addFloat64(record.x);
+//   ...
+// }
+// AsyncRunLog<PoseRecord> log(
+//     "output_poses.csv",
+//     {{"timestamp", RunLogColumnType::kInt64},
+//      {"x", RunLogColumnType::kFloat64}, ...},
+//     &writePose);
+// log.log(PoseRecord{timestamp, x, y, z});  // Does not block.
+//
+// Each log has a lock-free ring of --async_log_ring_size records, with a
+// single producer: only one thread may log to a given log. The
+// AsyncLogWriter thread converts the records of all logs to rows every
+// --async_log_flush_interval_ms, and writes them to the files in one chunk
+// per file. Records logged while the ring is full are dropped and counted.
+// With --log_output_binary, the files are binary run logs (RunLog.h) instead
+// of CSV, with the extension .runlog.
+
+// File of an asynchronous log, drained by the AsyncLogWriter.
+class AsyncLogSink {
+ public:
+  // Opens the file in FLAGS_output_path, as CSV or binary run log depending
+  // on --log_output_binary, and writes the header.
+  AsyncLogSink(const std::string& filename, const RunLogSchema& schema);
+  virtual ~AsyncLogSink() = default;
+
+  AsyncLogSink(const AsyncLogSink&) = delete;
+  AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+  // Number of records dropped because the ring was full.
+  inline size_t nrDropped() const { return nr_dropped_; }
+  inline const std::string& filename() const { return filename_; }
+
+ protected:
+  friend class AsyncLogWriter;
+
+  // Passes the records logged so far to row_writer_, and frees their slots.
+  // Only called by the AsyncLogWriter, under its mutex.
+  virtual void drain() = 0;
+
+ protected:
+  const std::string filename_;
+  OfstreamWrapper file_;
+  // Destroyed before the file, to which it may still write.
+  std::unique_ptr<RunLogRowWriter> row_writer_;
+  std::atomic<size_t> nr_dropped_ = {0u};
+};
+
+// Background thread writing all asynchronous logs.
+class AsyncLogWriter {
+ public:
+  static AsyncLogWriter& Instance();
+  ~AsyncLogWriter();
+
+  // The sink is drained from the writer thread as soon as added, so it must
+  // be fully constructed, and removed before its destruction. Removing it
+  // writes its pending records.
+  void addSink(AsyncLogSink* sink);
+  void removeSink(AsyncLogSink* sink);
+
+  // Writes the records logged so far to the files, blocking.
+  void flush();
+
+ private:
+  AsyncLogWriter();
+  void spin();
+  // Drains all sinks and writes their buffered rows, or all their rows if
+  // flush_all, requires mutex_.
+  void writeSinks(bool flush_all);
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable shutdown_cond_;
+  bool shutdown_ = false;
+  std::vector<AsyncLogSink*> sinks_;
+  std::thread thread_;
+};
+
+// Asynchronous log of records of type Record, converted to one row each by
+// the given function, in the writer thread.
+template <typename Record>
+class AsyncRunLog : public AsyncLogSink {
+ public:
+  // Adds the values of the record to the row, in the order of the schema.
+  typedef void (*Formatter)(const Record& record, RunLogRowWriter* row);
+
+  // Records are copied in the ring as is, and formatted later.
+  static_assert(std::is_trivially_copyable<Record>::value,
+                "AsyncRunLog records must be trivially copyable.");
+
+  AsyncRunLog(const std::string& filename, const RunLogSchema& schema,
+              Formatter formatter);
+  ~AsyncRunLog();
+
+  // Enqueues the record without blocking, returns false if it was dropped
+  // because the ring is full. Must always be called from the same thread.
+  bool log(const Record& record) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == ring_.size()) {
+      nr_dropped_.fetch_add(1u, std::memory_order_relaxed);
+      return false;
+    }
+    ring_[head & mask_] = record;
+    head_.store(head + 1u, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  void drain() override {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      formatter_(ring_[tail & mask_], row_writer_.get());
+      row_writer_->endRow();
+    }
+    tail_.store(tail, std::memory_order_release);
+  }
+
+ private:
+  const Formatter formatter_;
+  std::vector<Record> ring_;
+  const size_t mask_;
+  // Number of records logged, written by the producer.
+  std::atomic<size_t> head_ = {0u};
+  // Keeps the indices on different cache lines, to avoid false sharing.
+  char padding_[64u - sizeof(std::atomic<size_t>)];
+  // Number of records formatted, written by the consumer.
+  std::atomic<size_t> tail_ = {0u};
+};
+
+/* -------------------------------------------------------------------------- */
+// Size of the ring of each log: --async_log_ring_size rounded up to a power
+// of 2, to wrap the indices with a mask.
+size_t asyncLogRingSize();
+
+template <typename Record>
+AsyncRunLog<Record>::AsyncRunLog(const std::string& filename,
+                                 const RunLogSchema& schema,
+                                 Formatter formatter)
+    : AsyncLogSink(filename, schema),
+      formatter_(formatter),
+      ring_(asyncLogRingSize()),
+      mask_(ring_.size() - 1u) {
+  CHECK_NOTNULL(formatter_);
+  AsyncLogWriter::Instance().addSink(this);
+}
+
+template <typename Record>
+AsyncRunLog<Record>::~AsyncRunLog() {
+  AsyncLogWriter::Instance().removeSink(this);
+}
+
+}  // namespace VIO
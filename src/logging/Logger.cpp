@@ -19,6 +19,8 @@
 
 #include "StereoVisionFrontEnd-definitions.h"
 #include "UtilsOpenCV.h"
+#include "logging/AsyncLogWriter.h"
+#include "logging/RunLog.h"
 #include "utils/Statistics.h"
 #include "utils/Timer.h"
 
@@ -51,12 +53,182 @@ void OfstreamWrapper::openLogFile(const std::string& output_file_name,
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+struct BackendLogger::PoseRecord {
+  Timestamp timestamp_kf;
+  double position[3];
+  double quaternion[4];  // qx, qy, qz, qw.
+  double velocity[3];
+  double bias_gyro[3];
+  double bias_acc[3];
+};
+
+struct BackendLogger::SmartFactorsRecord {
+  int cur_kf_id;
+  Timestamp timestamp_kf;
+  int numSF, numValid, numDegenerate, numFarPoints, numOutliers;
+  int numCheirality, numNonInitialized;
+  double meanPixelError, maxPixelError, meanTrackLength;
+  size_t maxTrackLength;
+  int nrElementsInMatrix, nrZeroElementsInMatrix;
+};
+
+struct BackendLogger::PimNavstateRecord {
+  Timestamp timestamp_kf;
+  double position[3];
+  double quaternion[4];  // qw, qx, qy, qz.
+  double velocity[3];
+};
+
+struct BackendLogger::FactorsRecord {
+  int cur_kf_id;
+  int numAddedSmartF, numAddedImuF, numAddedNoMotionF, numAddedConstantVelF;
+  int numAddedBetweenStereoF;
+  size_t state_size;
+  int landmark_count;
+};
+
+struct BackendLogger::TimingRecord {
+  int cur_kf_id;
+  double factorsAndSlotsTime, preUpdateTime, updateTime, updateSlotTime;
+  double extraIterationsTime, linearizeTime, linearSolveTime, retractTime;
+  double linearizeMarginalizeTime, marginalizeTime;
+};
+
+// Columns of the given type, one per name.
+static RunLogSchema columns(const std::vector<std::string>& names,
+                            const RunLogColumnType& type) {
+  RunLogSchema schema;
+  for (const std::string& name : names) schema.emplace_back(name, type);
+  return schema;
+}
+
+static RunLogSchema concatenate(std::initializer_list<RunLogSchema> schemas) {
+  RunLogSchema schema;
+  for (const RunLogSchema& columns : schemas) {
+    schema.insert(schema.end(), columns.begin(), columns.end());
+  }
+  return schema;
+}
+
+template <size_t N>
+static void addFloat64s(const double (&values)[N], RunLogRowWriter* row) {
+  for (const double& value : values) row->addFloat64(value);
+}
+
+static const RunLogColumnType kInt32 = RunLogColumnType::kInt32;
+static const RunLogColumnType kInt64 = RunLogColumnType::kInt64;
+static const RunLogColumnType kUint64 = RunLogColumnType::kUint64;
+static const RunLogColumnType kFloat64 = RunLogColumnType::kFloat64;
+static const RunLogColumnType kUint8 = RunLogColumnType::kUint8;
+
 BackendLogger::BackendLogger()
-    : output_poses_vio_csv_("output_posesVIO.csv"),
-      output_smart_factors_stats_csv_("output_smartFactors.csv"),
-      output_pim_navstates_csv_("output_pim_navstates.csv"),
-      output_backend_factors_stats_csv_("output_backendFactors.csv"),
-      output_backend_timing_csv_("output_backendTiming.csv"){};
+    : output_poses_vio_csv_(VIO::make_unique<AsyncRunLog<PoseRecord>>(
+          "output_posesVIO.csv",
+          concatenate({{{"timestamp", kInt64}},
+                       columns({"x", "y", "z", "qx", "qy", "qz", "qw", "vx",
+                                "vy", "vz", "bgx", "bgy", "bgz", "bax", "bay",
+                                "baz"},
+                               kFloat64)}),
+          [](const PoseRecord& record, RunLogRowWriter* row) {
+            row->addInt64(record.timestamp_kf);
+            addFloat64s(record.position, row);
+            addFloat64s(record.quaternion, row);
+            addFloat64s(record.velocity, row);
+            addFloat64s(record.bias_gyro, row);
+            addFloat64s(record.bias_acc, row);
+          })),
+      output_smart_factors_stats_csv_(
+          VIO::make_unique<AsyncRunLog<SmartFactorsRecord>>(
+              "output_smartFactors.csv",
+              concatenate(
+                  {{{"cur_kf_id", kInt32}, {"timestamp_kf", kInt64}},
+                   columns({"numSF", "numValid", "numDegenerate",
+                            "numFarPoints", "numOutliers", "numCheirality",
+                            "numNonInitialized"},
+                           kInt32),
+                   columns({"meanPixelError", "maxPixelError",
+                            "meanTrackLength"},
+                           kFloat64),
+                   {{"maxTrackLength", kUint64}},
+                   columns({"nrElementsInMatrix", "nrZeroElementsInMatrix"},
+                           kInt32)}),
+              [](const SmartFactorsRecord& record, RunLogRowWriter* row) {
+                row->addInt32(record.cur_kf_id);
+                row->addInt64(record.timestamp_kf);
+                row->addInt32(record.numSF);
+                row->addInt32(record.numValid);
+                row->addInt32(record.numDegenerate);
+                row->addInt32(record.numFarPoints);
+                row->addInt32(record.numOutliers);
+                row->addInt32(record.numCheirality);
+                row->addInt32(record.numNonInitialized);
+                row->addFloat64(record.meanPixelError);
+                row->addFloat64(record.maxPixelError);
+                row->addFloat64(record.meanTrackLength);
+                row->addUint64(record.maxTrackLength);
+                row->addInt32(record.nrElementsInMatrix);
+                row->addInt32(record.nrZeroElementsInMatrix);
+              })),
+      output_pim_navstates_csv_(
+          VIO::make_unique<AsyncRunLog<PimNavstateRecord>>(
+              "output_pim_navstates.csv",
+              concatenate({{{"timestamp_kf", kInt64}},
+                           columns({"x", "y", "z", "qw", "qx", "qy", "qz",
+                                    "vx", "vy", "vz"},
+                                   kFloat64)}),
+              [](const PimNavstateRecord& record, RunLogRowWriter* row) {
+                row->addInt64(record.timestamp_kf);
+                addFloat64s(record.position, row);
+                addFloat64s(record.quaternion, row);
+                addFloat64s(record.velocity, row);
+              })),
+      output_backend_factors_stats_csv_(
+          VIO::make_unique<AsyncRunLog<FactorsRecord>>(
+              "output_backendFactors.csv",
+              concatenate({columns({"cur_kf_id", "numAddedSmartF",
+                                    "numAddedImuF", "numAddedNoMotionF",
+                                    "numAddedConstantF",
+                                    "numAddedBetweenStereoF"},
+                                   kInt32),
+                           {{"state_size", kUint64},
+                            {"landmark_count", kInt32}}}),
+              [](const FactorsRecord& record, RunLogRowWriter* row) {
+                row->addInt32(record.cur_kf_id);
+                row->addInt32(record.numAddedSmartF);
+                row->addInt32(record.numAddedImuF);
+                row->addInt32(record.numAddedNoMotionF);
+                row->addInt32(record.numAddedConstantVelF);
+                row->addInt32(record.numAddedBetweenStereoF);
+                row->addUint64(record.state_size);
+                row->addInt32(record.landmark_count);
+              })),
+      output_backend_timing_csv_(VIO::make_unique<AsyncRunLog<TimingRecord>>(
+          "output_backendTiming.csv",
+          concatenate({{{"cur_kf_id", kInt32}},
+                       columns({"factorsAndSlotsTime", "preUpdateTime",
+                                "updateTime", "updateSlotTime",
+                                "extraIterationsTime", "linearizeTime",
+                                "linearSolveTime", "retractTime",
+                                "linearizeMarginalizeTime", "marginalizeTime"},
+                               kFloat64)}),
+          [](const TimingRecord& record, RunLogRowWriter* row) {
+            row->addInt32(record.cur_kf_id);
+            row->addFloat64(record.factorsAndSlotsTime);
+            row->addFloat64(record.preUpdateTime);
+            row->addFloat64(record.updateTime);
+            row->addFloat64(record.updateSlotTime);
+            row->addFloat64(record.extraIterationsTime);
+            row->addFloat64(record.linearizeTime);
+            row->addFloat64(record.linearSolveTime);
+            row->addFloat64(record.retractTime);
+            row->addFloat64(record.linearizeMarginalizeTime);
+            row->addFloat64(record.marginalizeTime);
+          })) {}
+
+// Out of line, where the records are complete types.
+BackendLogger::~BackendLogger() = default;
+
+void BackendLogger::flush() const { AsyncLogWriter::Instance().flush(); }
 
 void BackendLogger::logBackendOutput(const VioBackEndOutputPayload& output) {
   logBackendResultsCSV(output);
@@ -107,164 +279,68 @@ void BackendLogger::displayInitialStateVioInfo(
 void BackendLogger::logBackendResultsCSV(
     const VioBackEndOutputPayload& vio_output) {
   // We log the poses in csv format for later alignement and analysis.
-  std::ofstream& output_stream = output_poses_vio_csv_.ofstream_;
-
-  // First, write header, but only once.
-  static bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream << "timestamp,x,y,z,qx,qy,qz,qw,vx,vy,vz,"
-                  << "bgx,bgy,bgz,bax,bay,baz"
-                  << std::endl;
-    is_header_written = true;
-  }
   // TODO(marcus): everything on EVO and evaluation needs to change for the new
   // qw before qx paradigm!
-  const auto& w_pose_blkf_trans =
-      vio_output.W_Pose_Blkf_.translation().transpose();
+  const auto& w_pose_blkf_trans = vio_output.W_Pose_Blkf_.translation();
   const auto& w_pose_blkf_rot = vio_output.W_Pose_Blkf_.rotation().quaternion();
-  const auto& w_vel_blkf = vio_output.W_Vel_Blkf_.transpose();
-  const auto& imu_bias_gyro = vio_output.imu_bias_lkf_.gyroscope().transpose();
-  const auto& imu_bias_acc =
-      vio_output.imu_bias_lkf_.accelerometer().transpose();
-  output_stream << vio_output.timestamp_kf_ << ","  //
-                << w_pose_blkf_trans.x() << ","     //
-                << w_pose_blkf_trans.y() << ","     //
-                << w_pose_blkf_trans.z() << ","     //
-                << w_pose_blkf_rot(1) << ","        // q_x
-                << w_pose_blkf_rot(2) << ","        // q_y
-                << w_pose_blkf_rot(3) << ","        // q_z
-                << w_pose_blkf_rot(0) << ","        // q_w
-                << w_vel_blkf(0) << ","             //
-                << w_vel_blkf(1) << ","             //
-                << w_vel_blkf(2) << ","             //
-                << imu_bias_gyro(0) << ","          //
-                << imu_bias_gyro(1) << ","          //
-                << imu_bias_gyro(2) << ","          //
-                << imu_bias_acc(0) << ","           //
-                << imu_bias_acc(1) << ","           //
-                << imu_bias_acc(2)                  //
-                << std::endl;
+  const auto& w_vel_blkf = vio_output.W_Vel_Blkf_;
+  const auto& imu_bias_gyro = vio_output.imu_bias_lkf_.gyroscope();
+  const auto& imu_bias_acc = vio_output.imu_bias_lkf_.accelerometer();
+  output_poses_vio_csv_->log(PoseRecord{
+      vio_output.timestamp_kf_,
+      {w_pose_blkf_trans.x(), w_pose_blkf_trans.y(), w_pose_blkf_trans.z()},
+      {w_pose_blkf_rot(1),    // q_x
+       w_pose_blkf_rot(2),    // q_y
+       w_pose_blkf_rot(3),    // q_z
+       w_pose_blkf_rot(0)},   // q_w
+      {w_vel_blkf(0), w_vel_blkf(1), w_vel_blkf(2)},
+      {imu_bias_gyro(0), imu_bias_gyro(1), imu_bias_gyro(2)},
+      {imu_bias_acc(0), imu_bias_acc(1), imu_bias_acc(2)}});
 }
 
 void BackendLogger::logSmartFactorsStats(
     const VioBackEndOutputPayload& output) {
-  std::ofstream& output_stream = output_smart_factors_stats_csv_.ofstream_;
-
-  // First, write header, but only once.
-  static bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream << "cur_kf_id,timestamp_kf,numSF,"
-                  << "numValid,numDegenerate,numFarPoints,numOutliers,"
-                  << "numCheirality,numNonInitialized,meanPixelError,"
-                  << "maxPixelError,meanTrackLength,maxTrackLength,"
-                  << "nrElementsInMatrix,nrZeroElementsInMatrix"
-                  << std::endl;
-    is_header_written = true;
-  }
-
-  output_stream << output.cur_kf_id_ << ","
-                << output.timestamp_kf_ << ","
-                << output.debug_info_.numSF_ << ","
-                << output.debug_info_.numValid_ << ","
-                << output.debug_info_.numDegenerate_ << ","
-                << output.debug_info_.numFarPoints_ << ","
-                << output.debug_info_.numOutliers_ << ","
-                << output.debug_info_.numCheirality_ << ","
-                << output.debug_info_.numNonInitialized_ << ","
-                << output.debug_info_.meanPixelError_ << ","
-                << output.debug_info_.maxPixelError_ << ","
-                << output.debug_info_.meanTrackLength_ << ","
-                << output.debug_info_.maxTrackLength_ << ","
-                << output.debug_info_.nrElementsInMatrix_ << ","
-                << output.debug_info_.nrZeroElementsInMatrix_
-                << std::endl;
+  const DebugVioInfo& info = output.debug_info_;
+  output_smart_factors_stats_csv_->log(SmartFactorsRecord{
+      output.cur_kf_id_, output.timestamp_kf_, info.numSF_, info.numValid_,
+      info.numDegenerate_, info.numFarPoints_, info.numOutliers_,
+      info.numCheirality_, info.numNonInitialized_, info.meanPixelError_,
+      info.maxPixelError_, info.meanTrackLength_, info.maxTrackLength_,
+      info.nrElementsInMatrix_, info.nrZeroElementsInMatrix_});
 }
 
 void BackendLogger::logBackendPimNavstates(
     const VioBackEndOutputPayload& output) {
-  std::ofstream& output_stream = output_pim_navstates_csv_.ofstream_;
-
-  // First, write header, but only once.
-  static bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream << "timestamp_kf,x,y,z,qw,qx,qy,qz,vx,vy,vz"
-                  << std::endl;
-    is_header_written = true;
-  }
-
   const gtsam::Pose3& pose = output.debug_info_.navstate_k_.pose();
   const gtsam::Point3& position = pose.translation();
   const gtsam::Quaternion& quaternion = pose.rotation().toQuaternion();
   const gtsam::Velocity3& velocity = output.debug_info_.navstate_k_.velocity();
-
-  output_stream << output.timestamp_kf_ << ","
-                << position.x() << ","
-                << position.y() << ","
-                << position.z() << ","
-                << quaternion.w() << ","
-                << quaternion.x() << ","
-                << quaternion.y() << ","
-                << quaternion.z() << ","
-                << velocity.x() << ","
-                << velocity.y() << ","
-                << velocity.z()
-                << std::endl;
+  output_pim_navstates_csv_->log(PimNavstateRecord{
+      output.timestamp_kf_,
+      {position.x(), position.y(), position.z()},
+      {quaternion.w(), quaternion.x(), quaternion.y(), quaternion.z()},
+      {velocity.x(), velocity.y(), velocity.z()}});
 }
 
 void BackendLogger::logBackendTiming(const VioBackEndOutputPayload& output) {
-  std::ofstream& output_stream = output_backend_timing_csv_.ofstream_;
-
-  // First, write header, but only once.
-  static bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream << "cur_kf_id,factorsAndSlotsTime,preUpdateTime,"
-                  << "updateTime,updateSlotTime,extraIterationsTime,"
-                  << "linearizeTime,linearSolveTime,retractTime,"
-                  << "linearizeMarginalizeTime,marginalizeTime"
-                  << std::endl;
-    is_header_written = true;
-  }
-
   // Log timing for benchmarking and performance profiling.
-  output_stream << output.cur_kf_id_ << ","
-                << output.debug_info_.factorsAndSlotsTime_ << ","
-                << output.debug_info_.preUpdateTime_ << ","
-                << output.debug_info_.updateTime_ << ","
-                << output.debug_info_.updateSlotTime_ << ","
-                << output.debug_info_.extraIterationsTime_ << ","
-                << output.debug_info_.linearizeTime_ << ","
-                << output.debug_info_.linearSolveTime_ << ","
-                << output.debug_info_.retractTime_ << ","
-                << output.debug_info_.linearizeMarginalizeTime_ << ","
-                << output.debug_info_.marginalizeTime_
-                << std::endl;
+  const DebugVioInfo& info = output.debug_info_;
+  output_backend_timing_csv_->log(TimingRecord{
+      output.cur_kf_id_, info.factorsAndSlotsTime_, info.preUpdateTime_,
+      info.updateTime_, info.updateSlotTime_, info.extraIterationsTime_,
+      info.linearizeTime_, info.linearSolveTime_, info.retractTime_,
+      info.linearizeMarginalizeTime_, info.marginalizeTime_});
 }
 
 void BackendLogger::logBackendFactorsStats(
     const VioBackEndOutputPayload& output) {
-  std::ofstream& output_stream = output_backend_factors_stats_csv_.ofstream_;
-
-  // First, write header, but only once.
-  static bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream << "cur_kf_id,numAddedSmartF,numAddedImuF,numAddedNoMotionF,"
-                  << "numAddedConstantF,numAddedBetweenStereoF,state_size,"
-                  << "landmark_count"
-                  << std::endl;
-    is_header_written = true;
-  }
-
-  // Log timing for benchmarking and performance profiling.
   // Statistics about factors added to the graph.
-  output_stream << output.cur_kf_id_ << ","
-                << output.debug_info_.numAddedSmartF_ << ","
-                << output.debug_info_.numAddedImuF_ << ","
-                << output.debug_info_.numAddedNoMotionF_ << ","
-                << output.debug_info_.numAddedConstantVelF_ << ","
-                << output.debug_info_.numAddedBetweenStereoF_ << ","
-                << output.state_.size() << ","
-                << output.landmark_count_
-                << std::endl;
+  const DebugVioInfo& info = output.debug_info_;
+  output_backend_factors_stats_csv_->log(FactorsRecord{
+      output.cur_kf_id_, info.numAddedSmartF_, info.numAddedImuF_,
+      info.numAddedNoMotionF_, info.numAddedConstantVelF_,
+      info.numAddedBetweenStereoF_, output.state_.size(),
+      output.landmark_count_});
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -355,10 +431,116 @@ void VisualizerLogger::logMesh(const cv::Mat& lmks,
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+struct FrontendLogger::StatsRecord {
+  Timestamp timestamp_lkf;
+  TrackingStatus mono_status;
+  TrackingStatus stereo_status;
+  size_t nr_keypoints;
+  DebugTrackerInfo tracker_info;
+};
+
+struct FrontendLogger::RelativePoseRecord {
+  Timestamp timestamp_lkf;
+  double position[3];
+  double quaternion[4];  // qw, qx, qy, qz.
+};
+
+static RunLogSchema relativePoseSchema() {
+  return concatenate(
+      {{{"timestamp_lkf", kInt64}},
+       columns({"x", "y", "z", "qw", "qx", "qy", "qz"}, kFloat64)});
+}
+
+// Names of the tracking statuses, in the order of their values.
+static std::vector<std::string> trackingStatusLabels() {
+  std::vector<std::string> labels;
+  for (const TrackingStatus& status :
+       {TrackingStatus::VALID, TrackingStatus::LOW_DISPARITY,
+        TrackingStatus::FEW_MATCHES, TrackingStatus::INVALID,
+        TrackingStatus::DISABLED}) {
+    CHECK_EQ(static_cast<size_t>(status), labels.size());
+    labels.push_back(TrackerStatusSummary::asString(status));
+  }
+  return labels;
+}
+
 FrontendLogger::FrontendLogger()
-    : output_frontend_stats_("output_frontend_stats.csv"),
-      output_frontend_ransac_mono_("output_frontend_ransac_mono.csv"),
-      output_frontend_ransac_stereo_("output_frontend_ransac_stereo.csv") {};
+    : output_frontend_stats_(VIO::make_unique<AsyncRunLog<StatsRecord>>(
+          "output_frontend_stats.csv",
+          concatenate(
+              {{{"timestamp_lkf", kInt64},
+                {"mono_status", kUint8, trackingStatusLabels()},
+                {"stereo_status", kUint8, trackingStatusLabels()}},
+               columns({"nr_keypoints", "nrDetectedFeatures",
+                        "nrTrackerFeatures", "nrMonoInliers",
+                        "nrMonoPutatives", "nrStereoInliers",
+                        "nrStereoPutatives", "monoRansacIters",
+                        "stereoRansacIters", "nrValidRKP", "nrNoLeftRectRKP",
+                        "nrNoRightRectRKP", "nrNoDepthRKP",
+                        "nrFailedArunRKP"},
+                       kUint64),
+               columns({"featureDetectionTime", "featureTrackingTime",
+                        "monoRansacTime", "stereoRansacTime",
+                        "featureSelectionTime"},
+                       kFloat64),
+               columns({"extracted_corners", "need_n_corners",
+                        "nrPrunedKltTracks", "nrPrunedStereoTracks",
+                        "nrKltFbRejected", "nrGreedySelected"},
+                       kUint64),
+               {{"featureSelectionBudgetExpired", kUint8}}}),
+          [](const StatsRecord& record, RunLogRowWriter* row) {
+            const DebugTrackerInfo& tracker_info = record.tracker_info;
+            row->addInt64(record.timestamp_lkf);
+            // Mono and stereo status.
+            row->addUint8(static_cast<uint8_t>(record.mono_status));
+            row->addUint8(static_cast<uint8_t>(record.stereo_status));
+            // Nr of keypoints.
+            row->addUint64(record.nr_keypoints);
+            // Feature detection, tracking and ransac.
+            row->addUint64(tracker_info.nrDetectedFeatures_);
+            row->addUint64(tracker_info.nrTrackerFeatures_);
+            row->addUint64(tracker_info.nrMonoInliers_);
+            row->addUint64(tracker_info.nrMonoPutatives_);
+            row->addUint64(tracker_info.nrStereoInliers_);
+            row->addUint64(tracker_info.nrStereoPutatives_);
+            row->addUint64(tracker_info.monoRansacIters_);
+            row->addUint64(tracker_info.stereoRansacIters_);
+            // Performance of sparse-stereo-matching and ransac.
+            row->addUint64(tracker_info.nrValidRKP_);
+            row->addUint64(tracker_info.nrNoLeftRectRKP_);
+            row->addUint64(tracker_info.nrNoRightRectRKP_);
+            row->addUint64(tracker_info.nrNoDepthRKP_);
+            row->addUint64(tracker_info.nrFailedArunRKP_);
+            // Info about timing.
+            row->addFloat64(tracker_info.featureDetectionTime_);
+            row->addFloat64(tracker_info.featureTrackingTime_);
+            row->addFloat64(tracker_info.monoRansacTime_);
+            row->addFloat64(tracker_info.stereoRansacTime_);
+            // Info about feature selector.
+            row->addFloat64(tracker_info.featureSelectionTime_);
+            row->addUint64(tracker_info.extracted_corners_);
+            row->addUint64(tracker_info.need_n_corners_);
+            // Pruned tracks.
+            row->addUint64(tracker_info.nrPrunedKltTracks_);
+            row->addUint64(tracker_info.nrPrunedStereoTracks_);
+            row->addUint64(tracker_info.nrKltFbRejected_);
+            // Feature selection budget.
+            row->addUint64(tracker_info.nrGreedySelected_);
+            row->addUint8(tracker_info.featureSelectionBudgetExpired_);
+          })),
+      output_frontend_ransac_mono_(
+          VIO::make_unique<AsyncRunLog<RelativePoseRecord>>(
+              "output_frontend_ransac_mono.csv", relativePoseSchema(),
+              &writeRelativePose)),
+      output_frontend_ransac_stereo_(
+          VIO::make_unique<AsyncRunLog<RelativePoseRecord>>(
+              "output_frontend_ransac_stereo.csv", relativePoseSchema(),
+              &writeRelativePose)) {}
+
+// Out of line, where the records are complete types.
+FrontendLogger::~FrontendLogger() = default;
+
+void FrontendLogger::flush() const { AsyncLogWriter::Instance().flush(); }
 
 void FrontendLogger::logFrontendStats(
     const Timestamp& timestamp_lkf,
@@ -366,58 +548,17 @@ void FrontendLogger::logFrontendStats(
     const TrackerStatusSummary& tracker_summary,
     const size_t& nrKeypoints) {
   // We log frontend results in csv format.
-  std::ofstream& output_stream_stats = output_frontend_stats_.ofstream_;
-
-  static bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream_stats << "timestamp_lkf,mono_status,stereo_status,"
-                        << "nr_keypoints,nrDetectedFeatures,nrTrackerFeatures,"
-                        << "nrMonoInliers,nrMonoPutatives,nrStereoInliers,"
-                        << "nrStereoPutatives,monoRansacIters,"
-                        << "stereoRansacIters,nrValidRKP,nrNoLeftRectRKP,"
-                        << "nrNoRightRectRKP,nrNoDepthRKP,nrFailedArunRKP,"
-                        << "featureDetectionTime,featureTrackingTime,"
-                        << "monoRansacTime,stereoRansacTime,"
-                        << "featureSelectionTime,extracted_corners,"
-                        << "need_n_corners"
-                        << std::endl;
-    is_header_written = true;
-  }
+  output_frontend_stats_->log(
+      StatsRecord{timestamp_lkf, tracker_summary.kfTrackingStatus_mono_,
+                  tracker_summary.kfTrackingStatus_stereo_, nrKeypoints,
+                  tracker_info});
+}
 
-  output_stream_stats << timestamp_lkf << ","
-  // Mono status.
-                      << TrackerStatusSummary::asString(
-                              tracker_summary.kfTrackingStatus_mono_) << ","
-  // Stereo status.
-                      << TrackerStatusSummary::asString(
-                              tracker_summary.kfTrackingStatus_stereo_) << ","
-  // Nr of keypoints.
-                      << nrKeypoints << ","
-  // Feature detection, tracking and ransac.
-                      << tracker_info.nrDetectedFeatures_ << ","
-                      << tracker_info.nrTrackerFeatures_ << ","
-                      << tracker_info.nrMonoInliers_ << ","
-                      << tracker_info.nrMonoPutatives_ << ","
-                      << tracker_info.nrStereoInliers_ << ","
-                      << tracker_info.nrStereoPutatives_ << ","
-                      << tracker_info.monoRansacIters_ << ","
-                      << tracker_info.stereoRansacIters_ << ","
-  // Performance of sparse-stereo-matching and ransac.
-                      << tracker_info.nrValidRKP_ << ","
-                      << tracker_info.nrNoLeftRectRKP_ << ","
-                      << tracker_info.nrNoRightRectRKP_ << ","
-                      << tracker_info.nrNoDepthRKP_ << ","
-                      << tracker_info.nrFailedArunRKP_ << ","
-  // Info about timing.
-                      << tracker_info.featureDetectionTime_ << ","
-                      << tracker_info.featureTrackingTime_ << ","
-                      << tracker_info.monoRansacTime_ << ","
-                      << tracker_info.stereoRansacTime_ << ","
-  // Info about feature selector.
-                      << tracker_info.featureSelectionTime_ << ","
-                      << tracker_info.extracted_corners_ << ","
-                      << tracker_info.need_n_corners_
-                      << std::endl;
+void FrontendLogger::writeRelativePose(const RelativePoseRecord& record,
+                                       RunLogRowWriter* row) {
+  row->addInt64(record.timestamp_lkf);
+  addFloat64s(record.position, row);
+  addFloat64s(record.quaternion, row);
 }
 
 void FrontendLogger::logFrontendRansac(
@@ -425,48 +566,19 @@ void FrontendLogger::logFrontendRansac(
     const gtsam::Pose3& relative_pose_body_mono,
     const gtsam::Pose3& relative_pose_body_stereo) {
   // We log the relative poses in csv format for later analysis.
-  std::ofstream& output_stream_mono = output_frontend_ransac_mono_.ofstream_;
-  std::ofstream& output_stream_stereo =
-      output_frontend_ransac_stereo_.ofstream_;
-
-  static bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream_mono << "timestamp_lkf,x,y,z,qw,qx,qy,qz"
-                       << std::endl;
-    output_stream_stereo << "timestamp_lkf,x,y,z,qw,qx,qy,qz"
-                         << std::endl;
-    is_header_written = true;
-  }
-
-  // Log relative mono poses; pose from previous keyframe to current keyframe,
-  // in previous-keyframe coordinates. These are not cumulative trajectories.
-  const gtsam::Point3& mono_tran = relative_pose_body_mono.translation();
-  const gtsam::Quaternion& mono_quat = relative_pose_body_mono.rotation().toQuaternion();
-
-  output_stream_mono << timestamp_lkf << ","
-                     << mono_tran.x() << ","
-                     << mono_tran.y() << ","
-                     << mono_tran.z() << ","
-                     << mono_quat.w() << ","
-                     << mono_quat.x() << ","
-                     << mono_quat.y() << ","
-                     << mono_quat.z()
-                     << std::endl;
-
-  // Log relative stereo poses; pose from previous keyframe to current keyframe,
+  // Log relative poses; pose from previous keyframe to current keyframe,
   // in previous-keyframe coordinates. These are not cumulative trajectories.
-  const gtsam::Point3& stereo_tran = relative_pose_body_stereo.translation();
-  const gtsam::Quaternion& stereo_quat = relative_pose_body_stereo.rotation().toQuaternion();
-
-  output_stream_stereo << timestamp_lkf   << ","
-                       << stereo_tran.x() << ","
-                       << stereo_tran.y() << ","
-                       << stereo_tran.z() << ","
-                       << stereo_quat.w() << ","
-                       << stereo_quat.x() << ","
-                       << stereo_quat.y() << ","
-                       << stereo_quat.z()
-                       << std::endl;
+  auto relative_pose_record = [&timestamp_lkf](const gtsam::Pose3& pose) {
+    const gtsam::Point3& tran = pose.translation();
+    const gtsam::Quaternion& quat = pose.rotation().toQuaternion();
+    return RelativePoseRecord{timestamp_lkf,
+                              {tran.x(), tran.y(), tran.z()},
+                              {quat.w(), quat.x(), quat.y(), quat.z()}};
+  };
+  output_frontend_ransac_mono_->log(
+      relative_pose_record(relative_pose_body_mono));
+  output_frontend_ransac_stereo_->log(
+      relative_pose_record(relative_pose_body_stereo));
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <unordered_map>
 
 #include "datasource/ETH_parser.h"  // REMOVE THIS!!
@@ -43,10 +44,18 @@ class OfstreamWrapper {
   const bool open_file_in_append_mode = false;
 };
 
+template <typename Record>
+class AsyncRunLog;
+class RunLogRowWriter;
+
+// The backend and frontend loggers only enqueue records, which are formatted
+// and written to the CSV files (or binary run logs) in the background, see
+// AsyncLogWriter.h.
+
 class BackendLogger {
  public:
   BackendLogger();
-  ~BackendLogger() = default;
+  ~BackendLogger();
 
   void logBackendOutput(const VioBackEndOutputPayload& output);
   void displayInitialStateVioInfo(const gtsam::Vector3& n_gravity_,
@@ -55,6 +64,9 @@ class BackendLogger {
                                   const ImuAccGyrS& imu_accgyr,
                                   const Timestamp& timestamp_k) const;
 
+  // Writes the records logged so far to the files, blocking.
+  void flush() const;
+
  private:
   void logBackendResultsCSV(const VioBackEndOutputPayload& output);
   void logSmartFactorsStats(const VioBackEndOutputPayload& output);
@@ -63,12 +75,21 @@ class BackendLogger {
   void logBackendTiming(const VioBackEndOutputPayload& output);
 
  private:
-  // Filenames to be saved in the output folder.
-  OfstreamWrapper output_poses_vio_csv_;
-  OfstreamWrapper output_smart_factors_stats_csv_;
-  OfstreamWrapper output_pim_navstates_csv_;
-  OfstreamWrapper output_backend_factors_stats_csv_;
-  OfstreamWrapper output_backend_timing_csv_;
+  // Records of each CSV file, defined in Logger.cpp.
+  struct PoseRecord;
+  struct SmartFactorsRecord;
+  struct PimNavstateRecord;
+  struct FactorsRecord;
+  struct TimingRecord;
+
+  // Logs saved in the output folder.
+  std::unique_ptr<AsyncRunLog<PoseRecord>> output_poses_vio_csv_;
+  std::unique_ptr<AsyncRunLog<SmartFactorsRecord>>
+      output_smart_factors_stats_csv_;
+  std::unique_ptr<AsyncRunLog<PimNavstateRecord>> output_pim_navstates_csv_;
+  std::unique_ptr<AsyncRunLog<FactorsRecord>>
+      output_backend_factors_stats_csv_;
+  std::unique_ptr<AsyncRunLog<TimingRecord>> output_backend_timing_csv_;
 
   gtsam::Pose3 W_Pose_Bprevkf_vio_;
   double timing_loggerBackend_;
@@ -77,7 +98,7 @@ class BackendLogger {
 class FrontendLogger {
  public:
   FrontendLogger();
-  ~FrontendLogger() = default;
+  ~FrontendLogger();
 
   void logFrontendStats(const Timestamp& timestamp_lkf,
                         const DebugTrackerInfo& tracker_info,
@@ -87,11 +108,22 @@ class FrontendLogger {
                          const gtsam::Pose3& relative_pose_body_mono,
                          const gtsam::Pose3& relative_pose_body_stereo);
 
+  // Writes the records logged so far to the files, blocking.
+  void flush() const;
+
  private:
-  // StreamWrappers with filenames to which output is saved.
-  OfstreamWrapper output_frontend_stats_;
-  OfstreamWrapper output_frontend_ransac_mono_;
-  OfstreamWrapper output_frontend_ransac_stereo_;
+  // Records of each CSV file, defined in Logger.cpp.
+  struct StatsRecord;
+  struct RelativePoseRecord;
+
+  static void writeRelativePose(const RelativePoseRecord& record,
+                                RunLogRowWriter* row);
+
+  // Logs saved in the output folder.
+  std::unique_ptr<AsyncRunLog<StatsRecord>> output_frontend_stats_;
+  std::unique_ptr<AsyncRunLog<RelativePoseRecord>> output_frontend_ransac_mono_;
+  std::unique_ptr<AsyncRunLog<RelativePoseRecord>>
+      output_frontend_ransac_stereo_;
 };
 
 class VisualizerLogger {
@@ -0,0 +1,443 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RunLog.cpp
+ * @brief  Rows of a run output (poses, frontend and backend statistics...),
+ *         written either as CSV or in a compact columnar binary format.
+ * @author Antoni Rosinol
+ */
+
+#include "logging/RunLog.h"
+
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+#ifdef SPARK_VIO_WITH_LZ4
+#include <lz4.h>
+#endif
+
+namespace VIO {
+
+static const char kHeaderMagic[8] = {'S', 'V', 'I', 'O', 'R', 'L', 'O', 'G'};
+static const char kEndMagic[8] = {'S', 'V', 'I', 'O', 'R', 'E', 'N', 'D'};
+static const char kChunkMagic[4] = {'C', 'H', 'N', 'K'};
+static const char kFooterMagic[4] = {'F', 'O', 'O', 'T'};
+static const uint32_t kVersion = 1u;
+static const uint8_t kNoCompression = 0u;
+static const uint8_t kLz4Compression = 1u;
+// Size of the end of the file: offset of the footer and end magic.
+static const size_t kEndSize = 8u + sizeof(kEndMagic);
+
+/* -------------------------------------------------------------------------- */
+size_t runLogColumnTypeSize(const RunLogColumnType& type) {
+  switch (type) {
+    case RunLogColumnType::kInt32:
+      return sizeof(int32_t);
+    case RunLogColumnType::kInt64:
+      return sizeof(int64_t);
+    case RunLogColumnType::kUint64:
+      return sizeof(uint64_t);
+    case RunLogColumnType::kFloat64:
+      return sizeof(double);
+    case RunLogColumnType::kUint8:
+      return sizeof(uint8_t);
+  }
+  LOG(FATAL) << "Unknown run log column type: " << static_cast<int>(type);
+  return 0u;
+}
+
+/* -------------------------------------------------------------------------- */
+RunLogRowWriter::RunLogRowWriter(const RunLogSchema& schema) : schema_(schema) {
+  CHECK(!schema_.empty());
+}
+
+void RunLogRowWriter::startNextRow() {
+  CHECK_EQ(column_, schema_.size()) << "Missing values in row.";
+  column_ = 0u;
+}
+
+/* -------------------------------------------------------------------------- */
+CsvRowWriter::CsvRowWriter(const RunLogSchema& schema, std::ostream* out)
+    : RunLogRowWriter(schema), out_(CHECK_NOTNULL(out)) {
+  // Same format as writing to the stream directly.
+  buffer_.flags(out_->flags());
+  buffer_.precision(out_->precision());
+  for (size_t i = 0u; i < schema_.size(); i++) {
+    separate(i);
+    buffer_ << schema_[i].name_;
+  }
+  buffer_ << '\n';
+  flush();
+}
+
+CsvRowWriter::~CsvRowWriter() { flush(); }
+
+void CsvRowWriter::addUint8(const uint8_t& value) {
+  const size_t column = nextColumn(RunLogColumnType::kUint8);
+  separate(column);
+  const std::vector<std::string>& labels = schema_[column].labels_;
+  if (value < labels.size()) {
+    buffer_ << labels[value];
+  } else {
+    buffer_ << static_cast<int>(value);
+  }
+}
+
+void CsvRowWriter::endRow() {
+  startNextRow();
+  buffer_ << '\n';
+}
+
+void CsvRowWriter::flush() {
+  const std::string buffer = buffer_.str();
+  if (buffer.empty()) return;
+  out_->write(buffer.data(), buffer.size());
+  out_->flush();
+  buffer_.str(std::string());
+}
+
+/* -------------------------------------------------------------------------- */
+RunLogWriter::RunLogWriter(const std::string& stream_name,
+                           const RunLogSchema& schema, std::ostream* out,
+                           size_t rows_per_chunk, bool compress)
+    : RunLogRowWriter(schema),
+      out_(CHECK_NOTNULL(out)),
+      rows_per_chunk_(rows_per_chunk),
+      compress_(compress && IsCompressionAvailable()),
+      columns_(schema.size()) {
+  CHECK_GT(rows_per_chunk_, 0u);
+  CHECK_LE(rows_per_chunk_, std::numeric_limits<uint32_t>::max());
+  LOG_IF(WARNING, compress && !compress_)
+      << "SparkVio was built without LZ4, run log " << stream_name
+      << " is not compressed.";
+  for (size_t i = 0u; i < schema_.size(); i++) {
+    columns_[i].reserve(rows_per_chunk_ *
+                        runLogColumnTypeSize(schema_[i].type_));
+  }
+  writeHeader(stream_name);
+}
+
+RunLogWriter::~RunLogWriter() {
+  writeChunk();
+  writeFooter();
+  out_->flush();
+}
+
+bool RunLogWriter::IsCompressionAvailable() {
+#ifdef SPARK_VIO_WITH_LZ4
+  return true;
+#else
+  return false;
+#endif
+}
+
+void RunLogWriter::endRow() {
+  startNextRow();
+  if (++nr_rows_ == rows_per_chunk_) writeChunk();
+}
+
+void RunLogWriter::flush() {
+  writeChunk();
+  out_->flush();
+}
+
+void RunLogWriter::write(const void* data, size_t size) {
+  out_->write(static_cast<const char*>(data), size);
+  nr_bytes_written_ += size;
+}
+
+// Writes integers in little-endian, strings with their length.
+template <typename T>
+static void writeValue(const T& value, std::string* bytes) {
+  bytes->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void writeString(const std::string& value, std::string* bytes) {
+  CHECK_LE(value.size(), std::numeric_limits<uint16_t>::max());
+  writeValue(static_cast<uint16_t>(value.size()), bytes);
+  bytes->append(value);
+}
+
+void RunLogWriter::writeHeader(const std::string& stream_name) {
+  std::string header(kHeaderMagic, sizeof(kHeaderMagic));
+  writeValue(kVersion, &header);
+  writeString(stream_name, &header);
+  writeValue(static_cast<uint32_t>(schema_.size()), &header);
+  for (const RunLogColumn& column : schema_) {
+    writeString(column.name_, &header);
+    writeValue(static_cast<uint8_t>(column.type_), &header);
+    writeValue(static_cast<uint32_t>(column.labels_.size()), &header);
+    for (const std::string& label : column.labels_) {
+      writeString(label, &header);
+    }
+  }
+  write(header.data(), header.size());
+  out_->flush();
+}
+
+void RunLogWriter::writeChunk() {
+  if (nr_rows_ == 0u) return;
+  std::string raw;
+  for (std::vector<char>& column : columns_) {
+    raw.append(column.data(), column.size());
+    column.clear();
+  }
+  const uint64_t raw_size = raw.size();
+
+  uint8_t compression = kNoCompression;
+  std::string stored;
+#ifdef SPARK_VIO_WITH_LZ4
+  if (compress_) {
+    stored.resize(LZ4_compressBound(raw.size()));
+    const int stored_size = LZ4_compress_default(
+        raw.data(), &stored[0], raw.size(), stored.size());
+    // Incompressible chunks are stored as is.
+    if (stored_size > 0 && static_cast<size_t>(stored_size) < raw.size()) {
+      stored.resize(stored_size);
+      compression = kLz4Compression;
+    }
+  }
+#endif
+  if (compression == kNoCompression) stored.swap(raw);
+
+  std::string chunk_header(kChunkMagic, sizeof(kChunkMagic));
+  writeValue(static_cast<uint32_t>(nr_rows_), &chunk_header);
+  writeValue(compression, &chunk_header);
+  writeValue(raw_size, &chunk_header);
+  writeValue(static_cast<uint64_t>(stored.size()), &chunk_header);
+  chunks_.emplace_back(nr_bytes_written_, static_cast<uint32_t>(nr_rows_));
+  write(chunk_header.data(), chunk_header.size());
+  write(stored.data(), stored.size());
+  nr_rows_ = 0u;
+}
+
+void RunLogWriter::writeFooter() {
+  const uint64_t footer_offset = nr_bytes_written_;
+  std::string footer(kFooterMagic, sizeof(kFooterMagic));
+  writeValue(static_cast<uint64_t>(chunks_.size()), &footer);
+  for (const auto& chunk : chunks_) {
+    writeValue(chunk.first, &footer);
+    writeValue(chunk.second, &footer);
+  }
+  writeValue(footer_offset, &footer);
+  footer.append(kEndMagic, sizeof(kEndMagic));
+  write(footer.data(), footer.size());
+}
+
+/* -------------------------------------------------------------------------- */
+// Reads values from a buffer, failing instead of reading past its end.
+class ByteReader {
+ public:
+  ByteReader(const std::string& bytes, size_t offset)
+      : bytes_(bytes), offset_(offset) {}
+
+  template <typename T>
+  bool read(T* value) {
+    if (remaining() < sizeof(T)) return false;
+    std::memcpy(value, bytes_.data() + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+  bool readString(std::string* value) {
+    uint16_t size;
+    if (!read(&size) || remaining() < size) return false;
+    value->assign(bytes_, offset_, size);
+    offset_ += size;
+    return true;
+  }
+  bool readMagic(const char* magic, size_t size) {
+    if (remaining() < size || bytes_.compare(offset_, size, magic, size) != 0) {
+      return false;
+    }
+    offset_ += size;
+    return true;
+  }
+
+  inline size_t offset() const { return offset_; }
+  inline size_t remaining() const { return bytes_.size() - offset_; }
+  inline const char* data() const { return bytes_.data() + offset_; }
+  inline void skip(size_t size) { offset_ += size; }
+
+ private:
+  const std::string& bytes_;
+  size_t offset_;
+};
+
+static bool readHeader(ByteReader* reader, RunLog* run_log) {
+  uint32_t version;
+  uint32_t nr_columns;
+  if (!reader->readMagic(kHeaderMagic, sizeof(kHeaderMagic)) ||
+      !reader->read(&version) || version != kVersion ||
+      !reader->readString(&run_log->stream_name_) ||
+      !reader->read(&nr_columns)) {
+    return false;
+  }
+  run_log->schema_.clear();
+  for (uint32_t i = 0u; i < nr_columns; i++) {
+    std::string name;
+    uint8_t type;
+    uint32_t nr_labels;
+    if (!reader->readString(&name) || !reader->read(&type) ||
+        type > static_cast<uint8_t>(RunLogColumnType::kUint8) ||
+        !reader->read(&nr_labels)) {
+      return false;
+    }
+    std::vector<std::string> labels(nr_labels);
+    for (std::string& label : labels) {
+      if (!reader->readString(&label)) return false;
+    }
+    run_log->schema_.emplace_back(name, static_cast<RunLogColumnType>(type),
+                                  labels);
+  }
+  return !run_log->schema_.empty();
+}
+
+// Appends the rows of the chunk to the columns of the run log.
+static bool readChunk(ByteReader* reader, RunLog* run_log) {
+  uint32_t nr_rows;
+  uint8_t compression;
+  uint64_t raw_size, stored_size;
+  if (!reader->readMagic(kChunkMagic, sizeof(kChunkMagic)) ||
+      !reader->read(&nr_rows) || !reader->read(&compression) ||
+      !reader->read(&raw_size) || !reader->read(&stored_size) ||
+      reader->remaining() < stored_size) {
+    return false;
+  }
+  size_t row_size = 0u;
+  for (const RunLogColumn& column : run_log->schema_) {
+    row_size += runLogColumnTypeSize(column.type_);
+  }
+  if (raw_size != nr_rows * row_size) return false;
+
+  std::string raw;
+  if (compression == kNoCompression) {
+    if (stored_size != raw_size) return false;
+    raw.assign(reader->data(), stored_size);
+  } else if (compression == kLz4Compression) {
+#ifdef SPARK_VIO_WITH_LZ4
+    raw.resize(raw_size);
+    if (LZ4_decompress_safe(reader->data(), &raw[0], stored_size, raw_size) !=
+        static_cast<int>(raw_size)) {
+      return false;
+    }
+#else
+    LOG(ERROR) << "SparkVio was built without LZ4, cannot read compressed "
+                  "run log.";
+    return false;
+#endif
+  } else {
+    return false;
+  }
+  reader->skip(stored_size);
+
+  size_t offset = 0u;
+  for (size_t i = 0u; i < run_log->schema_.size(); i++) {
+    const size_t size =
+        nr_rows * runLogColumnTypeSize(run_log->schema_[i].type_);
+    run_log->columns_[i].insert(run_log->columns_[i].end(),
+                                raw.data() + offset,
+                                raw.data() + offset + size);
+    offset += size;
+  }
+  run_log->nr_rows_ += nr_rows;
+  return true;
+}
+
+bool readRunLog(const std::string& filename, RunLog* run_log) {
+  CHECK_NOTNULL(run_log);
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.good()) {
+    LOG(ERROR) << "Cannot open run log: " << filename;
+    return false;
+  }
+  const std::string bytes((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+  ByteReader reader(bytes, 0u);
+  if (!readHeader(&reader, run_log)) {
+    LOG(ERROR) << "Not a run log: " << filename;
+    return false;
+  }
+  run_log->nr_rows_ = 0u;
+  run_log->columns_.assign(run_log->schema_.size(), std::vector<char>());
+
+  // Offsets of the chunks, from the footer if the file is complete.
+  std::vector<uint64_t> chunk_offsets;
+  bool has_footer = false;
+  if (bytes.size() >= reader.offset() + kEndSize &&
+      bytes.compare(bytes.size() - sizeof(kEndMagic), sizeof(kEndMagic),
+                    kEndMagic, sizeof(kEndMagic)) == 0) {
+    uint64_t footer_offset;
+    ByteReader end_reader(bytes, bytes.size() - kEndSize);
+    end_reader.read(&footer_offset);
+    ByteReader footer_reader(bytes, footer_offset);
+    uint64_t nr_chunks;
+    if (footer_offset < bytes.size() &&
+        footer_reader.readMagic(kFooterMagic, sizeof(kFooterMagic)) &&
+        footer_reader.read(&nr_chunks)) {
+      has_footer = true;
+      for (uint64_t i = 0u; i < nr_chunks && has_footer; i++) {
+        uint64_t offset;
+        uint32_t nr_rows;
+        has_footer = footer_reader.read(&offset) &&
+                     footer_reader.read(&nr_rows);
+        chunk_offsets.push_back(offset);
+      }
+    }
+  }
+
+  if (has_footer) {
+    for (const uint64_t& offset : chunk_offsets) {
+      ByteReader chunk_reader(bytes, offset);
+      if (offset >= bytes.size() || !readChunk(&chunk_reader, run_log)) {
+        LOG(ERROR) << "Corrupted chunk at offset " << offset
+                   << " in run log: " << filename;
+        return false;
+      }
+    }
+  } else {
+    // Incomplete file: read the chunks in turn, up to the last complete one.
+    while (reader.remaining() > 0u && readChunk(&reader, run_log)) {
+    }
+    LOG(WARNING) << "Run log without footer, read the " << run_log->nr_rows_
+                 << " rows of its complete chunks: " << filename;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void writeRunLogAsCsv(const RunLog& run_log, std::ostream* out) {
+  CsvRowWriter csv_writer(run_log.schema_, out);
+  for (size_t row = 0u; row < run_log.nr_rows_; row++) {
+    for (size_t column = 0u; column < run_log.schema_.size(); column++) {
+      switch (run_log.schema_[column].type_) {
+        case RunLogColumnType::kInt32:
+          csv_writer.addInt32(run_log.value<int32_t>(column, row));
+          break;
+        case RunLogColumnType::kInt64:
+          csv_writer.addInt64(run_log.value<int64_t>(column, row));
+          break;
+        case RunLogColumnType::kUint64:
+          csv_writer.addUint64(run_log.value<uint64_t>(column, row));
+          break;
+        case RunLogColumnType::kFloat64:
+          csv_writer.addFloat64(run_log.value<double>(column, row));
+          break;
+        case RunLogColumnType::kUint8:
+          csv_writer.addUint8(run_log.value<uint8_t>(column, row));
+          break;
+      }
+    }
+    csv_writer.endRow();
+    // Bounds the memory of the CSV buffer for long logs.
+    if (row % 4096u == 4095u) csv_writer.flush();
+  }
+}
+
+}  // namespace VIO
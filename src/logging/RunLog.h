@@ -0,0 +1,241 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RunLog.h
+ * @brief  Rows of a run output (poses, frontend and backend statistics...),
+ *         written either as CSV or in a compact columnar binary format.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+///
+// Binary run log format (.runlog), little-endian:
+//
+// Header:  "SVIORLOG", uint32 version,
+//          uint16 length + stream name,
+//          uint32 number of columns, and per column:
+//            uint16 length + name, uint8 type,
+//            uint32 number of labels, and per label: uint16 length + label.
+// Chunks:  "CHNK", uint32 number of rows, uint8 compression (0: none,
+//          1: LZ4 block), uint64 raw size, uint64 stored size, and the stored
+//          bytes. The raw bytes are the values of each column in turn, with
+//          the size of the column type.
+// Footer:  "FOOT", uint64 number of chunks, and per chunk:
+//            uint64 offset in the file, uint32 number of rows,
+//          uint64 offset of the footer, "SVIOREND".
+//
+// Files without footer (e.g. from a run that crashed) are read up to the last
+// complete chunk. See scripts/plotting/run_log.py to read them in Python.
+
+enum class RunLogColumnType : uint8_t {
+  kInt32 = 0,
+  kInt64 = 1,
+  kUint64 = 2,
+  kFloat64 = 3,
+  kUint8 = 4,
+};
+
+// Size of a value of the given type, in bytes.
+size_t runLogColumnTypeSize(const RunLogColumnType& type);
+
+struct RunLogColumn {
+  RunLogColumn(const std::string& name, const RunLogColumnType& type,
+               const std::vector<std::string>& labels = {})
+      : name_(name), type_(type), labels_(labels) {}
+
+  std::string name_;
+  RunLogColumnType type_;
+  // Names of the values of a kUint8 column (e.g. of an enum), written in CSV
+  // instead of the values.
+  std::vector<std::string> labels_;
+};
+
+typedef std::vector<RunLogColumn> RunLogSchema;
+
+// Receives the values of each row, in the order of the columns of the schema.
+class RunLogRowWriter {
+ public:
+  explicit RunLogRowWriter(const RunLogSchema& schema);
+  virtual ~RunLogRowWriter() = default;
+
+  RunLogRowWriter(const RunLogRowWriter&) = delete;
+  RunLogRowWriter& operator=(const RunLogRowWriter&) = delete;
+
+  virtual void addInt32(const int32_t& value) = 0;
+  virtual void addInt64(const int64_t& value) = 0;
+  virtual void addUint64(const uint64_t& value) = 0;
+  virtual void addFloat64(const double& value) = 0;
+  virtual void addUint8(const uint8_t& value) = 0;
+  // Ends the row, after a value for each column.
+  virtual void endRow() = 0;
+
+  // Writes the rows that are ready to be written, periodically.
+  virtual void writeBuffered() = 0;
+  // Writes all rows so far.
+  virtual void flush() = 0;
+
+  inline const RunLogSchema& schema() const { return schema_; }
+
+ protected:
+  // Checks the type of the next column, and returns its index.
+  inline size_t nextColumn(const RunLogColumnType& type) {
+    DCHECK_LT(column_, schema_.size()) << "Too many values in row.";
+    DCHECK(schema_[column_].type_ == type)
+        << "Wrong type for column " << schema_[column_].name_;
+    return column_++;
+  }
+  // Checks that the row has a value for each column, and starts a new row.
+  void startNextRow();
+
+  // Column type of a value.
+  static RunLogColumnType typeOf(const int32_t&) {
+    return RunLogColumnType::kInt32;
+  }
+  static RunLogColumnType typeOf(const int64_t&) {
+    return RunLogColumnType::kInt64;
+  }
+  static RunLogColumnType typeOf(const uint64_t&) {
+    return RunLogColumnType::kUint64;
+  }
+  static RunLogColumnType typeOf(const double&) {
+    return RunLogColumnType::kFloat64;
+  }
+  static RunLogColumnType typeOf(const uint8_t&) {
+    return RunLogColumnType::kUint8;
+  }
+
+ protected:
+  const RunLogSchema schema_;
+
+ private:
+  size_t column_ = 0u;
+};
+
+// Writes the rows as CSV lines, with a header line, buffered until
+// writeBuffered or flush.
+class CsvRowWriter : public RunLogRowWriter {
+ public:
+  // The stream must outlive the writer.
+  CsvRowWriter(const RunLogSchema& schema, std::ostream* out);
+  ~CsvRowWriter();
+
+  void addInt32(const int32_t& value) override { addValue(value); }
+  void addInt64(const int64_t& value) override { addValue(value); }
+  void addUint64(const uint64_t& value) override { addValue(value); }
+  void addFloat64(const double& value) override { addValue(value); }
+  void addUint8(const uint8_t& value) override;
+  void endRow() override;
+
+  void writeBuffered() override { flush(); }
+  void flush() override;
+
+ private:
+  template <typename T>
+  inline void addValue(const T& value) {
+    separate(nextColumn(typeOf(value)));
+    buffer_ << value;
+  }
+  inline void separate(size_t column) {
+    if (column > 0u) buffer_ << ',';
+  }
+
+ private:
+  std::ostream* out_;
+  std::ostringstream buffer_;
+};
+
+// Writes the rows in the binary run log format, in chunks of rows_per_chunk
+// rows, LZ4-compressed if requested and SparkVio was built with LZ4.
+// The footer is written on destruction.
+class RunLogWriter : public RunLogRowWriter {
+ public:
+  // The stream must outlive the writer.
+  RunLogWriter(const std::string& stream_name, const RunLogSchema& schema,
+               std::ostream* out, size_t rows_per_chunk = 4096u,
+               bool compress = true);
+  ~RunLogWriter();
+
+  void addInt32(const int32_t& value) override { addValue(value); }
+  void addInt64(const int64_t& value) override { addValue(value); }
+  void addUint64(const uint64_t& value) override { addValue(value); }
+  void addFloat64(const double& value) override { addValue(value); }
+  void addUint8(const uint8_t& value) override { addValue(value); }
+  void endRow() override;
+
+  // Only full chunks are written, as soon as they are full.
+  void writeBuffered() override {}
+  // Writes the rows so far as a chunk, even if not full.
+  void flush() override;
+
+  // Whether chunks can be LZ4-compressed in this build.
+  static bool IsCompressionAvailable();
+
+ private:
+  template <typename T>
+  inline void addValue(const T& value) {
+    std::vector<char>& column = columns_[nextColumn(typeOf(value))];
+    const size_t size = column.size();
+    column.resize(size + sizeof(T));
+    std::memcpy(column.data() + size, &value, sizeof(T));
+  }
+  void writeHeader(const std::string& stream_name);
+  void writeChunk();
+  void writeFooter();
+  void write(const void* data, size_t size);
+
+ private:
+  std::ostream* out_;
+  const size_t rows_per_chunk_;
+  const bool compress_;
+  // Values of the rows of the current chunk, per column.
+  std::vector<std::vector<char>> columns_;
+  size_t nr_rows_ = 0u;
+  // Offset and number of rows of each chunk written, for the footer.
+  std::vector<std::pair<uint64_t, uint32_t>> chunks_;
+  uint64_t nr_bytes_written_ = 0u;
+};
+
+// Contents of a binary run log.
+struct RunLog {
+  std::string stream_name_;
+  RunLogSchema schema_;
+  size_t nr_rows_ = 0u;
+  // Values of each column, nr_rows_ values of the size of its type.
+  std::vector<std::vector<char>> columns_;
+
+  template <typename T>
+  inline T value(size_t column, size_t row) const {
+    DCHECK_EQ(sizeof(T), runLogColumnTypeSize(schema_.at(column).type_));
+    T value;
+    std::memcpy(&value, columns_.at(column).data() + row * sizeof(T),
+                sizeof(T));
+    return value;
+  }
+};
+
+// Reads a binary run log, returns false if it is not one.
+bool readRunLog(const std::string& filename, RunLog* run_log);
+
+// Writes the run log as CSV, with the same format as the loggers.
+void writeRunLogAsCsv(const RunLog& run_log, std::ostream* out);
+
+}  // namespace VIO
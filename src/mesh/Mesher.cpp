@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <opencv2/imgproc.hpp>
 
+#include "utils/Diagnostics.h"
 #include "utils/Statistics.h"
 #include "utils/Timer.h"
 
@@ -615,7 +616,8 @@ bool Mesher::isNormalAroundAxis(const cv::Point3f& axis,
   DCHECK_GT(tolerance, 0.0);                // Tolerance is positive.
   DCHECK_LT(tolerance, 1.0);  // Tolerance is lower than maximum dot product.
   // Dot product should be close to 1 or -1 if axis is aligned with normal.
-  std::cout << "std::fabs(normal.ddot(axis)): " << std::fabs(normal.ddot(axis)) << std::endl;
+  VIO_DIAG(kMesher, kTrace) << "std::fabs(normal.ddot(axis)): "
+                            << std::fabs(normal.ddot(axis));
   return (std::fabs(normal.ddot(axis)) > 1.0 - tolerance);
 }
 
@@ -698,7 +700,6 @@ void Mesher::clusterPlanesFromMesh(
   VLOG(10) << "Finished plane segmentation.";
   // Do data association between the planes given and the ones segmented.
   VLOG(10) << "Starting plane association...";
-  std::cout << "Starting plane association..." << std::endl;
   std::vector<Plane> new_non_associated_planes;
   associatePlanes(new_planes, *planes, &new_non_associated_planes,
                   FLAGS_normal_tolerance_plane_plane_association,
@@ -743,7 +744,7 @@ void Mesher::segmentPlanesInMesh(
   CHECK_NOTNULL(seed_planes);
   CHECK_NOTNULL(new_planes);
 
-  std::cout << "segment Planes In Mesh start!" << std::endl;
+  VIO_DIAG(kMesher, kDebug) << "segment Planes In Mesh start!";
 
   // Clean seed_planes of lmk_ids:
   for (Plane& seed_plane : *seed_planes) {
@@ -760,16 +761,16 @@ void Mesher::segmentPlanesInMesh(
   Mesh3D::Polygon polygon;
   cv::Mat z_components(1, 0, CV_32F);
   cv::Mat walls(0, 0, CV_32FC2);
-  std::cout << "mesh_3d_.getNumberOfPolygons(): " << mesh_3d_.getNumberOfPolygons() << std::endl;
+  VIO_DIAG(kMesher, kDebug) << "mesh_3d_.getNumberOfPolygons(): "
+                            << mesh_3d_.getNumberOfPolygons();
   for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
     CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
     CHECK_EQ(polygon.size(), mesh_polygon_dim);
     const Vertex3D& p1 = polygon.at(0).getVertexPosition();
     const Vertex3D& p2 = polygon.at(1).getVertexPosition();
     const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-    std::cout << "p1: " << p1 << std::endl;
-    std::cout << "p2: " << p2 << std::endl;
-    std::cout << "p3: " << p3 << std::endl;
+    VIO_DIAG(kMesher, kTrace) << "p1: " << p1 << " p2: " << p2
+                              << " p3: " << p3;
 
     // Calculate normal of the triangle in the mesh.
     // The normals are in the world frame of reference.
@@ -803,10 +804,8 @@ void Mesher::segmentPlanesInMesh(
         z_components.push_back(p1.z);
         z_components.push_back(p2.z);
         z_components.push_back(p3.z);
-        std::cout << "p1.z: " << p1.z << std::endl;
-        std::cout << "p2.z: " << p2.z << std::endl;
-        std::cout << "p3.z: " << p3.z << std::endl;
-        std::cout << std::endl;
+        VIO_DIAG(kMesher, kTrace) << "p1.z: " << p1.z << " p2.z: " << p2.z
+                                  << " p3.z: " << p3.z;
       } else if ((FLAGS_only_use_non_clustered_points ? !is_polygon_on_a_plane
                                                       : true) &&
                  isNormalPerpendicularToAxis(vertical, triangle_normal,
@@ -1038,8 +1037,8 @@ void Mesher::segmentHorizontalPlanes(std::vector<Plane>* horizontal_planes,
                                      const cv::Mat& z_components) {
   CHECK_NOTNULL(horizontal_planes);
   CHECK_NOTNULL(plane_id);
-  std::cout << "normal: " << normal << std::endl;
-  std::cout << "z_components: " << std::endl << z_components << std::endl;
+  VIO_DIAG(kMesher, kDebug) << "normal: " << normal;
+  VIO_DIAG(kMesher, kTrace) << "z_components: \n" << z_components;
   ////////////////////////////// 1D Histogram //////////////////////////////////
   VLOG(10) << "Starting calculate 1D histogram.";
   z_hist_.calculateHistogram(z_components, FLAGS_log_histogram_1D);
@@ -1121,10 +1120,6 @@ void Mesher::segmentHorizontalPlanes(std::vector<Plane>* horizontal_planes,
                << "\t distance: " << plane_distance << "\n\t plane id: "
                << gtsam::DefaultKeyFormatter(plane_symbol.key())
                << "\n\t cluster id: " << cluster_id;
-      std::cout << "Segmented an horizontal plane with:\n"
-                << "\t distance: " << plane_distance << "\n\t plane id: "
-                << gtsam::DefaultKeyFormatter(plane_symbol.key())
-                << "\n\t cluster id: " << cluster_id << std::endl;
       horizontal_planes->push_back(
           Plane(plane_symbol, normal, plane_distance,
                 // Currently filled after this function...
@@ -1163,9 +1158,6 @@ void Mesher::associatePlanes(const std::vector<Plane>& segmented_planes,
     VLOG(0) << "No planes in backend, just copy the " << segmented_planes.size()
             << " segmented planes to the set of "
             << "backend planes, skipping data association.";
-    std::cout << "No planes in backend, just copy the " << segmented_planes.size()
-              << " segmented planes to the set of "
-              << "backend planes, skipping data association." << std::endl;
     *non_associated_planes = segmented_planes;
   } else {
     // Planes tmp will contain the new segmented planes.
@@ -1192,7 +1184,8 @@ void Mesher::associatePlanes(const std::vector<Plane>& segmented_planes,
                                          distance_tolerance)) {
           // We found a plane association
           uint64_t backend_plane_index = plane_backend.getPlaneSymbol().index();
-          std::cout << "backend_plane_index: " << backend_plane_index << std::endl;
+          VIO_DIAG(kMesher, kDebug)
+              << "backend_plane_index: " << backend_plane_index;
           // Check that it was not associated before.
           if (std::find(associated_plane_ids.begin(),
                         associated_plane_ids.end(),
@@ -1326,9 +1319,10 @@ void Mesher::updateMesh3D(
   // THIS CALL IS NOT THREAD-SAFE
   stereo_frame_ptr->filterTrianglesWithGradients(
       mesh_2d_pixels, &mesh_2d_filtered, FLAGS_max_grad_in_triangle);
-  std::cout << "mesh_2d_pixels size:   " << mesh_2d_pixels.size() << std::endl;
-  std::cout << "mesh_2d_filtered size: " << mesh_2d_filtered.size() << std::endl;
-  std::cout << "FLAGS_max_grad_in_triangle: " << FLAGS_max_grad_in_triangle << std::endl;
+  VIO_DIAG(kMesher, kDebug)
+      << "mesh_2d_pixels size: " << mesh_2d_pixels.size()
+      << ", mesh_2d_filtered size: " << mesh_2d_filtered.size()
+      << ", FLAGS_max_grad_in_triangle: " << FLAGS_max_grad_in_triangle;
   if (mesh_2d_filtered_for_viz) *mesh_2d_filtered_for_viz = mesh_2d_filtered;
 
   populate3dMeshTimeHorizon(mesh_2d_filtered, *points_with_id_all,
@@ -14,7 +14,10 @@
 
 #include "pipeline/Pipeline.h"
 
+#include <algorithm>
+#include <cmath>
 #include <future>
+#include <queue>
 #include <string>
 #include <utility>
 #include <vector>
@@ -28,6 +31,8 @@
 #include "StereoVisionFrontEnd.h"
 #include "initial/InitializationBackEnd.h"
 #include "initial/InitializationFromImu.h"
+#include "pipeline/PipelineRegression.h"
+#include "utils/Diagnostics.h"
 #include "utils/Statistics.h"
 #include "utils/Timer.h"
 
@@ -79,6 +84,9 @@ DEFINE_int32(min_num_obs_for_mesher_points, 4,
 DEFINE_int32(num_frames_vio_init, 25,
              "Minimum number of frames for the online "
              "gravity-aligned initialization.");
+DEFINE_int32(online_alignment_retry_interval, 5,
+             "Number of new frames in the online initialization window "
+             "before retrying a failed alignment.");
 
 // TODO(Sandro): Create YAML file for initialization and read in!
 DEFINE_double(smart_noise_sigma_bundle_adjustment, 1.5,
@@ -90,6 +98,31 @@ DEFINE_double(outlier_rejection_bundle_adjustment, 30,
 DEFINE_double(between_translation_bundle_adjustment, 0.5,
               "Between factor precision for bundle adjustment"
               " in initialization.");
+DEFINE_string(checkpoint_path, "",
+              "Path of the estimator checkpoint written every "
+              "checkpoint_every_n_keyframes keyframes.");
+DEFINE_int32(checkpoint_every_n_keyframes, 0,
+             "Write an estimator checkpoint asynchronously every n keyframes "
+             "to checkpoint_path (0 disables checkpoints).");
+DEFINE_string(restore_checkpoint_path, "",
+              "If not empty, initialize the pipeline from this checkpoint.");
+DEFINE_string(imu_warm_start_path, "",
+              "If not empty, the IMU bias, gravity and IMU bias covariance are "
+              "loaded from this file (if it exists) to seed the initial bias "
+              "prior, and the ones of this run are saved to it at shutdown. "
+              "Only used when initializing from IMU or online: ground-truth "
+              "and checkpoint initializations have their own bias.");
+DEFINE_double(imu_warm_start_covariance_inflation, 10.0,
+              "Inflation of the IMU bias covariance loaded for warm start, "
+              "to account for the bias drift between runs.");
+DEFINE_double(imu_bias_convergence_rate, 1e-3,
+              "The IMU bias is considered converged when its rate of change "
+              "stays below this value (norm of the 6D bias per second)...");
+DEFINE_int32(imu_bias_convergence_keyframes, 10,
+             "...during this many consecutive keyframes.");
+DEFINE_bool(hot_reinitialization, true,
+            "Re-initialize the pipeline in place, without shutting down and "
+            "relaunching its threads.");
 DEFINE_int32(max_time_allowed_for_keyframe_callback,
              5u,
              "Maximum time allowed for processing keyframe rate callback "
@@ -114,14 +147,17 @@ Pipeline::Pipeline(const PipelineParams& params, bool parallel_run)
       parallel_run_(parallel_run),
       stereo_frontend_input_queue_("stereo_frontend_input_queue"),
       stereo_frontend_output_queue_("stereo_frontend_output_queue"),
-      initialization_frontend_output_queue_(
-          "initialization_frontend_output_queue"),
       backend_input_queue_("backend_input_queue"),
       backend_output_queue_("backend_output_queue"),
       mesher_input_queue_("mesher_input_queue"),
       mesher_output_queue_("mesher_output_queue"),
       visualizer_input_queue_("visualizer_input_queue"),
-      visualizer_output_queue_("visualizer_output_queue") {
+      visualizer_output_queue_("visualizer_output_queue"),
+      init_alignment_schedule_(FLAGS_num_frames_vio_init,
+                               FLAGS_online_alignment_retry_interval),
+      estimated_n_gravity_(params.backend_params_->n_gravity_),
+      imu_bias_convergence_monitor_(FLAGS_imu_bias_convergence_rate,
+                                    FLAGS_imu_bias_convergence_keyframes) {
   if (FLAGS_deterministic_random_number_generator) setDeterministicPipeline();
 
   // Instantiate stereo tracker (class that tracks implements estimation
@@ -131,12 +167,51 @@ Pipeline::Pipeline(const PipelineParams& params, bool parallel_run)
                                              gtsam::imuBias::ConstantBias(),
                                              frontend_params_,
                                              FLAGS_log_output);
+  // The backend load is published by the thread feeding the backend.
+  vio_frontend_->registerBackendLoadCallback([this]() {
+    BackendLoad backend_load;
+    backend_load.queue_size_ = backend_queue_size_;
+    backend_load.last_spin_time_ = backend_last_spin_time_;
+    return backend_load;
+  });
 
   // Instantiate feature selector: not used in vanilla implementation.
   if (FLAGS_use_feature_selection) {
     feature_selector_ =
         VIO::make_unique<FeatureSelector>(frontend_params_, *backend_params_);
   }
+
+  // Warm restart from a previous run.
+  if (!FLAGS_restore_checkpoint_path.empty()) {
+    LOG_IF(ERROR, !restoreCheckpoint(FLAGS_restore_checkpoint_path))
+        << "Could not restore checkpoint, using the initialization mode in "
+           "the backend params instead.";
+  }
+
+  // IMU calibration from a previous run.
+  if (!FLAGS_imu_warm_start_path.empty()) {
+    std::unique_ptr<ImuWarmStartState> imu_warm_start =
+        VIO::make_unique<ImuWarmStartState>();
+    if (loadImuWarmStartState(FLAGS_imu_warm_start_path,
+                              imu_warm_start.get())) {
+      imu_warm_start->print();
+      // Carried over until estimated again at initialization.
+      if (std::fabs(imu_warm_start->n_gravity_.norm() -
+                    backend_params_->n_gravity_.norm()) >
+          0.01 * backend_params_->n_gravity_.norm()) {
+        LOG(WARNING) << "Gravity of the IMU warm start ("
+                     << imu_warm_start->n_gravity_.norm()
+                     << ") differs from the one in the backend params ("
+                     << backend_params_->n_gravity_.norm()
+                     << "), ignoring it.";
+      } else {
+        estimated_n_gravity_ = imu_warm_start->n_gravity_;
+      }
+      imu_warm_start_ = std::move(imu_warm_start);
+    } else {
+      LOG(WARNING) << "No IMU warm start, starting from scratch.";
+    }
+  }
 }
 
 /* -------------------------------------------------------------------------- */
@@ -205,8 +280,8 @@ void Pipeline::processKeyframe(
     const ImuFrontEnd::PreintegratedImuMeasurements& pim,
     const TrackingStatus& kf_tracking_status_stereo,
     const gtsam::Pose3& relative_pose_body_stereo,
-    const DebugTrackerInfo&
-        debug_tracker_info) {  // Only for output of pipeline
+    const DebugTrackerInfo& debug_tracker_info,  // Only for output of pipeline
+    const boost::optional<VioNavState>& reinit_state) {
   //////////////////// BACK-END ////////////////////////////////////////////////
   // Push to backend input.
   // This should be done inside the frontend!!!!
@@ -214,7 +289,9 @@ void Pipeline::processKeyframe(
   VLOG(2) << "Push input payload to Backend.";
   backend_input_queue_.push(VioBackEndInputPayload(
       last_stereo_keyframe.getTimestamp(), statusSmartStereoMeasurements,
-      kf_tracking_status_stereo, pim, relative_pose_body_stereo, &planes_));
+      kf_tracking_status_stereo, pim, relative_pose_body_stereo, &planes_,
+      reinit_state));
+  publishBackendLoad();
 
   // This should be done inside those who need the backend results
   // IN this case the logger!!!!!
@@ -224,6 +301,12 @@ void Pipeline::processKeyframe(
   std::shared_ptr<VioBackEndOutputPayload> backend_output_payload =
       backend_output_queue_.popBlocking();
   LOG_IF(WARNING, !backend_output_payload) << "Missing backend output payload.";
+  updateReInitLatency(static_cast<bool>(reinit_state));
+  publishBackendLoad();
+  if (backend_output_payload) {
+    updateCheckpoint(*backend_output_payload, last_stereo_keyframe);
+    updateImuBiasConvergence(*backend_output_payload);
+  }
 
   ////////////////// CREATE AND VISUALIZE MESH /////////////////////////////////
   PointsWithIdMap points_with_id_VIO;
@@ -381,7 +464,8 @@ void Pipeline::spinSequential() {
       stereo_frontend_output_payload->statusSmartStereoMeasurements_,
       stereo_frontend_output_payload->tracker_status_,
       stereo_frontend_output_payload->pim_,
-      stereo_frontend_output_payload->relative_pose_body_stereo_, &planes_));
+      stereo_frontend_output_payload->relative_pose_body_stereo_, &planes_,
+      stereo_frontend_output_payload->reinit_state_));
 
   // Spin once backend. Do not run in parallel.
   CHECK(vio_backend_);
@@ -390,6 +474,12 @@ void Pipeline::spinSequential() {
   // Pop blocking from backend.
   const auto& backend_output_payload = backend_output_queue_.popBlocking();
   CHECK(backend_output_payload);
+  updateReInitLatency(
+      static_cast<bool>(stereo_frontend_output_payload->reinit_state_));
+  publishBackendLoad();
+  updateCheckpoint(*backend_output_payload,
+                   stereo_frontend_output_payload->stereo_frame_lkf_);
+  updateImuBiasConvergence(*backend_output_payload);
 
   const auto& stereo_keyframe =
       stereo_frontend_output_payload->stereo_frame_lkf_;
@@ -421,18 +511,19 @@ void Pipeline::spinSequential() {
     // Find regularities in the mesh if we are using RegularVIO backend.
     // TODO create a new class that is mesh segmenter or plane extractor.
     if (FLAGS_extract_planes_from_the_scene) {
-      std::cout << "extract planes from the scene!" << std::endl;
+      VIO_DIAG(kPipeline, kDebug) << "extract planes from the scene!";
       CHECK_EQ(backend_type_, 1);  // Use Regular VIO
       mesher_.clusterPlanesFromMesh(&planes_, points_with_id_VIO);
-    for(const auto &plane : planes_){
-        std::cout << "plane id: " << plane.getPlaneSymbol().key() << std::endl <<
-                  "plane normal: " << plane.normal_ << std::endl <<
-                  "plane distance: " << plane.distance_ << std::endl <<
-                  "plane.lmk_ids.size: " << plane.lmk_ids_.size() << std::endl <<
-                  "plane color: " << plane.triangle_cluster_.cluster_id_ << std::endl;
-    }
+      for (const auto& plane : planes_) {
+        VIO_DIAG(kPipeline, kDebug)
+            << "plane id: " << plane.getPlaneSymbol().key()
+            << "\nplane normal: " << plane.normal_
+            << "\nplane distance: " << plane.distance_
+            << "\nplane.lmk_ids.size: " << plane.lmk_ids_.size()
+            << "\nplane color: " << plane.triangle_cluster_.cluster_id_;
+      }
     } else {
-      std::cout << "do not extract planes from the scene!" << std::endl;
+      VIO_DIAG(kPipeline, kDebug) << "do not extract planes from the scene!";
       LOG_IF_EVERY_N(
           WARNING,
           backend_type_ == 1u && (FLAGS_regular_vio_backend_modality == 2u ||
@@ -563,15 +654,25 @@ void Pipeline::shutdown() {
                               "shutdown.";
   LOG(INFO) << "Shutting down VIO pipeline.";
   shutdown_ = true;
+  logQueueAndThreadStats();
   stopThreads();
   // if (parallel_run_) {
   joinThreads();
   //}
+  if (!FLAGS_imu_warm_start_path.empty()) {
+    LOG_IF(ERROR, !saveImuWarmStart()) << "Could not save IMU warm start.";
+  }
   LOG(INFO) << "Pipeline destructor finished.";
 }
 
 /* -------------------------------------------------------------------------- */
 bool Pipeline::initialize(const StereoImuSyncPacket& stereo_imu_sync_packet) {
+  if (restored_checkpoint_) {
+    // Warm restart: only done once.
+    std::unique_ptr<PipelineCheckpoint> checkpoint =
+        std::move(restored_checkpoint_);
+    return initializeFromCheckpoint(stereo_imu_sync_packet, *checkpoint);
+  }
   switch (backend_params_->autoInitialize_) {
     case 0:
       // If the gtNavState is identity, the params provider probably did a
@@ -600,6 +701,10 @@ void Pipeline::checkReInitialize(
   // Re-initialize pipeline if requested
   if (is_initialized_ &&
       stereo_imu_sync_packet.getReinitPacket().getReinitFlag()) {
+    if (FLAGS_hot_reinitialization) {
+      hotReInitialize(stereo_imu_sync_packet);
+      return;
+    }
     LOG(WARNING) << "Re-initialization triggered!";
     // Shutdown pipeline first
     shutdown();
@@ -622,7 +727,50 @@ void Pipeline::checkReInitialize(
     visualizer_.restart();
     // Resume pipeline
     resume();
-    initialization_frontend_output_queue_.resume();
+    resetOnlineInitialization();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::hotReInitialize(
+    const StereoImuSyncPacket& stereo_imu_sync_packet) {
+  CHECK(is_initialized_);
+  CHECK(stereo_imu_sync_packet.getReinitFlag());
+  LOG(WARNING) << "Hot re-initialization triggered at frame: "
+               << stereo_imu_sync_packet.getStereoFrame().getFrameId();
+  reinit_tic_ = utils::Timer::tic();
+  is_reinit_seeded_ = false;
+  is_reinit_pending_ = true;
+
+  // Data queued before the re-initialization refers to the old trajectory,
+  // drop it. Threads are kept alive, waiting on their queues.
+  // Only the frontend input is cleared here: the keyframe thread may be
+  // waiting on the backend for a keyframe it already pushed, so the frontend
+  // outputs are dropped by the keyframe thread itself, until the one carrying
+  // the re-initialization state (see processKeyframePop).
+  // The re-initialization packet itself is pushed by spinOnce, and resets the
+  // frontend, which in turn resets the backend with the re-initialization
+  // state.
+  const size_t n_dropped = stereo_frontend_input_queue_.clear();
+  LOG_IF(WARNING, n_dropped > 0u)
+      << "Dropped " << n_dropped << " payloads for hot re-initialization.";
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::updateReInitLatency(bool is_reinit_seed) {
+  if (is_reinit_seed) {
+    // The backend has been reset, wait for the first tracked keyframe.
+    is_reinit_seeded_ = true;
+  } else if (is_reinit_seeded_) {
+    is_reinit_seeded_ = false;
+    if (is_reinit_pending_) {
+      is_reinit_pending_ = false;
+      auto reinit_duration = utils::Timer::toc(reinit_tic_).count();
+      LOG(WARNING) << "Hot re-initialization took " << reinit_duration
+                   << " ms until first pose.";
+      utils::StatsCollector("Pipeline Reinit Time To First Pose [ms]")
+          .AddSample(reinit_duration);
+    }
   }
 }
 
@@ -639,9 +787,9 @@ bool Pipeline::initializeFromGroundTruth(
   const StereoFrame& stereo_frame_lkf = vio_frontend_->processFirstStereoFrame(
       stereo_imu_sync_packet.getStereoFrame());
 
-  // Initialize Backend using ground-truth.
+  // Initialize Backend using ground-truth. The ground-truth bias is kept
+  // even with an IMU warm start.
   initBackend(&vio_backend_,
-              stereo_imu_sync_packet,
               initial_ground_truth_state,
               stereo_frame_lkf);
 
@@ -665,18 +813,70 @@ bool Pipeline::initializeFromIMU(
 
   // Initialize Stereo Frontend.
   CHECK(vio_frontend_);
+  // The bias of a previous run is better than the static guess.
+  warmStartImuBias(false, &initial_state_estimate.imu_bias_);
+  // Static vehicle: the accelerometer measures the negative of gravity.
+  const ImuAcc mean_acc =
+      stereo_imu_sync_packet.getImuAccGyr().topRows(3).rowwise().mean();
+  estimated_n_gravity_ =
+      -(initial_state_estimate.pose_.rotation().matrix() *
+        (mean_acc - initial_state_estimate.imu_bias_.accelerometer()));
   const StereoFrame& stereo_frame_lkf = vio_frontend_->processFirstStereoFrame(
       stereo_imu_sync_packet.getStereoFrame());
 
   // Initialize Backend using IMU data.
   initBackend(&vio_backend_,
-              stereo_imu_sync_packet,
               initial_state_estimate,
               stereo_frame_lkf);
 
   return true;
 }
 
+/* -------------------------------------------------------------------------- */
+// The backend is re-seeded with the state at the last keyframe of the
+// checkpoint, with its covariance as prior: the factor graph and the feature
+// tracks are started from scratch.
+bool Pipeline::initializeFromCheckpoint(
+    const StereoImuSyncPacket& stereo_imu_sync_packet,
+    const PipelineCheckpoint& checkpoint) {
+  LOG(INFO) << "------------------- Initialize Pipeline from checkpoint with "
+               "frame k = "
+            << stereo_imu_sync_packet.getStereoFrame().getFrameId()
+            << "--------------------";
+  checkpoint.print();
+
+  // Initialize Stereo Frontend, keep counting landmarks from the checkpoint.
+  CHECK(vio_frontend_);
+  vio_frontend_->setLandmarkCount(checkpoint.landmark_count_);
+  vio_frontend_->updateAndResetImuBias(checkpoint.imu_bias_lkf_);
+  const StereoFrame& stereo_frame_lkf = vio_frontend_->processFirstStereoFrame(
+      stereo_imu_sync_packet.getStereoFrame());
+
+  // Initialize Backend using the checkpoint state.
+  const VioNavState checkpoint_state(checkpoint.W_Pose_Blkf_,
+                                     checkpoint.W_Vel_Blkf_,
+                                     checkpoint.imu_bias_lkf_);
+  initBackend(&vio_backend_, checkpoint_state, stereo_frame_lkf);
+
+  // The state is the one of the last keyframe of the checkpoint, resume at
+  // that frame for it to be exact.
+  LOG_IF(WARNING,
+         stereo_frame_lkf.getTimestamp() != checkpoint.last_keyframe_timestamp_)
+      << "Resuming at timestamp " << stereo_frame_lkf.getTimestamp()
+      << " with the state of the checkpoint keyframe "
+      << checkpoint.last_keyframe_id_
+      << " (timestamp: " << checkpoint.last_keyframe_timestamp_ << ").";
+  // Keep counting keyframes from the checkpoint, and use its covariance for
+  // the priors.
+  CHECK(vio_backend_);
+  vio_backend_->restoreStateAndSetPriors(stereo_frame_lkf.getTimestamp(),
+                                         checkpoint_state,
+                                         checkpoint.state_covariance_lkf_,
+                                         checkpoint.cur_kf_id_);
+
+  return true;
+}
+
 /* -------------------------------------------------------------------------- */
 // TODO (Toni): move this as much as possible inside initialization...
 bool Pipeline::initializeOnline(
@@ -687,7 +887,6 @@ bool Pipeline::initializeOnline(
 
   CHECK(vio_frontend_);
   CHECK_GE(frame_id, init_frame_id_);
-  CHECK_GE(init_frame_id_ + FLAGS_num_frames_vio_init, frame_id);
 
   // TODO(Sandro): Find a way to optimize this
   // Create ImuFrontEnd with non-zero gravity (zero bias)
@@ -707,136 +906,360 @@ bool Pipeline::initializeOnline(
 
   /////////////////// FIRST FRAME //////////////////////////////////////////////
   if (frame_id == init_frame_id_) {
+    resetOnlineInitialization();
     // Set trivial bias, gravity and force 5/3 point method for initialization
     vio_frontend_->prepareFrontendForOnlineAlignment();
     // Initialize Stereo Frontend.
     StereoFrame stereo_frame_lkf = vio_frontend_->processFirstStereoFrame(
         stereo_imu_sync_init.getStereoFrame());
     return false;
+  }
 
-    /////////////////// FRONTEND
-    /////////////////////////////////////////////////////
-  } else {
-    // Check trivial bias and gravity vector for online initialization
-    vio_frontend_->checkFrontendForOnlineAlignment();
-    // Spin frontend once with enforced keyframe and 53-point method
-    // TODO why is this copying? (by doing make_shared?)
-    auto frontend_output = vio_frontend_->spinOnce(
-        std::make_shared<StereoImuSyncPacket>(stereo_imu_sync_init));
-    const StereoFrame stereo_frame_lkf = frontend_output.stereo_frame_lkf_;
-    // TODO(Sandro): Optionally add AHRS PIM
-    InitializationInputPayload frontend_init_output(
-        frontend_output.is_keyframe_,
-        frontend_output.statusSmartStereoMeasurements_,
-        frontend_output.tracker_status_,
-        frontend_output.relative_pose_body_stereo_,
-        frontend_output.stereo_frame_lkf_, frontend_output.pim_,
-        frontend_output.debug_tracker_info_);
-    initialization_frontend_output_queue_.push(frontend_init_output);
-
-    // TODO(Sandro): Find a way to optimize this
-    // This queue is used for the the backend optimization
-    const auto& imu_stamps = stereo_imu_sync_packet.getImuStamps();
-    const auto& imu_accgyr = stereo_imu_sync_packet.getImuAccGyr();
-    const auto& pim =
-        imu_frontend_real.preintegrateImuMeasurements(imu_stamps, imu_accgyr);
-    StereoFrontEndOutputPayload frontend_real_output(
-        frontend_output.is_keyframe_,
-        frontend_output.statusSmartStereoMeasurements_,
-        frontend_output.tracker_status_,
-        frontend_output.relative_pose_body_stereo_,
-        frontend_output.stereo_frame_lkf_, pim,
-        frontend_output.debug_tracker_info_);
-    // This queue is used for the backend after initialization
-    VLOG(2) << "Initialization: Push input payload to Backend.";
-    stereo_frontend_output_queue_.push(frontend_real_output);
-    /////////
-
-    // Only process set of frontend outputs after specific number of frames
-    if (frame_id < (init_frame_id_ + FLAGS_num_frames_vio_init)) {
+  /////////////////// FRONTEND /////////////////////////////////////////////////
+  // The frontend keeps tracking while the alignment job runs.
+  // Check trivial bias and gravity vector for online initialization
+  vio_frontend_->checkFrontendForOnlineAlignment();
+  // Spin frontend once with enforced keyframe and 53-point method
+  // TODO why is this copying? (by doing make_shared?)
+  auto frontend_output = vio_frontend_->spinOnce(
+      std::make_shared<StereoImuSyncPacket>(stereo_imu_sync_init));
+  // TODO(Sandro): Optionally add AHRS PIM
+  init_alignment_window_.push_back(InitializationInputPayload(
+      frontend_output.is_keyframe_,
+      frontend_output.statusSmartStereoMeasurements_,
+      frontend_output.tracker_status_,
+      frontend_output.relative_pose_body_stereo_,
+      frontend_output.stereo_frame_lkf_, frontend_output.pim_,
+      frontend_output.debug_tracker_info_));
+
+  // TODO(Sandro): Find a way to optimize this
+  // This window is replayed by the backend after initialization.
+  const auto& imu_stamps = stereo_imu_sync_packet.getImuStamps();
+  const auto& imu_accgyr = stereo_imu_sync_packet.getImuAccGyr();
+  const auto& pim =
+      imu_frontend_real.preintegrateImuMeasurements(imu_stamps, imu_accgyr);
+  init_replay_window_.push_back(StereoFrontEndOutputPayload(
+      frontend_output.is_keyframe_,
+      frontend_output.statusSmartStereoMeasurements_,
+      frontend_output.tracker_status_,
+      frontend_output.relative_pose_body_stereo_,
+      frontend_output.stereo_frame_lkf_, pim,
+      frontend_output.debug_tracker_info_));
+  init_alignment_schedule_.addFrame();
+  CHECK_EQ(init_alignment_window_.size(), init_replay_window_.size());
+  CHECK_EQ(init_alignment_window_.size(), init_alignment_schedule_.nrFrames());
+
+  ///////////////////////////// ONLINE INITIALIZER ////////////////////////////
+  if (!init_alignment_job_.valid()) {
+    // Slide the window: keep only the latest frames for the next attempt.
+    for (size_t i = init_alignment_schedule_.slide(); i > 0u; i--) {
+      init_alignment_window_.pop_front();
+      init_replay_window_.pop_front();
+    }
+    // Only process set of frontend outputs after specific number of frames,
+    // and retry a failed alignment only once the window has moved on.
+    if (!init_alignment_schedule_.shouldLaunch()) return false;
+    launchOnlineAlignment();
+  }
+
+  // Do not block on the alignment while running in parallel.
+  if (parallel_run_ &&
+      init_alignment_job_.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready) {
+    VLOG(2) << "Alignment running, frames buffered for replay: "
+            << init_replay_window_.size();
+    return false;
+  }
+  OnlineAlignmentResult result = init_alignment_job_.get();
+
+  if (!result.is_success_) {
+    // Retry on the next window.
+    LOG(ERROR) << "Bundle adjustment or alignment failed! (attempt "
+               << init_alignment_schedule_.nrAttempts() << ")";
+    return false;
+  }
+  LOG(INFO) << "Bundle adjustment and alignment successful!";
+  LOG(WARNING) << "Time used for initialization: " << result.duration_ms_
+               << " (ms) in " << init_alignment_schedule_.nrAttempts()
+               << " attempts.";
+  utils::StatsCollector("Pipeline Online Initialization Timing [ms]")
+      .AddSample(result.duration_ms_);
+
+  // Reset frontend with non-trivial gravity and remove 53-enforcement.
+  // Update frontend with initial gyro bias estimate.
+  vio_frontend_->resetFrontendAfterOnlineAlignment(backend_params_->n_gravity_,
+                                                   result.gyro_bias_);
+
+  ///////////////////////////// BACKEND ////////////////////////////////////////
+  // Initialize backend with pose estimate from gravity alignment
+  // Create initial state for initialization from online gravity
+  // The aligned state is the one of the first keyframe of the window: seed
+  // the backend there.
+  VioNavState initial_state_OGA(result.init_navstate_,
+                                ImuBias(gtsam::Vector3(), result.gyro_bias_));
+  // The alignment only estimates the gyroscope bias.
+  warmStartImuBias(true, &initial_state_OGA.imu_bias_);
+  // The world frame is aligned with gravity, only its norm is estimated.
+  estimated_n_gravity_ =
+      backend_params_->n_gravity_.normalized() * result.g_iter_b0_.norm();
+  initBackend(&vio_backend_,
+              initial_state_OGA,
+              init_replay_window_.front().stereo_frame_lkf_);
+
+  // Replay the rest of the aligned window, and the frames tracked while
+  // aligning.
+  VLOG(2) << "Initialization: Push " << init_replay_window_.size() - 1u
+          << " input payloads to Backend.";
+  for (size_t i = 1u; i < init_replay_window_.size(); i++) {
+    stereo_frontend_output_queue_.push(init_replay_window_[i]);
+  }
+  init_alignment_window_.clear();
+  init_replay_window_.clear();
+  init_alignment_schedule_.reset();
+  LOG(INFO) << "Initialization finalized.";
+
+  // TODO(Sandro): Create check-return for function
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::launchOnlineAlignment() {
+  CHECK(!init_alignment_job_.valid());
+  CHECK(!init_alignment_window_.empty());
+  init_alignment_schedule_.launch();
+  LOG(INFO) << "Launching online alignment with "
+            << init_alignment_window_.size() << " frames.";
+
+  // Adjust parameters for Bundle Adjustment
+  // TODO(Sandro): Create YAML file for initialization and read in!
+  VioBackEndParams backend_params_init(*backend_params_);
+  backend_params_init.smartNoiseSigma_ =
+      FLAGS_smart_noise_sigma_bundle_adjustment;
+  backend_params_init.outlierRejection_ =
+      FLAGS_outlier_rejection_bundle_adjustment;
+  backend_params_init.betweenTranslationPrecision_ =
+      FLAGS_between_translation_bundle_adjustment;
+
+  // Zero bias in initial propagation: it is set once by
+  // prepareFrontendForOnlineAlignment, and the frontend keeps integrating
+  // with it meanwhile, so a retry must not reset it.
+  // TODO(Sandro): Remove this, once AHRS is implemented
+  const gtsam::Vector3 gyro_bias =
+      vio_frontend_->getCurrentImuBias().gyroscope();
+
+  // The job works on its own copy of the window, so that the frontend can keep
+  // on filling the window meanwhile.
+  std::queue<InitializationInputPayload> output_frontend(
+      init_alignment_window_);
+  const bool log_output = FLAGS_log_output;
+  init_alignment_job_ = std::async(
+      parallel_run_ ? std::launch::async : std::launch::deferred,
+      [backend_params_init, gyro_bias, log_output,
+       output_frontend]() mutable {
+        auto tic_full_init = utils::Timer::tic();
+        OnlineAlignmentResult result;
+        result.gyro_bias_ = gyro_bias;
+
+        // Create initial backend
+        const StereoFrame& stereo_frame =
+            output_frontend.front().stereo_frame_lkf_;
+        InitializationBackEnd initial_backend(
+            stereo_frame.getBPoseCamLRect(),
+            stereo_frame.getLeftUndistRectCamMat(),
+            stereo_frame.getBaseline(),
+            backend_params_init, log_output);
+
+        result.is_success_ =
+            initial_backend.bundleAdjustmentAndGravityAlignment(
+                output_frontend, &result.gyro_bias_, &result.g_iter_b0_,
+                &result.init_navstate_);
+        result.duration_ms_ = utils::Timer::toc(tic_full_init).count();
+        return result;
+      });
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::resetOnlineInitialization() {
+  // Results of a running alignment are discarded.
+  if (init_alignment_job_.valid()) init_alignment_job_.get();
+  init_alignment_window_.clear();
+  init_replay_window_.clear();
+  init_alignment_schedule_.reset();
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::updateCheckpoint(
+    const VioBackEndOutputPayload& backend_output_payload,
+    const StereoFrame& last_stereo_keyframe) {
+  // Next landmark id of the tracker. The frontend may be ahead of this
+  // keyframe, which only skips some ids after restoring.
+  CHECK(vio_frontend_);
+  const LandmarkId landmark_count = vio_frontend_->getLandmarkCount();
+
+  {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+    checkpoint_.timestamp_lkf_ = backend_output_payload.timestamp_kf_;
+    checkpoint_.W_Pose_Blkf_ = backend_output_payload.W_Pose_Blkf_;
+    checkpoint_.W_Vel_Blkf_ = backend_output_payload.W_Vel_Blkf_;
+    checkpoint_.imu_bias_lkf_ = backend_output_payload.imu_bias_lkf_;
+    checkpoint_.state_covariance_lkf_ =
+        backend_output_payload.state_covariance_lkf_;
+    checkpoint_.cur_kf_id_ = backend_output_payload.cur_kf_id_;
+    checkpoint_.last_keyframe_id_ = last_stereo_keyframe.getFrameId();
+    checkpoint_.last_keyframe_timestamp_ = last_stereo_keyframe.getTimestamp();
+    checkpoint_.landmark_count_ = landmark_count;
+    has_checkpoint_ = true;
+  }
+
+  // Periodic checkpoints.
+  ++checkpoint_keyframe_count_;
+  if (FLAGS_checkpoint_every_n_keyframes <= 0 ||
+      FLAGS_checkpoint_path.empty() ||
+      checkpoint_keyframe_count_ % FLAGS_checkpoint_every_n_keyframes != 0) {
+    return;
+  }
+  if (checkpoint_job_.valid() &&
+      checkpoint_job_.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready) {
+    LOG(WARNING) << "Previous checkpoint is still being written, skipping.";
+    return;
+  }
+  if (checkpoint_job_.valid()) {
+    LOG_IF(ERROR, !checkpoint_job_.get()) << "Previous checkpoint failed.";
+  }
+  checkpoint_job_ = saveCheckpointAsync(FLAGS_checkpoint_path);
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::publishBackendLoad() {
+  backend_queue_size_ = backend_input_queue_.size();
+  CHECK(vio_backend_);
+  backend_last_spin_time_ = vio_backend_->getLastSpinDuration();
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::updateImuBiasConvergence(
+    const VioBackEndOutputPayload& backend_output_payload) {
+  std::lock_guard<std::mutex> lock(imu_bias_convergence_mutex_);
+  if (!imu_bias_convergence_monitor_.update(
+          backend_output_payload.timestamp_kf_,
+          backend_output_payload.imu_bias_lkf_)) {
+    return;
+  }
+  const double convergence_time =
+      imu_bias_convergence_monitor_.getConvergenceTime();
+  LOG(INFO) << "IMU bias converged after " << convergence_time << " s"
+            << (is_imu_warm_started_ ? " (warm start)." : ".");
+  utils::StatsCollector("Pipeline Imu Bias Convergence Time [s]")
+      .AddSample(convergence_time);
+  if (is_imu_warm_started_ &&
+      imu_warm_start_->cold_start_convergence_time_ >= 0.0) {
+    const double time_saved =
+        imu_warm_start_->cold_start_convergence_time_ - convergence_time;
+    LOG(INFO) << "IMU warm start saved " << time_saved
+              << " s of IMU bias convergence.";
+    utils::StatsCollector("Pipeline Imu Warm Start Convergence Time Saved [s]")
+        .AddSample(time_saved);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool Pipeline::saveImuWarmStart() {
+  CHECK(!FLAGS_imu_warm_start_path.empty());
+  ImuWarmStartState imu_warm_start;
+  {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+    if (!has_checkpoint_) {
+      LOG(WARNING) << "No IMU bias estimate to save for warm start.";
       return false;
-    } else {
-      ///////////////////////////// ONLINE INITIALIZER //////////////////////
-      auto tic_full_init = utils::Timer::tic();
-
-      // Create empty output variables
-      gtsam::Vector3 gyro_bias, g_iter_b0;
-      gtsam::NavState init_navstate;
-
-      // Get frontend output to backend input for online initialization
-      std::queue<InitializationInputPayload> output_frontend;
-      CHECK(initialization_frontend_output_queue_.batchPop(&output_frontend));
-      // Shutdown the initialization input queue once used
-      initialization_frontend_output_queue_.shutdown();
-
-      // Adjust parameters for Bundle Adjustment
-      // TODO(Sandro): Create YAML file for initialization and read in!
-      VioBackEndParams backend_params_init(*backend_params_);
-      backend_params_init.smartNoiseSigma_ =
-          FLAGS_smart_noise_sigma_bundle_adjustment;
-      backend_params_init.outlierRejection_ =
-          FLAGS_outlier_rejection_bundle_adjustment;
-      backend_params_init.betweenTranslationPrecision_ =
-          FLAGS_between_translation_bundle_adjustment;
-
-      // Create initial backend
-      InitializationBackEnd initial_backend(
-          output_frontend.front().stereo_frame_lkf_.getBPoseCamLRect(),
-          output_frontend.front().stereo_frame_lkf_.getLeftUndistRectCamMat(),
-          output_frontend.front().stereo_frame_lkf_.getBaseline(),
-          backend_params_init, FLAGS_log_output);
-
-      // Enforce zero bias in initial propagation
-      // TODO(Sandro): Remove this, once AHRS is implemented
-      vio_frontend_->updateAndResetImuBias(
-          gtsam::imuBias::ConstantBias(Vector3::Zero(), Vector3::Zero()));
-      gyro_bias = vio_frontend_->getCurrentImuBias().gyroscope();
-
-      // Initialize if successful
-      if (initial_backend.bundleAdjustmentAndGravityAlignment(
-              output_frontend, &gyro_bias, &g_iter_b0, &init_navstate)) {
-        LOG(INFO) << "Bundle adjustment and alignment successful!";
-
-        // Reset frontend with non-trivial gravity and remove 53-enforcement.
-        // Update frontend with initial gyro bias estimate.
-        vio_frontend_->resetFrontendAfterOnlineAlignment(
-            backend_params_->n_gravity_, gyro_bias);
-        LOG(WARNING) << "Time used for initialization: "
-                     << utils::Timer::toc(tic_full_init).count() << " (ms).";
-
-        ///////////////////////////// BACKEND ////////////////////////////////
-        // Initialize backend with pose estimate from gravity alignment
-        // Create initial state for initialization from online gravity
-        VioNavState initial_state_OGA(init_navstate,
-                                      ImuBias(gtsam::Vector3(), gyro_bias));
-        initBackend(&vio_backend_,
-                    stereo_imu_sync_packet,
-                    initial_state_OGA,
-                    stereo_frame_lkf);
-        LOG(INFO) << "Initialization finalized.";
-
-        // TODO(Sandro): Create check-return for function
-        return true;
-      } else {
-        // Reset initialization
-        LOG(ERROR) << "Bundle adjustment or alignment failed!";
-        init_frame_id_ = stereo_imu_sync_packet.getStereoFrame().getFrameId();
-        stereo_frontend_output_queue_.shutdown();
-        initialization_frontend_output_queue_.shutdown();
-        stereo_frontend_output_queue_.resume();
-        initialization_frontend_output_queue_.resume();
-        return false;
-      }
+    }
+    imu_warm_start.imu_bias_ = checkpoint_.imu_bias_lkf_;
+    // Only available if the backend computes the state covariance, ordered
+    // as pose, velocity and bias.
+    const gtsam::Matrix& state_covariance = checkpoint_.state_covariance_lkf_;
+    if (state_covariance.rows() == 15 && state_covariance.cols() == 15) {
+      imu_warm_start.imu_bias_covariance_ =
+          state_covariance.bottomRightCorner(6, 6);
     }
   }
+  // Keep the convergence time of the cold start as reference.
+  if (is_imu_warm_started_) {
+    imu_warm_start.cold_start_convergence_time_ =
+        imu_warm_start_->cold_start_convergence_time_;
+  } else {
+    std::lock_guard<std::mutex> lock(imu_bias_convergence_mutex_);
+    imu_warm_start.cold_start_convergence_time_ =
+        imu_bias_convergence_monitor_.getConvergenceTime();
+  }
+  imu_warm_start.n_gravity_ = estimated_n_gravity_;
+  return saveImuWarmStartState(imu_warm_start, FLAGS_imu_warm_start_path);
+}
+
+/* -------------------------------------------------------------------------- */
+void Pipeline::warmStartImuBias(const bool& keep_gyro_bias,
+                                ImuBias* imu_bias) {
+  CHECK_NOTNULL(imu_bias);
+  if (!imu_warm_start_) return;
+  LOG(INFO) << "Using IMU warm start bias as initial "
+            << (keep_gyro_bias ? "accelerometer bias." : "bias.");
+  *imu_bias = ImuBias(imu_warm_start_->imu_bias_.accelerometer(),
+                      keep_gyro_bias ? imu_bias->gyroscope()
+                                     : imu_warm_start_->imu_bias_.gyroscope());
+  CHECK(vio_frontend_);
+  vio_frontend_->updateAndResetImuBias(*imu_bias);
+  is_imu_warm_started_ = true;
+}
+
+/* -------------------------------------------------------------------------- */
+bool Pipeline::saveCheckpoint(const std::string& filename) {
+  return saveCheckpointAsync(filename).get();
+}
+
+/* -------------------------------------------------------------------------- */
+std::future<bool> Pipeline::saveCheckpointAsync(const std::string& filename) {
+  // Copy the checkpoint, so that the backend can keep on updating it.
+  PipelineCheckpoint checkpoint;
+  {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+    if (!has_checkpoint_) {
+      LOG(WARNING) << "No estimator state to checkpoint yet.";
+      std::promise<bool> no_checkpoint;
+      no_checkpoint.set_value(false);
+      return no_checkpoint.get_future();
+    }
+    checkpoint = checkpoint_;
+  }
+  return std::async(std::launch::async, [checkpoint, filename]() {
+    auto tic = utils::Timer::tic();
+    bool is_saved = VIO::saveCheckpoint(checkpoint, filename);
+    utils::StatsCollector("Pipeline Checkpoint Timing [ms]")
+        .AddSample(utils::Timer::toc(tic).count());
+    return is_saved;
+  });
+}
+
+/* -------------------------------------------------------------------------- */
+bool Pipeline::restoreCheckpoint(const std::string& filename) {
+  CHECK(!is_initialized_) << "Restore the checkpoint before the first spin.";
+  std::unique_ptr<PipelineCheckpoint> checkpoint =
+      VIO::make_unique<PipelineCheckpoint>();
+  if (!loadCheckpoint(filename, checkpoint.get())) return false;
+  restored_checkpoint_ = std::move(checkpoint);
+  return true;
 }
 
 /* -------------------------------------------------------------------------- */
 bool Pipeline::initBackend(std::unique_ptr<VioBackEnd>* vio_backend,
-                           const StereoImuSyncPacket& stereo_imu_sync_packet,
                            const VioNavState& initial_state_seed,
                            const StereoFrame& stereo_frame_lkf) {
   CHECK_NOTNULL(vio_backend);
+  // Prior on the IMU bias from a previous run.
+  boost::optional<gtsam::Matrix> initial_imu_bias_covariance = boost::none;
+  if (is_imu_warm_started_ &&
+      imu_warm_start_->imu_bias_covariance_.trace() > 0.0) {
+    initial_imu_bias_covariance = FLAGS_imu_warm_start_covariance_inflation *
+                                  imu_warm_start_->imu_bias_covariance_;
+  }
   // Create VIO.
   switch (backend_type_) {
     case 0: {
@@ -846,9 +1269,10 @@ bool Pipeline::initBackend(std::unique_ptr<VioBackEnd>* vio_backend,
           stereo_frame_lkf.getLeftUndistRectCamMat(),
           stereo_frame_lkf.getBaseline(),
           initial_state_seed,
-          stereo_imu_sync_packet.getStereoFrame().getTimestamp(),
+          stereo_frame_lkf.getTimestamp(),
           *backend_params_,
-          FLAGS_log_output);  // No timestamps needed for IMU?
+          FLAGS_log_output,  // No timestamps needed for IMU?
+          initial_imu_bias_covariance);
       break;
     }
     case 1: {
@@ -859,11 +1283,12 @@ bool Pipeline::initBackend(std::unique_ptr<VioBackEnd>* vio_backend,
           stereo_frame_lkf.getLeftUndistRectCamMat(),
           stereo_frame_lkf.getBaseline(),
           initial_state_seed,
-          stereo_imu_sync_packet.getStereoFrame().getTimestamp(),
+          stereo_frame_lkf.getTimestamp(),
           *backend_params_,
           FLAGS_log_output,
           static_cast<RegularVioBackEnd::BackendModality>(
-              FLAGS_regular_vio_backend_modality));
+              FLAGS_regular_vio_backend_modality),
+          initial_imu_bias_covariance);
       break;
     }
     default: {
@@ -915,12 +1340,12 @@ void Pipeline::spinDisplayOnce(
 StatusSmartStereoMeasurements Pipeline::featureSelect(
     const VioFrontEndParams& tracker_params, const Timestamp& timestamp_k,
     const Timestamp& timestamp_lkf, const gtsam::Pose3& W_Pose_Blkf,
-    double* feature_selection_time,
+    DebugTrackerInfo* debug_tracker_info,
     std::shared_ptr<StereoFrame>& stereoFrame_km1,
     const StatusSmartStereoMeasurements& status_smart_stereo_meas,
     int cur_kf_id, int save_image_selector, const gtsam::Matrix& curr_state_cov,
     const Frame& left_frame) {  // last one for visualization only
-  CHECK_NOTNULL(feature_selection_time);
+  CHECK_NOTNULL(debug_tracker_info);
 
   // ------------ DATA ABOUT CURRENT AND FUTURE ROBOT STATE ------------- //
   size_t nrKfInHorizon = round(tracker_params.featureSelectionHorizon_ /
@@ -938,7 +1363,8 @@ StatusSmartStereoMeasurements Pipeline::featureSelect(
 
   VLOG(100) << "Starting feature selection...";
   SmartStereoMeasurements trackedAndSelectedSmartStereoMeasurements;
-  std::tie(trackedAndSelectedSmartStereoMeasurements, *feature_selection_time) =
+  std::tie(trackedAndSelectedSmartStereoMeasurements,
+           debug_tracker_info->featureSelectionTime_) =
       feature_selector_->splitTrackedAndNewFeatures_Select_Display(
           stereoFrame_km1,
           status_smart_stereo_meas.second,
@@ -950,7 +1376,10 @@ StatusSmartStereoMeasurements Pipeline::featureSelect(
           posesAtFutureKeyframes,
           curr_state_cov,
           "",
-          left_frame);  // last 2 are for visualization
+          left_frame,  // last 2 are for visualization
+          &debug_tracker_info->nrGreedySelected_,
+          &debug_tracker_info->featureSelectionBudgetExpired_);
+  // Expired budgets are also counted by the selector, in its stats.
   VLOG(100) << "Feature selection completed.";
 
   // Same status as before.
@@ -974,6 +1403,13 @@ void Pipeline::processKeyframePop() {
       continue;
     }
     CHECK(stereo_frontend_output_payload->is_keyframe_);
+    // Keyframes tracked before a hot re-initialization refer to the old
+    // trajectory, drop them until the one resetting the backend.
+    if (is_reinit_pending_ && !is_reinit_seeded_ &&
+        !stereo_frontend_output_payload->reinit_state_) {
+      VLOG(1) << "Dropping keyframe tracked before hot re-initialization.";
+      continue;
+    }
 
     ////////////////////////////////////////////////////////////////////////////
     // So from this point on, we have a keyframe.
@@ -988,7 +1424,8 @@ void Pipeline::processKeyframePop() {
         stereo_frontend_output_payload->pim_,
         stereo_frontend_output_payload->tracker_status_,
         stereo_frontend_output_payload->relative_pose_body_stereo_,
-        stereo_frontend_output_payload->debug_tracker_info_);
+        stereo_frontend_output_payload->debug_tracker_info_,
+        stereo_frontend_output_payload->reinit_state_);
   }
   LOG(INFO) << "Shutdown wrapped thread.";
 }
@@ -1107,6 +1544,37 @@ void Pipeline::stopThreads() {
   LOG(INFO) << "Sent stop flag to all workers and queues...";
 }
 
+/* -------------------------------------------------------------------------- */
+template <typename T>
+static void logMaxQueueSize(const ThreadsafeQueue<T>& queue) {
+  utils::StatsCollector("Pipeline Max Queue Size " + queue.id() + " [#]")
+      .AddSample(queue.maxSize());
+}
+
+static void logThreadCpuTime(const std::unique_ptr<std::thread>& thread,
+                             const std::string& thread_name) {
+  if (thread && thread->joinable()) {
+    utils::StatsCollector("Pipeline Thread CPU Time " + thread_name + " [s]")
+        .AddSample(getThreadCpuTime(thread->native_handle()));
+  }
+}
+
+void Pipeline::logQueueAndThreadStats() const {
+  logMaxQueueSize(stereo_frontend_input_queue_);
+  logMaxQueueSize(stereo_frontend_output_queue_);
+  logMaxQueueSize(backend_input_queue_);
+  logMaxQueueSize(backend_output_queue_);
+  logMaxQueueSize(mesher_input_queue_);
+  logMaxQueueSize(mesher_output_queue_);
+  logMaxQueueSize(visualizer_input_queue_);
+  logMaxQueueSize(visualizer_output_queue_);
+  // Threads are still alive, since they are only stopped afterwards.
+  logThreadCpuTime(stereo_frontend_thread_, "Frontend");
+  logThreadCpuTime(wrapped_thread_, "Keyframe Processing");
+  logThreadCpuTime(backend_thread_, "Backend");
+  logThreadCpuTime(mesher_thread_, "Mesher");
+}
+
 /* --------------------------------------------------------------------------
  */
 void Pipeline::joinThreads() {
@@ -16,8 +16,13 @@
 
 #include <stddef.h>
 #include <atomic>
+#include <chrono>
 #include <cstdlib>  // for srand()
+#include <deque>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <utility>  // for make_pair
 #include <vector>
@@ -26,8 +31,11 @@
 #include "StereoImuSyncPacket.h"
 #include "Visualizer3D.h"
 #include "datasource/DataSource-definitions.h"  // Only used for gtNavState, add it to vio_types.h instead...
+#include "initial/ImuWarmStart.h"
 #include "initial/InitializationBackEnd-definitions.h"
+#include "initial/OnlineAlignmentSchedule.h"
 #include "mesh/Mesher.h"
+#include "pipeline/PipelineCheckpoint.h"
 #include "utils/ThreadsafeQueue.h"
 
 namespace VIO {
@@ -46,6 +54,16 @@ class Pipeline {
   typedef std::function<void(const SpinOutputPacket&)>
       KeyframeRateOutputCallback;
 
+  // Result of the bundle adjustment and gravity alignment used for online
+  // initialization.
+  struct OnlineAlignmentResult {
+    bool is_success_ = false;
+    gtsam::Vector3 gyro_bias_ = gtsam::Vector3::Zero();
+    gtsam::Vector3 g_iter_b0_ = gtsam::Vector3::Zero();
+    gtsam::NavState init_navstate_;
+    double duration_ms_ = 0.0;
+  };
+
  public:
   Pipeline(const PipelineParams& params, bool parallel_run = true);
 
@@ -73,6 +91,19 @@ class Pipeline {
   // Resumes all queues
   void resume();
 
+  // Save a checkpoint of the estimator state at the last keyframe processed
+  // by the backend. Returns false if there is no state yet, or it could not
+  // be written.
+  bool saveCheckpoint(const std::string& filename);
+
+  // Same as saveCheckpoint, but the file is written in another thread.
+  std::future<bool> saveCheckpointAsync(const std::string& filename);
+
+  // Load a checkpoint: the pipeline is then initialized from it at the next
+  // spin, instead of using the initialization mode in the backend params.
+  // Call it before the first spin.
+  bool restoreCheckpoint(const std::string& filename);
+
   // Return the mesher output queue for FUSES to process the mesh_2d and
   // mesh_3d to extract semantic information.
   // TODO(Toni) this should be a callback instead...
@@ -107,6 +138,16 @@ class Pipeline {
   // Check if necessary to re-initialize pipeline.
   void checkReInitialize(const StereoImuSyncPacket& stereo_imu_sync_packet);
 
+  // Re-initialize the pipeline without stopping its threads: drops the
+  // pending frontend input and lets the re-initialization packet reset the
+  // frontend and the backend in place. Keyframes already tracked are dropped
+  // by the keyframe thread, which never waits on a cleared queue.
+  void hotReInitialize(const StereoImuSyncPacket& stereo_imu_sync_packet);
+
+  // Measures the time from a hot re-initialization request to the first
+  // tracked keyframe estimated by the backend after the re-initialization.
+  void updateReInitLatency(bool is_reinit_seed);
+
   // Initialize pipeline from ground truth pose.
   bool initializeFromGroundTruth(
       const StereoImuSyncPacket& stereo_imu_sync_packet,
@@ -117,15 +158,56 @@ class Pipeline {
   //  - Guesses IMU bias assuming steady upright vehicle.
   bool initializeFromIMU(const StereoImuSyncPacket& stereo_imu_sync_packet);
 
+  // Initialize pipeline from a restored checkpoint.
+  bool initializeFromCheckpoint(
+      const StereoImuSyncPacket& stereo_imu_sync_packet,
+      const PipelineCheckpoint& checkpoint);
+
+  // Keep the checkpoint of the estimator state up to date with the latest
+  // backend output, and write it every FLAGS_checkpoint_every_n_keyframes.
+  void updateCheckpoint(const VioBackEndOutputPayload& backend_output_payload,
+                        const StereoFrame& last_stereo_keyframe);
+
+  // Publish the backend load for the keyframe policy, only call it from the
+  // thread feeding the backend.
+  void publishBackendLoad();
+
+  // Track the convergence of the IMU bias estimated by the backend, and
+  // report the convergence time saved by the IMU warm start.
+  void updateImuBiasConvergence(
+      const VioBackEndOutputPayload& backend_output_payload);
+
+  // Save the IMU bias, gravity and bias covariance of this run to
+  // FLAGS_imu_warm_start_path.
+  bool saveImuWarmStart();
+
+  // Seeds the initial IMU bias, and the one of the frontend, with the bias of
+  // the IMU warm start, if any. Only the accelerometer bias is replaced if
+  // keep_gyro_bias, e.g. when the gyroscope bias has been estimated at
+  // initialization.
+  void warmStartImuBias(const bool& keep_gyro_bias, ImuBias* imu_bias);
+
   // Initialize pipeline from online gravity alignment.
+  // The frontend keeps tracking every packet, while the bundle adjustment
+  // and alignment run as a background job over a sliding window of the last
+  // FLAGS_num_frames_vio_init frontend outputs. If the alignment fails, it is
+  // retried once FLAGS_online_alignment_retry_interval new frames are in the
+  // window. The backend is seeded at the first keyframe of the window.
   bool initializeOnline(const StereoImuSyncPacket& stereo_imu_sync_packet);
 
+  // Launch bundle adjustment and gravity alignment on the current
+  // initialization window (asynchronously if running in parallel).
+  void launchOnlineAlignment();
+
+  // Wait for any running alignment job and drop the initialization windows.
+  void resetOnlineInitialization();
+
   // Initialize backend.
   // Initialize backend given external pose estimate (GT, IMU or OGA)
   /// @param: vio_backend: returns the backend initialized.
   /// @param: initial_state_seed: first state guess.
+  /// @param: stereo_frame_lkf: keyframe of the initial state.
   bool initBackend(std::unique_ptr<VioBackEnd>* vio_backend,
-                   const StereoImuSyncPacket& stereo_imu_sync_packet,
                    const VioNavState& initial_state_seed,
                    const StereoFrame& stereo_frame_lkf);
 
@@ -138,7 +220,8 @@ class Pipeline {
       const ImuFrontEnd::PreintegratedImuMeasurements& pim,
       const TrackingStatus& kf_tracking_status_stereo,
       const gtsam::Pose3& relative_pose_body_stereo,
-      const DebugTrackerInfo& debug_tracker_info);
+      const DebugTrackerInfo& debug_tracker_info,
+      const boost::optional<VioNavState>& reinit_state = boost::none);
 
   void processKeyframePop();
 
@@ -147,7 +230,7 @@ class Pipeline {
       const Timestamp& timestamp_k,
       const Timestamp& timestamp_lkf,
       const gtsam::Pose3& W_Pose_Blkf,
-      double* feature_selection_time,
+      DebugTrackerInfo* debug_tracker_info,
       std::shared_ptr<StereoFrame>& stereoFrame_km1,
       const StatusSmartStereoMeasurements& smart_stereo_meas,
       int cur_kf_id,
@@ -170,6 +253,10 @@ class Pipeline {
   // Join threads to do a clean shutdown.
   void joinThreads();
 
+  // Record the max size reached by each queue, and the CPU time of each
+  // thread, in the statistics. Call it before stopping the threads.
+  void logQueueAndThreadStats() const;
+
   // Callbacks.
   KeyframeRateOutputCallback keyframe_rate_output_callback_;
 
@@ -186,9 +273,33 @@ class Pipeline {
   ThreadsafeQueue<StereoImuSyncPacket> stereo_frontend_input_queue_;
   ThreadsafeQueue<StereoFrontEndOutputPayload> stereo_frontend_output_queue_;
 
-  // Online initialization frontend queue.
-  ThreadsafeQueue<InitializationInputPayload>
-      initialization_frontend_output_queue_;
+  // Online initialization.
+  // Sliding window of frontend outputs used for alignment (trivial gravity
+  // and bias), and the matching outputs with real gravity, which are
+  // replayed by the backend once initialized. Only used by the spin thread.
+  std::deque<InitializationInputPayload> init_alignment_window_;
+  std::deque<StereoFrontEndOutputPayload> init_replay_window_;
+  // Background bundle adjustment and alignment job.
+  std::future<OnlineAlignmentResult> init_alignment_job_;
+  OnlineAlignmentSchedule init_alignment_schedule_;
+
+  // Checkpoint of the estimator state at the last keyframe.
+  std::mutex checkpoint_mutex_;
+  PipelineCheckpoint checkpoint_;
+  bool has_checkpoint_ = false;
+  size_t checkpoint_keyframe_count_ = 0u;
+  std::future<bool> checkpoint_job_;
+  // Checkpoint to initialize the pipeline from.
+  std::unique_ptr<PipelineCheckpoint> restored_checkpoint_ = {nullptr};
+
+  // IMU calibration from a previous run, used as prior at initialization.
+  std::unique_ptr<ImuWarmStartState> imu_warm_start_ = {nullptr};
+  bool is_imu_warm_started_ = false;
+  // Gravity in the world frame estimated at initialization, or the one of the
+  // IMU warm start (or the backend params) if not estimated.
+  Vector3 estimated_n_gravity_;
+  std::mutex imu_bias_convergence_mutex_;
+  ImuBiasConvergenceMonitor imu_bias_convergence_monitor_;
 
   // Create VIO: class that implements estimation back-end.
   std::unique_ptr<VioBackEnd> vio_backend_;
@@ -220,6 +331,18 @@ class Pipeline {
   std::atomic_bool is_launched_ = {false};
   int init_frame_id_;
 
+  // Hot re-initialization bookkeeping.
+  // reinit_tic_ is written before the re-initialization packet is pushed to
+  // the frontend, and read after the backend output, so no lock is needed.
+  std::chrono::high_resolution_clock::time_point reinit_tic_;
+  std::atomic_bool is_reinit_pending_ = {false};
+  std::atomic_bool is_reinit_seeded_ = {false};
+
+  // Backend load, published by the thread feeding the backend for the
+  // keyframe policy of the frontend thread.
+  std::atomic<size_t> backend_queue_size_ = {0u};
+  std::atomic<double> backend_last_spin_time_ = {0.0};
+
   // Threads.
   std::unique_ptr<std::thread> stereo_frontend_thread_ = {nullptr};
   std::unique_ptr<std::thread> wrapped_thread_ = {nullptr};
@@ -0,0 +1,91 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineCheckpoint.cpp
+ * @brief  Versioned checkpoint of the estimator state, for warm restarts.
+ * @author Antoni Rosinol
+ */
+
+#include "pipeline/PipelineCheckpoint.h"
+
+#include <cstdio>  // for std::rename
+#include <fstream>
+
+#include <boost/archive/archive_exception.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+void PipelineCheckpoint::print() const {
+  LOG(INFO) << "Checkpoint at keyframe " << last_keyframe_id_
+            << " (timestamp: " << timestamp_lkf_ << ")\n"
+            << " - pose: " << W_Pose_Blkf_ << '\n'
+            << " - vel: " << W_Vel_Blkf_.transpose() << '\n'
+            << " - IMU bias: " << imu_bias_lkf_ << '\n'
+            << " - keyframe id in backend: " << cur_kf_id_ << '\n'
+            << " - landmark count: " << landmark_count_;
+}
+
+/* -------------------------------------------------------------------------- */
+bool saveCheckpoint(const PipelineCheckpoint& checkpoint,
+                    const std::string& filename) {
+  const std::string tmp_filename = filename + ".tmp";
+  {
+    std::ofstream output_file(tmp_filename,
+                              std::ios::out | std::ios::binary);
+    if (!output_file.is_open()) {
+      LOG(ERROR) << "Cannot open checkpoint file: " << tmp_filename;
+      return false;
+    }
+    try {
+      boost::archive::binary_oarchive archive(output_file);
+      archive << checkpoint;
+    } catch (const boost::archive::archive_exception& e) {
+      LOG(ERROR) << "Cannot write checkpoint: " << e.what();
+      return false;
+    }
+    if (!output_file.good()) {
+      LOG(ERROR) << "Cannot write checkpoint file: " << tmp_filename;
+      return false;
+    }
+  }
+  if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    LOG(ERROR) << "Cannot move checkpoint to: " << filename;
+    return false;
+  }
+  VLOG(1) << "Saved checkpoint to: " << filename;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+bool loadCheckpoint(const std::string& filename,
+                    PipelineCheckpoint* checkpoint) {
+  CHECK_NOTNULL(checkpoint);
+  std::ifstream input_file(filename, std::ios::in | std::ios::binary);
+  if (!input_file.is_open()) {
+    LOG(ERROR) << "Cannot open checkpoint file: " << filename;
+    return false;
+  }
+  try {
+    // Throws if the checkpoint was written with a newer version.
+    boost::archive::binary_iarchive archive(input_file);
+    archive >> *checkpoint;
+  } catch (const boost::archive::archive_exception& e) {
+    LOG(ERROR) << "Cannot read checkpoint " << filename << ": " << e.what();
+    return false;
+  }
+  LOG(INFO) << "Loaded checkpoint from: " << filename;
+  return true;
+}
+
+}  // namespace VIO
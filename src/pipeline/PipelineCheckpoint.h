@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineCheckpoint.h
+ * @brief  Versioned checkpoint of the estimator state, for warm restarts.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/version.hpp>
+
+#include <gtsam/base/Matrix.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/navigation/ImuBias.h>
+
+#include "common/vio_types.h"
+
+namespace VIO {
+
+// Estimator state needed to restart the pipeline without re-initializing:
+// backend state and covariance at the last keyframe, and the counters.
+// Neither the factor graph nor the feature tracks are stored: the backend is
+// re-seeded from the last keyframe state, with its covariance as prior.
+struct PipelineCheckpoint {
+  // Current version of the format, bump it when adding fields, and only read
+  // the new fields if version is high enough in serialize.
+  static constexpr unsigned int kVersion = 1u;
+
+  // Backend state at last keyframe.
+  Timestamp timestamp_lkf_ = 0;
+  gtsam::Pose3 W_Pose_Blkf_;
+  gtsam::Vector3 W_Vel_Blkf_ = gtsam::Vector3::Zero();
+  gtsam::imuBias::ConstantBias imu_bias_lkf_;
+  gtsam::Matrix state_covariance_lkf_;
+  int cur_kf_id_ = 0;
+
+  // Frontend state.
+  FrameId last_keyframe_id_ = 0u;
+  Timestamp last_keyframe_timestamp_ = 0;
+  // Next landmark id to be assigned by the tracker.
+  LandmarkId landmark_count_ = 0;
+
+  void print() const;
+
+  template <class Archive>
+  void serialize(Archive& ar, const unsigned int /*version*/) {
+    ar& BOOST_SERIALIZATION_NVP(timestamp_lkf_);
+    ar& BOOST_SERIALIZATION_NVP(W_Pose_Blkf_);
+    ar& BOOST_SERIALIZATION_NVP(W_Vel_Blkf_);
+    ar& BOOST_SERIALIZATION_NVP(imu_bias_lkf_);
+    ar& BOOST_SERIALIZATION_NVP(state_covariance_lkf_);
+    ar& BOOST_SERIALIZATION_NVP(cur_kf_id_);
+    ar& BOOST_SERIALIZATION_NVP(last_keyframe_id_);
+    ar& BOOST_SERIALIZATION_NVP(last_keyframe_timestamp_);
+    ar& BOOST_SERIALIZATION_NVP(landmark_count_);
+  }
+};
+
+// Writes the checkpoint in binary format. The checkpoint is first written to
+// a temporary file and then renamed, so that a crash while writing never
+// leaves a corrupted checkpoint behind.
+// Returns false if the checkpoint could not be written.
+bool saveCheckpoint(const PipelineCheckpoint& checkpoint,
+                    const std::string& filename);
+
+// Reads a checkpoint written by saveCheckpoint.
+// Returns false if the file cannot be read, or has an unknown version.
+bool loadCheckpoint(const std::string& filename,
+                    PipelineCheckpoint* checkpoint);
+
+}  // namespace VIO
+
+BOOST_CLASS_VERSION(VIO::PipelineCheckpoint, VIO::PipelineCheckpoint::kVersion)
@@ -0,0 +1,167 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineRegression.cpp
+ * @brief  Metrics of a pipeline run (latency, resources and accuracy), and
+ *         their comparison against a stored baseline.
+ * @author Antoni Rosinol
+ */
+
+#include "pipeline/PipelineRegression.h"
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include <opencv2/core/core.hpp>
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+bool saveRegressionMetrics(const RegressionMetrics& metrics,
+                           const std::string& filename) {
+  cv::FileStorage fs(filename, cv::FileStorage::WRITE);
+  if (!fs.isOpened()) {
+    LOG(ERROR) << "Cannot open regression metrics file: " << filename;
+    return false;
+  }
+  // Names have spaces and brackets, hence a list instead of a map.
+  fs << "metrics"
+     << "[";
+  for (const auto& metric : metrics) {
+    fs << "{:"
+       << "name" << metric.first << "value" << metric.second.value_
+       << "tolerance" << metric.second.tolerance_ << "absolute_tolerance"
+       << metric.second.absolute_tolerance_ << "}";
+  }
+  fs << "]";
+  fs.release();
+  VLOG(1) << "Saved " << metrics.size() << " regression metrics to: "
+          << filename;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+bool loadRegressionMetrics(const std::string& filename,
+                           RegressionMetrics* metrics) {
+  CHECK_NOTNULL(metrics);
+  // FileStorage asserts on missing files.
+  if (!std::ifstream(filename).good()) {
+    LOG(ERROR) << "Cannot open regression metrics file: " << filename;
+    return false;
+  }
+  cv::FileStorage fs(filename, cv::FileStorage::READ);
+  if (!fs.isOpened()) {
+    LOG(ERROR) << "Cannot read regression metrics file: " << filename;
+    return false;
+  }
+  const cv::FileNode metrics_node = fs["metrics"];
+  if (metrics_node.type() != cv::FileNode::SEQ) {
+    LOG(ERROR) << "No list of metrics in regression metrics file: "
+               << filename;
+    return false;
+  }
+  metrics->clear();
+  for (const cv::FileNode& metric_node : metrics_node) {
+    RegressionMetric metric;
+    metric_node["value"] >> metric.value_;
+    metric_node["tolerance"] >> metric.tolerance_;
+    metric_node["absolute_tolerance"] >> metric.absolute_tolerance_;
+    (*metrics)[static_cast<std::string>(metric_node["name"])] = metric;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<std::string> compareRegressionMetrics(
+    const RegressionMetrics& baseline, const RegressionMetrics& current) {
+  std::vector<std::string> regressions;
+  for (const auto& baseline_metric : baseline) {
+    const std::string& name = baseline_metric.first;
+    const RegressionMetric& expected = baseline_metric.second;
+    const auto& it = current.find(name);
+    if (it == current.end()) {
+      regressions.push_back("Missing metric: " + name);
+      continue;
+    }
+    const double value = it->second.value_;
+    const double slack =
+        std::max(expected.tolerance_ * std::abs(expected.value_),
+                 expected.absolute_tolerance_);
+    if (value > expected.value_ + slack) {
+      std::ostringstream message;
+      message << name << ": " << value << " (baseline: " << expected.value_
+              << ", max allowed: " << expected.value_ + slack << ")";
+      regressions.push_back(message.str());
+    } else {
+      LOG_IF(INFO, value < expected.value_ - slack)
+          << "Improvement beyond tolerance, consider updating the baseline: "
+          << name << ": " << value << " (baseline: " << expected.value_
+          << ")";
+    }
+  }
+  for (const auto& current_metric : current) {
+    LOG_IF(INFO, baseline.find(current_metric.first) == baseline.end())
+        << "New metric, not in baseline: " << current_metric.first;
+  }
+  return regressions;
+}
+
+/* -------------------------------------------------------------------------- */
+double getPeakRssMb() {
+  // VmHWM follows resetPeakRss, unlike getrusage.
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stod(line.substr(6)) / 1024.0;  // kB to MB.
+    }
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;  // kB on Linux.
+}
+
+/* -------------------------------------------------------------------------- */
+bool resetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  LOG_IF(WARNING, !clear_refs.good())
+      << "Cannot reset the peak RSS, it will be the one of the whole process.";
+  return clear_refs.good();
+}
+
+/* -------------------------------------------------------------------------- */
+double getProcessCpuTime() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/* -------------------------------------------------------------------------- */
+double getThreadCpuTime(pthread_t thread) {
+  clockid_t clock_id;
+  struct timespec cpu_time;
+  if (pthread_getcpuclockid(thread, &clock_id) != 0 ||
+      clock_gettime(clock_id, &cpu_time) != 0) {
+    LOG(ERROR) << "Cannot get the CPU time of thread.";
+    return 0.0;
+  }
+  return cpu_time.tv_sec + 1e-9 * cpu_time.tv_nsec;
+}
+
+}  // namespace VIO
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineRegression.h
+ * @brief  Metrics of a pipeline run (latency, resources and accuracy), and
+ *         their comparison against a stored baseline.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace VIO {
+
+// A metric of a pipeline run, lower is better.
+// It regresses if it exceeds the baseline value by more than
+// max(tolerance_ * baseline value, absolute_tolerance_): the absolute part
+// avoids flagging noise on metrics close to zero.
+struct RegressionMetric {
+  double value_ = 0.0;
+  double tolerance_ = 0.0;
+  double absolute_tolerance_ = 0.0;
+};
+
+// Metrics by name, e.g. "parallel/Backend Timing [ms]/p99".
+typedef std::map<std::string, RegressionMetric> RegressionMetrics;
+
+// Writes the metrics as YAML, so that a baseline can be edited by hand
+// (e.g. to loosen the tolerance of a noisy metric).
+// Returns false if the file cannot be written.
+bool saveRegressionMetrics(const RegressionMetrics& metrics,
+                           const std::string& filename);
+
+// Reads metrics written by saveRegressionMetrics.
+// Returns false if the file cannot be read.
+bool loadRegressionMetrics(const std::string& filename,
+                           RegressionMetrics* metrics);
+
+// Compares the metrics of a run against the baseline, with the tolerances of
+// the baseline. Returns one message per regression, empty if none.
+// A metric of the baseline missing in the run is a regression, while new
+// metrics are only logged.
+std::vector<std::string> compareRegressionMetrics(
+    const RegressionMetrics& baseline, const RegressionMetrics& current);
+
+/* -------------------------------------------------------------------------- */
+// Resource usage of the process.
+
+// Peak resident set size [MB], since the start of the process or the last
+// call to resetPeakRss.
+double getPeakRssMb();
+
+// Resets the peak resident set size to the current one, to measure the peak
+// of a part of the run. Returns false if not supported (Linux >= 4.0 only),
+// in which case the peak is the one since the start of the process.
+bool resetPeakRss();
+
+// User and system CPU time of the whole process [s].
+double getProcessCpuTime();
+
+// CPU time of the given thread [s], e.g. std::thread::native_handle(),
+// or pthread_self() for the calling thread. The thread must be alive.
+double getThreadCpuTime(pthread_t thread);
+
+}  // namespace VIO
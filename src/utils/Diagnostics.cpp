@@ -0,0 +1,111 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Diagnostics.cpp
+ * @brief  Debug output filtered by severity and category, at compile time
+ *         and at runtime.
+ * @author Antoni Rosinol
+ */
+
+#include "utils/Diagnostics.h"
+
+#include <sstream>
+
+#include <gflags/gflags.h>
+
+DEFINE_string(diagnostics_categories, "all",
+              "Comma-separated categories of diagnostics to print: frontend, "
+              "stereo_frame, feature_selector, backend, mesher, pipeline, or "
+              "all. Only the ones compiled in can be printed, see "
+              "SPARK_VIO_DIAGNOSTICS_MIN_SEVERITY.");
+DEFINE_int32(diagnostics_min_severity, 2,
+             "Minimum severity of the diagnostics to print: 0: trace, "
+             "1: debug, 2: info.");
+
+namespace VIO {
+
+namespace utils {
+
+std::atomic<uint32_t>
+    Diagnostics::enabled_categories_[Diagnostics::kNrSeverities] = {
+        {Diagnostics::kNotInitialized},
+        {Diagnostics::kNotInitialized},
+        {Diagnostics::kNotInitialized}};
+
+static const Diagnostics::Category kCategories[] = {
+    Diagnostics::kFrontend, Diagnostics::kStereoFrame,
+    Diagnostics::kFeatureSelector, Diagnostics::kBackend,
+    Diagnostics::kMesher, Diagnostics::kPipeline};
+
+/* -------------------------------------------------------------------------- */
+void Diagnostics::SetEnabled(uint32_t categories, Severity min_severity) {
+  CHECK_NE(categories, kNotInitialized);
+  for (int severity = 0; severity < kNrSeverities; severity++) {
+    enabled_categories_[severity].store(
+        severity >= min_severity ? categories : 0u, std::memory_order_relaxed);
+  }
+}
+
+const char* Diagnostics::CategoryName(Category category) {
+  switch (category) {
+    case kFrontend:
+      return "frontend";
+    case kStereoFrame:
+      return "stereo_frame";
+    case kFeatureSelector:
+      return "feature_selector";
+    case kBackend:
+      return "backend";
+    case kMesher:
+      return "mesher";
+    case kPipeline:
+      return "pipeline";
+  }
+  return "unknown";
+}
+
+uint32_t Diagnostics::ParseCategories(const std::string& names) {
+  uint32_t categories = 0u;
+  std::stringstream stream(names);
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    if (name.empty()) continue;
+    if (name == "all") {
+      for (Category category : kCategories) categories |= category;
+      continue;
+    }
+    bool found = false;
+    for (Category category : kCategories) {
+      if (name == CategoryName(category)) {
+        categories |= category;
+        found = true;
+      }
+    }
+    LOG_IF(FATAL, !found) << "Unrecognized diagnostics category: " << name;
+  }
+  return categories;
+}
+
+uint32_t Diagnostics::InitFromFlags(Severity severity) {
+  const uint32_t categories =
+      severity >= FLAGS_diagnostics_min_severity
+          ? ParseCategories(FLAGS_diagnostics_categories)
+          : 0u;
+  // Does not override SetEnabled, nor a concurrent initialization.
+  uint32_t current = kNotInitialized;
+  if (!enabled_categories_[severity].compare_exchange_strong(
+          current, categories, std::memory_order_relaxed)) {
+    return current;
+  }
+  return categories;
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,142 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Diagnostics.h
+ * @brief  Debug output filtered by severity and category, at compile time
+ *         and at runtime.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include <glog/logging.h>
+
+///
+// Example usage:
+//
+// VIO_DIAG(kMesher, kTrace) << "p1: " << p1;
+// VIO_DIAG_IF(kBackend, kDebug, verbosity_ >= 7) << "Added " << n << " lmks";
+// if (VIO_DIAG_ENABLED(kBackend, kDebug)) {
+//   debug_info_.stateBeforeOpt = ...;  // Only built if it will be printed.
+// }
+//
+// Diagnostics below SPARK_VIO_DIAGNOSTICS_MIN_SEVERITY (0: trace, 1: debug,
+// 2: info; 2 by default in release builds, 0 otherwise) or whose category is
+// not in the mask SPARK_VIO_DIAGNOSTICS_CATEGORIES (all by default) are
+// compiled out: the streamed values are not even evaluated.
+// The ones compiled in are printed through glog (LOG(INFO)) if enabled at
+// runtime with --diagnostics_min_severity and --diagnostics_categories, and
+// their values are only evaluated then.
+
+#ifndef SPARK_VIO_DIAGNOSTICS_MIN_SEVERITY
+#ifdef NDEBUG
+#define SPARK_VIO_DIAGNOSTICS_MIN_SEVERITY 2
+#else
+#define SPARK_VIO_DIAGNOSTICS_MIN_SEVERITY 0
+#endif
+#endif
+
+#ifndef SPARK_VIO_DIAGNOSTICS_CATEGORIES
+#define SPARK_VIO_DIAGNOSTICS_CATEGORIES 0xFFFFFFFFu
+#endif
+
+// Constant expression, so that the compiler drops the diagnostics compiled
+// out, and their arguments.
+#define VIO_DIAG_COMPILED_IN(category, severity)                 \
+  (::VIO::utils::Diagnostics::severity >=                        \
+       SPARK_VIO_DIAGNOSTICS_MIN_SEVERITY &&                     \
+   (::VIO::utils::Diagnostics::category &                        \
+    static_cast<uint32_t>(SPARK_VIO_DIAGNOSTICS_CATEGORIES)) != 0u)
+
+#define VIO_DIAG_ENABLED(category, severity)      \
+  (VIO_DIAG_COMPILED_IN(category, severity) &&    \
+   ::VIO::utils::Diagnostics::IsEnabled(          \
+       ::VIO::utils::Diagnostics::category,       \
+       ::VIO::utils::Diagnostics::severity))
+
+#define VIO_DIAG_IF(category, severity, condition)                         \
+  !(VIO_DIAG_ENABLED(category, severity) && (condition))                   \
+      ? (void)0                                                            \
+      : google::LogMessageVoidify() &                                      \
+            ::VIO::utils::DiagnosticMessage(                               \
+                __FILE__, __LINE__, ::VIO::utils::Diagnostics::category)   \
+                .stream()
+
+#define VIO_DIAG(category, severity) VIO_DIAG_IF(category, severity, true)
+
+namespace VIO {
+
+namespace utils {
+
+class Diagnostics {
+ public:
+  // Bits of the category mask.
+  enum Category : uint32_t {
+    kFrontend = 1u << 0,
+    kStereoFrame = 1u << 1,
+    kFeatureSelector = 1u << 2,
+    kBackend = 1u << 3,
+    kMesher = 1u << 4,
+    kPipeline = 1u << 5,
+  };
+  enum Severity : int {
+    kTrace = 0,
+    kDebug = 1,
+    kInfo = 2,
+  };
+  static const int kNrSeverities = 3;
+
+  // Whether the diagnostics of this category and severity are enabled at
+  // runtime, see VIO_DIAG_ENABLED for the compile-time filter.
+  static inline bool IsEnabled(Category category, Severity severity) {
+    uint32_t categories =
+        enabled_categories_[severity].load(std::memory_order_relaxed);
+    if (categories == kNotInitialized) categories = InitFromFlags(severity);
+    return (categories & category) != 0u;
+  }
+
+  // Overrides --diagnostics_categories and --diagnostics_min_severity.
+  static void SetEnabled(uint32_t categories, Severity min_severity);
+
+  static const char* CategoryName(Category category);
+  // Mask of the comma-separated category names, or "all".
+  static uint32_t ParseCategories(const std::string& names);
+
+ private:
+  // Not a valid mask of categories.
+  static const uint32_t kNotInitialized = 0xFFFFFFFFu;
+  static uint32_t InitFromFlags(Severity severity);
+
+  // Categories enabled at each severity.
+  static std::atomic<uint32_t> enabled_categories_[kNrSeverities];
+};
+
+// Diagnostic written to glog on destruction, see VIO_DIAG.
+class DiagnosticMessage {
+ public:
+  DiagnosticMessage(const char* file, int line,
+                    Diagnostics::Category category)
+      : message_(file, line, google::GLOG_INFO) {
+    message_.stream() << '[' << Diagnostics::CategoryName(category) << "] ";
+  }
+
+  inline std::ostream& stream() { return message_.stream(); }
+
+ private:
+  google::LogMessage message_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
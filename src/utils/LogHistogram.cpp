@@ -0,0 +1,139 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LogHistogram.cpp
+ * @brief  Lock-free histogram with logarithmic buckets, for percentiles.
+ * @author Antoni Rosinol
+ */
+
+#include "utils/LogHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VIO {
+
+namespace utils {
+
+constexpr int LogHistogram::kNrSubBuckets;
+constexpr int LogHistogram::kMinExponent;
+constexpr int LogHistogram::kMaxExponent;
+constexpr size_t LogHistogram::kNrBucketsPerSign;
+constexpr size_t LogHistogram::kNrBuckets;
+
+/* -------------------------------------------------------------------------- */
+LogHistogram::LogHistogram() : counts_(nullptr) {}
+
+/* -------------------------------------------------------------------------- */
+LogHistogram::~LogHistogram() {
+  delete counts_.load(std::memory_order_acquire);
+}
+
+/* -------------------------------------------------------------------------- */
+void LogHistogram::add(const double& value) {
+  if (std::isnan(value)) return;
+  Counts* counts = counts_.load(std::memory_order_acquire);
+  if (!counts) {
+    Counts* allocated = new Counts();
+    for (std::atomic<uint64_t>& count : *allocated) {
+      count.store(0u, std::memory_order_relaxed);
+    }
+    if (counts_.compare_exchange_strong(counts, allocated,
+                                        std::memory_order_acq_rel)) {
+      counts = allocated;
+    } else {
+      // Another writer allocated them first: counts is theirs.
+      delete allocated;
+    }
+  }
+  (*counts)[BucketIndex(value)].fetch_add(1u, std::memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<uint64_t> LogHistogram::snapshot() const {
+  std::vector<uint64_t> counts(kNrBuckets, 0u);
+  const Counts* allocated = counts_.load(std::memory_order_acquire);
+  if (!allocated) return counts;
+  for (size_t i = 0u; i < kNrBuckets; i++) {
+    counts[i] = (*allocated)[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+/* -------------------------------------------------------------------------- */
+double LogHistogram::percentile(const double& p) const {
+  return Percentile(snapshot(), p);
+}
+
+/* -------------------------------------------------------------------------- */
+double LogHistogram::Percentile(const std::vector<uint64_t>& counts,
+                                const double& p) {
+  uint64_t nr_samples = 0u;
+  for (const uint64_t& count : counts) nr_samples += count;
+  if (nr_samples == 0u) return 0.0;
+  // Rank of the sample, starting at 1.
+  const uint64_t rank = std::max<uint64_t>(
+      1u, static_cast<uint64_t>(
+              std::ceil(std::min(std::max(p, 0.0), 1.0) * nr_samples)));
+  uint64_t cumulative = 0u;
+  for (size_t i = 0u; i < counts.size(); i++) {
+    cumulative += counts[i];
+    if (cumulative >= rank) return BucketValue(i);
+  }
+  return BucketValue(counts.size() - 1u);
+}
+
+/* -------------------------------------------------------------------------- */
+void LogHistogram::reset() {
+  Counts* counts = counts_.load(std::memory_order_acquire);
+  if (!counts) return;
+  for (std::atomic<uint64_t>& count : *counts) {
+    count.store(0u, std::memory_order_relaxed);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+size_t LogHistogram::BucketIndex(const double& value) {
+  const double magnitude = std::fabs(value);
+  if (magnitude < std::ldexp(1.0, kMinExponent)) return kNrBucketsPerSign;
+  // magnitude = mantissa * 2^exponent, with mantissa in [0.5, 1).
+  int exponent;
+  const double mantissa = std::frexp(magnitude, &exponent);
+  size_t offset;
+  if (exponent > kMaxExponent || std::isinf(magnitude)) {
+    offset = kNrBucketsPerSign - 1u;
+  } else {
+    const size_t octave = static_cast<size_t>(exponent - 1 - kMinExponent);
+    const size_t sub_bucket = std::min<size_t>(
+        kNrSubBuckets - 1,
+        static_cast<size_t>((2.0 * mantissa - 1.0) * kNrSubBuckets));
+    offset = octave * kNrSubBuckets + sub_bucket;
+  }
+  return value > 0.0 ? kNrBucketsPerSign + 1u + offset
+                     : kNrBucketsPerSign - 1u - offset;
+}
+
+/* -------------------------------------------------------------------------- */
+double LogHistogram::BucketValue(const size_t& index) {
+  if (index == kNrBucketsPerSign) return 0.0;
+  const bool positive = index > kNrBucketsPerSign;
+  const size_t offset = positive ? index - kNrBucketsPerSign - 1u
+                                 : kNrBucketsPerSign - 1u - index;
+  const int octave = static_cast<int>(offset / kNrSubBuckets);
+  const size_t sub_bucket = offset % kNrSubBuckets;
+  // Bucket [2^e * (1 + s / n), 2^e * (1 + (s + 1) / n)).
+  const double midpoint =
+      std::ldexp(1.0 + (sub_bucket + 0.5) / kNrSubBuckets,
+                 octave + kMinExponent);
+  return positive ? midpoint : -midpoint;
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,82 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LogHistogram.h
+ * @brief  Lock-free histogram with logarithmic buckets, for percentiles.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VIO {
+
+namespace utils {
+
+// Histogram whose buckets have a constant relative width (as in HDR
+// histograms): each power of two is split in kNrSubBuckets buckets, hence
+// percentiles have a relative error below 1 / kNrSubBuckets over the whole
+// range, from nanoseconds to hours, without knowing the range in advance.
+// Negative values are mirrored, and values whose magnitude is below
+// 2^kMinExponent fall in the zero bucket (above 2^kMaxExponent in the last
+// one). Adding a value is one relaxed atomic increment, so writers never
+// block each other nor the readers. The buckets (32 KB) are only allocated
+// with the first value, since many histograms are never filled.
+class LogHistogram {
+ public:
+  static constexpr int kNrSubBuckets = 32;
+  static constexpr int kMinExponent = -24;
+  static constexpr int kMaxExponent = 40;
+  static constexpr size_t kNrBucketsPerSign =
+      (kMaxExponent - kMinExponent) * kNrSubBuckets;
+  // Negative buckets (reversed), the zero bucket, positive buckets.
+  static constexpr size_t kNrBuckets = 2u * kNrBucketsPerSign + 1u;
+
+  LogHistogram();
+  ~LogHistogram();
+
+  LogHistogram(const LogHistogram&) = delete;
+  LogHistogram& operator=(const LogHistogram&) = delete;
+
+  // NaNs are ignored.
+  void add(const double& value);
+
+  // Counts of each bucket. Writers may add values meanwhile, so the snapshot
+  // is not atomic as a whole, but each count is.
+  std::vector<uint64_t> snapshot() const;
+
+  // Value of the given percentile (in [0, 1]) of the samples, as the
+  // midpoint of the bucket it falls in; 0 if there are no samples.
+  double percentile(const double& p) const;
+  // Same, on a snapshot, so that several percentiles are consistent.
+  static double Percentile(const std::vector<uint64_t>& counts,
+                           const double& p);
+
+  // Keeps the buckets, if allocated.
+  void reset();
+
+  static size_t BucketIndex(const double& value);
+  // Midpoint of the bucket.
+  static double BucketValue(const size_t& index);
+
+ private:
+  using Counts = std::array<std::atomic<uint64_t>, kNrBuckets>;
+  // Allocated by the first add (the first writer wins), and only freed by
+  // the destructor, so that readers and writers never see it go away.
+  std::atomic<Counts*> counts_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,248 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Profiler.cpp
+ * @brief  Scoped profiling zones, exported to Statistics and Chrome traces.
+ * @author Antoni Rosinol
+ */
+
+#include "utils/Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "utils/Statistics.h"
+
+DEFINE_bool(profiler_trace, false,
+            "Record the profiling zones of each thread, to export them as a "
+            "Chrome trace.");
+
+namespace VIO {
+
+namespace utils {
+
+namespace {
+
+struct Zone {
+  std::string name;
+  size_t stats_handle;
+};
+
+// Events are atomic so that they can be read while the thread overwrites
+// them (such events are then dropped).
+struct AtomicEvent {
+  std::atomic<size_t> zone_id;
+  std::atomic<int64_t> start_ns;
+  std::atomic<int64_t> end_ns;
+  std::atomic<uint32_t> depth;
+};
+
+struct ThreadEvents {
+  explicit ThreadEvents(uint32_t id)
+      : thread_id(id), events(new AtomicEvent[Profiler::kNrEventsPerThread]) {}
+
+  const uint32_t thread_id;
+  std::unique_ptr<AtomicEvent[]> events;
+  // Only written by the thread, events [0, nr_events) have been recorded.
+  std::atomic<uint64_t> nr_events{0u};
+  // Events before this one were cleared.
+  std::atomic<uint64_t> first_event{0u};
+};
+
+struct ProfilerState {
+  std::mutex mutex;
+  // Slots are filled under the mutex and never moved: ids come from
+  // RegisterZone, which synchronizes with the thread using them.
+  std::array<Zone, Profiler::kMaxNrZones> zones;
+  size_t nr_zones = 0u;
+  std::map<std::string, size_t> zone_ids;
+  // Owned here, so that the events outlive their threads.
+  std::vector<std::shared_ptr<ThreadEvents>> thread_events;
+  std::atomic<int> trace_enabled{-1};  // -1: use the gflag.
+};
+
+ProfilerState& State() {
+  static ProfilerState state;
+  return state;
+}
+
+ThreadEvents& GetThreadEvents() {
+  static thread_local ThreadEvents* thread_events = nullptr;
+  if (thread_events == nullptr) {
+    ProfilerState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.thread_events.push_back(std::make_shared<ThreadEvents>(
+        static_cast<uint32_t>(state.thread_events.size())));
+    thread_events = state.thread_events.back().get();
+  }
+  return *thread_events;
+}
+
+// Minimal escaping for json strings.
+std::string EscapeJson(const std::string& str) {
+  std::string escaped;
+  escaped.reserve(str.size());
+  for (const char& c : str) {
+    if (c == '"' || c == '\\') escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+size_t Profiler::RegisterZone(const char* name) {
+  CHECK_NOTNULL(name);
+  ProfilerState& state = State();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  const auto it = state.zone_ids.find(name);
+  if (it != state.zone_ids.end()) return it->second;
+  const size_t zone_id = state.nr_zones++;
+  CHECK_LT(zone_id, kMaxNrZones) << "Profiler: too many zones.";
+  state.zones[zone_id].name = name;
+  state.zones[zone_id].stats_handle =
+      Statistics::GetHandle(std::string(name) + " [ms]");
+  state.zone_ids[name] = zone_id;
+  return zone_id;
+}
+
+/* -------------------------------------------------------------------------- */
+std::string Profiler::GetZoneName(size_t zone_id) {
+  CHECK_LT(zone_id, kMaxNrZones);
+  return State().zones[zone_id].name;
+}
+
+/* -------------------------------------------------------------------------- */
+void Profiler::Record(size_t zone_id, int64_t start_ns, int64_t end_ns,
+                      uint32_t depth) {
+  DCHECK_LT(zone_id, kMaxNrZones);
+  StatsCollector(State().zones[zone_id].stats_handle)
+      .AddSample(static_cast<double>(end_ns - start_ns) * 1e-6);
+  if (!IsTraceEnabled()) return;
+
+  ThreadEvents& thread_events = GetThreadEvents();
+  const uint64_t index =
+      thread_events.nr_events.load(std::memory_order_relaxed);
+  AtomicEvent& event = thread_events.events[index % kNrEventsPerThread];
+  event.zone_id.store(zone_id, std::memory_order_relaxed);
+  event.start_ns.store(start_ns, std::memory_order_relaxed);
+  event.end_ns.store(end_ns, std::memory_order_relaxed);
+  event.depth.store(depth, std::memory_order_relaxed);
+  thread_events.nr_events.store(index + 1u, std::memory_order_release);
+}
+
+/* -------------------------------------------------------------------------- */
+bool Profiler::IsTraceEnabled() {
+  const int enabled = State().trace_enabled.load(std::memory_order_relaxed);
+  return enabled < 0 ? FLAGS_profiler_trace : enabled > 0;
+}
+
+/* -------------------------------------------------------------------------- */
+void Profiler::SetTraceEnabled(bool enabled) {
+  State().trace_enabled.store(enabled ? 1 : 0, std::memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<Profiler::Event> Profiler::GetEvents() {
+  std::vector<std::shared_ptr<ThreadEvents>> all_thread_events;
+  {
+    ProfilerState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    all_thread_events = state.thread_events;
+  }
+
+  std::vector<Event> events;
+  for (const std::shared_ptr<ThreadEvents>& thread_events : all_thread_events) {
+    const uint64_t nr_events =
+        thread_events->nr_events.load(std::memory_order_acquire);
+    const uint64_t first_event = std::max(
+        thread_events->first_event.load(std::memory_order_relaxed),
+        nr_events > kNrEventsPerThread ? nr_events - kNrEventsPerThread : 0u);
+    std::vector<Event> new_events;
+    for (uint64_t i = first_event; i < nr_events; i++) {
+      const AtomicEvent& event = thread_events->events[i % kNrEventsPerThread];
+      new_events.push_back(Event{event.zone_id.load(std::memory_order_relaxed),
+                                 event.start_ns.load(std::memory_order_relaxed),
+                                 event.end_ns.load(std::memory_order_relaxed),
+                                 event.depth.load(std::memory_order_relaxed),
+                                 thread_events->thread_id});
+    }
+    // The thread may have overwritten the oldest events while we read them.
+    const uint64_t nr_events_after =
+        thread_events->nr_events.load(std::memory_order_acquire);
+    const uint64_t nr_overwritten =
+        nr_events_after > kNrEventsPerThread + first_event
+            ? nr_events_after - kNrEventsPerThread - first_event
+            : 0u;
+    events.insert(events.end(),
+                  new_events.begin() +
+                      std::min<uint64_t>(nr_overwritten, new_events.size()),
+                  new_events.end());
+  }
+  std::sort(events.begin(), events.end(),
+            [](const Event& a, const Event& b) {
+              return a.start_ns < b.start_ns;
+            });
+  return events;
+}
+
+/* -------------------------------------------------------------------------- */
+bool Profiler::WriteChromeTrace(const std::string& path) {
+  std::ofstream output_file(path);
+  if (!output_file) {
+    LOG(ERROR) << "Could not write profiler trace: Unable to open file: "
+               << path;
+    return false;
+  }
+
+  const std::vector<Event> events = GetEvents();
+  VLOG(1) << "Writing " << events.size() << " profiler events to: " << path;
+  const int64_t origin_ns = events.empty() ? 0 : events.front().start_ns;
+  output_file << std::fixed << std::setprecision(3);
+  output_file << "{\"traceEvents\":[";
+  for (size_t i = 0u; i < events.size(); i++) {
+    const Event& event = events[i];
+    // Complete events, timestamps in microseconds.
+    output_file << (i == 0u ? "\n" : ",\n") << "{\"name\":\""
+                << EscapeJson(GetZoneName(event.zone_id))
+                << "\",\"cat\":\"vio\",\"ph\":\"X\",\"ts\":"
+                << static_cast<double>(event.start_ns - origin_ns) * 1e-3
+                << ",\"dur\":"
+                << static_cast<double>(event.end_ns - event.start_ns) * 1e-3
+                << ",\"pid\":0,\"tid\":" << event.thread_id
+                << ",\"args\":{\"depth\":" << event.depth << "}}";
+  }
+  output_file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void Profiler::ClearEvents() {
+  ProfilerState& state = State();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  for (const std::shared_ptr<ThreadEvents>& thread_events :
+       state.thread_events) {
+    thread_events->first_event.store(
+        thread_events->nr_events.load(std::memory_order_acquire),
+        std::memory_order_relaxed);
+  }
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Profiler.h
+ * @brief  Scoped profiling zones, exported to Statistics and Chrome traces.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///
+// Example usage:
+//
+// void Tracker::featureTracking(...) {
+//   VIO_PROFILE_ZONE("Tracker::featureTracking");
+//   ...
+//   {
+//     VIO_PROFILE_ZONE("Tracker::featureTracking KLT");  // Nested zone.
+//     ...
+//   }
+// }
+//
+// Each zone adds its duration to the statistic "<name> [ms]", and, with
+// --profiler_trace, an event to the trace of its thread, which
+// Profiler::WriteChromeTrace exports for chrome://tracing.
+// VIO_PROFILE_ZONE_NAMED(zone, name) names the zone variable, e.g. to give
+// access to zone.elapsedSeconds() in code that is itself only compiled with
+// the zones. Code that always needs a duration uses a ScopedTimer instead.
+//
+// Zones are compiled out, and cost nothing, unless SPARK_VIO_ENABLE_PROFILING
+// is defined (CMake option SPARK_VIO_ENABLE_PROFILING, OFF by default). Zone
+// names must be string literals.
+
+#define VIO_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VIO_PROFILE_CONCAT(a, b) VIO_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef SPARK_VIO_ENABLE_PROFILING
+// The zone is registered once per call site.
+#define VIO_PROFILE_ZONE_NAMED(var, name)                                     \
+  static const size_t VIO_PROFILE_CONCAT(vio_profile_zone_id_, __LINE__) =   \
+      ::VIO::utils::Profiler::RegisterZone(name);                             \
+  ::VIO::utils::ProfileZone var(                                              \
+      VIO_PROFILE_CONCAT(vio_profile_zone_id_, __LINE__))
+#define VIO_PROFILE_ZONE(name) \
+  VIO_PROFILE_ZONE_NAMED(VIO_PROFILE_CONCAT(vio_profile_zone_, __LINE__), name)
+#else
+#define VIO_PROFILE_ZONE_NAMED(var, name) \
+  do {                                    \
+  } while (0)
+#define VIO_PROFILE_ZONE(name) \
+  do {                         \
+  } while (0)
+#endif
+
+namespace VIO {
+
+namespace utils {
+
+// Measures the time since its construction, on a monotonic clock.
+class ScopedTimer {
+ public:
+  ScopedTimer() : start_ns_(NowNanoseconds()) {}
+
+  inline double elapsedSeconds() const {
+    return static_cast<double>(NowNanoseconds() - start_ns_) * 1e-9;
+  }
+
+  static inline int64_t NowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+ protected:
+  const int64_t start_ns_;
+};
+
+// Registry of the zones, and per-thread buffers of the finished zones.
+// Each thread only writes to its own buffer, a ring of the last
+// kNrEventsPerThread events, without locking; readers take a snapshot
+// concurrently and drop the events that were overwritten meanwhile.
+class Profiler {
+ public:
+  struct Event {
+    size_t zone_id;
+    int64_t start_ns;
+    int64_t end_ns;
+    // Number of zones of the same thread that contain this one.
+    uint32_t depth;
+    // Order in which the threads recorded their first event.
+    uint32_t thread_id;
+  };
+
+  static const size_t kMaxNrZones = 1024u;
+  static const size_t kNrEventsPerThread = 1u << 16;
+
+  // Returns the id of the zone, the same for all zones with this name.
+  static size_t RegisterZone(const char* name);
+  static std::string GetZoneName(size_t zone_id);
+
+  // Adds the duration to the statistics of the zone, and the event to the
+  // trace of the calling thread, if tracing is enabled.
+  static void Record(size_t zone_id, int64_t start_ns, int64_t end_ns,
+                     uint32_t depth);
+
+  static bool IsTraceEnabled();
+  // Overrides --profiler_trace.
+  static void SetTraceEnabled(bool enabled);
+
+  // Snapshot of the events of all threads, sorted by start time. Does not
+  // block the threads recording events.
+  static std::vector<Event> GetEvents();
+  // Writes the events in the Chrome trace event format (chrome://tracing).
+  static bool WriteChromeTrace(const std::string& path);
+  // Drops the events recorded so far.
+  static void ClearEvents();
+};
+
+// Zone from its construction to its destruction, see VIO_PROFILE_ZONE.
+class ProfileZone : public ScopedTimer {
+ public:
+  explicit ProfileZone(size_t zone_id) : zone_id_(zone_id), depth_(Depth()++) {}
+  ~ProfileZone() {
+    Depth()--;
+    Profiler::Record(zone_id_, start_ns_, NowNanoseconds(), depth_);
+  }
+
+  ProfileZone(const ProfileZone&) = delete;
+  ProfileZone& operator=(const ProfileZone&) = delete;
+
+ private:
+  // Number of open zones in this thread.
+  static uint32_t& Depth() {
+    static thread_local uint32_t depth = 0u;
+    return depth;
+  }
+
+ private:
+  const size_t zone_id_;
+  const uint32_t depth_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
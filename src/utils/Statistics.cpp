@@ -30,41 +30,221 @@
 
 #include "utils/Statistics.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <limits>
 #include <ostream>
 #include <sstream>
+#include <unordered_map>
+
+#include <glog/logging.h>
 
 namespace VIO {
 
 namespace utils {
 
+namespace {
+
+// Lock-free updates of atomic doubles.
+inline void AtomicAdd(std::atomic<double>* value, double increment) {
+  double current = value->load(std::memory_order_relaxed);
+  while (!value->compare_exchange_weak(current, current + increment,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+inline void AtomicMin(std::atomic<double>* value, double sample) {
+  double current = value->load(std::memory_order_relaxed);
+  while (sample < current &&
+         !value->compare_exchange_weak(current, sample,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+inline void AtomicMax(std::atomic<double>* value, double sample) {
+  double current = value->load(std::memory_order_relaxed);
+  while (sample > current &&
+         !value->compare_exchange_weak(current, sample,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+inline std::chrono::steady_clock::rep Now() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+void StatisticsMapValue::AtomicMoments::Add(double sample) {
+  AtomicAdd(&sum_, sample);
+  AtomicAdd(&sum_squares_, sample * sample);
+  AtomicMin(&min_, sample);
+  AtomicMax(&max_, sample);
+  // Last, so that readers seeing the count also see (most of) the sums.
+  count_.fetch_add(1u, std::memory_order_release);
+}
+
+void StatisticsMapValue::AtomicMoments::Reset() {
+  count_.store(0u, std::memory_order_relaxed);
+  sum_.store(0.0, std::memory_order_relaxed);
+  sum_squares_.store(0.0, std::memory_order_relaxed);
+  min_.store(std::numeric_limits<double>::max(), std::memory_order_relaxed);
+  max_.store(std::numeric_limits<double>::lowest(), std::memory_order_relaxed);
+}
+
+double StatisticsMapValue::AtomicMoments::Mean() const {
+  const uint64_t n = count_.load(std::memory_order_acquire);
+  return n == 0u ? 0.0 : sum() / n;
+}
+
+double StatisticsMapValue::AtomicMoments::Variance() const {
+  const uint64_t n = count_.load(std::memory_order_acquire);
+  if (n < 2u) return 0.0;
+  const double sum = sum_.load(std::memory_order_relaxed);
+  const double sum_squares = sum_squares_.load(std::memory_order_relaxed);
+  return std::max(0.0, (sum_squares - sum * sum / n) / (n - 1u));
+}
+
+double StatisticsMapValue::AtomicMoments::min() const {
+  return count() == 0u ? 0.0 : min_.load(std::memory_order_relaxed);
+}
+
+double StatisticsMapValue::AtomicMoments::max() const {
+  return count() == 0u ? 0.0 : max_.load(std::memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+StatisticsMapValue::StatisticsMapValue() { Reset(); }
+
+void StatisticsMapValue::AddValue(double sample) {
+  const std::chrono::steady_clock::rep now = Now();
+  const std::chrono::steady_clock::rep last =
+      time_last_called_.exchange(now, std::memory_order_relaxed);
+  // Concurrent writers may swap the order of their timestamps.
+  const std::chrono::steady_clock::duration elapsed(
+      std::max(now - last, std::chrono::steady_clock::rep(0)));
+  const double dt =
+      static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count()) *
+      kNumSecondsPerNanosecond;
+
+  const uint64_t index =
+      nr_window_samples_.fetch_add(1u, std::memory_order_relaxed);
+  window_[index % kWindowSize].store(sample, std::memory_order_relaxed);
+  last_value_.store(sample, std::memory_order_relaxed);
+  last_delta_time_.store(dt, std::memory_order_relaxed);
+  histogram_.add(sample);
+  values_.Add(sample);
+  time_deltas_.Add(dt);
+}
+
+void StatisticsMapValue::Reset() {
+  values_.Reset();
+  time_deltas_.Reset();
+  histogram_.reset();
+  last_value_.store(0.0, std::memory_order_relaxed);
+  last_delta_time_.store(0.0, std::memory_order_relaxed);
+  for (std::atomic<double>& sample : window_) {
+    sample.store(0.0, std::memory_order_relaxed);
+  }
+  nr_window_samples_.store(0u, std::memory_order_relaxed);
+  time_last_called_.store(Now(), std::memory_order_relaxed);
+}
+
+double StatisticsMapValue::RollingMean() const {
+  const std::vector<double> samples = GetAllValues();
+  if (samples.empty()) return 0.0;
+  double sum = 0.0;
+  for (const double& sample : samples) sum += sample;
+  return sum / samples.size();
+}
+
+double StatisticsMapValue::Percentile(double p) const {
+  if (values_.count() == 0u) return 0.0;
+  // The bucket midpoint may be out of the range of the samples.
+  return std::min(std::max(histogram_.percentile(p), values_.min()),
+                  values_.max());
+}
+
+std::vector<double> StatisticsMapValue::GetAllValues() const {
+  const uint64_t nr_samples =
+      nr_window_samples_.load(std::memory_order_relaxed);
+  const uint64_t nr_window =
+      std::min<uint64_t>(nr_samples, static_cast<uint64_t>(kWindowSize));
+  std::vector<double> samples;
+  samples.reserve(nr_window);
+  for (uint64_t i = nr_samples - nr_window; i < nr_samples; i++) {
+    samples.push_back(window_[i % kWindowSize].load(std::memory_order_relaxed));
+  }
+  return samples;
+}
+
+/* -------------------------------------------------------------------------- */
 Statistics& Statistics::Instance() {
   static Statistics instance;
   return instance;
 }
 
-Statistics::Statistics() : max_tag_length_(0) {}
+Statistics::Statistics()
+    : nr_stats_collectors_(0u), max_tag_length_(0), generation_(0u) {}
 
 Statistics::~Statistics() {}
 
 // Static functions to query the stats collectors:
 size_t Statistics::GetHandle(std::string const& tag) {
+  // StatsCollectors are mostly built from a tag for each sample: look it up
+  // in a cache of this thread first, to not contend on the lock.
+  struct TagCache {
+    uint64_t generation = 0u;
+    std::unordered_map<std::string, size_t> handles;
+  };
+  static thread_local TagCache cache;
+  const uint64_t generation =
+      Instance().generation_.load(std::memory_order_acquire);
+  if (cache.generation != generation) {
+    cache.handles.clear();
+    cache.generation = generation;
+  }
+  const auto cached = cache.handles.find(tag);
+  if (cached != cache.handles.end()) {
+    return cached->second;
+  }
+
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  size_t handle;
   // Search for an existing tag.
   map_t::iterator i = Instance().tag_map_.find(tag);
-  if (i == Instance().tag_map_.end()) {
-    // If it is not there, create a tag.
-    size_t handle = Instance().stats_collectors_.size();
+  if (i != Instance().tag_map_.end()) {
+    handle = i->second;
+  } else {
+    map_t::iterator reset_tag = Instance().reset_tag_map_.find(tag);
+    if (reset_tag != Instance().reset_tag_map_.end()) {
+      // Reuse the handle of the tag before Reset.
+      handle = reset_tag->second;
+      Instance().reset_tag_map_.erase(reset_tag);
+    } else if (Instance().nr_stats_collectors_ >= kMaxNrStats) {
+      // Losing a stat is better than aborting the pipeline: the samples of
+      // this tag are ignored (the handle is cached, so this is logged once
+      // per thread).
+      LOG(ERROR) << "Statistics: more than " << kMaxNrStats
+                 << " tags, ignoring the samples of " << tag;
+      cache.handles[tag] = kIgnoredHandle;
+      return kIgnoredHandle;
+    } else {
+      // If it is not there, create a tag.
+      handle = Instance().nr_stats_collectors_++;
+      Instance().stats_collectors_[handle].reset(new StatisticsMapValue());
+    }
     Instance().tag_map_[tag] = handle;
-    Instance().stats_collectors_.push_back(StatisticsMapValue());
     // Track the maximum tag length to help printing a table of values later.
     Instance().max_tag_length_ =
         std::max(Instance().max_tag_length_, tag.size());
-    return handle;
-  } else {
-    return i->second;
   }
+  cache.handles[tag] = handle;
+  return handle;
 }
 
 // Return true if a handle has been initialized for a specific tag.
@@ -88,6 +268,24 @@ std::string Statistics::GetTag(size_t handle) {
   return tag;
 }
 
+Statistics::map_t Statistics::GetStatsCollectors() {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  return Instance().tag_map_;
+}
+
+StatisticsMapValue& Statistics::GetStatsCollector(size_t handle) {
+  if (handle == kIgnoredHandle) {
+    // Never sampled: the stats of ignored tags are all zero.
+    static StatisticsMapValue ignored;
+    return ignored;
+  }
+  CHECK_LT(handle, kMaxNrStats);
+  StatisticsMapValue* stats_collector =
+      Instance().stats_collectors_[handle].get();
+  CHECK(stats_collector) << "Statistics: invalid handle " << handle;
+  return *stats_collector;
+}
+
 StatsCollectorImpl::StatsCollectorImpl(size_t handle) : handle_(handle) {}
 
 StatsCollectorImpl::StatsCollectorImpl(std::string const& tag)
@@ -101,89 +299,83 @@ void StatsCollectorImpl::IncrementOne() const {
   Statistics::Instance().AddSample(handle_, 1.0);
 }
 void Statistics::AddSample(size_t handle, double seconds) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  stats_collectors_[handle].AddValue(seconds);
+  if (handle == kIgnoredHandle) return;
+  GetStatsCollector(handle).AddValue(seconds);
 }
 double Statistics::GetLastValue(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].GetLastValue();
+  return GetStatsCollector(handle).GetLastValue();
 }
 double Statistics::GetLastValue(std::string const& tag) {
   return GetLastValue(GetHandle(tag));
 }
 double Statistics::GetTotal(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Sum();
+  return GetStatsCollector(handle).Sum();
 }
 double Statistics::GetTotal(std::string const& tag) {
   return GetTotal(GetHandle(tag));
 }
 double Statistics::GetMean(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Mean();
+  return GetStatsCollector(handle).Mean();
 }
 double Statistics::GetMean(std::string const& tag) {
   return GetMean(GetHandle(tag));
 }
 size_t Statistics::GetNumSamples(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].TotalSamples();
+  return GetStatsCollector(handle).TotalSamples();
 }
 size_t Statistics::GetNumSamples(std::string const& tag) {
   return GetNumSamples(GetHandle(tag));
 }
 std::vector<double> Statistics::GetAllSamples(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].GetAllValues();
+  return GetStatsCollector(handle).GetAllValues();
 }
 std::vector<double> Statistics::GetAllSamples(std::string const &tag) {
   return GetAllSamples(GetHandle(tag));
 }
 double Statistics::GetVariance(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].LazyVariance();
+  return GetStatsCollector(handle).LazyVariance();
 }
 double Statistics::GetVariance(std::string const& tag) {
   return GetVariance(GetHandle(tag));
 }
 double Statistics::GetMin(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Min();
+  return GetStatsCollector(handle).Min();
 }
 double Statistics::GetMin(std::string const& tag) {
   return GetMin(GetHandle(tag));
 }
 double Statistics::GetMax(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Max();
+  return GetStatsCollector(handle).Max();
 }
 double Statistics::GetMax(std::string const& tag) {
   return GetMax(GetHandle(tag));
 }
 double Statistics::GetMedian(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Median();
+  return GetStatsCollector(handle).Median();
 }
 double Statistics::GetMedian(std::string const &tag) {
   return GetMedian(GetHandle(tag));
 }
 double Statistics::GetQ1(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Q1();
+  return GetStatsCollector(handle).Q1();
 }
 double Statistics::GetQ1(std::string const &tag) {
   return GetQ1(GetHandle(tag));
 }
 double Statistics::GetQ3(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Q1();
+  return GetStatsCollector(handle).Q3();
 }
 double Statistics::GetQ3(std::string const &tag) {
   return GetQ3(GetHandle(tag));
 }
+double Statistics::GetPercentile(size_t handle, double p) {
+  return GetStatsCollector(handle).Percentile(p);
+}
+double Statistics::GetPercentile(std::string const& tag, double p) {
+  return GetPercentile(GetHandle(tag), p);
+}
 double Statistics::GetHz(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].MeanCallsPerSec();
+  return GetStatsCollector(handle).MeanCallsPerSec();
 }
 double Statistics::GetHz(std::string const& tag) {
   return GetHz(GetHandle(tag));
@@ -194,36 +386,31 @@ double Statistics::GetMeanDeltaTime(std::string const& tag) {
   return GetMeanDeltaTime(GetHandle(tag));
 }
 double Statistics::GetMeanDeltaTime(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].MeanDeltaTime();
+  return GetStatsCollector(handle).MeanDeltaTime();
 }
 double Statistics::GetMaxDeltaTime(std::string const& tag) {
   return GetMaxDeltaTime(GetHandle(tag));
 }
 double Statistics::GetMaxDeltaTime(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].MaxDeltaTime();
+  return GetStatsCollector(handle).MaxDeltaTime();
 }
 double Statistics::GetMinDeltaTime(std::string const& tag) {
   return GetMinDeltaTime(GetHandle(tag));
 }
 double Statistics::GetMinDeltaTime(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].MinDeltaTime();
+  return GetStatsCollector(handle).MinDeltaTime();
 }
 double Statistics::GetLastDeltaTime(std::string const& tag) {
   return GetLastDeltaTime(GetHandle(tag));
 }
 double Statistics::GetLastDeltaTime(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].GetLastDeltaTime();
+  return GetStatsCollector(handle).GetLastDeltaTime();
 }
 double Statistics::GetVarianceDeltaTime(std::string const& tag) {
   return GetVarianceDeltaTime(GetHandle(tag));
 }
 double Statistics::GetVarianceDeltaTime(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].LazyVarianceDeltaTime();
+  return GetStatsCollector(handle).LazyVarianceDeltaTime();
 }
 
 std::string Statistics::SecondsToTimeString(double seconds) {
@@ -252,7 +439,14 @@ std::string Statistics::SecondsToTimeString(double seconds) {
 }
 
 void Statistics::Print(std::ostream& out) {  // NOLINT
-  const map_t& tag_map = Instance().tag_map_;
+  // Only the tags are copied under the lock: writers keep adding samples.
+  map_t tag_map;
+  size_t max_tag_length;
+  {
+    std::lock_guard<std::mutex> lock(Instance().mutex_);
+    tag_map = Instance().tag_map_;
+    max_tag_length = Instance().max_tag_length_;
+  }
 
   if (tag_map.empty()) {
     return;
@@ -260,7 +454,7 @@ void Statistics::Print(std::ostream& out) {  // NOLINT
 
   out << "Statistics\n";
 
-  out.width((std::streamsize)Instance().max_tag_length_);
+  out.width((std::streamsize)max_tag_length);
   out.setf(std::ios::left, std::ios::adjustfield);
   out << "-----------";
   out.width(7);
@@ -268,11 +462,12 @@ void Statistics::Print(std::ostream& out) {  // NOLINT
   out << "#\t";
   out << "Hz\t";
   out << "(avg     +- std    )\t";
-  out << "[min,max]\n";
+  out << "[min,max]\t";
+  out << "p50/p90/p99/p99.9\n";
 
   for (const typename map_t::value_type& t : tag_map) {
     size_t i = t.second;
-    out.width((std::streamsize)Instance().max_tag_length_);
+    out.width((std::streamsize)max_tag_length);
     out.setf(std::ios::left, std::ios::adjustfield);
     out << t.first << "\t";
     out.width(7);
@@ -289,14 +484,17 @@ void Statistics::Print(std::ostream& out) {  // NOLINT
       double min_value = GetMin(i);
       double max_value = GetMax(i);
 
-      out << "[" << min_value << "," << max_value << "]";
+      out << "[" << min_value << "," << max_value << "]\t";
+
+      out << GetPercentile(i, 0.5) << "/" << GetPercentile(i, 0.9) << "/"
+          << GetPercentile(i, 0.99) << "/" << GetPercentile(i, 0.999);
     }
     out << std::endl;
   }
 }
 
 void Statistics::WriteAllSamplesToCsvFile(const std::string &path) {
-  const map_t& tag_map = Instance().tag_map_;
+  const map_t tag_map = GetStatsCollectors();
   if (tag_map.empty()) {
     return;
   }
@@ -334,7 +532,7 @@ void Statistics::WriteToYamlFile(const std::string &path) {
     return;
   }
 
-  const map_t &tag_map = Instance().tag_map_;
+  const map_t tag_map = GetStatsCollectors();
   if (tag_map.empty()) {
     return;
   }
@@ -360,6 +558,9 @@ void Statistics::WriteToYamlFile(const std::string &path) {
       output_file << "  median: " << GetMedian(index) << "\n";
       output_file << "  q1: " << GetQ1(index) << "\n";
       output_file << "  q3: " << GetQ3(index) << "\n";
+      output_file << "  p90: " << GetPercentile(index, 0.9) << "\n";
+      output_file << "  p99: " << GetPercentile(index, 0.99) << "\n";
+      output_file << "  p999: " << GetPercentile(index, 0.999) << "\n";
     }
     output_file << "\n";
   }
@@ -373,7 +574,12 @@ std::string Statistics::Print() {
 
 void Statistics::Reset() {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  for (const map_t::value_type& tag : Instance().tag_map_) {
+    Instance().stats_collectors_[tag.second]->Reset();
+    Instance().reset_tag_map_.insert(tag);
+  }
   Instance().tag_map_.clear();
+  Instance().generation_.fetch_add(1u, std::memory_order_release);
 }
 
 }  // namespace utils
@@ -29,13 +29,17 @@
  */
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
-#include "utils/Accumulator.h"
+#include "utils/LogHistogram.h"
 
 ///
 // Example usage:
@@ -55,50 +59,43 @@ namespace utils {
 
 const double kNumSecondsPerNanosecond = 1.e-9;
 
-struct StatisticsMapValue {
+// Accumulates the samples of one statistic, and the time between samples,
+// with atomics only: writers from several threads never wait for each other
+// nor for the readers, which see each value atomically, but not necessarily
+// all of them from the same instant.
+// Percentiles come from a LogHistogram over all samples, and the last
+// kWindowSize samples are kept for the rolling mean and the csv output.
+class StatisticsMapValue {
+ public:
   static const int kWindowSize = 100;
 
-  inline StatisticsMapValue() {
-    time_last_called_ = std::chrono::system_clock::now();
-  }
+  StatisticsMapValue();
+
+  StatisticsMapValue(const StatisticsMapValue&) = delete;
+  StatisticsMapValue& operator=(const StatisticsMapValue&) = delete;
+
+  void AddValue(double sample);
+  void Reset();
 
-  inline void AddValue(double sample) {
-    std::chrono::time_point<std::chrono::system_clock> now =
-        std::chrono::system_clock::now();
-    double dt = static_cast<double>(
-                    std::chrono::duration_cast<std::chrono::nanoseconds>(
-                        now - time_last_called_)
-                        .count()) *
-                kNumSecondsPerNanosecond;
-    time_last_called_ = now;
-
-    values_.Add(sample);
-    time_deltas_.Add(dt);
+  double GetLastDeltaTime() const {
+    return last_delta_time_.load(std::memory_order_relaxed);
   }
-  inline double GetLastDeltaTime() const {
-    if (time_deltas_.total_samples()) {
-      return time_deltas_.GetMostRecent();
-    } else {
-      return 0;
-    }
+  double GetLastValue() const {
+    return last_value_.load(std::memory_order_relaxed);
   }
-  inline double GetLastValue() const {
-    if (values_.total_samples()) {
-      return values_.GetMostRecent();
-    } else {
-      return 0;
-    }
-  }
-  inline double Sum() const { return values_.sum(); }
-  int TotalSamples() const { return values_.total_samples(); }
+  double Sum() const { return values_.sum(); }
+  int TotalSamples() const { return static_cast<int>(values_.count()); }
   double Mean() const { return values_.Mean(); }
-  double RollingMean() const { return values_.RollingMean(); }
+  double RollingMean() const;
   double Max() const { return values_.max(); }
   double Min() const { return values_.min(); }
-  double Median() const { return values_.median(); }
-  double Q1() const { return values_.q1(); }
-  double Q3() const { return values_.q3(); }
-  double LazyVariance() const { return values_.LazyVariance(); }
+  // Percentile p in [0, 1], within the relative resolution of LogHistogram,
+  // and clamped to [min, max].
+  double Percentile(double p) const;
+  double Median() const { return Percentile(0.5); }
+  double Q1() const { return Percentile(0.25); }
+  double Q3() const { return Percentile(0.75); }
+  double LazyVariance() const { return values_.Variance(); }
   double MeanCallsPerSec() const {
     double mean_dt = time_deltas_.Mean();
     if (mean_dt != 0) {
@@ -109,17 +106,45 @@ struct StatisticsMapValue {
   }
 
   double MeanDeltaTime() const { return time_deltas_.Mean(); }
-  double RollingMeanDeltaTime() const { return time_deltas_.RollingMean(); }
   double MaxDeltaTime() const { return time_deltas_.max(); }
   double MinDeltaTime() const { return time_deltas_.min(); }
-  double LazyVarianceDeltaTime() const { return time_deltas_.LazyVariance(); }
-  std::vector<double> GetAllValues() const { return values_.GetAllSamples(); }
-
-private:
-  // Create an accumulator with specified window size.
-  Accumulator<double, double, kWindowSize> values_;
-  Accumulator<double, double, kWindowSize> time_deltas_;
-  std::chrono::time_point<std::chrono::system_clock> time_last_called_;
+  double LazyVarianceDeltaTime() const { return time_deltas_.Variance(); }
+  // Last kWindowSize samples, oldest first.
+  std::vector<double> GetAllValues() const;
+
+ private:
+  // Count, sum, sum of squares, min and max of the samples.
+  class AtomicMoments {
+   public:
+    AtomicMoments() { Reset(); }
+    void Add(double sample);
+    void Reset();
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const { return sum_.load(std::memory_order_relaxed); }
+    double Mean() const;
+    // Sample variance, 0 with less than two samples.
+    double Variance() const;
+    double min() const;
+    double max() const;
+
+   private:
+    std::atomic<uint64_t> count_;
+    std::atomic<double> sum_;
+    std::atomic<double> sum_squares_;
+    std::atomic<double> min_;
+    std::atomic<double> max_;
+  };
+
+  AtomicMoments values_;
+  AtomicMoments time_deltas_;
+  LogHistogram histogram_;
+  std::atomic<double> last_value_;
+  std::atomic<double> last_delta_time_;
+  // Ring buffer of the last samples, indexed by the sample number.
+  std::array<std::atomic<double>, kWindowSize> window_;
+  std::atomic<uint64_t> nr_window_samples_;
+  // Monotonic, since the time deltas are used as latencies and rates.
+  std::atomic<std::chrono::steady_clock::rep> time_last_called_;
 };
 
 // A class that has the statistics interface but does nothing. Swapping this in
@@ -178,6 +203,9 @@ class Statistics {
   static double GetQ1(std::string const &tag);
   static double GetQ3(size_t handle);
   static double GetQ3(std::string const &tag);
+  // Percentile p in [0, 1] (e.g. 0.99), over all the samples.
+  static double GetPercentile(size_t handle, double p);
+  static double GetPercentile(std::string const& tag, double p);
   static double GetHz(size_t handle);
   static double GetHz(std::string const& tag);
 
@@ -199,22 +227,41 @@ class Statistics {
   static void Print(std::ostream& out);  // NOLINT
   static std::string Print();
   static std::string SecondsToTimeString(double seconds);
+  // Clears the statistics. Handles stay valid, so collectors created before
+  // keep working.
   static void Reset();
-  static const map_t& GetStatsCollectors() { return Instance().tag_map_; }
+  // Copy of the tags and their handles.
+  static map_t GetStatsCollectors();
+
+  // Maximum number of different tags. The samples of further tags are
+  // ignored (with an error), and they get kIgnoredHandle.
+  static const size_t kMaxNrStats = 1024u;
+  static const size_t kIgnoredHandle = kMaxNrStats;
 
  private:
   void AddSample(size_t handle, double sample);
+  // Stats collector of the handle, which must have been created.
+  static StatisticsMapValue& GetStatsCollector(size_t handle);
 
   static Statistics& Instance();
 
   Statistics();
   ~Statistics();
 
-  typedef std::vector<utils::StatisticsMapValue> list_t;
-
-  list_t stats_collectors_;
+  // Slots are filled (under mutex_) but never moved nor freed, so that
+  // samples are added without locking. Handles come from GetHandle, which
+  // takes mutex_ (or from a cache filled under mutex_), hence the slot is
+  // visible to the thread using the handle.
+  std::array<std::unique_ptr<StatisticsMapValue>, kMaxNrStats>
+      stats_collectors_;
+  size_t nr_stats_collectors_;
   map_t tag_map_;
+  // Tags cleared by Reset, to reuse their handles if they come back.
+  map_t reset_tag_map_;
   size_t max_tag_length_;
+  // Incremented by Reset, to invalidate the tag caches of the threads.
+  std::atomic<uint64_t> generation_;
+  // Only guards the tags, not the samples.
   std::mutex mutex_;
 };
 
@@ -0,0 +1,115 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadPool.cpp
+ * @brief  Fixed-size pool of threads running fork-join parallel loops.
+ * @author Antoni Rosinol
+ */
+
+#include "utils/ThreadPool.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace utils {
+
+/* -------------------------------------------------------------------------- */
+ThreadPool::ThreadPool(const size_t& nr_threads) {
+  size_t nr_total_threads = nr_threads;
+  if (nr_total_threads == 0u) {
+    // May return 0 if it is not computable.
+    nr_total_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  workers_.reserve(nr_total_threads - 1u);
+  for (size_t i = 1u; i < nr_total_threads; i++) {
+    workers_.emplace_back(&ThreadPool::workerLoop, this);
+  }
+  VLOG(1) << "ThreadPool: using " << getNrThreads() << " threads.";
+}
+
+/* -------------------------------------------------------------------------- */
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    shutdown_ = true;
+  }
+  work_cond_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void ThreadPool::parallelFor(const size_t& begin,
+                             const size_t& end,
+                             const std::function<void(const size_t&)>& fn) {
+  if (begin >= end) return;
+  // Not worth waking up the workers.
+  if (workers_.empty() || end - begin == 1u) {
+    for (size_t i = begin; i < end; i++) fn(i);
+    return;
+  }
+
+  std::unique_lock<std::mutex> loop_lk(loop_mutex_);
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    fn_ = &fn;
+    end_ = end;
+    next_index_ = begin;
+    nr_busy_workers_ = workers_.size();
+    loop_id_++;
+  }
+  work_cond_.notify_all();
+
+  runLoop();
+
+  // Workers may still be running their last index.
+  std::unique_lock<std::mutex> lk(mutex_);
+  done_cond_.wait(lk, [this] { return nr_busy_workers_ == 0u; });
+  fn_ = nullptr;
+}
+
+/* -------------------------------------------------------------------------- */
+void ThreadPool::workerLoop() {
+  size_t last_loop_id = 0u;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      work_cond_.wait(
+          lk, [this, &last_loop_id] {
+            return shutdown_ || loop_id_ != last_loop_id;
+          });
+      if (shutdown_) return;
+      last_loop_id = loop_id_;
+    }
+
+    runLoop();
+
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      nr_busy_workers_--;
+    }
+    done_cond_.notify_one();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void ThreadPool::runLoop() {
+  // fn_ and end_ do not change until all workers are done with this loop.
+  for (size_t i = next_index_++; i < end_; i = next_index_++) {
+    (*fn_)(i);
+  }
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,77 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadPool.h
+ * @brief  Fixed-size pool of threads running fork-join parallel loops.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VIO {
+
+namespace utils {
+
+// Runs parallel loops over a fixed set of threads, which are created once and
+// sleep in between loops. The calling thread also takes part in each loop,
+// hence a pool of n threads only spawns n - 1 workers, and a pool of 1 thread
+// runs everything on the calling thread.
+class ThreadPool {
+ public:
+  // nr_threads = 0 uses one thread per hardware thread.
+  explicit ThreadPool(const size_t& nr_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Calls fn(i) for each i in [begin, end), and returns once all calls are
+  // done. Indices are handed out dynamically, in increasing order, so fn
+  // must only write to data owned by index i. Only one loop runs at a time:
+  // concurrent calls are serialized.
+  void parallelFor(const size_t& begin,
+                   const size_t& end,
+                   const std::function<void(const size_t&)>& fn);
+
+  inline size_t getNrThreads() const { return workers_.size() + 1u; }
+
+ private:
+  void workerLoop();
+  // Runs indices of the current loop until there are none left.
+  void runLoop();
+
+ private:
+  std::vector<std::thread> workers_;
+
+  // Serializes calls to parallelFor.
+  std::mutex loop_mutex_;
+
+  // Current loop, guarded by mutex_ (except the atomic index).
+  std::mutex mutex_;
+  std::condition_variable work_cond_;
+  std::condition_variable done_cond_;
+  const std::function<void(const size_t&)>* fn_ = nullptr;
+  size_t end_ = 0u;
+  std::atomic<size_t> next_index_{0u};
+  // Incremented for each loop, so that workers run each loop once.
+  size_t loop_id_ = 0u;
+  size_t nr_busy_workers_ = 0u;
+  bool shutdown_ = false;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -72,9 +72,15 @@ inline void ThreadsafeImuBuffer::addMeasurements(
   size_t num_samples = timestamps_nanoseconds.cols();
   CHECK_GT(num_samples, 0u);
 
-  for (size_t idx = 0; idx < num_samples; ++idx) {
-    addMeasurement(timestamps_nanoseconds(idx), imu_measurements.col(idx));
-  }
+  // Enforces strict time-wise ordering as well.
+  buffer_.addNewestValues(
+      timestamps_nanoseconds.data(), num_samples, [&](const size_t& idx) {
+        return ImuMeasurement(timestamps_nanoseconds(idx),
+                              imu_measurements.col(idx));
+      });
+
+  // Notify possibly waiting consumers.
+  cv_new_measurement_.notify_all();
 }
 
 inline void ThreadsafeImuBuffer::clear() {
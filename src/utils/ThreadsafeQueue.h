@@ -31,6 +31,7 @@ class ThreadsafeQueue {
     lk.unlock();
     // No need to lock here, atomic bool.
     shutdown_ = other.shutdown_;
+    max_size_ = other.max_size_.load();
   }
 
   // Push an lvalue to the queue.
@@ -42,6 +43,7 @@ class ThreadsafeQueue {
     VLOG_IF(1, queue_size != 0) << "Queue with id: " << queue_id_
                                 << " is getting full, size: " << queue_size;
     data_queue_.push(new_value);
+    if (queue_size >= max_size_) max_size_ = queue_size + 1u;
     lk.unlock();  // Unlock before notify.
     data_cond_.notify_one();
     return true;
@@ -58,6 +60,7 @@ class ThreadsafeQueue {
     VLOG_IF(1, queue_size != 0) << "Queue with id: " << queue_id_
                                 << " is getting full, size: " << queue_size;
     data_queue_.push(std::move(new_value));
+    if (queue_size >= max_size_) max_size_ = queue_size + 1u;
     lk.unlock();  // Unlock before notify.
     data_cond_.notify_one();
     return true;
@@ -135,6 +138,16 @@ class ThreadsafeQueue {
     }
   }
   
+  // Drop all values in the queue without shutting it down, so that consumers
+  // blocked in popBlocking keep waiting for new data.
+  // Returns the number of values dropped.
+  size_t clear() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    size_t queue_size = data_queue_.size();
+    std::queue<T>().swap(data_queue_);
+    return queue_size;
+  }
+
   void shutdown() {
     std::unique_lock<std::mutex> mlock(mutex_);
     // Even if the shared variable is atomic, it must be modified under the
@@ -162,10 +175,25 @@ class ThreadsafeQueue {
     return data_queue_.empty();
   }
 
+  // Number of values in the queue.
+  // !! the state of the queue might change right after this query.
+  size_t size() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return data_queue_.size();
+  }
+
+  // Largest number of values the queue ever held, to size the queues and
+  // to spot a stage that cannot keep up.
+  size_t maxSize() const { return max_size_; }
+
+  inline const std::string& id() const { return queue_id_; }
+
  private:
   mutable std::mutex mutex_;  // mutable for empty() and copy-constructor.
   std::string queue_id_;
   std::queue<T> data_queue_;
   std::condition_variable data_cond_;
   std::atomic_bool shutdown_ = {false};  // flag for signaling queue shutdown.
+  // Only written under the mutex, atomic to be read without it.
+  std::atomic<size_t> max_size_ = {0u};
 };
@@ -85,6 +85,23 @@ void ThreadsafeTemporalBuffer<ValueType, AllocatorType>::addValue(
   removeOutdatedItems();
 }
 
+template <typename ValueType, typename AllocatorType>
+template <typename ValueFactory>
+void ThreadsafeTemporalBuffer<ValueType, AllocatorType>::addNewestValues(
+    const Timestamp* timestamps, const size_t& nr_values,
+    const ValueFactory& make_value) {
+  CHECK_NOTNULL(timestamps);
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  for (size_t i = 0u; i < nr_values; i++) {
+    if (!values_.empty()) {
+      CHECK_GT(timestamps[i], values_.rbegin()->first)
+          << "Timestamps not strictly increasing.";
+    }
+    values_.emplace_hint(values_.end(), timestamps[i], make_value(i));
+  }
+  removeOutdatedItems();
+}
+
 template <typename ValueType, typename AllocatorType>
 bool ThreadsafeTemporalBuffer<ValueType, AllocatorType>::deleteValueAtTime(
     Timestamp timestamp_ns) {
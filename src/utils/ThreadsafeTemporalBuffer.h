@@ -65,6 +65,13 @@ class ThreadsafeTemporalBuffer {
   void addValue(const Timestamp timestamp, const ValueType& value,
                 const bool emit_warning_on_value_overwrite);
   void insert(const ThreadsafeTemporalBuffer& other);
+  // Adds nr_values values at once, the i-th one make_value(i) at
+  // timestamps[i]. Timestamps must be strictly increasing and newer than the
+  // buffered ones: the values are appended under a single lock, without
+  // searching for their position.
+  template <typename ValueFactory>
+  void addNewestValues(const Timestamp* timestamps, const size_t& nr_values,
+                       const ValueFactory& make_value);
 
   inline size_t size() const {
     std::lock_guard<std::recursive_mutex> lock(mutex_);
@@ -0,0 +1,199 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testBlockBandedMatrix.cpp
+ * @brief  test BlockBandedMatrix
+ * @author Luca Carlone
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/JacobianFactor.h>
+
+#include "BlockBandedMatrix.h"
+
+using namespace VIO;
+
+static const double tol = 1e-7;
+
+/* ************************************************************************* */
+// Random symmetric positive definite matrix with the given band.
+SelectorInformationMatrix randomBandedMatrix(const size_t& nr_blocks,
+                                             const size_t& bandwidth) {
+  srand(0);
+  SelectorInformationMatrix M(nr_blocks, bandwidth);
+  for (size_t i = 0; i < nr_blocks; i++) {
+    for (size_t j = (i > bandwidth ? i - bandwidth : 0); j < i; j++) {
+      M.block(i, j) = SelectorInformationMatrix::Block::Random();
+    }
+    const SelectorInformationMatrix::Block R =
+        SelectorInformationMatrix::Block::Random();
+    // Diagonally dominant.
+    M.block(i, i) = R * R.transpose() +
+                    20.0 * (bandwidth + 1) *
+                        SelectorInformationMatrix::Block::Identity();
+  }
+  return M;
+}
+
+/* ************************************************************************* */
+TEST(testBlockBandedMatrix, toDense) {
+  SelectorInformationMatrix M = randomBandedMatrix(5, 1);
+  EXPECT_EQ(M.rows(), 45u);
+  EXPECT_EQ(M.getBandwidth(), 1u);
+  const gtsam::Matrix dense = M.toDense();
+  EXPECT_TRUE(dense.isApprox(dense.transpose()));
+  EXPECT_TRUE(dense.block(18, 9, 9, 9).isApprox(M.block(2, 1)));
+  EXPECT_TRUE(dense.block(9, 18, 9, 9).isApprox(M.block(2, 1).transpose()));
+  EXPECT_TRUE(dense.block(27, 9, 9, 9).isZero());
+
+  // The bandwidth can not exceed the number of blocks.
+  EXPECT_EQ(SelectorInformationMatrix(3, 10).getBandwidth(), 2u);
+}
+
+/* ************************************************************************* */
+TEST(testBlockBandedMatrix, choleskyLogdetAndSolve) {
+  // Bandwidth 0 (block-diagonal) up to dense.
+  for (size_t bandwidth : {0u, 1u, 2u, 5u}) {
+    const SelectorInformationMatrix M = randomBandedMatrix(6, bandwidth);
+    const gtsam::Matrix dense = M.toDense();
+    const Eigen::LLT<gtsam::Matrix> llt(dense);
+    ASSERT_EQ(llt.info(), Eigen::Success);
+
+    SelectorInformationMatrix L(0, 0);
+    ASSERT_TRUE(M.cholesky(&L));
+    EXPECT_EQ(L.getBandwidth(), M.getBandwidth());
+    // toDense() would symmetrize L.
+    gtsam::Matrix L_dense = gtsam::Matrix::Zero(M.rows(), M.rows());
+    for (size_t i = 0; i < L.getNrBlocks(); i++) {
+      for (size_t j = (i > bandwidth ? i - bandwidth : 0); j <= i; j++) {
+        L_dense.block(9 * i, 9 * j, 9, 9) = L.block(i, j);
+      }
+    }
+    EXPECT_TRUE(L_dense.isApprox(gtsam::Matrix(llt.matrixL()), tol));
+
+    double logdet;
+    ASSERT_TRUE(M.logDeterminant(&logdet));
+    const double expected_logdet =
+        2.0 * llt.matrixLLT().diagonal().array().log().sum();
+    EXPECT_NEAR(logdet, expected_logdet, tol * std::fabs(expected_logdet));
+
+    const gtsam::Vector b = gtsam::Vector::Random(M.rows());
+    EXPECT_TRUE(L.solveWithCholesky(b).isApprox(llt.solve(b), tol));
+  }
+}
+
+/* ************************************************************************* */
+TEST(testBlockBandedMatrix, choleskyRankUpdate) {
+  const SelectorInformationMatrix M = randomBandedMatrix(6, 1);
+  SelectorInformationMatrix L(0, 0);
+  ASSERT_TRUE(M.cholesky(&L));
+
+  // u on blocks 2 and 4 needs bandwidth 2.
+  gtsam::Vector u = gtsam::Vector::Zero(M.rows());
+  u.segment(18, 9) = gtsam::Vector::Random(9);
+  u.segment(36, 9) = gtsam::Vector::Random(9);
+  EXPECT_FALSE(L.choleskyRankUpdate(u));
+  L = L.withBandwidth(2);
+  EXPECT_EQ(L.getBandwidth(), 2u);
+  ASSERT_TRUE(L.choleskyRankUpdate(u));
+
+  const gtsam::Matrix expected = M.toDense() + u * u.transpose();
+  const Eigen::LLT<gtsam::Matrix> llt(expected);
+  ASSERT_EQ(llt.info(), Eigen::Success);
+  EXPECT_NEAR(L.logDeterminantFromCholesky(),
+              2.0 * llt.matrixLLT().diagonal().array().log().sum(),
+              tol * std::fabs(L.logDeterminantFromCholesky()));
+  const gtsam::Vector b = gtsam::Vector::Random(M.rows());
+  EXPECT_TRUE(L.solveWithCholesky(b).isApprox(llt.solve(b), tol));
+  EXPECT_TRUE(L.diagonal().isApprox(
+      gtsam::Vector(gtsam::Matrix(llt.matrixL()).diagonal()), tol));
+}
+
+/* ************************************************************************* */
+TEST(testBlockBandedMatrix, smallestEigenpair) {
+  for (size_t bandwidth : {0u, 1u, 3u}) {
+    SelectorInformationMatrix M = randomBandedMatrix(8, bandwidth);
+    // Well separated smallest eigenvalue.
+    M.block(3, 3) -= 15.0 * SelectorInformationMatrix::Block::Identity();
+    const Eigen::SelfAdjointEigenSolver<gtsam::Matrix> eig(M.toDense());
+
+    double eigenvalue;
+    gtsam::Vector eigenvector;
+    ASSERT_TRUE(M.smallestEigenpair(&eigenvalue, &eigenvector));
+    EXPECT_NEAR(eigenvalue, eig.eigenvalues()(0),
+                1e-6 * eig.eigenvalues()(0));
+    // Up to the sign.
+    EXPECT_NEAR(std::fabs(eigenvector.dot(eig.eigenvectors().col(0))), 1.0,
+                1e-6);
+  }
+}
+
+/* ************************************************************************* */
+TEST(testBlockBandedMatrix, notPositiveDefinite) {
+  SelectorInformationMatrix M = randomBandedMatrix(4, 1);
+  M.block(2, 2) = -M.block(2, 2);
+  SelectorInformationMatrix L(0, 0);
+  EXPECT_FALSE(M.cholesky(&L));
+  double value;
+  gtsam::Vector eigenvector;
+  EXPECT_FALSE(M.logDeterminant(&value));
+  EXPECT_FALSE(M.smallestEigenpair(&value, &eigenvector));
+}
+
+/* ************************************************************************* */
+TEST(testBlockBandedMatrix, fromFactors) {
+  srand(0);
+  // Chain 0 - 1 - 2 - 3, plus a prior on 0: bandwidth 1.
+  gtsam::GaussianFactorGraph graph;
+  graph.push_back(boost::make_shared<gtsam::HessianFactor>(
+      gtsam::JacobianFactor(0, gtsam::Matrix::Random(9, 9),
+                            gtsam::Vector::Zero(9))));
+  for (gtsam::Key k = 0; k < 3; k++) {
+    graph.push_back(boost::make_shared<gtsam::HessianFactor>(
+        gtsam::JacobianFactor(k, gtsam::Matrix::Random(9, 9), k + 1,
+                              gtsam::Matrix::Random(9, 9),
+                              gtsam::Vector::Zero(9))));
+  }
+  std::vector<gtsam::GaussianFactor::shared_ptr> factors(graph.begin(),
+                                                         graph.end());
+  SelectorInformationMatrix M(0, 0);
+  ASSERT_TRUE(SelectorInformationMatrix::FromFactors(factors, &M));
+  EXPECT_EQ(M.getNrBlocks(), 4u);
+  EXPECT_EQ(M.getBandwidth(), 1u);
+  EXPECT_TRUE(M.toDense().isApprox(graph.hessian().first, tol));
+
+  // Same for a single dense factor: the zero blocks are out of the band.
+  const gtsam::GaussianFactorGraph::shared_ptr merged =
+      boost::make_shared<gtsam::GaussianFactorGraph>();
+  merged->push_back(gtsam::HessianFactor(graph));
+  std::vector<gtsam::GaussianFactor::shared_ptr> merged_factors(
+      merged->begin(), merged->end());
+  ASSERT_TRUE(SelectorInformationMatrix::FromFactors(merged_factors, &M));
+  EXPECT_EQ(M.getBandwidth(), 1u);
+  EXPECT_TRUE(M.toDense().isApprox(graph.hessian().first, tol));
+
+  // Keys must be 0, ..., n - 1, with states of size 9.
+  factors.push_back(boost::make_shared<gtsam::HessianFactor>(
+      gtsam::JacobianFactor(5, gtsam::Matrix::Random(9, 9),
+                            gtsam::Vector::Zero(9))));
+  EXPECT_FALSE(SelectorInformationMatrix::FromFactors(factors, &M));
+  factors.back() = boost::make_shared<gtsam::HessianFactor>(
+      gtsam::JacobianFactor(4, gtsam::Matrix::Random(6, 6),
+                            gtsam::Vector::Zero(6)));
+  EXPECT_FALSE(SelectorInformationMatrix::FromFactors(factors, &M));
+}
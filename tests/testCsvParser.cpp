@@ -0,0 +1,157 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testCsvParser.cpp
+ * @brief  test CsvParser
+ * @author Antoni Rosinol
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "datasource/CsvParser.h"
+
+using namespace VIO;
+
+// Same bits, to also compare signed zeros.
+static bool sameBits(const double& a, const double& b) {
+  return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/* ************************************************************************* */
+TEST(testCsvParser, parseInt64) {
+  int64_t value = 0;
+  const std::string text = " 1403636579763555584,";
+  const char* end = parseInt64(text.data(), text.data() + text.size(), &value);
+  ASSERT_TRUE(end != nullptr);
+  EXPECT_EQ(*end, ',');
+  EXPECT_EQ(value, 1403636579763555584);
+
+  for (const std::string number :
+       {"-9223372036854775808", "9223372036854775807", "-0", "+12"}) {
+    ASSERT_TRUE(parseInt64(number.data(), number.data() + number.size(),
+                           &value) != nullptr);
+    EXPECT_EQ(value, std::stoll(number));
+  }
+  for (const std::string invalid : {"", "-", "a1", "9223372036854775808"}) {
+    EXPECT_TRUE(parseInt64(invalid.data(), invalid.data() + invalid.size(),
+                           &value) == nullptr);
+  }
+}
+
+/* ************************************************************************* */
+TEST(testCsvParser, parseDoubleAsStod) {
+  std::vector<std::string> numbers = {
+      "0", "-0", "0.0", "1", "-1.5", "+2.25", ".5", "5.", "1e3", "1E-3",
+      "-0.0000000000000000000000123", "1.7976931348623157e308", "4.9e-300",
+      "0.1", "9.81", "123456789012345678901234567890", "3.14159265358979323846",
+      "9007199254740993", "1e22", "1e23", "1e", "2e+", "inf", "-nan"};
+  // Numbers as in the datasets, with all their digits.
+  std::mt19937 generator(0u);
+  std::uniform_real_distribution<double> distribution(-100.0, 100.0);
+  for (size_t i = 0u; i < 20000u; i++) {
+    std::ostringstream number;
+    number.precision(1 + i % 20u);
+    if (i % 3u == 0u) number << std::scientific;
+    number << distribution(generator);
+    numbers.push_back(number.str());
+  }
+
+  for (const std::string& number : numbers) {
+    double value = 0.0;
+    const char* end =
+        parseDouble(number.data(), number.data() + number.size(), &value);
+    ASSERT_TRUE(end != nullptr) << number;
+    size_t stod_end = 0u;
+    const double expected = std::stod(number, &stod_end);
+    EXPECT_EQ(static_cast<size_t>(end - number.data()), stod_end) << number;
+    if (expected != expected) {
+      EXPECT_TRUE(value != value) << number;
+    } else {
+      EXPECT_TRUE(sameBits(value, expected))
+          << number << ": " << value << " vs " << expected;
+    }
+  }
+
+  double value = 0.0;
+  for (const std::string invalid : {"", "-", ".", "e5", "1e999"}) {
+    EXPECT_TRUE(parseDouble(invalid.data(), invalid.data() + invalid.size(),
+                            &value) == nullptr)
+        << invalid;
+  }
+}
+
+/* ************************************************************************* */
+TEST(testCsvParser, parseDoubles) {
+  const std::string line = "1 2.5 -3 4 5";
+  double values[4];
+  ASSERT_TRUE(parseDoubles(line.data(), line.data() + line.size(), ' ', 4u,
+                           values));
+  EXPECT_EQ(values[0], 1.0);
+  EXPECT_EQ(values[1], 2.5);
+  EXPECT_EQ(values[2], -3.0);
+  EXPECT_EQ(values[3], 4.0);
+  double more_values[6];
+  EXPECT_FALSE(parseDoubles(line.data(), line.data() + line.size(), ' ', 6u,
+                            more_values));
+}
+
+// Writes an EuRoC-like csv of nr_rows rows and nr_values values per row.
+static void writeCsv(const std::string& filename, const size_t& nr_rows,
+                     const size_t& nr_values) {
+  std::ofstream file(filename);
+  file << "#timestamp [ns],values\n";
+  file.precision(17);
+  for (size_t i = 0u; i < nr_rows; i++) {
+    file << 1403636579758555392 + static_cast<int64_t>(i) * 5000000;
+    for (size_t j = 0u; j < nr_values; j++) {
+      file << ',' << 0.001 * i - 0.1 * j;
+    }
+    // Also Windows line endings.
+    file << (i % 2u == 0u ? "\n" : "\r\n");
+  }
+}
+
+/* ************************************************************************* */
+TEST(testCsvParser, parseTimestampedCsv) {
+  const std::string filename = "testCsvParser.csv";
+  writeCsv(filename, 1000u, 6u);
+  // Small chunks, so that this small file is parsed in parallel too.
+  TimestampedCsv sequential, parallel;
+  ASSERT_TRUE(parseTimestampedCsv(filename, 6u, 1u, &sequential));
+  ASSERT_TRUE(parseTimestampedCsv(filename, 6u, 4u, &parallel, 1000u));
+
+  ASSERT_EQ(sequential.nrRows(), 1000u);
+  EXPECT_EQ(sequential.nr_values_per_row_, 6u);
+  EXPECT_EQ(sequential.timestamps_[999],
+            1403636579758555392 + int64_t(999) * 5000000);
+  EXPECT_EQ(sequential.row(999)[5], 0.001 * 999 - 0.1 * 5);
+  EXPECT_EQ(parallel.timestamps_, sequential.timestamps_);
+  EXPECT_EQ(parallel.values_, sequential.values_);
+
+  // Only the values asked for.
+  TimestampedCsv timestamps_only;
+  ASSERT_TRUE(parseTimestampedCsv(filename, 0u, 4u, &timestamps_only, 1000u));
+  EXPECT_EQ(timestamps_only.timestamps_, sequential.timestamps_);
+  EXPECT_TRUE(timestamps_only.values_.empty());
+
+  // Less values than asked for.
+  TimestampedCsv csv;
+  EXPECT_FALSE(parseTimestampedCsv(filename, 7u, 1u, &csv));
+  std::remove(filename.c_str());
+  EXPECT_FALSE(parseTimestampedCsv(filename, 6u, 1u, &csv));
+}
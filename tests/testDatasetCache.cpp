@@ -0,0 +1,177 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testDatasetCache.cpp
+ * @brief  test DatasetCache and CachedDataProvider
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "StereoImuSyncPacket.h"
+#include "datasource/CachedDataSource.h"
+#include "datasource/DatasetCache.h"
+#include "datasource/SyntheticDataSource.h"
+
+DECLARE_int64(initial_k);
+DECLARE_int64(final_k);
+DECLARE_int32(synthetic_image_width);
+DECLARE_int32(synthetic_image_height);
+
+namespace VIO {
+
+static const std::string kCachePath = "testDatasetCache.dscache";
+
+class DatasetCacheFixture : public ::testing::Test {
+ public:
+  DatasetCacheFixture() {
+    // Few small frames, to keep the test fast.
+    FLAGS_initial_k = 10;
+    FLAGS_final_k = 15;
+    FLAGS_synthetic_image_width = 160;
+    FLAGS_synthetic_image_height = 120;
+  }
+  ~DatasetCacheFixture() { std::remove(kCachePath.c_str()); }
+
+ protected:
+  std::vector<StereoImuSyncPacket> spinDataset(DataProvider* data_provider) {
+    CHECK_NOTNULL(data_provider);
+    std::vector<StereoImuSyncPacket> packets;
+    data_provider->registerVioCallback(
+        [&packets](const StereoImuSyncPacket& packet) {
+          packets.push_back(packet);
+        });
+    EXPECT_TRUE(data_provider->spin());
+    return packets;
+  }
+
+  // Writes the synthetic dataset in the cache, returns its packets.
+  std::vector<StereoImuSyncPacket> buildCache(
+      SyntheticDataProvider* data_provider) {
+    CHECK_NOTNULL(data_provider);
+    DatasetCacheWriter writer(kCachePath, false);
+    writer.setImuParams(data_provider->pipeline_params_.imu_params_);
+    writer.setGroundTruth(data_provider->gt_data_);
+    std::vector<StereoImuSyncPacket> packets = spinDataset(data_provider);
+    for (const StereoImuSyncPacket& packet : packets) writer.addPacket(packet);
+    EXPECT_TRUE(writer.finish());
+    return packets;
+  }
+
+ private:
+  // Restores the flags modified by the tests.
+  google::FlagSaver flag_saver_;
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(DatasetCacheFixture, replaysDataset) {
+  SyntheticDataProvider synthetic;
+  const std::vector<StereoImuSyncPacket> packets = buildCache(&synthetic);
+  ASSERT_EQ(packets.size(),
+            static_cast<size_t>(FLAGS_final_k - FLAGS_initial_k));
+
+  CachedDataProvider cached(kCachePath);
+  const DatasetCache& cache = cached.getCache();
+  ASSERT_EQ(cache.nrFrames(), packets.size());
+  EXPECT_FALSE(cache.isEqualized());
+  EXPECT_TRUE(cache.getLeftCamInfo().equals(synthetic.getLeftCamInfo()));
+  EXPECT_TRUE(cache.getRightCamInfo().equals(synthetic.getRightCamInfo()));
+  EXPECT_TRUE(cache.getCamLPoseCamR().equals(synthetic.getCamLPoseCamR()));
+  EXPECT_EQ(cached.pipeline_params_.imu_params_.gyro_noise_,
+            synthetic.pipeline_params_.imu_params_.gyro_noise_);
+  EXPECT_EQ(cached.pipeline_params_.imu_params_.acc_walk_,
+            synthetic.pipeline_params_.imu_params_.acc_walk_);
+
+  // Same packets, with the images in the cache.
+  const std::vector<StereoImuSyncPacket> cached_packets = spinDataset(&cached);
+  ASSERT_EQ(cached_packets.size(), packets.size());
+  for (size_t i = 0u; i < packets.size(); i++) {
+    const StereoFrame& expected = packets[i].getStereoFrame();
+    const StereoFrame& actual = cached_packets[i].getStereoFrame();
+    EXPECT_EQ(actual.getFrameId(), expected.getFrameId());
+    EXPECT_EQ(actual.getTimestamp(), expected.getTimestamp());
+    EXPECT_EQ(cv::norm(actual.getLeftFrame().img_,
+                       expected.getLeftFrame().img_, cv::NORM_L1),
+              0.0);
+    EXPECT_EQ(cv::norm(actual.getRightFrame().img_,
+                       expected.getRightFrame().img_, cv::NORM_L1),
+              0.0);
+    EXPECT_EQ(actual.getLeftFrame().img_.data, cache.leftImage(i).data);
+    EXPECT_EQ(actual.getRightFrame().img_.data, cache.rightImage(i).data);
+    EXPECT_TRUE(cached_packets[i].getImuStamps() == packets[i].getImuStamps());
+    EXPECT_TRUE(cached_packets[i].getImuAccGyr() ==
+                packets[i].getImuAccGyr());
+    EXPECT_TRUE(
+        cached.getGroundTruthState(expected.getTimestamp())
+            .equals(synthetic.gt_data_.map_to_gt_.lower_bound(
+                                               expected.getTimestamp())
+                        ->second));
+  }
+  EXPECT_EQ(cache.getGroundTruth().map_to_gt_.size(),
+            synthetic.gt_data_.map_to_gt_.size());
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(DatasetCacheFixture, servesFramesInRange) {
+  SyntheticDataProvider synthetic;
+  buildCache(&synthetic);
+  FLAGS_initial_k = 12;
+  FLAGS_final_k = 14;
+  CachedDataProvider cached(kCachePath);
+  const std::vector<StereoImuSyncPacket> packets = spinDataset(&cached);
+  ASSERT_EQ(packets.size(), 2u);
+  EXPECT_EQ(packets[0].getStereoFrame().getFrameId(), 12);
+  EXPECT_EQ(packets[1].getStereoFrame().getFrameId(), 13);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(DatasetCacheFixture, rejectsInvalidFiles) {
+  DatasetCache cache;
+  EXPECT_FALSE(cache.open("nonexistent.dscache"));
+
+  SyntheticDataProvider synthetic;
+  buildCache(&synthetic);
+  {
+    DatasetCache valid_cache;
+    ASSERT_TRUE(valid_cache.open(kCachePath));
+  }
+  std::string bytes;
+  {
+    std::ifstream file(kCachePath, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  }
+
+  // Truncated.
+  {
+    std::ofstream file(kCachePath, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size() / 2u);
+  }
+  EXPECT_FALSE(cache.open(kCachePath));
+
+  // Without header, as if the writer had not finished.
+  std::string no_header = bytes;
+  std::fill(no_header.begin(), no_header.begin() + kDatasetCachePageSize, 0);
+  {
+    std::ofstream file(kCachePath, std::ios::binary | std::ios::trunc);
+    file.write(no_header.data(), no_header.size());
+  }
+  EXPECT_FALSE(cache.open(kCachePath));
+}
+
+}  // namespace VIO
@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testDiagnostics.cpp
+ * @brief  test Diagnostics
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "utils/Diagnostics.h"
+
+using VIO::utils::Diagnostics;
+
+static int nr_evaluations = 0;
+// Counts the evaluations of the streamed values.
+static int evaluate() { return ++nr_evaluations; }
+
+class DiagnosticsFixture : public ::testing::Test {
+ protected:
+  void SetUp() override { nr_evaluations = 0; }
+  // Defaults of --diagnostics_categories and --diagnostics_min_severity.
+  void TearDown() override {
+    Diagnostics::SetEnabled(Diagnostics::ParseCategories("all"),
+                            Diagnostics::kInfo);
+  }
+};
+
+/* ************************************************************************* */
+TEST_F(DiagnosticsFixture, parseCategories) {
+  EXPECT_EQ(Diagnostics::ParseCategories(""), 0u);
+  EXPECT_EQ(Diagnostics::ParseCategories("mesher"),
+            static_cast<uint32_t>(Diagnostics::kMesher));
+  EXPECT_EQ(Diagnostics::ParseCategories("backend,stereo_frame"),
+            Diagnostics::kBackend | Diagnostics::kStereoFrame);
+  const uint32_t all = Diagnostics::ParseCategories("all");
+  EXPECT_NE(all & Diagnostics::kFrontend, 0u);
+  EXPECT_NE(all & Diagnostics::kPipeline, 0u);
+}
+
+/* ************************************************************************* */
+TEST_F(DiagnosticsFixture, runtimeFilter) {
+  Diagnostics::SetEnabled(Diagnostics::kMesher, Diagnostics::kInfo);
+  EXPECT_TRUE(Diagnostics::IsEnabled(Diagnostics::kMesher, Diagnostics::kInfo));
+  EXPECT_FALSE(
+      Diagnostics::IsEnabled(Diagnostics::kMesher, Diagnostics::kDebug));
+  EXPECT_FALSE(
+      Diagnostics::IsEnabled(Diagnostics::kBackend, Diagnostics::kInfo));
+
+  // Info is compiled in by default.
+  VIO_DIAG(kMesher, kInfo) << "evaluated " << evaluate();
+  EXPECT_EQ(nr_evaluations, 1);
+  // Disabled diagnostics do not evaluate their values.
+  VIO_DIAG(kMesher, kDebug) << evaluate();
+  VIO_DIAG(kBackend, kInfo) << evaluate();
+  VIO_DIAG_IF(kMesher, kInfo, false) << evaluate();
+  EXPECT_EQ(nr_evaluations, 1);
+  EXPECT_FALSE(VIO_DIAG_ENABLED(kBackend, kInfo));
+}
+
+/* ************************************************************************* */
+TEST_F(DiagnosticsFixture, compileTimeFilter) {
+  Diagnostics::SetEnabled(Diagnostics::ParseCategories("all"),
+                          Diagnostics::kTrace);
+  EXPECT_TRUE(Diagnostics::IsEnabled(Diagnostics::kMesher, Diagnostics::kTrace));
+  VIO_DIAG(kMesher, kTrace) << evaluate();
+  // Enabled at runtime, but only evaluated if compiled in.
+  EXPECT_EQ(nr_evaluations, VIO_DIAG_COMPILED_IN(kMesher, kTrace) ? 1 : 0);
+  EXPECT_EQ(VIO_DIAG_ENABLED(kMesher, kTrace),
+            VIO_DIAG_COMPILED_IN(kMesher, kTrace));
+}
+
+/* ************************************************************************* */
+TEST_F(DiagnosticsFixture, danglingElse) {
+  // The macro is a single expression, it does not capture the else.
+  bool else_taken = false;
+  if (nr_evaluations != 0)
+    VIO_DIAG(kMesher, kInfo) << "never";
+  else
+    else_taken = true;
+  EXPECT_TRUE(else_taken);
+}
@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testFeatureGrid.cpp
+ * @brief  test FeatureGrid
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "FeatureGrid.h"
+
+using namespace VIO;
+
+/* ************************************************************************* */
+TEST(testFeatureGrid, quota) {
+  FeatureGrid grid(cv::Size(640, 480), 4, 5, 100);
+  EXPECT_EQ(grid.getNrCells(), 20u);
+  EXPECT_EQ(grid.getCellQuota(), 5);
+  // Quotas are rounded up so that the grid can hold max_features.
+  FeatureGrid grid_rounded(cv::Size(640, 480), 3, 3, 100);
+  EXPECT_EQ(grid_rounded.getCellQuota(), 12);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureGrid, addMoveRemove) {
+  FeatureGrid grid(cv::Size(100, 100), 2, 2, 8);
+  grid.add(KeypointCV(10, 10));
+  grid.add(KeypointCV(60, 10));
+  grid.add(KeypointCV(60, 20));
+  EXPECT_EQ(grid.getNrFeatures(), 3);
+  EXPECT_EQ(grid.getCellCount(0), 1);
+  EXPECT_EQ(grid.getCellCount(1), 2);
+
+  // Within the same cell.
+  grid.move(KeypointCV(60, 10), KeypointCV(70, 30));
+  EXPECT_EQ(grid.getCellCount(1), 2);
+  // To another cell.
+  grid.move(KeypointCV(60, 20), KeypointCV(60, 80));
+  EXPECT_EQ(grid.getCellCount(1), 1);
+  EXPECT_EQ(grid.getCellCount(3), 1);
+  EXPECT_EQ(grid.getNrFeatures(), 3);
+
+  grid.remove(KeypointCV(10, 10));
+  EXPECT_EQ(grid.getCellCount(0), 0);
+  // Removing from an empty cell does not go negative.
+  grid.remove(KeypointCV(10, 10));
+  EXPECT_EQ(grid.getCellCount(0), 0);
+  EXPECT_EQ(grid.getNrFeatures(), 2);
+
+  // Outside of the image: in the closest cell.
+  grid.add(KeypointCV(100, 10));
+  grid.add(KeypointCV(-1.5, 120));
+  EXPECT_EQ(grid.getCellCount(1), 2);
+  EXPECT_EQ(grid.getCellCount(2), 1);
+  EXPECT_EQ(grid.getNrFeatures(), 4);
+  grid.move(KeypointCV(-1.5, 120), KeypointCV(-0.5, 99.5));
+  EXPECT_EQ(grid.getCellCount(2), 1);
+  grid.remove(KeypointCV(-0.5, 99.5));
+  EXPECT_EQ(grid.getCellCount(2), 0);
+  EXPECT_EQ(grid.getNrFeatures(), 3);
+
+  grid.clear();
+  EXPECT_EQ(grid.getNrFeatures(), 0);
+  EXPECT_EQ(grid.getCellCount(1), 0);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureGrid, rebuild) {
+  FeatureGrid grid(cv::Size(100, 100), 2, 2, 8);
+  grid.add(KeypointCV(10, 10));
+  KeypointsCV keypoints = {KeypointCV(10, 60), KeypointCV(60, 60),
+                           KeypointCV(70, 70)};
+  LandmarkIds landmarks = {3, -1, 5};
+  grid.rebuild(keypoints, landmarks);
+  // Only valid landmarks count.
+  EXPECT_EQ(grid.getNrFeatures(), 2);
+  EXPECT_EQ(grid.getCellCount(0), 0);
+  EXPECT_EQ(grid.getCellCount(2), 1);
+  EXPECT_EQ(grid.getCellCount(3), 1);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureGrid, underPopulatedCells) {
+  FeatureGrid grid(cv::Size(100, 100), 2, 2, 8);
+  for (size_t i = 0; i < 2; i++) grid.add(KeypointCV(10 + i, 10));
+  grid.add(KeypointCV(60, 10));
+  for (size_t i = 0; i < 3; i++) grid.add(KeypointCV(60 + i, 60));
+  const std::vector<std::pair<size_t, int>> cells =
+      grid.getUnderPopulatedCells();
+  ASSERT_EQ(cells.size(), 2u);
+  EXPECT_EQ(cells[0].first, 1u);
+  EXPECT_EQ(cells[0].second, 1);
+  EXPECT_EQ(cells[1].first, 2u);
+  EXPECT_EQ(cells[1].second, 2);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureGrid, cellRects) {
+  // Image size not divisible by the grid size.
+  const cv::Size img_size(101, 77);
+  FeatureGrid grid(img_size, 3, 4, 120);
+  int area = 0;
+  for (size_t cell = 0u; cell < grid.getNrCells(); cell++) {
+    const cv::Rect rect = grid.getCellRect(cell);
+    area += rect.area();
+    // The corners of the rect belong to the cell.
+    FeatureGrid single(img_size, 3, 4, 120);
+    single.add(KeypointCV(rect.x, rect.y));
+    single.add(KeypointCV(rect.br().x - 1, rect.br().y - 1));
+    EXPECT_EQ(single.getCellCount(cell), 2);
+  }
+  // Cells cover the whole image without overlapping.
+  EXPECT_EQ(area, img_size.area());
+}
@@ -38,6 +38,8 @@ using namespace boost::assign;
 using namespace VIO;
 using namespace cv;
 
+DECLARE_bool(feature_selection_factor_cache);
+
 // default
 static const VioFrontEndParams trackerParams = VioFrontEndParams();
 VioBackEndParams vioParams = VioBackEndParams();
@@ -433,9 +435,8 @@ TEST(FeatureSelector, createLinearVisionFactor_no_parallax) {
       FeatureSelector::GetVersorIfInFOV(Camera(spose1.pose, K), pworld_l));
 
   // get actual factor
-  double time1 = 0, time2 = 0, time3 = 0;
-  HessianFactor::shared_ptr hFactor = f.createLinearVisionFactor(
-      pworld_l, left_cameras, right_cameras, time1, time2, time3);
+  HessianFactor::shared_ptr hFactor =
+      f.createLinearVisionFactor(pworld_l, left_cameras, right_cameras);
 
   // check that we got an empty factor
   EXPECT_TRUE(assert_equal(HessianFactor(), *hFactor.get()));
@@ -477,9 +478,8 @@ TEST(FeatureSelector, createLinearVisionFactor_And_SchurComplement) {
   EXPECT_TRUE(
       FeatureSelector::GetVersorIfInFOV(Camera(spose2.pose, K), pworld_l));
 
-  double time1 = 0, time2 = 0, time3 = 0;
-  HessianFactor::shared_ptr hFactor = f.createLinearVisionFactor(
-      pworld_l, left_cameras, right_cameras, time1, time2, time3);
+  HessianFactor::shared_ptr hFactor =
+      f.createLinearVisionFactor(pworld_l, left_cameras, right_cameras);
   Matrix actualHessian = hFactor->information();  // NOTE: he we assume that the
                                                   // keys are in the right order
 
@@ -597,9 +597,8 @@ TEST(FeatureSelector, createLinearVisionFactor_body_P_cam) {
   EXPECT_TRUE(FeatureSelector::GetVersorIfInFOV(
       Camera(spose2.pose.compose(b_P_RCam), K), pworld_l));
 
-  double time1 = 0, time2 = 0, time3 = 0;
-  HessianFactor::shared_ptr hFactor = f.createLinearVisionFactor(
-      pworld_l, left_cameras, right_cameras, time1, time2, time3);
+  HessianFactor::shared_ptr hFactor =
+      f.createLinearVisionFactor(pworld_l, left_cameras, right_cameras);
   Matrix actualHessian = hFactor->information();  // NOTE: he we assume that the
                                                   // keys are in the right order
 
@@ -613,13 +612,13 @@ TEST(FeatureSelector, createLinearVisionFactor_body_P_cam) {
 
 /* ************************************************************************* */
 // helper function
-GaussianFactorGraph::shared_ptr createOmegaBarTest() {
+FeatureSelectorData createFeatureSelectorDataTest(
+    const Pose3& pose0 = Pose3(Rot3::Ypr(0.2, 0.4, 0.5), Point3(0, 0, 1)),
+    const Point3& t01 = Point3(0.2, 0, 0)) {
   // create 3 stamped pose
-  Pose3 pose0 = Pose3(Rot3::Ypr(0.2, 0.4, 0.5), Point3(0, 0, 1));
   StampedPose spose0 = StampedPose(pose0, 0);
   StampedPose spose1 = StampedPose(
-      pose0.compose(Pose3(Rot3::Ypr(0.02, 0.04, 0.05), Point3(0.2, 0, 0))),
-      0.5);
+      pose0.compose(Pose3(Rot3::Ypr(0.02, 0.04, 0.05), t01)), 0.5);
 
   // create featureSelectionData
   FeatureSelectorData featureSelectionData;
@@ -635,14 +634,27 @@ GaussianFactorGraph::shared_ptr createOmegaBarTest() {
   featureSelectionData.keypoints_3d.push_back(
       pose0.transform_to(pworld_l));  // convert to local frame
   featureSelectionData.keypointLife.push_back(3);
+  return featureSelectionData;
+}
 
-  // instantiate selector
+/* ************************************************************************* */
+// helper function
+VioBackEndParams createBackEndParamsTest() {
   VioBackEndParams vp = VioBackEndParams();
   vp.smartNoiseSigma_ = 1000;
   vp.imuIntegrationSigma_ = 1e-4;
   vp.accNoiseDensity_ = 1e-2;
   vp.accBiasSigma_ = 1e-2;
-  FeatureSelector f(trackerParams, vp);
+  return vp;
+}
+
+/* ************************************************************************* */
+// helper function
+GaussianFactorGraph::shared_ptr createOmegaBarTest() {
+  FeatureSelectorData featureSelectionData = createFeatureSelectorDataTest();
+
+  // instantiate selector
+  FeatureSelector f(trackerParams, createBackEndParamsTest());
   Cameras left_cameras, right_cameras;
   tie(left_cameras, right_cameras) = f.getCameras(featureSelectionData);
 
@@ -663,6 +675,117 @@ TEST(FeatureSelector, createOmegaBar) {
       0 && keys0[1] == 1);  // single factor, including imu, prior, and vision
 }
 
+/* ************************************************************************* */
+TEST(FeatureSelector, createOmegaBarVisionFactorCache) {
+  FeatureSelector f(trackerParams, createBackEndParamsTest());
+  FLAGS_feature_selection_factor_cache = true;
+  FeatureSelector fCache(trackerParams, createBackEndParamsTest());
+  FLAGS_feature_selection_factor_cache = false;
+  ASSERT_TRUE(fCache.vision_factor_cache_);
+  EXPECT_FALSE(f.vision_factor_cache_);
+
+  // The same geometry (hit), a different horizon (miss), and the same
+  // relative geometry in another global frame (miss).
+  const Pose3 pose0 = Pose3(Rot3::Ypr(0.2, 0.4, 0.5), Point3(0, 0, 1));
+  const Pose3 world_T = Pose3(Rot3::Ypr(0.3, -0.1, 0.2), Point3(1, 2, 3));
+  const vector<FeatureSelectorData> datas = {
+      createFeatureSelectorDataTest(pose0),
+      createFeatureSelectorDataTest(pose0),
+      createFeatureSelectorDataTest(pose0, Point3(0.3, 0, 0)),
+      createFeatureSelectorDataTest(world_T * pose0)};
+  const vector<size_t> expectedHits = {0, 1, 1, 1};
+  for (size_t i = 0; i < datas.size(); i++) {
+    FeatureSelectorData data = datas[i];
+    data.landmarkIds.push_back(7);
+    Cameras left_cameras, right_cameras;
+    tie(left_cameras, right_cameras) = f.getCameras(data);
+
+    Matrix expected =
+        f.createOmegaBar(data, left_cameras, right_cameras)->hessian().first;
+    Matrix actual = fCache.createOmegaBar(data, left_cameras, right_cameras)
+                        ->hessian()
+                        .first;
+    EXPECT_TRUE(assert_equal(expected, actual, 1e-9 * expected.norm()));
+    EXPECT_EQ(fCache.vision_factor_cache_->getNrLookups(), i + 1);
+    EXPECT_EQ(fCache.vision_factor_cache_->getNrHits(), expectedHits[i]);
+    EXPECT_EQ(fCache.vision_factor_cache_->size(), 1);
+  }
+
+  // Landmarks that are not tracked anymore are removed.
+  FeatureSelectorData data = datas[0];
+  data.landmarkIds.push_back(8);
+  Cameras left_cameras, right_cameras;
+  tie(left_cameras, right_cameras) = f.getCameras(data);
+  fCache.createOmegaBar(data, left_cameras, right_cameras);
+  EXPECT_EQ(fCache.vision_factor_cache_->size(), 1);
+  EXPECT_EQ(fCache.vision_factor_cache_->getNrHits(), 1);
+}
+
+/* ************************************************************************* */
+TEST(FeatureSelector, createOmegaBarVisionFactorCacheWhileMoving) {
+  FLAGS_feature_selection_factor_cache = true;
+  FeatureSelector fCache(trackerParams, createBackEndParamsTest());
+  FLAGS_feature_selection_factor_cache = false;
+  ASSERT_TRUE(fCache.vision_factor_cache_);
+
+  // The camera moves forward by 0.2m per keyframe, and the horizon (3
+  // keyframes) moves with it. The bearing of the far landmark barely changes
+  // (hits), the one of the near landmark changes by ~0.02rad (misses).
+  const double step = 0.2;
+  const Point3 far_lmk(1, 0.5, 15);
+  const Point3 near_lmk(1, 0, 3);
+  const size_t nrKeyframes = 3;
+  for (size_t k = 0; k < nrKeyframes; k++) {
+    FeatureSelectorData data;
+    for (size_t h = 0; h < 3; h++) {
+      data.posesAtFutureKeyframes.push_back(StampedPose(
+          Pose3(Rot3(), Point3(0, 0, step * (k + h))), 0.5 * (k + h)));
+    }
+    data.currentNavStateCovariance = 0.0001 * Matrix::Identity(15, 15);
+    data.left_undistRectCameraMatrix = K;
+    data.right_undistRectCameraMatrix = K;
+    const Pose3& pose0 = data.posesAtFutureKeyframes.at(0).pose;
+    data.keypoints_3d.push_back(pose0.transform_to(far_lmk));
+    data.keypoints_3d.push_back(pose0.transform_to(near_lmk));
+    // The far landmark gets older: its track in the horizon gets shorter
+    // at the last keyframe (3, 3, 2 keyframes).
+    data.keypointLife.push_back(4 - k);
+    data.keypointLife.push_back(100);
+    data.landmarkIds.push_back(1);
+    data.landmarkIds.push_back(2);
+    Cameras left_cameras, right_cameras;
+    tie(left_cameras, right_cameras) = fCache.getCameras(data);
+
+    fCache.createOmegaBar(data, left_cameras, right_cameras);
+    EXPECT_EQ(fCache.vision_factor_cache_->getNrLookups(), 2 * (k + 1));
+    EXPECT_EQ(fCache.vision_factor_cache_->getNrHits(), k);
+    EXPECT_EQ(fCache.vision_factor_cache_->size(), 2u);
+  }
+}
+
+/* ************************************************************************* */
+TEST(FeatureSelector, visionFactorCacheKeepFirstKeys) {
+  const vector<DenseIndex> dims = {9, 9, 9, 1};
+  const Matrix A = Matrix::Random(28, 28);
+  const SymmetricBlockMatrix info(dims, Matrix(A * A.transpose()));
+  const HessianFactor factor(FastVector<Key>{0, 1, 2}, info);
+
+  HessianFactor::shared_ptr kept =
+      LinearVisionFactorCache::KeepFirstKeys(factor, 2);
+  ASSERT_EQ(kept->keys().size(), 2u);
+  EXPECT_EQ(kept->keys()[1], 1u);
+  for (size_t i = 0; i < 2; i++) {
+    for (size_t j = i; j < 2; j++) {
+      EXPECT_TRUE(assert_equal(Matrix(info.block(i, j)),
+                               Matrix(kept->info().block(i, j))));
+    }
+    EXPECT_TRUE(assert_equal(Matrix(info.block(i, 3)),
+                             Matrix(kept->info().block(i, 2))));
+  }
+  EXPECT_TRUE(assert_equal(Matrix(info.block(3, 3)),
+                           Matrix(kept->info().block(2, 2))));
+}
+
 /* ************************************************************************* */
 TEST(FeatureSelector, evaluateGain_det) {
   // get some gaussian factor graph
@@ -929,6 +1052,117 @@ TEST(FeatureSelector, greedyAlgorithm) {
   EXPECT_EQ(actualDet.size(), 5);
 }
 
+/* ************************************************************************* */
+TEST(FeatureSelector, greedyAlgorithmParallel) {
+  // Candidates i and i + 6 are the same (ties), plus an empty one.
+  vector<HessianFactor::shared_ptr> Deltas;
+  for (size_t i = 0; i < 24; i++) {
+    JacobianFactor J(0, double(i % 6 + 1) * Matrix::Identity(3, 9), 1,
+                     double(i % 3) * Matrix::Identity(3, 9), Vector3::Zero());
+    Deltas.push_back(boost::make_shared<HessianFactor>(J));
+  }
+  Deltas.push_back(boost::make_shared<HessianFactor>());
+
+  int need_n_corners = 6;
+  utils::ThreadPool thread_pool(4);
+  for (const auto& criterion :
+       {VioFrontEndParams::FeatureSelectionCriterion::LOGDET,
+        VioFrontEndParams::FeatureSelectionCriterion::MIN_EIG}) {
+    for (const bool useLazyEval : {true, false}) {
+      vector<size_t> expected, actual;
+      vector<double> expectedGains, actualGains;
+      tie(expected, expectedGains) = FeatureSelector::GreedyAlgorithm(
+          createOmegaBarTest(), Deltas, need_n_corners, criterion,
+          useLazyEval);
+      tie(actual, actualGains) = FeatureSelector::GreedyAlgorithm(
+          createOmegaBarTest(), Deltas, need_n_corners, criterion,
+          useLazyEval, &thread_pool);
+      // Same selection, whatever the number of threads.
+      EXPECT_EQ(expected, actual);
+      EXPECT_EQ(expectedGains, actualGains);
+      // Ties are broken by the lowest index.
+      for (size_t k = 0; k < actual.size(); k++) {
+        if (actual[k] >= 6 && actual[k] < 24) {
+          EXPECT_NE(find(actual.begin(), actual.begin() + k, actual[k] - 6),
+                    actual.begin() + k);
+        }
+      }
+    }
+  }
+}
+
+/* ************************************************************************* */
+TEST(FeatureSelector, greedyAlgorithmTimeBudget) {
+  vector<HessianFactor::shared_ptr> Deltas;
+  for (size_t i = 0; i < 10; i++) {
+    JacobianFactor J(0, double(10 - i) * Matrix::Identity(3, 9), 1,
+                     double(i) * Matrix::Identity(3, 9), Vector3::Zero());
+    Deltas.push_back(boost::make_shared<HessianFactor>(J));
+  }
+  int need_n_corners = 4;
+  const auto criterion = VioFrontEndParams::FeatureSelectionCriterion::LOGDET;
+
+  // A large budget does not change the selection.
+  vector<size_t> expected, actual;
+  vector<double> expectedGains, actualGains;
+  size_t nrSelectedGreedily = 0;
+  tie(expected, expectedGains) = FeatureSelector::GreedyAlgorithm(
+      createOmegaBarTest(), Deltas, need_n_corners, criterion);
+  tie(actual, actualGains) = FeatureSelector::GreedyAlgorithm(
+      createOmegaBarTest(), Deltas, need_n_corners, criterion, true, nullptr,
+      100.0, &nrSelectedGreedily);
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(expectedGains, actualGains);
+  EXPECT_EQ(nrSelectedGreedily, size_t(need_n_corners));
+
+  // An expired budget selects by score (first features first).
+  tie(actual, actualGains) = FeatureSelector::GreedyAlgorithm(
+      createOmegaBarTest(), Deltas, need_n_corners, criterion, true, nullptr,
+      1e-12, &nrSelectedGreedily);
+  EXPECT_EQ(nrSelectedGreedily, 0u);
+  EXPECT_EQ(actual, vector<size_t>({0, 1, 2, 3}));
+  EXPECT_EQ(actualGains, vector<double>(need_n_corners, 0.0));
+}
+
+/* ************************************************************************* */
+TEST(FeatureSelector, incrementalGainEvaluator) {
+  // Candidates with different information on the two keys.
+  vector<HessianFactor::shared_ptr> Deltas;
+  for (size_t i = 0; i < 4; i++) {
+    JacobianFactor J(0, (i + 1) * Matrix::Identity(3, 9), 1,
+                     double(i) * Matrix::Identity(3, 9), Vector3::Zero());
+    Deltas.push_back(boost::make_shared<HessianFactor>(J));
+  }
+  Deltas.push_back(boost::make_shared<HessianFactor>());
+
+  for (const auto& criterion :
+       {VioFrontEndParams::FeatureSelectionCriterion::LOGDET,
+        VioFrontEndParams::FeatureSelectionCriterion::MIN_EIG}) {
+    GaussianFactorGraph::shared_ptr OmegaBar = createOmegaBarTest();
+    IncrementalGainEvaluator evaluator(*OmegaBar, Deltas, criterion);
+    EXPECT_NEAR(evaluator.getGain(),
+                FeatureSelector::EvaluateGain(
+                    OmegaBar, boost::make_shared<HessianFactor>(), criterion),
+                fabs(evaluator.getGain()) * 1e-6);
+
+    // Same gains as EvaluateGain, before and after selecting Deltas.
+    for (size_t selected = 0; selected < 2; selected++) {
+      for (size_t j = 0; j < Deltas.size(); j++) {
+        const double expected =
+            FeatureSelector::EvaluateGain(OmegaBar, Deltas[j], criterion);
+        EXPECT_NEAR(evaluator.evaluateGain(j), expected,
+                    fabs(expected) * 1e-6);
+        EXPECT_GE(evaluator.upperBound(j), expected * (1 - 1e-7));
+      }
+      evaluator.add(selected + 2);
+      OmegaBar->push_back(Deltas[selected + 2]);
+      EXPECT_TRUE(
+          assert_equal(Matrix(OmegaBar->hessian().first),
+                       evaluator.getInformation(), 1e-6));
+    }
+  }
+}
+
 /* ************************************************************************* */
 TEST(FeatureSelector, createDeltas) {
   // create 3 stamped pose
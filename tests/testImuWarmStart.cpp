@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testImuWarmStart.cpp
+ * @brief  test ImuWarmStartState and ImuBiasConvergenceMonitor
+ * @author Antoni Rosinol
+ */
+
+#include <cstdio>
+#include <string>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/base/Matrix.h>
+#include <gtsam/navigation/ImuBias.h>
+
+#include "initial/ImuWarmStart.h"
+
+using namespace VIO;
+
+static const double tol = 1e-9;
+
+/* ************************************************************************* */
+TEST(testImuWarmStart, saveAndLoad) {
+  ImuWarmStartState state;
+  state.imu_bias_ = ImuBias(gtsam::Vector3(0.1, -0.2, 0.05),
+                            gtsam::Vector3(0.001, 0.002, -0.003));
+  state.n_gravity_ = gtsam::Vector3(0.0, 0.0, -9.81);
+  gtsam::Matrix random = gtsam::Matrix::Random(6, 6);
+  state.imu_bias_covariance_ = random * random.transpose();
+  state.cold_start_convergence_time_ = 12.5;
+
+  const std::string filename = "/tmp/testImuWarmStart.yaml";
+  ASSERT_TRUE(saveImuWarmStartState(state, filename));
+
+  ImuWarmStartState loaded_state;
+  ASSERT_TRUE(loadImuWarmStartState(filename, &loaded_state));
+  EXPECT_TRUE(loaded_state.imu_bias_.equals(state.imu_bias_, tol));
+  EXPECT_TRUE(gtsam::assert_equal(loaded_state.n_gravity_, state.n_gravity_));
+  EXPECT_TRUE(gtsam::assert_equal(loaded_state.imu_bias_covariance_,
+                                  state.imu_bias_covariance_));
+  EXPECT_DOUBLE_EQ(loaded_state.cold_start_convergence_time_,
+                   state.cold_start_convergence_time_);
+
+  std::remove(filename.c_str());
+  EXPECT_FALSE(loadImuWarmStartState(filename, &loaded_state));
+}
+
+/* ************************************************************************* */
+TEST(testImuWarmStart, biasConvergence) {
+  ImuBiasConvergenceMonitor monitor(1e-3, 3u);
+  const Timestamp dt = 100000000;  // 0.1 s between keyframes.
+  Timestamp timestamp = 1000000000;
+
+  // Bias changing fast: not converged.
+  for (size_t i = 0u; i < 10u; i++) {
+    EXPECT_FALSE(monitor.update(
+        timestamp, ImuBias(gtsam::Vector3::Constant(0.01 * i),
+                           gtsam::Vector3::Zero())));
+    timestamp += dt;
+  }
+  EXPECT_FALSE(monitor.isConverged());
+
+  // Bias steady for 3 keyframes: converged at the third one.
+  const ImuBias steady_bias(gtsam::Vector3::Constant(0.1),
+                            gtsam::Vector3::Zero());
+  EXPECT_FALSE(monitor.update(timestamp, steady_bias));  // Still a big jump.
+  for (size_t i = 0u; i < 2u; i++) {
+    timestamp += dt;
+    EXPECT_FALSE(monitor.update(timestamp, steady_bias));
+  }
+  timestamp += dt;
+  EXPECT_TRUE(monitor.update(timestamp, steady_bias));
+  EXPECT_TRUE(monitor.isConverged());
+  EXPECT_NEAR(monitor.getConvergenceTime(), 1.3, tol);
+
+  // Only reported once.
+  timestamp += dt;
+  EXPECT_FALSE(monitor.update(timestamp, steady_bias));
+  EXPECT_NEAR(monitor.getConvergenceTime(), 1.3, tol);
+
+  monitor.reset();
+  EXPECT_FALSE(monitor.isConverged());
+  EXPECT_LT(monitor.getConvergenceTime(), 0.0);
+}
@@ -0,0 +1,130 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testKeyframePolicy.cpp
+ * @brief  test KeyframePolicy
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "KeyframePolicy.h"
+
+using namespace VIO;
+
+static const double tol = 1e-9;
+
+/* ************************************************************************* */
+TEST(testKeyframePolicy, timePolicy) {
+  TimeKeyframePolicy policy(0.2, 10u);
+  EXPECT_FALSE(policy.needsFeatureStats());
+  KeyframePolicyInput input;
+  input.nr_valid_features_ = 100u;
+  input.time_since_keyframe_ = 0.1;
+  EXPECT_FALSE(policy.decide(input).is_keyframe_);
+
+  input.time_since_keyframe_ = 0.2;
+  KeyframeDecision decision = policy.decide(input);
+  EXPECT_TRUE(decision.is_keyframe_);
+  EXPECT_FALSE(decision.is_critical_);
+
+  // Too few features, or user enforced: critical keyframe.
+  input.time_since_keyframe_ = 0.1;
+  input.nr_valid_features_ = 10u;
+  decision = policy.decide(input);
+  EXPECT_TRUE(decision.is_keyframe_);
+  EXPECT_TRUE(decision.is_critical_);
+  input.nr_valid_features_ = 100u;
+  input.is_user_keyframe_ = true;
+  decision = policy.decide(input);
+  EXPECT_TRUE(decision.is_keyframe_);
+  EXPECT_TRUE(decision.is_critical_);
+}
+
+/* ************************************************************************* */
+TEST(testKeyframePolicy, parallaxAndOverlapPolicies) {
+  ParallaxKeyframePolicy parallax_policy(20.0, 1.0, 0u);
+  OverlapKeyframePolicy overlap_policy(0.7, 1.0, 0u);
+  EXPECT_TRUE(parallax_policy.needsFeatureStats());
+  EXPECT_TRUE(overlap_policy.needsFeatureStats());
+  KeyframePolicyInput input;
+  input.nr_valid_features_ = 100u;
+  input.time_since_keyframe_ = 0.5;
+  input.median_parallax_ = 5.0;
+  input.feature_overlap_ratio_ = 0.9;
+  EXPECT_FALSE(parallax_policy.decide(input).is_keyframe_);
+  EXPECT_FALSE(overlap_policy.decide(input).is_keyframe_);
+
+  input.median_parallax_ = 25.0;
+  input.feature_overlap_ratio_ = 0.5;
+  EXPECT_TRUE(parallax_policy.decide(input).is_keyframe_);
+  EXPECT_TRUE(overlap_policy.decide(input).is_keyframe_);
+
+  // Max time elapsed.
+  input.median_parallax_ = 5.0;
+  input.feature_overlap_ratio_ = 0.9;
+  input.time_since_keyframe_ = 1.0;
+  EXPECT_TRUE(parallax_policy.decide(input).is_keyframe_);
+  EXPECT_TRUE(overlap_policy.decide(input).is_keyframe_);
+}
+
+/* ************************************************************************* */
+TEST(testKeyframePolicy, loadAdaptivePolicy) {
+  LoadAdaptiveKeyframePolicy policy(
+      VIO::make_unique<TimeKeyframePolicy>(0.2, 10u), 0.2, 100.0, 3.0, 10u);
+  EXPECT_FALSE(policy.needsFeatureStats());
+  KeyframePolicyInput input;
+  input.nr_valid_features_ = 100u;
+  input.time_since_keyframe_ = 0.2;
+
+  // Backend idle: same as the time policy.
+  EXPECT_NEAR(policy.getStretch(input.backend_load_), 1.0, tol);
+  EXPECT_TRUE(policy.decide(input).is_keyframe_);
+
+  // One keyframe queued: spacing doubled.
+  input.backend_load_.queue_size_ = 1u;
+  EXPECT_NEAR(policy.getStretch(input.backend_load_), 2.0, tol);
+  EXPECT_FALSE(policy.decide(input).is_keyframe_);
+  input.time_since_keyframe_ = 0.4;
+  EXPECT_TRUE(policy.decide(input).is_keyframe_);
+
+  // Backend over budget, stretch is bounded.
+  input.backend_load_.queue_size_ = 0u;
+  input.backend_load_.last_spin_time_ = 250.0;
+  EXPECT_NEAR(policy.getStretch(input.backend_load_), 2.5, tol);
+  input.backend_load_.last_spin_time_ = 1000.0;
+  EXPECT_NEAR(policy.getStretch(input.backend_load_), 3.0, tol);
+  EXPECT_FALSE(policy.decide(input).is_keyframe_);
+
+  // Critical keyframes are never postponed.
+  input.nr_valid_features_ = 5u;
+  EXPECT_TRUE(policy.decide(input).is_keyframe_);
+}
+
+/* ************************************************************************* */
+TEST(testKeyframePolicy, featureStats) {
+  Frame keyframe(0u, 0, CameraParams(), cv::Mat());
+  keyframe.keypoints_ = {KeypointCV(10, 10), KeypointCV(20, 20),
+                         KeypointCV(30, 30), KeypointCV(40, 40)};
+  keyframe.landmarks_ = {0, 1, 2, -1};
+  Frame frame(1u, 1, CameraParams(), cv::Mat());
+  // Landmark 2 lost, 3 is new.
+  frame.keypoints_ = {KeypointCV(13, 14), KeypointCV(20, 30),
+                      KeypointCV(50, 50)};
+  frame.landmarks_ = {0, 1, 3};
+
+  double median_parallax = 0.0;
+  double feature_overlap_ratio = 0.0;
+  computeKeyframeFeatureStats(
+      keyframe, frame, &median_parallax, &feature_overlap_ratio);
+  EXPECT_NEAR(feature_overlap_ratio, 2.0 / 3.0, tol);
+  // Parallaxes are 5 and 10.
+  EXPECT_NEAR(median_parallax, 10.0, tol);
+}
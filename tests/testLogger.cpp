@@ -22,6 +22,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/random/mersenne_twister.hpp>
 
+#include "logging/AsyncLogWriter.h"
 #include "logging/Logger.h"
 #include "StereoVisionFrontEnd-definitions.h"
 #include "VioBackEnd-definitions.h"
@@ -31,6 +32,7 @@
 
 DECLARE_string(test_data_path);
 DECLARE_string(output_path);
+DECLARE_int32(async_log_ring_size);
 
 static const double tol = 1e-7;
 
@@ -141,6 +143,8 @@ TEST_F(BackendLoggerFixture, logBackendOutput) {
           cur_kf_id,
           landmark_count,
           DebugVioInfo()));
+  // Records are written asynchronously.
+  logger_->flush();
 
 
   // First check the output_posesVIO.csv results file.
@@ -273,6 +277,8 @@ TEST_F(FrontendLoggerFixture, logFrontendStats) {
       VIO::DebugTrackerInfo(),
       VIO::TrackerStatusSummary(),
       nrKeypoints);
+  // Records are written asynchronously.
+  logger_->flush();
 
   // First check the output_frontend_stats.csv results file.
   std::string stats_csv = FLAGS_output_path + "output_frontend_stats.csv";
@@ -291,7 +297,9 @@ TEST_F(FrontendLoggerFixture, logFrontendStats) {
        "nrNoRightRectRKP", "nrNoDepthRKP", "nrFailedArunRKP",
        "featureDetectionTime", "featureTrackingTime", "monoRansacTime",
        "stereoRansacTime", "featureSelectionTime", "extracted_corners",
-       "need_n_corners"};
+       "need_n_corners", "nrPrunedKltTracks", "nrPrunedStereoTracks",
+       "nrKltFbRejected", "nrGreedySelected",
+       "featureSelectionBudgetExpired"};
   checkHeader(actual_results_header, expected_results_header);
 
   // Check values of the only result line.
@@ -325,6 +333,8 @@ TEST_F(FrontendLoggerFixture, logFrontendRansac) {
       timestamp,
       mono_pose,
       stereo_pose);
+  // Records are written asynchronously.
+  logger_->flush();
 
   // First check the output_frontend_ransac_mono.csv results file.
   std::string ransac_mono_csv = FLAGS_output_path +
@@ -392,4 +402,69 @@ TEST_F(FrontendLoggerFixture, logFrontendRansac) {
   EXPECT_LT(actual_qz - stereo_pose.rotation().toQuaternion().z(), tol);
 }
 
+struct TestRecord {
+  int id;
+  double value;
+};
+
+TEST_F(LoggerFixture, asyncCsvLogDropsOnOverflow) {
+  google::FlagSaver flag_saver;
+  FLAGS_output_path = logger_FLAGS_test_data_path + "backend_output/";
+  FLAGS_async_log_ring_size = 4;
+  const size_t nr_records = 100u;
+  size_t nr_dropped = 0u;
+  {
+    AsyncRunLog<TestRecord> log(
+        "output_async_log.csv",
+        {{"id", RunLogColumnType::kInt32},
+         {"value", RunLogColumnType::kFloat64}},
+        [](const TestRecord& record, RunLogRowWriter* row) {
+          row->addInt32(record.id);
+          row->addFloat64(record.value);
+        });
+    for (size_t i = 0u; i < nr_records; i++) {
+      log.log(TestRecord{static_cast<int>(i), 0.5 * i});
+    }
+    nr_dropped = log.nrDropped();
+    EXPECT_GT(nr_dropped, 0u);
+  }  // Writes the pending records.
+
+  csv_mat records =
+      csv_reader_.getData(FLAGS_output_path + "output_async_log.csv");
+  ASSERT_GE(records.size(), 1u);
+  checkHeader(records.at(0), {"id", "value"});
+  // Records are either written, in order, or counted as dropped.
+  EXPECT_EQ(records.size() - 1u + nr_dropped, nr_records);
+  int prev_id = -1;
+  for (size_t i = 1u; i < records.size(); i++) {
+    const int id = std::stoi(records.at(i).at(0));
+    EXPECT_GT(id, prev_id);
+    EXPECT_EQ(std::stod(records.at(i).at(1)), 0.5 * id);
+    prev_id = id;
+  }
+}
+
+TEST_F(LoggerFixture, asyncCsvLogKeepsPrecision) {
+  google::FlagSaver flag_saver;
+  FLAGS_output_path = logger_FLAGS_test_data_path + "backend_output/";
+  // More significant digits than the default precision of a stream (6).
+  const double value = 1403636579.763555527;
+  {
+    AsyncRunLog<TestRecord> log(
+        "output_async_log_precision.csv",
+        {{"id", RunLogColumnType::kInt32},
+         {"value", RunLogColumnType::kFloat64}},
+        [](const TestRecord& record, RunLogRowWriter* row) {
+          row->addInt32(record.id);
+          row->addFloat64(record.value);
+        });
+    log.log(TestRecord{0, value});
+  }  // Writes the pending records.
+
+  csv_mat records = csv_reader_.getData(
+      FLAGS_output_path + "output_async_log_precision.csv");
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(std::stod(records.at(1).at(1)), value);
+}
+
 } // namespace VIO
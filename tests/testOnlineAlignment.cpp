@@ -20,11 +20,14 @@
 
 #include "ImuFrontEnd-definitions.h"
 #include "ImuFrontEnd.h"
+#include "initial/OnlineAlignmentSchedule.h"
 #include "initial/OnlineGravityAlignment.h"
 #include "utils/ThreadsafeImuBuffer.h"
 #include "ETH_parser.h"
 #include "test_config.h"
 
+DECLARE_bool(use_incremental_gravity_alignment);
+
 using namespace VIO;
 
 static const double tol_GB = 2e-4;
@@ -290,6 +293,60 @@ TEST(testOnlineAlignment, OnlineGravityAlignment) {
             init_navstate.velocity().z(), tol_OGA);
 }
 
+/* -------------------------------------------------------------------------- */
+TEST(testOnlineAlignment, IncrementalGravityAlignment) {
+  // Construct ETH Parser and get data
+  std::string reason = "test of incremental alignment estimation";
+  ETHDatasetParser dataset(reason);
+  static const std::string data_path(
+      DATASET_PATH + std::string("/ForOnlineAlignment/real_data/"));
+  int n_begin = 1000;
+  int n_frames = 40;
+  OnlineAlignmentTestData test_data(dataset, data_path, n_begin, n_frames);
+  gtsam::Vector3 n_gravity(0.0, 0.0, -9.81);
+
+  // Dense alignment.
+  FLAGS_use_incremental_gravity_alignment = false;
+  gtsam::Vector3 gyro_bias_dense = test_data.imu_bias_.gyroscope();
+  gtsam::Vector3 g_iter_dense;
+  gtsam::NavState init_navstate_dense;
+  OnlineGravityAlignment initial_alignment(test_data.estimated_poses_,
+                                           test_data.delta_t_poses_,
+                                           test_data.pims_, n_gravity);
+  bool is_success_dense = initial_alignment.alignVisualInertialEstimates(
+      &gyro_bias_dense, &g_iter_dense, &init_navstate_dense);
+  FLAGS_use_incremental_gravity_alignment = true;
+
+  // Incremental alignment, attempted after each new frame.
+  IncrementalGravityAlignment incremental_alignment(
+      n_gravity, test_data.pims_.size());
+  gtsam::Vector3 gyro_bias = test_data.imu_bias_.gyroscope();
+  gtsam::Vector3 g_iter;
+  gtsam::NavState init_navstate;
+  bool is_success = false;
+  for (size_t i = 0; i < test_data.pims_.size(); i++) {
+    incremental_alignment.addFrame(test_data.estimated_poses_.at(i),
+                                   test_data.estimated_poses_.at(i + 1),
+                                   test_data.delta_t_poses_.at(i),
+                                   test_data.pims_.at(i));
+    gyro_bias.setZero();
+    is_success = incremental_alignment.alignVisualInertialEstimates(
+        &gyro_bias, &g_iter, &init_navstate);
+  }
+  EXPECT_EQ(incremental_alignment.size(), test_data.pims_.size());
+
+  // Both solve the same least squares problems.
+  EXPECT_EQ(is_success_dense, is_success);
+  EXPECT_TRUE(gtsam::assert_equal(gyro_bias_dense, gyro_bias, tol_TB));
+  EXPECT_TRUE(gtsam::assert_equal(g_iter_dense, g_iter, tol_OGA));
+  EXPECT_TRUE(gtsam::assert_equal(init_navstate_dense.velocity(),
+                                  init_navstate.velocity(), tol_OGA));
+
+  // Reset drops all frames.
+  incremental_alignment.reset();
+  EXPECT_EQ(incremental_alignment.size(), 0u);
+}
+
 /* -------------------------------------------------------------------------- */
 TEST(testOnlineAlignment, GravityAlignmentRealData) {
   for (int i = 0; i < 30; i++) {
@@ -349,3 +406,51 @@ TEST(testOnlineAlignment, GravityAlignmentRealData) {
               init_navstate.velocity().z(), tol_RD); */
   }
 }
+
+/* -------------------------------------------------------------------------- */
+TEST(testOnlineAlignment, AlignmentWindowSlides) {
+  OnlineAlignmentSchedule schedule(3u, 2u);
+  for (size_t i = 0u; i < 2u; i++) {
+    schedule.addFrame();
+    EXPECT_EQ(schedule.slide(), 0u);
+    EXPECT_FALSE(schedule.shouldLaunch());
+  }
+  // First attempt as soon as the window is full.
+  schedule.addFrame();
+  EXPECT_EQ(schedule.slide(), 0u);
+  ASSERT_TRUE(schedule.shouldLaunch());
+  schedule.launch();
+  EXPECT_EQ(schedule.nrAttempts(), 1u);
+
+  // Frames tracked while the alignment runs are kept in the window, and only
+  // dropped once it is done.
+  schedule.addFrame();
+  schedule.addFrame();
+  EXPECT_EQ(schedule.nrFrames(), 5u);
+  EXPECT_EQ(schedule.slide(), 2u);
+  EXPECT_EQ(schedule.nrFrames(), 3u);
+
+  schedule.reset();
+  EXPECT_EQ(schedule.nrFrames(), 0u);
+  EXPECT_EQ(schedule.nrAttempts(), 0u);
+  EXPECT_FALSE(schedule.shouldLaunch());
+}
+
+/* -------------------------------------------------------------------------- */
+TEST(testOnlineAlignment, AlignmentRetryInterval) {
+  OnlineAlignmentSchedule schedule(3u, 2u);
+  for (size_t i = 0u; i < 3u; i++) schedule.addFrame();
+  ASSERT_TRUE(schedule.shouldLaunch());
+  schedule.launch();
+
+  // After a failure, not retried on every new frame.
+  schedule.addFrame();
+  EXPECT_EQ(schedule.slide(), 1u);
+  EXPECT_FALSE(schedule.shouldLaunch());
+  schedule.addFrame();
+  EXPECT_EQ(schedule.slide(), 1u);
+  ASSERT_TRUE(schedule.shouldLaunch());
+  schedule.launch();
+  EXPECT_EQ(schedule.nrAttempts(), 2u);
+  EXPECT_FALSE(schedule.shouldLaunch());
+}
@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPipelineCheckpoint.cpp
+ * @brief  test PipelineCheckpoint
+ * @author Antoni Rosinol
+ */
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "datasource/SyntheticDataSource.h"
+#include "pipeline/Pipeline.h"
+#include "pipeline/PipelineCheckpoint.h"
+
+DECLARE_int64(initial_k);
+DECLARE_int64(final_k);
+DECLARE_int32(synthetic_image_width);
+DECLARE_int32(synthetic_image_height);
+DECLARE_bool(visualize);
+DECLARE_bool(log_output);
+
+using namespace VIO;
+
+static const double tol = 1e-9;
+
+/* ************************************************************************* */
+TEST(testPipelineCheckpoint, saveAndLoad) {
+  PipelineCheckpoint checkpoint;
+  checkpoint.timestamp_lkf_ = 1403636579763555584;
+  checkpoint.W_Pose_Blkf_ = gtsam::Pose3(gtsam::Rot3::Ypr(0.1, -0.2, 0.3),
+                                         gtsam::Point3(1.0, 2.0, 3.0));
+  checkpoint.W_Vel_Blkf_ = gtsam::Vector3(0.1, 0.2, -0.3);
+  checkpoint.imu_bias_lkf_ = gtsam::imuBias::ConstantBias(
+      gtsam::Vector3(0.01, 0.02, 0.03), gtsam::Vector3(-0.001, 0.0, 0.002));
+  checkpoint.state_covariance_lkf_ = gtsam::Matrix::Identity(15, 15) * 0.5;
+  checkpoint.cur_kf_id_ = 42;
+  checkpoint.last_keyframe_id_ = 210u;
+  checkpoint.last_keyframe_timestamp_ = checkpoint.timestamp_lkf_;
+  checkpoint.landmark_count_ = 1234;
+
+  const std::string filename = "/tmp/testPipelineCheckpoint.bin";
+  ASSERT_TRUE(saveCheckpoint(checkpoint, filename));
+
+  PipelineCheckpoint loaded_checkpoint;
+  ASSERT_TRUE(loadCheckpoint(filename, &loaded_checkpoint));
+  EXPECT_EQ(loaded_checkpoint.timestamp_lkf_, checkpoint.timestamp_lkf_);
+  EXPECT_TRUE(
+      loaded_checkpoint.W_Pose_Blkf_.equals(checkpoint.W_Pose_Blkf_, tol));
+  EXPECT_TRUE(
+      gtsam::assert_equal(loaded_checkpoint.W_Vel_Blkf_, checkpoint.W_Vel_Blkf_));
+  EXPECT_TRUE(
+      loaded_checkpoint.imu_bias_lkf_.equals(checkpoint.imu_bias_lkf_, tol));
+  EXPECT_TRUE(gtsam::assert_equal(loaded_checkpoint.state_covariance_lkf_,
+                                  checkpoint.state_covariance_lkf_));
+  EXPECT_EQ(loaded_checkpoint.cur_kf_id_, checkpoint.cur_kf_id_);
+  EXPECT_EQ(loaded_checkpoint.last_keyframe_id_, checkpoint.last_keyframe_id_);
+  EXPECT_EQ(loaded_checkpoint.last_keyframe_timestamp_,
+            checkpoint.last_keyframe_timestamp_);
+  EXPECT_EQ(loaded_checkpoint.landmark_count_, checkpoint.landmark_count_);
+
+  std::remove(filename.c_str());
+}
+
+/* ************************************************************************* */
+TEST(testPipelineCheckpoint, loadMissingFile) {
+  PipelineCheckpoint checkpoint;
+  EXPECT_FALSE(
+      loadCheckpoint("/tmp/testPipelineCheckpoint_missing.bin", &checkpoint));
+}
+
+/* ************************************************************************* */
+// Keyframe poses of a sequential pipeline over frames [initial_k, final_k)
+// of the synthetic dataset, optionally restored from / checkpointed to a file.
+static std::map<Timestamp, gtsam::Pose3> runSyntheticPipeline(
+    const FrameId& initial_k, const FrameId& final_k,
+    const std::string& restore_filename, const std::string& save_filename) {
+  FLAGS_initial_k = initial_k;
+  FLAGS_final_k = final_k;
+  SyntheticDataProvider data_provider;
+  std::map<Timestamp, gtsam::Pose3> poses;
+  std::mutex poses_mutex;
+  {
+    Pipeline vio_pipeline(data_provider.pipeline_params_, false);
+    if (!restore_filename.empty()) {
+      EXPECT_TRUE(vio_pipeline.restoreCheckpoint(restore_filename));
+    }
+    vio_pipeline.registerKeyFrameRateOutputCallback(
+        [&poses, &poses_mutex](const SpinOutputPacket& output) {
+          std::lock_guard<std::mutex> lock(poses_mutex);
+          poses[output.getTimestamp()] = output.getEstimatedPose();
+        });
+    data_provider.registerVioCallback(
+        [&vio_pipeline](const StereoImuSyncPacket& packet) {
+          vio_pipeline.spin(packet);
+        });
+    EXPECT_TRUE(data_provider.spin());
+    // Sequential: all the keyframes have been processed.
+    if (!save_filename.empty()) {
+      EXPECT_TRUE(vio_pipeline.saveCheckpoint(save_filename));
+    }
+    vio_pipeline.shutdown();
+  }
+  return poses;
+}
+
+/* ************************************************************************* */
+TEST(testPipelineCheckpoint, restoreMatchesUninterruptedRun) {
+  google::FlagSaver flag_saver;
+  FLAGS_synthetic_image_width = 376;
+  FLAGS_synthetic_image_height = 240;
+  FLAGS_visualize = false;
+  FLAGS_log_output = false;
+
+  const std::map<Timestamp, gtsam::Pose3> uninterrupted_poses =
+      runSyntheticPipeline(10, 60, "", "");
+  ASSERT_FALSE(uninterrupted_poses.empty());
+
+  // Interrupted at frame 35, and resumed at the checkpoint keyframe.
+  const std::string filename = "/tmp/testPipelineCheckpointRestore.bin";
+  runSyntheticPipeline(10, 35, "", filename);
+  PipelineCheckpoint checkpoint;
+  ASSERT_TRUE(loadCheckpoint(filename, &checkpoint));
+  EXPECT_GT(checkpoint.cur_kf_id_, 0);
+  EXPECT_GT(checkpoint.landmark_count_, 0);
+  const std::map<Timestamp, gtsam::Pose3> restored_poses =
+      runSyntheticPipeline(checkpoint.last_keyframe_id_, 60, filename, "");
+  std::remove(filename.c_str());
+  ASSERT_FALSE(restored_poses.empty());
+
+  // The graph restarts at the checkpoint keyframe, so the estimates are not
+  // identical, but close to the ones of the uninterrupted run.
+  size_t nr_common_keyframes = 0u;
+  for (const auto& restored_pose : restored_poses) {
+    const auto& it = uninterrupted_poses.find(restored_pose.first);
+    if (it == uninterrupted_poses.end()) continue;
+    ++nr_common_keyframes;
+    const gtsam::Pose3 delta = it->second.between(restored_pose.second);
+    EXPECT_LT(delta.translation().norm(), 0.05) << restored_pose.first;
+    EXPECT_LT(gtsam::Rot3::Logmap(delta.rotation()).norm(), 0.02)
+        << restored_pose.first;
+  }
+  EXPECT_GT(nr_common_keyframes, 0u);
+}
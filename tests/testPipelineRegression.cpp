@@ -0,0 +1,95 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPipelineRegression.cpp
+ * @brief  test PipelineRegression
+ * @author Antoni Rosinol
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "pipeline/PipelineRegression.h"
+
+using namespace VIO;
+
+static const double tol = 1e-9;
+
+static RegressionMetrics baselineMetrics() {
+  RegressionMetrics metrics;
+  metrics["parallel/Backend Timing [ms]/p99"] = {20.0, 0.25, 0.5};
+  metrics["parallel/Peak RSS [MB]"] = {300.0, 0.1, 10.0};
+  metrics["sequential/ATE [m]"] = {0.001, 0.1, 0.01};
+  return metrics;
+}
+
+/* ************************************************************************* */
+TEST(testPipelineRegression, saveAndLoad) {
+  const RegressionMetrics metrics = baselineMetrics();
+  const std::string filename = "/tmp/testPipelineRegression.yaml";
+  ASSERT_TRUE(saveRegressionMetrics(metrics, filename));
+
+  RegressionMetrics loaded_metrics;
+  ASSERT_TRUE(loadRegressionMetrics(filename, &loaded_metrics));
+  ASSERT_EQ(loaded_metrics.size(), metrics.size());
+  for (const auto& metric : metrics) {
+    const auto& it = loaded_metrics.find(metric.first);
+    ASSERT_TRUE(it != loaded_metrics.end()) << metric.first;
+    EXPECT_NEAR(it->second.value_, metric.second.value_, tol);
+    EXPECT_NEAR(it->second.tolerance_, metric.second.tolerance_, tol);
+    EXPECT_NEAR(it->second.absolute_tolerance_,
+                metric.second.absolute_tolerance_, tol);
+  }
+  std::remove(filename.c_str());
+}
+
+/* ************************************************************************* */
+TEST(testPipelineRegression, loadMissingFile) {
+  RegressionMetrics metrics;
+  EXPECT_FALSE(loadRegressionMetrics("/tmp/testPipelineRegression_missing.yaml",
+                                     &metrics));
+}
+
+/* ************************************************************************* */
+TEST(testPipelineRegression, compare) {
+  const RegressionMetrics baseline = baselineMetrics();
+
+  // Within tolerance, or better than the baseline.
+  RegressionMetrics current = baseline;
+  current["parallel/Backend Timing [ms]/p99"].value_ = 24.9;
+  current["parallel/Peak RSS [MB]"].value_ = 200.0;
+  // The absolute tolerance dominates for values close to zero.
+  current["sequential/ATE [m]"].value_ = 0.0105;
+  // New metrics are not regressions.
+  current["sequential/Peak RSS [MB]"] = {1000.0, 0.1, 10.0};
+  EXPECT_TRUE(compareRegressionMetrics(baseline, current).empty());
+
+  // Beyond tolerance.
+  current["parallel/Backend Timing [ms]/p99"].value_ = 25.1;
+  std::vector<std::string> regressions =
+      compareRegressionMetrics(baseline, current);
+  ASSERT_EQ(regressions.size(), 1u);
+  EXPECT_EQ(regressions[0].find("parallel/Backend Timing [ms]/p99"), 0u);
+
+  // Missing metric.
+  current.erase("sequential/ATE [m]");
+  regressions = compareRegressionMetrics(baseline, current);
+  EXPECT_EQ(regressions.size(), 2u);
+}
+
+/* ************************************************************************* */
+TEST(testPipelineRegression, resourceUsage) {
+  EXPECT_GT(getPeakRssMb(), 0.0);
+  EXPECT_GE(getProcessCpuTime(), 0.0);
+  EXPECT_GE(getThreadCpuTime(pthread_self()), 0.0);
+}
@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testProfiler.cpp
+ * @brief  test Profiler
+ * @author Antoni Rosinol
+ */
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "utils/Profiler.h"
+#include "utils/Statistics.h"
+
+using VIO::utils::Profiler;
+using VIO::utils::ScopedTimer;
+using VIO::utils::Statistics;
+
+static void sleepMs(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/* ************************************************************************* */
+TEST(testProfiler, scopedTimer) {
+  // Available whether or not the zones are compiled.
+  ScopedTimer timer;
+  sleepMs(2);
+  EXPECT_GE(timer.elapsedSeconds(), 2e-3);
+  EXPECT_LT(timer.elapsedSeconds(), 1.0);
+}
+
+#ifdef SPARK_VIO_ENABLE_PROFILING
+/* ************************************************************************* */
+TEST(testProfiler, namedZone) {
+  VIO_PROFILE_ZONE_NAMED(zone, "testProfiler namedZone");
+  sleepMs(2);
+  EXPECT_GE(zone.elapsedSeconds(), 2e-3);
+}
+
+/* ************************************************************************* */
+TEST(testProfiler, registerZone) {
+  const size_t zone_id = Profiler::RegisterZone("testProfiler registerZone");
+  EXPECT_EQ(Profiler::RegisterZone("testProfiler registerZone"), zone_id);
+  EXPECT_NE(Profiler::RegisterZone("testProfiler registerZone 2"), zone_id);
+  EXPECT_EQ(Profiler::GetZoneName(zone_id), "testProfiler registerZone");
+}
+
+/* ************************************************************************* */
+TEST(testProfiler, nestedZones) {
+  Profiler::SetTraceEnabled(true);
+  Profiler::ClearEvents();
+  for (int i = 0; i < 3; i++) {
+    VIO_PROFILE_ZONE("testProfiler outer");
+    sleepMs(1);
+    {
+      VIO_PROFILE_ZONE("testProfiler inner");
+      sleepMs(1);
+    }
+  }
+  Profiler::SetTraceEnabled(false);
+  {
+    // Not traced, but still in the statistics.
+    VIO_PROFILE_ZONE("testProfiler outer");
+  }
+
+  EXPECT_EQ(Statistics::GetNumSamples("testProfiler outer [ms]"), 4u);
+  EXPECT_EQ(Statistics::GetNumSamples("testProfiler inner [ms]"), 3u);
+  EXPECT_GE(Statistics::GetMax("testProfiler outer [ms]"), 2.0);
+
+  const std::vector<Profiler::Event> events = Profiler::GetEvents();
+  ASSERT_EQ(events.size(), 6u);
+  for (size_t i = 0u; i < events.size(); i += 2u) {
+    // Sorted by start time: outer first, and the inner zone is within it.
+    const Profiler::Event& outer = events[i];
+    const Profiler::Event& inner = events[i + 1u];
+    EXPECT_EQ(Profiler::GetZoneName(outer.zone_id), "testProfiler outer");
+    EXPECT_EQ(Profiler::GetZoneName(inner.zone_id), "testProfiler inner");
+    EXPECT_EQ(outer.depth, 0u);
+    EXPECT_EQ(inner.depth, 1u);
+    EXPECT_LE(outer.start_ns, inner.start_ns);
+    EXPECT_LE(inner.end_ns, outer.end_ns);
+    EXPECT_EQ(outer.thread_id, inner.thread_id);
+  }
+
+  Profiler::ClearEvents();
+  EXPECT_TRUE(Profiler::GetEvents().empty());
+}
+
+/* ************************************************************************* */
+TEST(testProfiler, threadsAndChromeTrace) {
+  Profiler::SetTraceEnabled(true);
+  Profiler::ClearEvents();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 100; i++) {
+        VIO_PROFILE_ZONE("testProfiler \"thread\"");
+      }
+    });
+  }
+  // Snapshots do not block the threads.
+  for (int i = 0; i < 10; i++) {
+    EXPECT_LE(Profiler::GetEvents().size(), 400u);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  Profiler::SetTraceEnabled(false);
+
+  const std::vector<Profiler::Event> events = Profiler::GetEvents();
+  EXPECT_EQ(events.size(), 400u);
+
+  const std::string path = "testProfilerTrace.json";
+  ASSERT_TRUE(Profiler::WriteChromeTrace(path));
+  std::ifstream trace_file(path);
+  std::stringstream trace;
+  trace << trace_file.rdbuf();
+  EXPECT_EQ(trace.str().find("{\"traceEvents\":["), 0u);
+  EXPECT_NE(trace.str().find("\"name\":\"testProfiler \\\"thread\\\"\""),
+            std::string::npos);
+  EXPECT_NE(trace.str().find("\"ph\":\"X\""), std::string::npos);
+  Profiler::ClearEvents();
+}
+#endif
@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testRunLog.cpp
+ * @brief  test RunLog
+ * @author Antoni Rosinol
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "logging/RunLog.h"
+
+using namespace VIO;
+
+static const RunLogSchema kSchema = {
+    {"timestamp", RunLogColumnType::kInt64},
+    {"x", RunLogColumnType::kFloat64},
+    {"status", RunLogColumnType::kUint8, {"VALID", "INVALID"}},
+    {"nr_features", RunLogColumnType::kUint64},
+    {"id", RunLogColumnType::kInt32}};
+
+// Writes nr_rows rows of kSchema.
+static void writeRows(RunLogRowWriter* writer, size_t nr_rows) {
+  for (size_t i = 0u; i < nr_rows; i++) {
+    writer->addInt64(1403636579763555584 + static_cast<int64_t>(i));
+    writer->addFloat64(0.1 * i);
+    writer->addUint8(i % 2u);
+    writer->addUint64(i * 3u);
+    writer->addInt32(-static_cast<int32_t>(i));
+    writer->endRow();
+  }
+}
+
+// Writes a run log of nr_rows rows to filename.
+static void writeRunLog(const std::string& filename, size_t nr_rows,
+                        size_t rows_per_chunk, bool compress) {
+  std::ofstream file(filename, std::ios::binary);
+  RunLogWriter writer("test", kSchema, &file, rows_per_chunk, compress);
+  writeRows(&writer, nr_rows);
+}
+
+/* ************************************************************************* */
+TEST(testRunLog, csvRows) {
+  std::ostringstream csv;
+  {
+    CsvRowWriter writer(kSchema, &csv);
+    writeRows(&writer, 2u);
+  }
+  EXPECT_EQ(csv.str(),
+            "timestamp,x,status,nr_features,id\n"
+            "1403636579763555584,0,VALID,0,0\n"
+            "1403636579763555585,0.1,INVALID,3,-1\n");
+}
+
+/* ************************************************************************* */
+TEST(testRunLog, roundTrip) {
+  const std::string filename = "testRunLog.runlog";
+  for (bool compress : {false, true}) {
+    // Several chunks, the last one partial.
+    writeRunLog(filename, 2500u, 1000u, compress);
+    RunLog run_log;
+    ASSERT_TRUE(readRunLog(filename, &run_log));
+    EXPECT_EQ(run_log.stream_name_, "test");
+    ASSERT_EQ(run_log.schema_.size(), kSchema.size());
+    for (size_t c = 0u; c < kSchema.size(); c++) {
+      EXPECT_EQ(run_log.schema_[c].name_, kSchema[c].name_);
+      EXPECT_TRUE(run_log.schema_[c].type_ == kSchema[c].type_);
+      EXPECT_EQ(run_log.schema_[c].labels_, kSchema[c].labels_);
+    }
+    ASSERT_EQ(run_log.nr_rows_, 2500u);
+    for (size_t i = 0u; i < run_log.nr_rows_; i++) {
+      EXPECT_EQ(run_log.value<int64_t>(0u, i),
+                1403636579763555584 + static_cast<int64_t>(i));
+      EXPECT_EQ(run_log.value<double>(1u, i), 0.1 * i);
+      EXPECT_EQ(run_log.value<uint8_t>(2u, i), i % 2u);
+      EXPECT_EQ(run_log.value<uint64_t>(3u, i), i * 3u);
+      EXPECT_EQ(run_log.value<int32_t>(4u, i), -static_cast<int32_t>(i));
+    }
+  }
+  std::remove(filename.c_str());
+}
+
+/* ************************************************************************* */
+TEST(testRunLog, convertToCsv) {
+  const std::string filename = "testRunLog.runlog";
+  writeRunLog(filename, 100u, 16u, true);
+  RunLog run_log;
+  ASSERT_TRUE(readRunLog(filename, &run_log));
+  std::remove(filename.c_str());
+
+  // Same CSV as written directly.
+  std::ostringstream expected_csv;
+  expected_csv.precision(20);
+  {
+    CsvRowWriter writer(kSchema, &expected_csv);
+    writeRows(&writer, 100u);
+  }
+  std::ostringstream csv;
+  csv.precision(20);
+  writeRunLogAsCsv(run_log, &csv);
+  EXPECT_EQ(csv.str(), expected_csv.str());
+}
+
+// Contents of a file.
+static std::string readBytes(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+/* ************************************************************************* */
+TEST(testRunLog, readWithoutFooter) {
+  const std::string filename = "testRunLog.runlog";
+  writeRunLog(filename, 25u, 10u, true);
+  // A run that crashed after writing its chunks, but not the footer.
+  std::string bytes = readBytes(filename);
+  const size_t footer = bytes.rfind("FOOT");
+  ASSERT_NE(footer, std::string::npos);
+  bytes.resize(footer);
+  std::ofstream(filename, std::ios::binary).write(bytes.data(), bytes.size());
+  RunLog run_log;
+  ASSERT_TRUE(readRunLog(filename, &run_log));
+  EXPECT_EQ(run_log.nr_rows_, 25u);
+  EXPECT_EQ(run_log.value<uint64_t>(3u, 24u), 72u);
+
+  // A truncated last chunk is skipped.
+  bytes.resize(bytes.size() - 5u);
+  std::ofstream(filename, std::ios::binary).write(bytes.data(), bytes.size());
+  ASSERT_TRUE(readRunLog(filename, &run_log));
+  EXPECT_EQ(run_log.nr_rows_, 20u);
+  std::remove(filename.c_str());
+}
+
+/* ************************************************************************* */
+TEST(testRunLog, notARunLog) {
+  const std::string filename = "testRunLog.csv";
+  std::ofstream(filename) << "timestamp,x\n1,2\n";
+  RunLog run_log;
+  EXPECT_FALSE(readRunLog(filename, &run_log));
+  EXPECT_FALSE(readRunLog("testRunLogMissing.runlog", &run_log));
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,163 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStatistics.cpp
+ * @brief  test Statistics and LogHistogram
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "utils/LogHistogram.h"
+#include "utils/Statistics.h"
+
+using VIO::utils::LogHistogram;
+using VIO::utils::Statistics;
+using VIO::utils::StatsCollector;
+
+/* ************************************************************************* */
+TEST(testLogHistogram, bucketResolution) {
+  const double resolution = 1.0 / LogHistogram::kNrSubBuckets;
+  for (double value : {1e-6, 3.3e-4, 0.5, 1.0, 1.01, 7.0, 123.456, 1e9}) {
+    for (double sign : {1.0, -1.0}) {
+      const double bucket_value =
+          LogHistogram::BucketValue(LogHistogram::BucketIndex(sign * value));
+      EXPECT_NEAR(bucket_value, sign * value, resolution * value);
+    }
+  }
+  // Buckets are sorted by value.
+  EXPECT_LT(LogHistogram::BucketIndex(-2.0), LogHistogram::BucketIndex(-1.0));
+  EXPECT_LT(LogHistogram::BucketIndex(-1.0), LogHistogram::BucketIndex(0.0));
+  EXPECT_LT(LogHistogram::BucketIndex(0.0), LogHistogram::BucketIndex(1.0));
+  EXPECT_LT(LogHistogram::BucketIndex(1.0), LogHistogram::BucketIndex(1.1));
+  EXPECT_EQ(LogHistogram::BucketValue(LogHistogram::BucketIndex(0.0)), 0.0);
+  // Out of range values are clamped.
+  EXPECT_EQ(LogHistogram::BucketIndex(1e-30), LogHistogram::BucketIndex(0.0));
+  EXPECT_EQ(LogHistogram::BucketIndex(1e30), LogHistogram::kNrBuckets - 1u);
+  EXPECT_EQ(LogHistogram::BucketIndex(-1e30), 0u);
+}
+
+/* ************************************************************************* */
+TEST(testLogHistogram, percentiles) {
+  LogHistogram histogram;
+  EXPECT_EQ(histogram.percentile(0.5), 0.0);
+  // Resetting an empty histogram (without buckets yet) is a no-op.
+  histogram.reset();
+  EXPECT_EQ(histogram.percentile(0.5), 0.0);
+  for (int i = 1; i <= 10000; i++) {
+    histogram.add(i);
+  }
+  histogram.add(std::nan(""));
+  const double resolution = 1.0 / LogHistogram::kNrSubBuckets;
+  EXPECT_NEAR(histogram.percentile(0.5), 5000.0, 5000.0 * resolution);
+  EXPECT_NEAR(histogram.percentile(0.9), 9000.0, 9000.0 * resolution);
+  EXPECT_NEAR(histogram.percentile(0.99), 9900.0, 9900.0 * resolution);
+  EXPECT_NEAR(histogram.percentile(0.999), 9990.0, 9990.0 * resolution);
+  EXPECT_NEAR(histogram.percentile(1.0), 10000.0, 10000.0 * resolution);
+  EXPECT_NEAR(histogram.percentile(0.0), 1.0, resolution);
+
+  histogram.reset();
+  EXPECT_EQ(histogram.percentile(0.5), 0.0);
+}
+
+/* ************************************************************************* */
+TEST(testStatistics, samples) {
+  const std::string tag = "testStatistics samples [ms]";
+  StatsCollector stats(tag);
+  for (int i = 1; i <= 1000; i++) {
+    stats.AddSample(i);
+  }
+  // A stats collector with the same tag has the same handle.
+  EXPECT_EQ(StatsCollector(tag).GetHandle(), stats.GetHandle());
+  EXPECT_TRUE(Statistics::HasHandle(tag));
+
+  EXPECT_EQ(Statistics::GetNumSamples(tag), 1000u);
+  EXPECT_DOUBLE_EQ(Statistics::GetTotal(tag), 500500.0);
+  EXPECT_DOUBLE_EQ(Statistics::GetMean(tag), 500.5);
+  EXPECT_DOUBLE_EQ(Statistics::GetMin(tag), 1.0);
+  EXPECT_DOUBLE_EQ(Statistics::GetMax(tag), 1000.0);
+  EXPECT_DOUBLE_EQ(Statistics::GetLastValue(tag), 1000.0);
+  // Sample variance of 1, ..., n is n * (n + 1) / 12.
+  EXPECT_NEAR(Statistics::GetVariance(tag), 1000.0 * 1001.0 / 12.0, 1e-6);
+  const double resolution = 1.0 / LogHistogram::kNrSubBuckets;
+  EXPECT_NEAR(Statistics::GetMedian(tag), 500.0, 500.0 * resolution);
+  EXPECT_NEAR(Statistics::GetQ1(tag), 250.0, 250.0 * resolution);
+  EXPECT_NEAR(Statistics::GetQ3(tag), 750.0, 750.0 * resolution);
+  EXPECT_NEAR(Statistics::GetPercentile(tag, 0.99), 990.0, 990.0 * resolution);
+  // Clamped to the samples.
+  EXPECT_LE(Statistics::GetPercentile(tag, 1.0), 1000.0);
+
+  // Only the last samples are kept, oldest first.
+  const std::vector<double> samples = Statistics::GetAllSamples(tag);
+  ASSERT_EQ(samples.size(),
+            static_cast<size_t>(VIO::utils::StatisticsMapValue::kWindowSize));
+  EXPECT_EQ(samples.front(), 1001.0 - samples.size());
+  EXPECT_EQ(samples.back(), 1000.0);
+
+  EXPECT_GE(Statistics::GetMinDeltaTime(tag), 0.0);
+  EXPECT_GE(Statistics::GetMaxDeltaTime(tag),
+            Statistics::GetMinDeltaTime(tag));
+}
+
+/* ************************************************************************* */
+TEST(testStatistics, reset) {
+  const std::string tag = "testStatistics reset [#]";
+  StatsCollector stats(tag);
+  stats.IncrementOne();
+  stats.IncrementOne();
+  EXPECT_EQ(Statistics::GetNumSamples(tag), 2u);
+
+  Statistics::Reset();
+  EXPECT_FALSE(Statistics::HasHandle(tag));
+  // The handle is still valid, and the tag comes back with the same one.
+  stats.AddSample(3.0);
+  EXPECT_EQ(StatsCollector(tag).GetHandle(), stats.GetHandle());
+  EXPECT_TRUE(Statistics::HasHandle(tag));
+  EXPECT_EQ(Statistics::GetNumSamples(tag), 1u);
+  EXPECT_DOUBLE_EQ(Statistics::GetMean(tag), 3.0);
+}
+
+/* ************************************************************************* */
+TEST(testStatistics, concurrentWriters) {
+  const std::string tag = "testStatistics concurrentWriters [us]";
+  const size_t nr_threads = 4u;
+  const int nr_samples = 10000;
+  std::vector<std::thread> threads;
+  for (size_t t = 0u; t < nr_threads; t++) {
+    threads.emplace_back([&tag] {
+      for (int i = 1; i <= nr_samples; i++) {
+        StatsCollector(tag).AddSample(i);
+      }
+    });
+  }
+  // Reading while writing does not block the writers.
+  for (int i = 0; i < 100; i++) {
+    EXPECT_LE(Statistics::GetNumSamples(tag), nr_threads * nr_samples);
+    Statistics::Print();
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(Statistics::GetNumSamples(tag), nr_threads * nr_samples);
+  // Integer sums are exact.
+  EXPECT_DOUBLE_EQ(Statistics::GetTotal(tag),
+                   nr_threads * nr_samples * (nr_samples + 1) / 2.0);
+  EXPECT_DOUBLE_EQ(Statistics::GetMin(tag), 1.0);
+  EXPECT_DOUBLE_EQ(Statistics::GetMax(tag), nr_samples);
+  const double resolution = 1.0 / LogHistogram::kNrSubBuckets;
+  EXPECT_NEAR(Statistics::GetPercentile(tag, 0.9), 0.9 * nr_samples,
+              0.9 * nr_samples * resolution);
+}
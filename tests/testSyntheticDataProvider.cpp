@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testSyntheticDataProvider.cpp
+ * @brief  Unit tests for the synthetic stereo + IMU data provider.
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "StereoImuSyncPacket.h"
+#include "datasource/SyntheticDataSource.h"
+#include "imu-frontend/ImuFrontEnd.h"
+
+DECLARE_int64(initial_k);
+DECLARE_int64(final_k);
+DECLARE_int32(synthetic_image_width);
+DECLARE_int32(synthetic_image_height);
+DECLARE_bool(synthetic_imu_noise);
+
+namespace VIO {
+
+class SyntheticDataProviderFixture : public ::testing::Test {
+ public:
+  SyntheticDataProviderFixture() {
+    // Few small frames, to keep the test fast.
+    FLAGS_initial_k = 10;
+    FLAGS_final_k = 15;
+    FLAGS_synthetic_image_width = 160;
+    FLAGS_synthetic_image_height = 120;
+  }
+
+ protected:
+  std::vector<StereoImuSyncPacket> spinDataset(
+      SyntheticDataProvider* data_provider) {
+    CHECK_NOTNULL(data_provider);
+    std::vector<StereoImuSyncPacket> packets;
+    data_provider->registerVioCallback(
+        [&packets](const StereoImuSyncPacket& packet) {
+          packets.push_back(packet);
+        });
+    EXPECT_TRUE(data_provider->spin());
+    return packets;
+  }
+
+ private:
+  // Restores the flags modified by the tests.
+  google::FlagSaver flag_saver_;
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SyntheticDataProviderFixture, imagesAreTextured) {
+  SyntheticDataProvider data_provider;
+  std::vector<StereoImuSyncPacket> packets = spinDataset(&data_provider);
+  ASSERT_EQ(packets.size(),
+            static_cast<size_t>(FLAGS_final_k - FLAGS_initial_k));
+  for (const StereoImuSyncPacket& packet : packets) {
+    for (const Frame* frame : {&packet.getStereoFrame().getLeftFrame(),
+                               &packet.getStereoFrame().getRightFrame()}) {
+      EXPECT_EQ(frame->img_.cols, FLAGS_synthetic_image_width);
+      EXPECT_EQ(frame->img_.rows, FLAGS_synthetic_image_height);
+      cv::Scalar mean, stddev;
+      cv::meanStdDev(frame->img_, mean, stddev);
+      EXPECT_GT(stddev[0], 10.0);
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SyntheticDataProviderFixture, isDeterministic) {
+  FLAGS_synthetic_imu_noise = true;
+  SyntheticDataProvider data_provider_1;
+  SyntheticDataProvider data_provider_2;
+  std::vector<StereoImuSyncPacket> packets_1 = spinDataset(&data_provider_1);
+  std::vector<StereoImuSyncPacket> packets_2 = spinDataset(&data_provider_2);
+  ASSERT_EQ(packets_1.size(), packets_2.size());
+  for (size_t i = 0u; i < packets_1.size(); i++) {
+    EXPECT_TRUE(packets_1[i].getImuAccGyr() == packets_2[i].getImuAccGyr());
+    EXPECT_EQ(cv::norm(packets_1[i].getStereoFrame().getLeftFrame().img_,
+                       packets_2[i].getStereoFrame().getLeftFrame().img_,
+                       cv::NORM_L1),
+              0.0);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SyntheticDataProviderFixture, imuIsConsistentWithGroundTruth) {
+  // Without noise, preintegrating the IMU between frames must bring the
+  // ground truth state of a frame to the one of the next frame.
+  FLAGS_synthetic_imu_noise = false;
+  SyntheticDataProvider data_provider;
+  const PipelineParams& pipeline_params = data_provider.pipeline_params_;
+  std::vector<StereoImuSyncPacket> packets = spinDataset(&data_provider);
+  ASSERT_GE(packets.size(), 2u);
+  for (size_t i = 1u; i < packets.size(); i++) {
+    const Timestamp timestamp_prev =
+        packets[i - 1].getStereoFrame().getTimestamp();
+    const Timestamp timestamp = packets[i].getStereoFrame().getTimestamp();
+    const VioNavState state_prev =
+        data_provider.getGroundTruthState(timestamp_prev);
+    const VioNavState state = data_provider.getGroundTruthState(timestamp);
+
+    ImuFrontEnd imu_frontend(pipeline_params.imu_params_, ImuBias());
+    const gtsam::NavState predicted_state =
+        imu_frontend
+            .preintegrateImuMeasurements(packets[i].getImuStamps(),
+                                         packets[i].getImuAccGyr())
+            .predict(gtsam::NavState(state_prev.pose_, state_prev.velocity_),
+                     ImuBias());
+    EXPECT_TRUE(gtsam::assert_equal(state.pose_, predicted_state.pose(), 1e-3));
+    EXPECT_TRUE(gtsam::assert_equal(state.velocity_,
+                                    predicted_state.velocity(), 1e-3));
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,60 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testThreadPool.cpp
+ * @brief  test ThreadPool
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "utils/ThreadPool.h"
+
+using VIO::utils::ThreadPool;
+
+/* ************************************************************************* */
+TEST(testThreadPool, nrThreads) {
+  EXPECT_EQ(ThreadPool(1).getNrThreads(), 1u);
+  EXPECT_EQ(ThreadPool(3).getNrThreads(), 3u);
+  EXPECT_GE(ThreadPool(0).getNrThreads(), 1u);
+}
+
+/* ************************************************************************* */
+TEST(testThreadPool, parallelForVisitsEachIndexOnce) {
+  ThreadPool pool(4);
+  // Run several loops on the same pool, including empty and tiny ones.
+  for (size_t n : {0u, 1u, 2u, 7u, 1000u}) {
+    std::vector<int> visits(n + 3u, 0);
+    pool.parallelFor(3u, n + 3u, [&visits](const size_t& i) { visits[i]++; });
+    for (size_t i = 0u; i < visits.size(); i++) {
+      EXPECT_EQ(visits[i], i < 3u ? 0 : 1) << "n: " << n << " i: " << i;
+    }
+  }
+}
+
+/* ************************************************************************* */
+TEST(testThreadPool, parallelForFromSeveralThreads) {
+  ThreadPool pool(3);
+  std::atomic<size_t> sum{0u};
+  std::vector<std::thread> callers;
+  for (size_t c = 0u; c < 4u; c++) {
+    callers.emplace_back([&pool, &sum] {
+      for (size_t k = 0u; k < 10u; k++) {
+        pool.parallelFor(0u, 100u, [&sum](const size_t& i) { sum += i; });
+      }
+    });
+  }
+  for (std::thread& caller : callers) caller.join();
+  EXPECT_EQ(sum, 4u * 10u * 4950u);
+}
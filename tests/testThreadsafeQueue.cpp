@@ -107,6 +107,23 @@ TEST(testThreadsafeQueue, push) {
   p.join();
 }
 
+/* ************************************************************************* */
+TEST(testThreadsafeQueue, clear) {
+  ThreadsafeQueue<std::string> q("test_queue");
+  q.push("Hello World!");
+  q.push("Hello World 2!");
+  EXPECT_EQ(q.clear(), 2u);
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(q.pop(), nullptr);
+
+  // Clearing does not shutdown the queue.
+  EXPECT_TRUE(q.push("Hello World 3!"));
+  std::string s;
+  EXPECT_TRUE(q.popBlocking(s));
+  EXPECT_EQ(s, "Hello World 3!");
+  EXPECT_EQ(q.clear(), 0u);
+}
+
 /* ************************************************************************* */
 TEST(testThreadsafeQueue, producer_consumer) {
   ThreadsafeQueue<std::string> q("test_queue");
@@ -333,6 +333,24 @@ TEST_F(ThreadsafeTemporalBufferFixture, MaintaingBufferLengthWorks) {
   EXPECT_EQ(retrieved_item.timestamp, 150);
 }
 
+TEST_F(ThreadsafeTemporalBufferFixture, AddNewestValuesWorks) {
+  addValue(TestData(0));
+  const int64_t timestamps[] = {50, 100, 150};
+  buffer_.addNewestValues(timestamps, 3u, [&timestamps](const size_t& i) {
+    return TestData(timestamps[i]);
+  });
+  // The value at 0 is outdated.
+  EXPECT_EQ(buffer_.size(), 3u);
+
+  TestData retrieved_item;
+  EXPECT_TRUE(buffer_.getOldestValue(&retrieved_item));
+  EXPECT_EQ(retrieved_item.timestamp, 50);
+  EXPECT_TRUE(buffer_.getValueAtTime(100, &retrieved_item));
+  EXPECT_EQ(retrieved_item.timestamp, 100);
+  EXPECT_TRUE(buffer_.getNewestValue(&retrieved_item));
+  EXPECT_EQ(retrieved_item.timestamp, 150);
+}
+
 }  // namespace utils
 
 }  // namespace VIO
@@ -1270,3 +1270,154 @@ TEST_F(TestTracker, mahalanobisDistance) {
           << "time2 (x'*O*x): " << time2 << '\n'
           << "time3 (manual): " << time3;
 }
+
+/* ************************************************************************* */
+TEST_F(TestTracker, featureDetectionAtProcessingScale) {
+  VioFrontEndParams tracker_params;
+  const cv::Mat cam_mask(ref_frame->img_.size(), CV_8UC1, cv::Scalar(255));
+  const int need_n_corners = 100;
+  Frame frame(id_ref, timestamp_ref, ref_frame->cam_param_, ref_frame->img_);
+
+  const auto corners_full_res = Tracker::featureDetection(
+      frame, tracker_params, cam_mask, need_n_corners);
+
+  const double processing_scale = 0.5;
+  cv::Mat processing_img;
+  cv::resize(frame.img_, processing_img, cv::Size(), processing_scale,
+             processing_scale, cv::INTER_AREA);
+  const auto corners_scaled =
+      Tracker::featureDetection(frame, tracker_params, cam_mask,
+                                need_n_corners, processing_img,
+                                processing_scale);
+  ASSERT_GT(corners_scaled.first.size(), 0u);
+  EXPECT_LE(corners_scaled.first.size(), size_t(need_n_corners));
+  EXPECT_EQ(corners_scaled.first.size(), corners_scaled.second.size());
+
+  // Corners are in full resolution pixel coordinates, and most of them are
+  // also found at full resolution.
+  size_t n_matched = 0u;
+  for (const KeypointCV& corner : corners_scaled.first) {
+    EXPECT_GE(corner.x, 0.0f);
+    EXPECT_GE(corner.y, 0.0f);
+    EXPECT_LT(corner.x, float(frame.img_.cols));
+    EXPECT_LT(corner.y, float(frame.img_.rows));
+    for (const KeypointCV& corner_full_res : corners_full_res.first) {
+      if (cv::norm(corner - corner_full_res) < 2.0) {
+        n_matched++;
+        break;
+      }
+    }
+  }
+  EXPECT_GT(n_matched, corners_scaled.first.size() / 2u);
+}
+
+/* ************************************************************************* */
+TEST_F(TestTracker, processingScaleCoordinates) {
+  // The first two pixels are averaged into the first one at half resolution.
+  const KeypointCV px(0.5f, 2.5f);
+  const KeypointCV px_scaled = Tracker::toProcessingScale(px, 0.5);
+  EXPECT_NEAR(px_scaled.x, 0.0, tol);
+  EXPECT_NEAR(px_scaled.y, 1.0, tol);
+  const KeypointCV px_back = Tracker::fromProcessingScale(px_scaled, 0.5);
+  EXPECT_NEAR(px_back.x, px.x, tol);
+  EXPECT_NEAR(px_back.y, px.y, tol);
+  // Identity at full resolution.
+  EXPECT_NEAR(Tracker::toProcessingScale(px, 1.0).x, px.x, tol);
+}
+
+/* ************************************************************************* */
+TEST_F(TestTracker, pruneTracks) {
+  VioFrontEndParams tracker_params;
+  tracker_params.track_max_stereo_failures_ = 2;
+  Tracker tracker(tracker_params);
+  ClearStereoFrame(cur_stereo_frame);
+  Frame* left_frame = cur_stereo_frame->getLeftFrameMutable();
+  left_frame->keypoints_ = {KeypointCV(10, 10), KeypointCV(20, 20),
+                            KeypointCV(30, 30), KeypointCV(40, 40)};
+  left_frame->landmarks_ = {1, 2, 3, -1};
+  cur_stereo_frame->right_keypoints_status_ = {
+      Kstatus::VALID, Kstatus::NO_DEPTH, Kstatus::NO_RIGHT_RECT,
+      Kstatus::NO_RIGHT_RECT};
+
+  // First stereo failure: nothing pruned.
+  EXPECT_EQ(tracker.pruneTracks(cur_stereo_frame), 0u);
+  EXPECT_EQ(left_frame->landmarks_, LandmarkIds({1, 2, 3, -1}));
+
+  // Landmark 3 recovers, landmark 2 fails again and is pruned.
+  cur_stereo_frame->right_keypoints_status_[2] = Kstatus::VALID;
+  EXPECT_EQ(tracker.pruneTracks(cur_stereo_frame), 1u);
+  EXPECT_EQ(left_frame->landmarks_, LandmarkIds({1, -1, 3, -1}));
+  EXPECT_EQ(tracker.getTrackerDebugInfo().nrPrunedStereoTracks_, 1u);
+
+  // Failures of landmark 3 are counted from scratch.
+  cur_stereo_frame->right_keypoints_status_[2] = Kstatus::FAILED_ARUN;
+  EXPECT_EQ(tracker.pruneTracks(cur_stereo_frame), 0u);
+  EXPECT_EQ(tracker.pruneTracks(cur_stereo_frame), 1u);
+  EXPECT_EQ(left_frame->landmarks_, LandmarkIds({1, -1, -1, -1}));
+
+  // Disabled.
+  Tracker tracker_no_pruning{VioFrontEndParams()};
+  cur_stereo_frame->right_keypoints_status_[0] = Kstatus::NO_DEPTH;
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(tracker_no_pruning.pruneTracks(cur_stereo_frame), 0u);
+  }
+  EXPECT_EQ(left_frame->landmarks_[0], 1);
+}
+
+/* ************************************************************************* */
+TEST_F(TestTracker, featureTrackingForwardBackwardCheck) {
+  VioFrontEndParams tracker_params;
+  const cv::Mat cam_mask(ref_frame->img_.size(), CV_8UC1, cv::Scalar(255));
+  Frame frame_ref(id_ref, timestamp_ref, ref_frame->cam_param_,
+                  ref_frame->img_);
+  const auto corners = Tracker::featureDetection(frame_ref, tracker_params,
+                                                 cam_mask, 200);
+  ASSERT_GT(corners.first.size(), 0u);
+  for (size_t i = 0; i < corners.first.size(); i++) {
+    frame_ref.keypoints_.push_back(corners.first[i]);
+    frame_ref.scores_.push_back(corners.second[i]);
+    frame_ref.landmarks_.push_back(i);
+    frame_ref.landmarksAge_.push_back(1);
+    frame_ref.versors_.push_back(
+        Frame::CalibratePixel(corners.first[i], frame_ref.cam_param_));
+  }
+
+  // Without the check.
+  Frame frame_ref_no_fb = frame_ref;
+  Frame frame_cur_no_fb(id_cur, timestamp_cur, cur_frame->cam_param_,
+                        cur_frame->img_);
+  Tracker tracker_no_fb(tracker_params);
+  tracker_no_fb.featureTracking(&frame_ref_no_fb, &frame_cur_no_fb);
+  EXPECT_EQ(tracker_no_fb.getTrackerDebugInfo().nrKltFbRejected_, 0u);
+
+  // With a check that accepts nothing.
+  tracker_params.klt_fb_check_ = true;
+  tracker_params.klt_fb_max_error_ = -1.0;
+  Frame frame_ref_fb_all = frame_ref;
+  Frame frame_cur_fb_all(id_cur, timestamp_cur, cur_frame->cam_param_,
+                         cur_frame->img_);
+  Tracker tracker_fb_all(tracker_params);
+  tracker_fb_all.featureTracking(&frame_ref_fb_all, &frame_cur_fb_all);
+  EXPECT_EQ(tracker_fb_all.getTrackerDebugInfo().nrKltFbRejected_,
+            frame_cur_no_fb.keypoints_.size());
+  EXPECT_EQ(frame_cur_fb_all.keypoints_.size(), 0u);
+
+  // With the check: only rejects tracks, and keeps the same keypoints for
+  // the others.
+  tracker_params.klt_fb_max_error_ = 0.5;
+  Frame frame_ref_fb = frame_ref;
+  Frame frame_cur_fb(id_cur, timestamp_cur, cur_frame->cam_param_,
+                     cur_frame->img_);
+  Tracker tracker_fb(tracker_params);
+  tracker_fb.featureTracking(&frame_ref_fb, &frame_cur_fb);
+  const size_t nr_rejected = tracker_fb.getTrackerDebugInfo().nrKltFbRejected_;
+  EXPECT_EQ(frame_cur_fb.keypoints_.size() + nr_rejected,
+            frame_cur_no_fb.keypoints_.size());
+  EXPECT_GT(frame_cur_fb.keypoints_.size(), 0u);
+  for (size_t i = 0, j = 0; i < frame_cur_fb.keypoints_.size(); i++) {
+    while (frame_cur_no_fb.landmarks_[j] != frame_cur_fb.landmarks_[i]) j++;
+    EXPECT_LT(cv::norm(frame_cur_no_fb.keypoints_[j] -
+                       frame_cur_fb.keypoints_[i]),
+              tol);
+  }
+}
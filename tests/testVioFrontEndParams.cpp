@@ -45,6 +45,10 @@ TEST(testTracker, TrackerParamParseYAML) {
   EXPECT_EQ(tp.klt_max_iter_, 30);
   EXPECT_EQ(tp.klt_max_level_, 2);
   EXPECT_EQ(tp.klt_eps_, 0.001);
+  EXPECT_EQ(tp.klt_fb_check_, true);
+  EXPECT_EQ(tp.klt_fb_max_error_, 0.5);
+  EXPECT_EQ(tp.track_max_klt_error_, 30.0);
+  EXPECT_EQ(tp.track_max_stereo_failures_, 3);
   EXPECT_EQ(tp.maxFeatureAge_, 10);
 
   EXPECT_EQ(tp.maxFeaturesPerFrame_, 200);
@@ -53,6 +57,9 @@ TEST(testTracker, TrackerParamParseYAML) {
   EXPECT_EQ(tp.block_size_, 3);
   EXPECT_EQ(tp.use_harris_detector_, 0);
   EXPECT_EQ(tp.k_, 0.04);
+  EXPECT_EQ(tp.processing_scale_, 0.5);
+  EXPECT_EQ(tp.feature_grid_rows_, 4);
+  EXPECT_EQ(tp.feature_grid_cols_, 5);
 
   EXPECT_EQ(tp.stereo_matching_params_.equalize_image_, true);
   EXPECT_EQ(tp.stereo_matching_params_.nominal_baseline_, 110);
@@ -72,6 +79,8 @@ TEST(testTracker, TrackerParamParseYAML) {
   EXPECT_EQ(tp.featureSelectionDefaultDepth_, 4);
   EXPECT_EQ(tp.featureSelectionCosineNeighborhood_, 0.9);
   EXPECT_EQ(tp.featureSelectionUseLazyEvaluation_, 0);
+  EXPECT_EQ(tp.featureSelectionNrThreads_, 2);
+  EXPECT_EQ(tp.featureSelectionTimeBudget_, 0.0);
   EXPECT_EQ(tp.useSuccessProbabilities_, 0);
 
   EXPECT_EQ(tp.useRANSAC_, false);